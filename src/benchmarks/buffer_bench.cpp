@@ -0,0 +1,437 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Multi-threaded throughput benchmark for BufMgr.
+ *
+ * Creates a set of files, then has a number of threads pin and unpin pages
+ * through one buffer manager following an access distribution, and reports
+ * throughput, the hit ratio from BufStats and per-operation latency
+ * percentiles.  Run with --help for the options.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "buffer.h"
+#include "exceptions/file_not_found_exception.h"
+#include "file.h"
+#include "page.h"
+
+using namespace badgerdb;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * Benchmark parameters, set from the command line.
+ */
+struct Options {
+  std::uint32_t frames = 1024;
+  int files = 4;
+  PageId pages = 1024;  // per file
+  int threads = 4;
+  long ops = 200000;  // per thread
+  std::string dist = "uniform";
+  double zipfTheta = 0.99;
+  double hotFraction = 0.1;
+  double hotProbability = 0.9;
+  double writeRatio = 0.0;
+  std::string dir = ".";
+  std::string policy = "clock";
+  BackgroundWriterConfig writer;
+  std::string durability = "buffered";
+  bool checksums = true;
+  bool compressed = false;
+  VictimCacheConfig victim;
+  std::uint32_t readAhead = 0;  // pages, scan only
+  std::string io = "uring";
+  IoEngineConfig ioConfig;
+};
+
+void usage(const char *prog) {
+  std::cout
+      << "usage: " << prog << " [options]\n"
+      << "  --frames N        buffer pool frames (1024)\n"
+      << "  --files N         number of files (4)\n"
+      << "  --pages N         pages per file (1024)\n"
+      << "  --threads N       worker threads (4)\n"
+      << "  --ops N           operations per thread (200000)\n"
+      << "  --dist D          uniform | zipf | scan | hotset (uniform)\n"
+      << "  --theta X         zipf skew (0.99)\n"
+      << "  --hot-fraction X  hotset: fraction of pages that are hot (0.1)\n"
+      << "  --hot-prob X      hotset: probability of a hot access (0.9)\n"
+      << "  --write-ratio X   fraction of accesses unpinned dirty (0)\n"
+      << "  --dir PATH        directory for the benchmark files (.)\n"
+      << "  --policy P        clock | 2q | clockpro (clock)\n"
+      << "  --writer 0|1      run the background writer (1)\n"
+      << "  --dirty-high X    dirty frame share starting the writer (0.25)\n"
+      << "  --dirty-low X     dirty frame share stopping it (0.10)\n"
+      << "  --durability D    buffered | sync | group (buffered)\n"
+      << "  --checksums 0|1   checksum pages written and read (1)\n"
+      << "  --compressed 0|1  store the files' pages compressed (0)\n"
+      << "  --victim-cache N  bytes of compressed pages behind the pool (0)\n"
+      << "  --read-ahead N    scan: prefetch the next N pages every N (0)\n"
+      << "  --io E            uring | threads, the async I/O engine (uring)\n"
+      << "  --queue-depth N   most asynchronous I/Os in flight (64)\n";
+}
+
+bool parseOptions(int argc, char **argv, Options &opts) {
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--help" || arg == "-h") return false;
+    if (i + 1 >= argc) {
+      std::cerr << "missing value for " << arg << "\n";
+      return false;
+    }
+    const char *value = argv[++i];
+    if (arg == "--frames") {
+      opts.frames = std::strtoul(value, NULL, 10);
+    } else if (arg == "--files") {
+      opts.files = std::atoi(value);
+    } else if (arg == "--pages") {
+      opts.pages = std::strtoul(value, NULL, 10);
+    } else if (arg == "--threads") {
+      opts.threads = std::atoi(value);
+    } else if (arg == "--ops") {
+      opts.ops = std::atol(value);
+    } else if (arg == "--dist") {
+      opts.dist = value;
+    } else if (arg == "--theta") {
+      opts.zipfTheta = std::atof(value);
+    } else if (arg == "--hot-fraction") {
+      opts.hotFraction = std::atof(value);
+    } else if (arg == "--hot-prob") {
+      opts.hotProbability = std::atof(value);
+    } else if (arg == "--write-ratio") {
+      opts.writeRatio = std::atof(value);
+    } else if (arg == "--dir") {
+      opts.dir = value;
+    } else if (arg == "--policy") {
+      opts.policy = value;
+    } else if (arg == "--writer") {
+      opts.writer.enabled = std::atoi(value) != 0;
+    } else if (arg == "--dirty-high") {
+      opts.writer.highWatermark = std::atof(value);
+    } else if (arg == "--dirty-low") {
+      opts.writer.lowWatermark = std::atof(value);
+    } else if (arg == "--durability") {
+      opts.durability = value;
+    } else if (arg == "--checksums") {
+      opts.checksums = std::atoi(value) != 0;
+    } else if (arg == "--compressed") {
+      opts.compressed = std::atoi(value) != 0;
+    } else if (arg == "--victim-cache") {
+      opts.victim.bytes = std::strtoull(value, NULL, 10);
+    } else if (arg == "--read-ahead") {
+      opts.readAhead = std::strtoul(value, NULL, 10);
+    } else if (arg == "--io") {
+      opts.io = value;
+    } else if (arg == "--queue-depth") {
+      opts.ioConfig.queueDepth = std::strtoul(value, NULL, 10);
+    } else {
+      std::cerr << "unknown option " << arg << "\n";
+      return false;
+    }
+  }
+  if (opts.dist != "uniform" && opts.dist != "zipf" && opts.dist != "scan" &&
+      opts.dist != "hotset") {
+    std::cerr << "unknown distribution " << opts.dist << "\n";
+    return false;
+  }
+  if (opts.io != "uring" && opts.io != "threads") {
+    std::cerr << "unknown I/O engine " << opts.io << "\n";
+    return false;
+  }
+  if (opts.policy != "clock" && opts.policy != "2q" &&
+      opts.policy != "clockpro") {
+    std::cerr << "unknown replacement policy " << opts.policy << "\n";
+    return false;
+  }
+  if (opts.durability != "buffered" && opts.durability != "sync" &&
+      opts.durability != "group") {
+    std::cerr << "unknown durability mode " << opts.durability << "\n";
+    return false;
+  }
+  return opts.frames > 0 && opts.files > 0 && opts.pages > 0 &&
+         opts.threads > 0 && opts.ops > 0;
+}
+
+/**
+ * Zipfian generator over [0, n) following Gray et al., "Quickly generating
+ * billion-record synthetic databases".  Item 0 is the most popular one.
+ */
+class ZipfGenerator {
+ public:
+  ZipfGenerator(std::uint64_t n, double theta) : n_(n), theta_(theta) {
+    zetan_ = zeta(n, theta);
+    const double zeta2 = zeta(2, theta);
+    alpha_ = 1.0 / (1.0 - theta);
+    eta_ = (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan_);
+  }
+
+  template <typename Rng>
+  std::uint64_t next(Rng &rng) const {
+    const double u = std::uniform_real_distribution<double>(0.0, 1.0)(rng);
+    const double uz = u * zetan_;
+    if (uz < 1.0) return 0;
+    if (uz < 1.0 + std::pow(0.5, theta_)) return 1;
+    const std::uint64_t v = static_cast<std::uint64_t>(
+        n_ * std::pow(eta_ * u - eta_ + 1.0, alpha_));
+    return std::min(v, n_ - 1);
+  }
+
+ private:
+  static double zeta(std::uint64_t n, double theta) {
+    double sum = 0;
+    for (std::uint64_t i = 1; i <= n; i++) sum += 1.0 / std::pow(i, theta);
+    return sum;
+  }
+
+  std::uint64_t n_;
+  double theta_;
+  double zetan_;
+  double alpha_;
+  double eta_;
+};
+
+/**
+ * Produces the sequence of global page indexes (file * pages + page) one
+ * worker thread accesses.
+ */
+class AccessGenerator {
+ public:
+  AccessGenerator(const Options &opts, const ZipfGenerator *zipf, int thread)
+      : opts_(opts),
+        total_(static_cast<std::uint64_t>(opts.files) * opts.pages),
+        zipf_(zipf),
+        rng_(12345 + thread),
+        // Scans start at staggered positions so threads do not run in
+        // lockstep over the same pages.
+        cursor_(total_ * thread / opts.threads) {}
+
+  std::uint64_t next() {
+    if (opts_.dist == "zipf") {
+      // Scatter popular items so they do not all sit in the first file.
+      return (zipf_->next(rng_) * 0x9E3779B97F4A7C15ULL) % total_;
+    }
+    if (opts_.dist == "scan") {
+      const std::uint64_t index = cursor_;
+      cursor_ = (cursor_ + 1) % total_;
+      return index;
+    }
+    if (opts_.dist == "hotset") {
+      const std::uint64_t hot = std::max<std::uint64_t>(
+          1, static_cast<std::uint64_t>(total_ * opts_.hotFraction));
+      if (uniform() < opts_.hotProbability || hot == total_) {
+        return rng_() % hot;
+      }
+      return hot + rng_() % (total_ - hot);
+    }
+    return rng_() % total_;
+  }
+
+  double uniform() {
+    return std::uniform_real_distribution<double>(0.0, 1.0)(rng_);
+  }
+
+ private:
+  const Options &opts_;
+  std::uint64_t total_;
+  const ZipfGenerator *zipf_;
+  std::mt19937_64 rng_;
+  std::uint64_t cursor_;
+};
+
+std::string benchFileName(const Options &opts, int i) {
+  return opts.dir + "/bench." + std::to_string(i) + ".db";
+}
+
+void removeIfExists(const std::string &name) {
+  try {
+    File::remove(name);
+  } catch (const FileNotFoundException &) {
+  }
+}
+
+/**
+ * Creates the benchmark files, each with opts.pages pages holding a single
+ * record, and pushes them to disk.
+ */
+std::vector<File> createFiles(const Options &opts, BufMgr &bufMgr) {
+  std::vector<File> files;
+  for (int i = 0; i < opts.files; i++) {
+    const std::string name = benchFileName(opts, i);
+    removeIfExists(name);
+    files.push_back(opts.compressed ? File::createCompressed(name)
+                                    : File::create(name));
+    if (opts.durability == "sync") {
+      files.back().setDurability(DurabilityMode::SYNC);
+    } else if (opts.durability == "group") {
+      files.back().setDurability(DurabilityMode::GROUP);
+    }
+    files.back().setChecksums(opts.checksums);
+
+    char record[64];
+    for (PageId n = 0; n < opts.pages; n++) {
+      PageId pageNo;
+      Page *page;
+      bufMgr.allocPage(files.back(), pageNo, page);
+      std::snprintf(record, sizeof(record), "bench.%d page %u", i, pageNo);
+      page->insertRecord(record);
+      bufMgr.unPinPage(files.back(), pageNo, true);
+    }
+    bufMgr.flushFile(files.back());
+  }
+  return files;
+}
+
+double percentile(const std::vector<std::uint32_t> &sorted, double p) {
+  if (sorted.empty()) return 0;
+  const std::size_t index = std::min(
+      sorted.size() - 1, static_cast<std::size_t>(p / 100.0 * sorted.size()));
+  return sorted[index] / 1000.0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opts;
+  if (!parseOptions(argc, argv, opts)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  ReplacementPolicyType policy = ReplacementPolicyType::CLOCK;
+  if (opts.policy == "2q") policy = ReplacementPolicyType::TWO_QUEUE;
+  if (opts.policy == "clockpro") policy = ReplacementPolicyType::CLOCK_PRO;
+
+  if (opts.io == "threads") opts.ioConfig.type = IoEngineType::THREAD_POOL;
+
+  std::unique_ptr<BufMgr> bufMgr(
+      new BufMgr(opts.frames, policy, opts.writer, opts.ioConfig,
+                 AllocConfig(), NumaConfig(), opts.victim));
+  std::vector<File> files = createFiles(opts, *bufMgr);
+
+  std::unique_ptr<ZipfGenerator> zipf;
+  if (opts.dist == "zipf") {
+    zipf.reset(new ZipfGenerator(
+        static_cast<std::uint64_t>(opts.files) * opts.pages, opts.zipfTheta));
+  }
+
+  bufMgr->clearBufStats();
+
+  // Latencies are kept per thread in nanoseconds and merged afterwards.
+  std::vector<std::vector<std::uint32_t>> latencies(opts.threads);
+  std::vector<std::thread> workers;
+  const Clock::time_point start = Clock::now();
+  for (int t = 0; t < opts.threads; t++) {
+    workers.emplace_back([&, t]() {
+      AccessGenerator gen(opts, zipf.get(), t);
+      std::vector<std::uint32_t> &lat = latencies[t];
+      lat.reserve(opts.ops);
+      for (long n = 0; n < opts.ops; n++) {
+        const std::uint64_t index = gen.next();
+        File &file = files[index / opts.pages];
+        const PageId pageNo = index % opts.pages + 1;
+        const bool dirty =
+            opts.writeRatio > 0 && gen.uniform() < opts.writeRatio;
+
+        const Clock::time_point begin = Clock::now();
+        if (opts.readAhead > 0 && opts.dist == "scan" &&
+            (pageNo - 1) % opts.readAhead == 0) {
+          std::vector<PageId> ahead;
+          for (PageId next = pageNo + opts.readAhead;
+               next < pageNo + 2 * opts.readAhead && next <= opts.pages;
+               next++) {
+            ahead.push_back(next);
+          }
+          bufMgr->prefetch(file, ahead.data(), ahead.size());
+        }
+        Page *page;
+        bufMgr->readPage(file, pageNo, page);
+        bufMgr->unPinPage(file, pageNo, dirty);
+        const Clock::time_point end = Clock::now();
+
+        lat.push_back(static_cast<std::uint32_t>(std::min<long long>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin)
+                .count(),
+            UINT32_MAX)));
+      }
+    });
+  }
+  for (auto &worker : workers) worker.join();
+  const double seconds =
+      std::chrono::duration<double>(Clock::now() - start).count();
+
+  std::vector<std::uint32_t> all;
+  for (const auto &lat : latencies) {
+    all.insert(all.end(), lat.begin(), lat.end());
+  }
+  std::sort(all.begin(), all.end());
+
+  const BufStats stats = bufMgr->getBufStats();
+  const double accesses = stats.accesses;
+  const double hitRatio = accesses > 0 ? 1.0 - stats.diskreads / accesses : 0;
+
+  std::printf("frames:        %u\n", opts.frames);
+  std::printf("files:         %d x %u pages\n", opts.files, opts.pages);
+  std::printf("threads:       %d\n", opts.threads);
+  std::printf("distribution:  %s\n", opts.dist.c_str());
+  std::printf("policy:        %s\n", bufMgr->policyName());
+  std::printf("durability:    %s\n", opts.durability.c_str());
+  std::printf("checksums:     %s\n", opts.checksums ? "on" : "off");
+  std::printf("compressed:    %s\n", opts.compressed ? "yes" : "no");
+  std::printf("io_engine:     %s\n", bufMgr->ioEngineName());
+  std::printf("operations:    %zu\n", all.size());
+  std::printf("elapsed_s:     %.3f\n", seconds);
+  std::printf("ops_per_sec:   %.0f\n", all.size() / seconds);
+  std::printf("hit_ratio:     %.4f\n", hitRatio);
+  std::printf("disk_reads:    %d\n", static_cast<int>(stats.diskreads));
+  std::printf("disk_writes:   %d\n", static_cast<int>(stats.diskwrites));
+  std::printf("bg_writes:     %d\n", static_cast<int>(stats.backgroundwrites));
+  std::printf("prefetched:    %d\n", static_cast<int>(stats.prefetchreads));
+  std::printf("victim_cache:  %d hits  %d puts\n",
+              static_cast<int>(stats.victimhits),
+              static_cast<int>(stats.victimputs));
+  std::printf("evictions:     %d clean  %d dirty\n",
+              static_cast<int>(stats.cleanevictions),
+              static_cast<int>(stats.dirtyevictions));
+  std::printf("sweep_steps:   %.2f per victim\n", stats.sweepStepsPerVictim());
+  std::printf("capped_sweeps: %d\n", static_cast<int>(stats.cappedsweeps));
+  std::printf("pin_waits:     %d\n", static_cast<int>(stats.pinwaits));
+  std::printf("read_io_us:    p50 %.2f  p99 %.2f\n",
+              stats.readlatency.percentile(50) / 1000.0,
+              stats.readlatency.percentile(99) / 1000.0);
+  std::printf("write_io_us:   p50 %.2f  p99 %.2f\n",
+              stats.writelatency.percentile(50) / 1000.0,
+              stats.writelatency.percentile(99) / 1000.0);
+  std::printf(
+      "latency_us:    p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  max %.2f\n",
+      percentile(all, 50), percentile(all, 90), percentile(all, 99),
+      percentile(all, 99.9), all.empty() ? 0 : all.back() / 1000.0);
+
+  // Drop the pool before the files so nothing is left open.
+  for (auto &file : files) bufMgr->flushFile(file);
+  bufMgr.reset();
+  files.clear();
+  for (int i = 0; i < opts.files; i++) removeIfExists(benchFileName(opts, i));
+  return 0;
+}
@@ -0,0 +1,471 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+/**
+ * Single-threaded microbenchmarks of the hot paths below the buffer pool:
+ * record operations on a Page across record sizes and fill factors, File
+ * page allocation as the file grows, full scans with FileIterator, and
+ * BufHashTbl at several load factors.
+ *
+ * Every benchmark does a fixed amount of work from fixed seeds and is run a
+ * number of times, of which the fastest run is reported, so that runs on the
+ * same machine can be compared to catch regressions.  Allocations are counted
+ * by replacing the global operator new, and only setup is left out of both
+ * the time and the counts.  Run with --help for the options.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bufHashTbl.h"
+#include "exceptions/file_not_found_exception.h"
+#include "file.h"
+#include "file_iterator.h"
+#include "page.h"
+#include "page_iterator.h"
+
+using namespace badgerdb;
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * Number and bytes of the allocations made through operator new.
+ */
+std::atomic<std::uint64_t> allocationCount(0);
+std::atomic<std::uint64_t> allocationBytes(0);
+
+}  // namespace
+
+void *operator new(std::size_t size) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  allocationBytes.fetch_add(size, std::memory_order_relaxed);
+  void *memory = std::malloc(size != 0 ? size : 1);
+  if (memory == NULL) throw std::bad_alloc();
+  return memory;
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+
+void operator delete(void *memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+namespace {
+
+/**
+ * Benchmark parameters, set from the command line.
+ */
+struct Options {
+  int repeat = 5;
+  long ops = 200000;         // per page and hash table benchmark
+  PageId filePages = 16384;  // pages allocated and scanned by the file ones
+  std::string dir = ".";
+  std::string filter;
+};
+
+void usage(const char *prog) {
+  std::cout
+      << "usage: " << prog << " [options]\n"
+      << "  --repeat N        runs of each benchmark, the fastest counts (5)\n"
+      << "  --ops N           operations per page and hash table run (200000)\n"
+      << "  --file-pages N    pages the file benchmarks grow to (16384)\n"
+      << "  --dir PATH        directory for the benchmark file (.)\n"
+      << "  --filter S        only run benchmarks whose name contains S\n";
+}
+
+bool parseOptions(int argc, char **argv, Options &opts) {
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--help" || arg == "-h") return false;
+    if (i + 1 >= argc) {
+      std::cerr << "missing value for " << arg << "\n";
+      return false;
+    }
+    const char *value = argv[++i];
+    if (arg == "--repeat") {
+      opts.repeat = std::atoi(value);
+    } else if (arg == "--ops") {
+      opts.ops = std::atol(value);
+    } else if (arg == "--file-pages") {
+      opts.filePages = std::strtoul(value, NULL, 10);
+    } else if (arg == "--dir") {
+      opts.dir = value;
+    } else if (arg == "--filter") {
+      opts.filter = value;
+    } else {
+      std::cerr << "unknown option " << arg << "\n";
+      return false;
+    }
+  }
+  return opts.repeat > 0 && opts.ops > 0 && opts.filePages >= 16;
+}
+
+/**
+ * Time and allocations of the measured parts of one run.  A run brackets
+ * what it measures with start() and stop(), which may be called many times.
+ */
+class Timer {
+ public:
+  void start() {
+    startAllocations_ = allocationCount.load(std::memory_order_relaxed);
+    startBytes_ = allocationBytes.load(std::memory_order_relaxed);
+    startTime_ = Clock::now();
+  }
+
+  void stop() {
+    elapsed_ += Clock::now() - startTime_;
+    allocations_ +=
+        allocationCount.load(std::memory_order_relaxed) - startAllocations_;
+    bytes_ += allocationBytes.load(std::memory_order_relaxed) - startBytes_;
+  }
+
+  Clock::duration elapsed() const { return elapsed_; }
+  std::uint64_t allocations() const { return allocations_; }
+  std::uint64_t bytes() const { return bytes_; }
+
+ private:
+  Clock::time_point startTime_;
+  std::uint64_t startAllocations_ = 0;
+  std::uint64_t startBytes_ = 0;
+  Clock::duration elapsed_ = Clock::duration::zero();
+  std::uint64_t allocations_ = 0;
+  std::uint64_t bytes_ = 0;
+};
+
+/**
+ * Runs a benchmark opts.repeat times and prints its fastest run.  <run> does
+ * the work, timing it with the Timer it is given, and returns the number of
+ * operations it timed.
+ */
+template <typename Run>
+void measure(const Options &opts, const std::string &name, Run run) {
+  if (name.find(opts.filter) == std::string::npos) return;
+  double best = 0;
+  Timer fastest;
+  std::uint64_t ops = 0;
+  for (int r = 0; r < opts.repeat; r++) {
+    Timer timer;
+    ops = run(timer);
+    const double ns =
+        std::chrono::duration<double, std::nano>(timer.elapsed()).count() /
+        std::max<std::uint64_t>(ops, 1);
+    if (r == 0 || ns < best) {
+      best = ns;
+      fastest = timer;
+    }
+  }
+  const double per_op = 1.0 / std::max<std::uint64_t>(ops, 1);
+  std::printf("%-36s %10.1f %10.2f %10.1f %10llu\n", name.c_str(), best,
+              fastest.allocations() * per_op, fastest.bytes() * per_op,
+              static_cast<unsigned long long>(ops));
+}
+
+/**
+ * Returns a record of <size> bytes, different for different seeds.
+ */
+std::string makeRecord(const std::size_t size, const std::uint32_t seed) {
+  std::string record(size, 'a');
+  for (std::size_t i = 0; i < size; i++) {
+    record[i] = static_cast<char>('a' + (seed + i * 7) % 26);
+  }
+  return record;
+}
+
+/**
+ * Fills a fresh page with records of <size> bytes to at least <fill> of its
+ * data space, returning their ids.
+ */
+std::vector<RecordId> fillPage(Page &page, const std::size_t size,
+                               const double fill) {
+  std::vector<RecordId> rids;
+  const std::string record = makeRecord(size, 0);
+  while (page.getFreeSpace() > (1.0 - fill) * Page::DATA_SIZE &&
+         page.hasSpaceForRecord(record)) {
+    rids.push_back(page.insertRecord(record));
+  }
+  return rids;
+}
+
+/**
+ * Returns <count> indexes into a vector of <size> elements, from a fixed
+ * seed.
+ */
+std::vector<std::size_t> randomIndexes(const long count,
+                                       const std::size_t size) {
+  std::mt19937 rng(12345);
+  std::vector<std::size_t> indexes(count);
+  for (std::size_t &index : indexes) index = rng() % size;
+  return indexes;
+}
+
+void pageBenchmarks(const Options &opts) {
+  const std::size_t sizes[] = {16, 64, 256, 1024};
+  const double fills[] = {0.5, 0.9};
+  for (const std::size_t size : sizes) {
+    const std::string suffix = "/" + std::to_string(size);
+    const std::string record = makeRecord(size, 1);
+    const RecordView view(record);
+
+    measure(opts, "page.insert" + suffix, [&](Timer &timer) {
+      std::uint64_t ops = 0;
+      while (ops < static_cast<std::uint64_t>(opts.ops)) {
+        Page page;
+        timer.start();
+        while (page.hasSpaceForRecord(view)) {
+          page.insertRecord(view);
+          ops++;
+        }
+        timer.stop();
+      }
+      return ops;
+    });
+
+    for (const double fill : fills) {
+      const std::string name =
+          suffix + "/fill" + std::to_string(static_cast<int>(fill * 100));
+      Page filled;
+      const std::vector<RecordId> rids = fillPage(filled, size, fill);
+      if (rids.empty()) continue;
+      const std::vector<std::size_t> picks =
+          randomIndexes(opts.ops, rids.size());
+
+      measure(opts, "page.get" + name, [&](Timer &timer) {
+        std::size_t bytes = 0;
+        timer.start();
+        for (const std::size_t pick : picks) {
+          bytes += filled.getRecord(rids[pick]).size();
+        }
+        timer.stop();
+        if (bytes == 0) std::abort();
+        return picks.size();
+      });
+
+      measure(opts, "page.get_view" + name, [&](Timer &timer) {
+        std::size_t bytes = 0;
+        timer.start();
+        for (const std::size_t pick : picks) {
+          bytes += filled.getRecordView(rids[pick]).length;
+        }
+        timer.stop();
+        if (bytes == 0) std::abort();
+        return picks.size();
+      });
+
+      measure(opts, "page.update" + name, [&](Timer &timer) {
+        Page page(filled);
+        timer.start();
+        for (const std::size_t pick : picks) {
+          page.updateRecord(rids[pick], view);
+        }
+        timer.stop();
+        return picks.size();
+      });
+
+      // Records alternate between their size and half of it, leaving holes
+      // for compaction to squeeze out.
+      const RecordView half(record.data(), size / 2);
+      measure(opts, "page.update_resize" + name, [&](Timer &timer) {
+        Page page(filled);
+        std::vector<bool> shrunk(rids.size(), false);
+        timer.start();
+        for (const std::size_t pick : picks) {
+          page.updateRecord(rids[pick], shrunk[pick] ? view : half);
+          shrunk[pick] = !shrunk[pick];
+        }
+        timer.stop();
+        return picks.size();
+      });
+
+      // A record is deleted and another inserted, so the fill stays put.
+      measure(opts, "page.delete_insert" + name, [&](Timer &timer) {
+        Page page(filled);
+        std::vector<RecordId> live(rids);
+        timer.start();
+        for (const std::size_t pick : picks) {
+          page.deleteRecord(live[pick]);
+          live[pick] = page.insertRecord(view);
+        }
+        timer.stop();
+        return picks.size();
+      });
+    }
+  }
+}
+
+void removeIfExists(const std::string &name) {
+  try {
+    File::remove(name);
+  } catch (const FileNotFoundException &) {
+  }
+}
+
+void fileBenchmarks(const Options &opts) {
+  const std::string name = opts.dir + "/microbench.db";
+  const std::string record = makeRecord(64, 2);
+
+  // Allocation is timed separately as the file goes through each band of
+  // sizes, a sixteenth, a quarter and all of opts.filePages.
+  const PageId bands[] = {0, opts.filePages / 16, opts.filePages / 4,
+                          opts.filePages};
+  for (int band = 0; band < 3; band++) {
+    measure(opts,
+            "file.allocate/" + std::to_string(bands[band]) + "-" +
+                std::to_string(bands[band + 1]),
+            [&](Timer &timer) {
+              removeIfExists(name);
+              File file = File::create(name);
+              Page page;
+              for (PageId n = 0; n < bands[band]; n++) file.allocatePage(page);
+              timer.start();
+              for (PageId n = bands[band]; n < bands[band + 1]; n++) {
+                file.allocatePage(page);
+              }
+              timer.stop();
+              return bands[band + 1] - bands[band];
+            });
+  }
+
+  // A file of opts.filePages pages of a few records, for the scans
+  removeIfExists(name);
+  {
+    File file = File::create(name);
+    for (PageId n = 0; n < opts.filePages; n++) {
+      Page page = file.allocatePage();
+      for (int r = 0; r < 8; r++) page.insertRecord(record);
+      file.writePage(page);
+    }
+  }
+
+  const auto scan = [&](File &file, Timer &timer) {
+    std::uint64_t pages = 0;
+    std::size_t records = 0;
+    timer.start();
+    for (FileIterator iter = file.begin(); iter != file.end(); ++iter) {
+      Page page = *iter;
+      records += page.begin() != page.end();
+      pages++;
+    }
+    timer.stop();
+    if (records != pages) std::abort();
+    return pages;
+  };
+  // What the buffer pool pays for the File kept with every frame
+  measure(opts, "file.copy", [&](Timer &timer) {
+    File file = File::open(name);
+    File copies[16];
+    timer.start();
+    for (long n = 0; n < opts.ops; n++) copies[n % 16] = file;
+    timer.stop();
+    return opts.ops;
+  });
+  measure(opts, "file.scan", [&](Timer &timer) {
+    File file = File::open(name);
+    return scan(file, timer);
+  });
+  measure(opts, "file.scan_mapped", [&](Timer &timer) {
+    File file = File::openMapped(name, AccessPattern::SEQUENTIAL);
+    return scan(file, timer);
+  });
+  removeIfExists(name);
+}
+
+void hashTableBenchmarks(const Options &opts) {
+  const std::string name = opts.dir + "/microbench.db";
+  removeIfExists(name);
+  File file = File::create(name);
+  const double loads[] = {0.125, 0.25, 0.5};
+  for (const double load : loads) {
+    BufHashTbl table(32768);
+    const int buckets = table.buckets();
+    const int entries = static_cast<int>(buckets * load);
+    // Multiplying by an odd constant scatters the keys without repeats.
+    std::vector<PageId> keys(2 * entries);
+    for (int i = 0; i < 2 * entries; i++) keys[i] = i * 2654435761u;
+    for (int i = 0; i < entries; i++) table.insert(file, keys[i], i);
+    const std::vector<std::size_t> picks = randomIndexes(opts.ops, entries);
+    const std::string suffix =
+        "/load" + std::to_string(static_cast<int>(load * 1000));
+
+    measure(opts, "hashtbl.lookup" + suffix, [&](Timer &timer) {
+      FrameId frame;
+      std::uint64_t sum = 0;
+      timer.start();
+      for (const std::size_t pick : picks) {
+        table.lookup(file, keys[pick], frame);
+        sum += frame;
+      }
+      timer.stop();
+      if (sum == 0 && entries > 1) std::abort();
+      return picks.size();
+    });
+
+    measure(opts, "hashtbl.lookup_miss" + suffix, [&](Timer &timer) {
+      FrameId frame;
+      std::size_t found = 0;
+      timer.start();
+      for (const std::size_t pick : picks) {
+        found += table.tryLookup(file, keys[entries + pick], frame);
+      }
+      timer.stop();
+      if (found != 0) std::abort();
+      return picks.size();
+    });
+
+    // The table keeps its load: each remove is followed by an insert, of
+    // the key just removed as often as of one not there before.
+    measure(opts, "hashtbl.remove_insert" + suffix, [&](Timer &timer) {
+      std::vector<PageId> present(keys.begin(), keys.begin() + entries);
+      std::vector<PageId> absent(keys.begin() + entries, keys.end());
+      std::size_t next = 0;
+      timer.start();
+      for (const std::size_t pick : picks) {
+        table.remove(file, present[pick]);
+        if (pick % 2 == 0) {
+          std::swap(present[pick], absent[next]);
+          next = (next + 1) % absent.size();
+        }
+        table.insert(file, present[pick], static_cast<FrameId>(pick));
+      }
+      timer.stop();
+      // back to the state the other runs start from
+      for (const PageId key : present) table.remove(file, key);
+      for (int i = 0; i < entries; i++) table.insert(file, keys[i], i);
+      return picks.size();
+    });
+  }
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opts;
+  if (!parseOptions(argc, argv, opts)) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  std::printf("page_size:    %zu\n", Page::SIZE);
+  std::printf("repeat:       %d, fastest run reported\n", opts.repeat);
+  std::printf("%-36s %10s %10s %10s %10s\n", "benchmark", "ns/op",
+              "allocs/op", "bytes/op", "ops");
+  pageBenchmarks(opts);
+  fileBenchmarks(opts);
+  hashTableBenchmarks(opts);
+  return 0;
+}
@@ -8,9 +8,8 @@
 
 #include "bufHashTbl.h"
 
-#include <functional>
+#include <algorithm>
 #include <iostream>
-#include <memory>
 
 #include "buffer.h"
 #include "exceptions/hash_already_present_exception.h"
@@ -19,74 +18,132 @@
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File& file, const PageId pageNo) {
-  auto hash =
-      std::hash<std::string>{}(file.filename()) ^ std::hash<PageId>{}(pageNo);
-  return hash % HTSIZE;
+/**
+ * Returns the smallest power of two that is at least twice the requested
+ * size, so a table filled with one entry per frame stays under half full.
+ */
+static int tableSize(const int htSize) {
+  int size = 1;
+  while (size < 2 * htSize) size <<= 1;
+  return size;
+}
+
+int BufHashTbl::hash(const FileId fileId, const PageId pageNo) const {
+  const std::uint64_t key = (static_cast<std::uint64_t>(fileId) << 32) | pageNo;
+  const std::uint64_t hash = key * 0x9E3779B97F4A7C15ULL;
+  return static_cast<int>(hash >> 32) & (HTSIZE - 1);
 }
 
-BufHashTbl::BufHashTbl(int htSize) : HTSIZE(htSize), ht(htSize) {
-  // allocate an array of pointers to hashBuckets
+BufHashTbl::BufHashTbl(int htSize)
+    : HTSIZE(tableSize(htSize)), ht(HTSIZE, hashBucket{0, 0, 0}), count(0) {}
+
+int BufHashTbl::find(const FileId fileId, const PageId pageNo) const {
+  int index = hash(fileId, pageNo);
+  while (ht[index].fileId != 0) {
+    if (ht[index].fileId == fileId && ht[index].pageNo == pageNo) return index;
+    index = (index + 1) & (HTSIZE - 1);
+  }
+  return -1;
+}
+
+void BufHashTbl::rebuild(const int buckets) {
+  std::vector<hashBucket> old(buckets, hashBucket{0, 0, 0});
+  old.swap(ht);
+  HTSIZE = buckets;
+
+  for (const hashBucket& bucket : old) {
+    if (bucket.fileId == 0) continue;
+    int index = hash(bucket.fileId, bucket.pageNo);
+    while (ht[index].fileId != 0) index = (index + 1) & (HTSIZE - 1);
+    ht[index] = bucket;
+  }
 }
 
 void BufHashTbl::insert(const File& file, const PageId pageNo,
                         const FrameId frameNo) {
-  int index = hash(file, pageNo);
-
-  std::shared_ptr<hashBucket> tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-      throw HashAlreadyPresentException(tmpBuc->file.filename(), tmpBuc->pageNo,
-                                        tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
+  const FileId fileId = file.id();
+  int index = hash(fileId, pageNo);
+
+  for (int probes = 0; probes < HTSIZE; ++probes) {
+    hashBucket& bucket = ht[index];
+    if (bucket.fileId == 0) {
+      if (2 * (count + 1) > HTSIZE) {
+        // Not a duplicate; make room and probe again in the larger table.
+        grow();
+        insert(file, pageNo, frameNo);
+        return;
+      }
+      bucket.fileId = fileId;
+      bucket.pageNo = pageNo;
+      bucket.frameNo = frameNo;
+      ++count;
+      return;
+    }
+    if (bucket.fileId == fileId && bucket.pageNo == pageNo)
+      throw HashAlreadyPresentException(file.filename(), bucket.pageNo,
+                                        bucket.frameNo);
+    index = (index + 1) & (HTSIZE - 1);
   }
 
-  tmpBuc = std::make_shared<hashBucket>();
-  if (!tmpBuc) throw HashTableException();
-
-  tmpBuc->file = file;
-  tmpBuc->pageNo = pageNo;
-  tmpBuc->frameNo = frameNo;
-  tmpBuc->next = ht[index];
-  ht[index] = tmpBuc;
+  // every bucket is taken
+  throw HashTableException();
 }
 
 void BufHashTbl::lookup(const File& file, const PageId pageNo,
                         FrameId& frameNo) {
-  int index = hash(file, pageNo);
-  std::shared_ptr<hashBucket> tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
-      frameNo = tmpBuc->frameNo;  // return frameNo by reference
-      return;
-    }
-    tmpBuc = tmpBuc->next;
+  if (!tryLookup(file, pageNo, frameNo)) {
+    throw HashNotFoundException(file.filename(), pageNo);
   }
+}
+
+bool BufHashTbl::tryLookup(const File& file, const PageId pageNo,
+                           FrameId& frameNo) {
+  const int index = find(file.id(), pageNo);
+  if (index < 0) return false;
 
-  throw HashNotFoundException(file.filename(), pageNo);
+  frameNo = ht[index].frameNo;  // return frameNo by reference
+  return true;
 }
 
 void BufHashTbl::remove(const File& file, const PageId pageNo) {
-  int index = hash(file, pageNo);
-  std::shared_ptr<hashBucket> tmpBuc = ht[index];
-  std::shared_ptr<hashBucket> prevBuc;
-
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
-      if (prevBuc)
-        prevBuc->next = tmpBuc->next;
-      else
-        ht[index] = tmpBuc->next;
-
-      tmpBuc.reset();
-      return;
-    } else {
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
+  int hole = find(file.id(), pageNo);
+  if (hole < 0) throw HashNotFoundException(file.filename(), pageNo);
+
+  // Shift later entries of the probe run into the hole whenever the hole
+  // lies on their path from their home bucket, so lookups never stop early.
+  int index = hole;
+  for (;;) {
+    index = (index + 1) & (HTSIZE - 1);
+    const hashBucket& bucket = ht[index];
+    if (bucket.fileId == 0) break;
+
+    const int home = hash(bucket.fileId, bucket.pageNo);
+    if (((index - home) & (HTSIZE - 1)) >= ((index - hole) & (HTSIZE - 1))) {
+      ht[hole] = bucket;
+      hole = index;
     }
   }
+  ht[hole].fileId = 0;
+  --count;
+}
 
-  throw HashNotFoundException(file.filename(), pageNo);
+void BufHashTbl::fit(const int htSize) {
+  const int buckets = tableSize(std::max(htSize, count));
+  if (buckets != HTSIZE) rebuild(buckets);
+}
+
+void BufHashTbl::probeLengths(std::uint64_t& total,
+                              std::uint32_t& longest) const {
+  total = 0;
+  longest = 0;
+  for (int index = 0; index < HTSIZE; ++index) {
+    const hashBucket& bucket = ht[index];
+    if (bucket.fileId == 0) continue;
+    const std::uint32_t length =
+        ((index - hash(bucket.fileId, bucket.pageNo)) & (HTSIZE - 1)) + 1;
+    total += length;
+    if (length > longest) longest = length;
+  }
 }
 
 }  // namespace badgerdb
@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include "file.h"
@@ -16,12 +17,15 @@ namespace badgerdb {
 
 /**
  * @brief Declarations for buffer pool hash table
+ *
+ * Buckets live directly in the table array; an empty bucket has a zero
+ * fileId.
  */
 struct hashBucket {
   /**
-   * pointer a file object (more on this below)
+   * identifier of the file the page belongs to
    */
-  File file;
+  FileId fileId;
 
   /**
    * page number within a file
@@ -32,37 +36,65 @@ struct hashBucket {
    * frame number of page in the buffer pool
    */
   FrameId frameNo;
-
-  /**
-   * Next node in the hash table
-   */
-  std::shared_ptr<hashBucket> next;
 };
 
 /**
  * @brief Hash table class to keep track of pages in the buffer pool
  *
+ * The table uses open addressing with linear probing over a single
+ * power-of-two sized array, so lookup and remove never allocate.
+ * Removal shifts the following entries of the probe run back instead of
+ * leaving tombstones.  The array is sized for the expected number of entries
+ * up front and only doubles if an insert would take it over half full, so
+ * in steady state insert does not allocate either.
+ *
  * @warning This class is not threadsafe.
  */
 class BufHashTbl {
  private:
   /**
-   *	Size of Hash Table
+   *	Size of Hash Table (number of buckets, always a power of two)
    */
   int HTSIZE;
   /**
    * Actual Hash table object
    */
-  std::vector<std::shared_ptr<hashBucket>> ht;
+  std::vector<hashBucket> ht;
+
+  /**
+   * Number of entries in the table
+   */
+  int count;
 
   /**
    * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
    *
-   * @param file   	File object
+   * @param fileId  Identifier of the file
    * @param pageNo  Page number in the file
    * @return  			Hash value.
    */
-  int hash(const File& file, const PageId pageNo);
+  int hash(const FileId fileId, const PageId pageNo) const;
+
+  /**
+   * Returns the index of the bucket holding (fileId, pageNo), or -1 if the
+   * entry is not present.
+   *
+   * @param fileId  Identifier of the file
+   * @param pageNo  Page number in the file
+   * @return  			Bucket index or -1.
+   */
+  int find(const FileId fileId, const PageId pageNo) const;
+
+  /**
+   * Doubles the number of buckets and re-inserts every entry.
+   */
+  void grow() { rebuild(2 * HTSIZE); }
+
+  /**
+   * Re-inserts every entry into a table of the given number of buckets, a
+   * power of two.
+   */
+  void rebuild(const int buckets);
 
  public:
   /**
@@ -95,6 +127,18 @@ class BufHashTbl {
    */
   void lookup(const File& file, const PageId pageNo, FrameId& frameNo);
 
+  /**
+   * Check if (file, pageNo) is currently in the buffer pool (ie. in
+   * the hash table) without throwing when it is not.  Misses are the common
+   * case on the buffer pool read path, so it uses this variant.
+   *
+   * @param file  	File object
+   * @param pageNo	Page number in the file
+   * @param frameNo Frame number reference, only set if the entry is found
+   * @return  True if the page entry is present in the hash table
+   */
+  bool tryLookup(const File& file, const PageId pageNo, FrameId& frameNo);
+
   /**
    * Delete entry (file,pageNo) from hash table.
    *
@@ -104,6 +148,34 @@ class BufHashTbl {
    * table
    */
   void remove(const File& file, const PageId pageNo);
+
+  /**
+   * Returns the number of entries in the table.
+   */
+  int size() const { return count; }
+
+  /**
+   * Returns the number of buckets in the table.
+   */
+  int buckets() const { return HTSIZE; }
+
+  /**
+   * Measures the probe runs in one pass over the table.  The probe length of
+   * an entry is the number of buckets a lookup of it looks at, one for an
+   * entry in its home bucket.
+   *
+   * @param total   Set to the sum of the probe lengths of all entries
+   * @param longest Set to the longest probe length, zero if the table is empty
+   */
+  void probeLengths(std::uint64_t& total, std::uint32_t& longest) const;
+
+  /**
+   * Resizes the table as the constructor would for the given size, but never
+   * so small that the entries it holds fill more than half of it.
+   *
+   * @param htSize  Number of entries the table is to be sized for
+   */
+  void fit(const int htSize);
 };
 
 }  // namespace badgerdb
@@ -8,19 +8,41 @@
 
 #include "buffer.h"
 
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
 #include <iostream>
+#include <limits>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
-#include "exceptions/bad_buffer_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
-#include "exceptions/hash_not_found_exception.h"
+#include "exceptions/file_io_exception.h"
+#include "exceptions/invalid_page_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
+#include "numa.h"
 
 namespace badgerdb {
 
 constexpr int HASHTABLE_SZ(int bufs) { return ((int)(bufs * 1.2) & -2) + 1; }
 
+/**
+ * Returns the number of page table shards for a pool of the given size: a
+ * power of two, at most 64 and leaving each shard around 16 frames or more.
+ */
+static std::uint32_t numShardsFor(const std::uint32_t bufs) {
+  std::uint32_t shards = 1;
+  while (shards < 64 && shards * 32 <= bufs) shards <<= 1;
+  return shards;
+}
+
 //----------------------------------------
 // Constructor of the class BufMgr
 //----------------------------------------
@@ -28,83 +50,881 @@ constexpr int HASHTABLE_SZ(int bufs) { return ((int)(bufs * 1.2) & -2) + 1; }
 /**
  * Constructor of BufMgr class
  */
-BufMgr::BufMgr(std::uint32_t bufs)
+BufMgr::BufMgr(std::uint32_t bufs, ReplacementPolicyType policyType,
+               const BackgroundWriterConfig& writer,
+               const IoEngineConfig& ioConfig, const AllocConfig& alloc,
+               const NumaConfig& numa, const VictimCacheConfig& victim)
     : numBufs(bufs),
-      hashTable(HASHTABLE_SZ(bufs)),
-      bufDescTable(bufs),
-      bufPool(bufs) {
+      maxBufs(std::max(bufs, alloc.maxFrames)),
+      shardMask(numShardsFor(maxBufs) - 1),
+      bufDescTable(maxBufs),
+      freeListed(maxBufs, false),
+      scanRingSize(std::min(alloc.scanRingFrames, bufs / 8)),
+      scanRingNext(0),
+      arena(maxBufs, Page::SIZE),
+      partitionedPolicy(NULL),
+      placement(numa.placement),
+      numaNodes(numaNodeCount()),
+      wal(NULL),
+      nextPlacement(0),
+      dirtyPages(0),
+      pinnedFrames(0),
+      pinWaiters(0),
+      allocConfig(alloc),
+      writerConfig(writer),
+      writerCursor(0),
+      stopWriter(false),
+      stopCheckpoint(false),
+      prefetchBusy(false),
+      stopPrefetcher(false),
+      io(IoEngine::create(ioConfig)),
+      loadsInFlight(0),
+      prefetchLoadsInFlight(0),
+      loadWaiters(0),
+      // leaves most of the pool unlatched while a batch is written
+      writeBatchSize(std::max<std::uint32_t>(
+          1, std::min(ioConfig.queueDepth, bufs / 4))) {
+  // frames past bufs are set up alike, for resize() to grow into
+  const std::uint32_t partitions = std::min(
+      maxBufs, numa.partitions == 0 ? numaNodes : numa.partitions);
+  if (partitions > 1) {
+    partitionedPolicy = new PartitionedPolicy(policyType, maxBufs, partitions);
+    policy.reset(partitionedPolicy);
+    // before the frames are touched, which places their memory
+    for (std::uint32_t p = 0; p < partitions && numaNodes > 1; p++) {
+      const FrameId first = partitionedPolicy->firstFrame(p);
+      arena.preferNode(first, partitionedPolicy->firstFrame(p + 1) - first,
+                       p % numaNodes);
+    }
+  } else {
+    policy = ReplacementPolicy::create(policyType, maxBufs);
+  }
+  policy->onResize(bufs);
+
+  if (victim.bytes > 0) victimCache.reset(new VictimCache(victim.bytes));
+
+  bufPool.reserve(maxBufs);
 
-  for (FrameId i = 0; i < bufs; i++) {
+  for (FrameId i = 0; i < maxBufs; i++) {
+    bufPool.emplace_back(arena.frame(i));
     bufDescTable[i].frameNo = i;
     bufDescTable[i].valid = false;
+    bufDescTable[i].partition =
+        partitionedPolicy != NULL ? partitionedPolicy->partitionOf(i) : 0;
+    bufDescTable[i].node = bufDescTable[i].partition % numaNodes;
+  }
+  // taken from the back, so frame 0 goes first
+  freeFrames.resize(numPartitions());
+  for (FrameId i = bufs; i > 0; i--) {
+    freeFrames[bufDescTable[i - 1].partition].push_back(i - 1);
+    freeListed[i - 1] = true;
+  }
+
+  const std::uint32_t shards = shardMask + 1;
+  for (std::uint32_t i = 0; i < shards; i++) {
+    pageTable.emplace_back(new PageTableShard(HASHTABLE_SZ(bufs) / shards + 1));
   }
 
-  clockHand = bufs - 1;
+  if (writer.enabled) {
+    setWatermarks(bufs);
+    writerThread = std::thread(&BufMgr::runWriter, this);
+  } else {
+    // never reached, so the writer is never woken
+    dirtyHigh = maxBufs + 1;
+    dirtyLow = 0;
+  }
+  prefetchThread = std::thread(&BufMgr::runPrefetcher, this);
+}
+
+BufMgr::~BufMgr() {
+  {
+    std::lock_guard<std::mutex> checkpoint_latch(checkpointLatch);
+    stopCheckpoint = true;
+  }
+  checkpointWake.notify_all();
+  std::thread checkpointer;
+  {
+    std::lock_guard<std::mutex> checkpoint_latch(checkpointLatch);
+    checkpointer.swap(checkpointThread);
+  }
+  if (checkpointer.joinable()) checkpointer.join();
+
+  if (writerThread.joinable()) {
+    {
+      std::lock_guard<std::mutex> writer_latch(writerLatch);
+      stopWriter = true;
+    }
+    writerWake.notify_one();
+    writerThread.join();
+  }
+
+  {
+    std::lock_guard<std::mutex> prefetch_latch(prefetchLatch);
+    stopPrefetcher = true;
+  }
+  prefetchWake.notify_one();
+  prefetchThread.join();
+  // requests not started yet are dropped
+  {
+    std::lock_guard<std::mutex> file_latch(fileLatch);
+    prefetchQueue.clear();
+  }
+
+  // the callbacks of reads in flight use the pool
+  {
+    std::unique_lock<std::mutex> load_latch(loadLatch);
+    loadDone.wait(load_latch, [this]() { return loadsInFlight == 0; });
+  }
+  io.reset();
 }
 
 /**
- * @brief Advances clock to the next frame in the buffer pool
+ * @brief Picks the page table shard for a page. Uses a different multiplier
+ * than BufHashTbl so pages of one shard still spread over its whole table.
  */
-void BufMgr::advanceClock() {
-  clockHand = (clockHand + 1) % numBufs;
+BufMgr::PageTableShard& BufMgr::shardFor(const File& file,
+                                         const PageId pageNo) {
+  return *pageTable[hashOf(file, pageNo) & shardMask];
+}
+
+/**
+ * @brief LOCAL placement spreads pages over the partitions of the thread's
+ * node, or takes partition node % count if there are fewer partitions than
+ * nodes.  Pages allocPage() places are spread round robin, their number not
+ * being known yet.
+ */
+std::uint32_t BufMgr::placeFor(const File& file, const PageId pageNo) {
+  if (partitionedPolicy == NULL) return 0;
+  const std::uint32_t partitions = partitionedPolicy->numPartitions();
+  const std::uint64_t spread =
+      pageNo == Page::INVALID_NUMBER ? nextPlacement++ : hashOf(file, pageNo);
+  if (placement == NumaPlacement::HASH) return spread % partitions;
+
+  const std::uint32_t node = currentNumaNode() % numaNodes;
+  if (node >= partitions) return node % partitions;
+  const std::uint32_t local = (partitions - node + numaNodes - 1) / numaNodes;
+  return node + numaNodes * static_cast<std::uint32_t>(spread % local);
+}
+
+void BufMgr::addNodeStat(const FrameId frame) {
+  if (partitionedPolicy == NULL || numaNodes == 1) return;
+  if (bufDescTable[frame].node != currentNumaNode() % numaNodes) {
+    addStat(BufStats::CROSS_NODE_ACCESSES);
+  }
+}
+
+/**
+ * @brief Latches the frame if nobody else has it latched and it does not hold
+ * a pinned page.
+ */
+bool BufMgr::ClaimableFrames::tryClaim(const FrameId frame) {
+  steps++;
+  BufDesc& desc = descs[frame];
+  std::unique_lock<std::mutex> frame_latch(desc.latch, std::try_to_lock);
+  if (!frame_latch.owns_lock()) {
+    busy = true;
+    return false;
+  }
+  // pinned, or reserved for an asynchronous load, or being resized away
+  if (desc.pinCnt > 0 || frame >= active) return false;
+
+  if (steps <= maxSteps && desc.keep.exchange(false)) {
+    spared = true;
+    return false;
+  }
+  claimed = std::move(frame_latch);
+  return true;
 }
 
 /**
  * @brief Allocate a free frame.
  *
+ * Frames on the free list, emptied by flushFile() and disposePage(), are used
+ * first.  Otherwise the replacement policy picks and latches the victim;
+ * frames whose latch is taken are being loaded or evicted by another thread
+ * and are never offered.  A victim that gets pinned again before it is
+ * written back is given up and another one picked.  If no frame could be had
+ * but some were latched, for instance by the background writer waiting for a
+ * batch of writes, the pick is retried a little later.
+ *
+ * With every frame pinned the allocation fails without sweeping, or first
+ * waits up to AllocConfig::pinWaitMs for an unpin.
+ *
  * @param frame   Frame reference, frame ID of allocated frame returned
  * via this variable
+ * @return Lock on the latch of the allocated frame
  * @throws BufferExceededException If no such buffer is found which can be
  * allocated
  */
-void BufMgr::allocBuf(FrameId& frame) {
+std::unique_lock<std::mutex> BufMgr::allocBuf(FrameId& frame,
+                                              const std::uint32_t partition) {
+  const std::uint32_t maxSteps =
+      allocConfig.maxSweepSteps > 0 ? allocConfig.maxSweepSteps
+                                    : std::numeric_limits<std::uint32_t>::max();
+  std::chrono::steady_clock::time_point deadline;
 
-  int pinned_frame = 0;
-  while (pinned_frame < numBufs) {
-    
-    advanceClock();
-    BufDesc *buf_desc = &bufDescTable[clockHand];
-    
-    // page is not valid, set frame
-    if (!buf_desc->valid) break;
+  std::unique_lock<std::mutex> free_frame = popFree(frame, partition, false);
+  if (free_frame.owns_lock()) {
+    addStat(BufStats::FREE_FRAMES);
+    bufPool[frame].bind(arena.frame(frame));
+    return free_frame;
+  }
 
-    // refbit is set, clear and continue
-    if (buf_desc->refbit) {
-      buf_desc->refbit = false;
-      continue;
+  // a partitioned pool reuses frames of the page's partition while it can
+  bool spilling = partitionedPolicy == NULL;
+  for (std::uint32_t attempt = 0; attempt < numBufs; attempt++) {
+
+    if (pinnedFrames >= numBufs) {
+      addStat(BufStats::ALL_PINNED);
+      if (allocConfig.pinWaitMs <= 0) break;
+      if (deadline == std::chrono::steady_clock::time_point()) {
+        deadline = std::chrono::steady_clock::now() +
+                   std::chrono::milliseconds(allocConfig.pinWaitMs);
+      }
+      if (!waitForUnpin(deadline)) break;
     }
-    
-    // page is pinned, continue
-    if (buf_desc->pinCnt > 0) {
-      pinned_frame = pinned_frame + 1;
+
+    ClaimableFrames frames(bufDescTable, numBufs, maxSteps);
+    FrameId victim;
+    const bool picked =
+        spilling ? policy->pickVictim(frames, victim)
+                 : partitionedPolicy->pickVictimIn(partition, frames, victim);
+    addStat(BufStats::SWEEP_STEPS, frames.steps);
+    if (frames.capped) addStat(BufStats::CAPPED_SWEEPS);
+    if (!picked) {
+      // a frame passed over for KEEP can be had right away now
+      if (frames.spared) continue;
+      if (!spilling) {
+        // the partition is all pinned or busy: take frames of the others
+        spilling = true;
+        addStat(BufStats::PARTITION_SPILLS);
+        free_frame = popFree(frame, partition, true);
+        if (free_frame.owns_lock()) {
+          addStat(BufStats::FREE_FRAMES);
+          bufPool[frame].bind(arena.frame(frame));
+          return free_frame;
+        }
+        continue;
+      }
+      if (!frames.busy) break;
+      addStat(BufStats::PIN_WAITS);
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
       continue;
     }
+    addStat(BufStats::VICTIMS);
+    BufDesc *buf_desc = &bufDescTable[victim];
+
+    if (buf_desc->valid) {
+      // flush page to disk if dirty and delete from buffer, unless someone
+      // pinned it in the meantime
+      bool written;
+      if (!evict(*buf_desc, written, true /* demote */)) continue;
+      addStat(written ? BufStats::DIRTY_EVICTIONS : BufStats::CLEAN_EVICTIONS);
+      policy->onEvict(victim);
+    }
+
+    // set frame; it may have been a view of a mapped file
+    frame = victim;
+    bufPool[victim].bind(arena.frame(victim));
+    return std::move(frames.claimed);
+  }
+
+  // all frame are pinned, throw exception
+  throw BufferExceededException();
+}
+
+std::unique_lock<std::mutex> BufMgr::allocFor(const AccessIntent intent,
+                                              const std::uint32_t partition,
+                                              FrameId& frame) {
+  if (intent == AccessIntent::SEQUENTIAL && scanRingSize > 0) {
+    return allocScanBuf(frame, partition);
+  }
+  return allocBuf(frame, partition);
+}
+
+/**
+ * @brief Only frames whose page nobody but a scan asked for are reused, so a
+ * page of the working set a scan happened to read stays in the pool.  The
+ * ring is shared by all scans.
+ */
+std::unique_lock<std::mutex> BufMgr::allocScanBuf(
+    FrameId& frame, const std::uint32_t partition) {
+  bool full;
+  FrameId candidate = 0;
+  {
+    std::lock_guard<std::mutex> ring_latch(scanRingLatch);
+    full = scanRing.size() == scanRingSize;
+    if (full) candidate = scanRing[scanRingNext];
+  }
+
+  if (full) {
+    BufDesc& desc = bufDescTable[candidate];
+    std::unique_lock<std::mutex> frame_latch(desc.latch, std::try_to_lock);
+    bool written;
+    if (frame_latch.owns_lock() && candidate < numBufs && desc.valid &&
+        desc.scanned && !desc.refbit && evict(desc, written, true)) {
+      addStat(written ? BufStats::DIRTY_EVICTIONS : BufStats::CLEAN_EVICTIONS);
+      addStat(BufStats::RING_REUSES);
+      policy->onRemove(candidate);
+      {
+        std::lock_guard<std::mutex> ring_latch(scanRingLatch);
+        scanRingNext = (scanRingNext + 1) % scanRingSize;
+      }
+      frame = candidate;
+      bufPool[frame].bind(arena.frame(frame));
+      return frame_latch;
+    }
+  }
 
-    // dirty bit is set
-    if (buf_desc->dirty) {
+  std::unique_lock<std::mutex> frame_latch = allocBuf(frame, partition);
+  std::lock_guard<std::mutex> ring_latch(scanRingLatch);
+  if (scanRing.size() < scanRingSize) {
+    scanRing.push_back(frame);
+  } else {
+    // the frame there is busy or was used otherwise: replace it
+    scanRing[scanRingNext] = frame;
+    scanRingNext = (scanRingNext + 1) % scanRingSize;
+  }
+  return frame_latch;
+}
 
-      File file = buf_desc->file;
-      PageId pageNo = buf_desc->pageNo;
+void BufMgr::pushFree(const FrameId frame) {
+  std::lock_guard<std::mutex> free_latch(freeLatch);
+  if (freeListed[frame]) return;
+  freeListed[frame] = true;
+  freeFrames[bufDescTable[frame].partition].push_back(frame);
+}
 
-      // flush page to disks
-      Page page = bufPool[clockHand];
-      file.writePage(page);
+std::unique_lock<std::mutex> BufMgr::popFree(FrameId& frame,
+                                             const std::uint32_t partition,
+                                             const bool anyPartition) {
+  const std::size_t lists = anyPartition ? freeFrames.size() : 1;
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> free_latch(freeLatch);
+      std::vector<FrameId>* list = NULL;
+      for (std::size_t k = 0; k < lists && list == NULL; k++) {
+        std::vector<FrameId>& candidate =
+            freeFrames[(partition + k) % freeFrames.size()];
+        if (!candidate.empty()) list = &candidate;
+      }
+      if (list == NULL) return std::unique_lock<std::mutex>();
+      frame = list->back();
+      list->pop_back();
+      freeListed[frame] = false;
+    }
+    BufDesc& desc = bufDescTable[frame];
+    std::unique_lock<std::mutex> frame_latch(desc.latch, std::try_to_lock);
+    // claimed by the policy since it was listed, busy, or resized away
+    if (frame_latch.owns_lock() && !desc.valid && desc.pinCnt == 0 &&
+        frame < numBufs) {
+      return frame_latch;
+    }
+  }
+}
+
+/**
+ * @brief Writes back and unmaps the page held by a latched frame.
+ *
+ * Writing happens while the page is still in the page table, so a thread
+ * that looks the page up meanwhile still finds the frame instead of reading
+ * the stale copy on disk.  If it got pinned or dirtied again during the write
+ * it stays in the pool.
+ */
+bool BufMgr::evict(BufDesc& desc, bool& written, const bool demote) {
+
+  written = false;
+  for (;;) {
+    // flush page to disk
+    if (takeDirty(desc)) {
+      written = true;
+      try {
+        writeBack(desc);
+      } catch (...) {
+        markDirty(desc);
+        throw;
+      }
+    }
+
+    // Compressed before the shard is latched, as the frame latch keeps the
+    // page from being replaced; pages of read-only files are views of a
+    // mapping, cheap to get again.
+    const bool cache = demote && victimCache && !desc.file.isReadOnly();
+    std::string cached;
+    if (cache) cached = VictimCache::compress(bufPool[desc.frameNo].bytes());
 
-      // delete from buffer
-      hashTable.remove(file, pageNo);
-      buf_desc->clear();
+    PageTableShard& shard = shardFor(desc.file, desc.pageNo);
+    std::lock_guard<std::mutex> shard_latch(shard.latch);
+    if (desc.pinCnt > 0) return false;
+    if (desc.dirty) continue;
+
+    // Clean now, so the copy matches the file.  It goes in before the page
+    // leaves the table, so whoever reads the page next finds it.
+    if (cache) {
+      victimCache->insert(desc.file.id(), desc.pageNo, std::move(cached));
+      addStat(BufStats::VICTIM_CACHE_PUTS);
     }
 
+    // delete from buffer
+    shard.table.remove(desc.file, desc.pageNo);
     break;
   }
 
-  // all frame are pinned, throw exception
-  if (pinned_frame == numBufs) {
-    throw BufferExceededException();
+  removeResident(desc);
+  std::lock_guard<std::mutex> file_latch(fileLatch);
+  desc.clear();
+  return true;
+}
+
+void BufMgr::addResident(BufDesc& desc) {
+  std::lock_guard<std::mutex> resident_latch(residentLatch);
+  std::vector<FrameId>& frames = residentFrames[desc.file.id()];
+  desc.residentIndex = frames.size();
+  frames.push_back(desc.frameNo);
+}
+
+void BufMgr::removeResident(BufDesc& desc) {
+  std::lock_guard<std::mutex> resident_latch(residentLatch);
+  auto found = residentFrames.find(desc.file.id());
+  std::vector<FrameId>& frames = found->second;
+  const FrameId last = frames.back();
+  frames[desc.residentIndex] = last;
+  bufDescTable[last].residentIndex = desc.residentIndex;
+  frames.pop_back();
+  if (frames.empty()) residentFrames.erase(found);
+}
+
+std::vector<std::pair<PageId, FrameId>> BufMgr::residentPages(
+    const File& file) {
+  std::vector<std::pair<PageId, FrameId>> pages;
+  {
+    std::lock_guard<std::mutex> resident_latch(residentLatch);
+    auto found = residentFrames.find(file.id());
+    if (found == residentFrames.end()) return pages;
+    pages.reserve(found->second.size());
+    for (const FrameId frame : found->second) {
+      pages.emplace_back(bufDescTable[frame].pageNo, frame);
+    }
+  }
+  std::sort(pages.begin(), pages.end());
+  return pages;
+}
+
+/**
+ * @brief Latches the first page of each run waiting if need be, as no other
+ * latch is held then, and the rest only if that does not wait.
+ */
+std::uint32_t BufMgr::writeRuns(
+    File& file, const std::vector<std::pair<PageId, FrameId>>& pages) {
+  std::uint32_t written = 0;
+  std::vector<std::unique_lock<std::mutex>> frame_latches;
+  std::vector<BufDesc*> run;
+  std::vector<Page*> run_pages;
+
+  // still holding the page, unpinned and dirty; marks it clean if so
+  auto take = [this, &file](BufDesc& desc, const PageId pageNo) {
+    return desc.valid && desc.file == file && desc.pageNo == pageNo &&
+           desc.pinCnt == 0 && takeDirty(desc);
+  };
+
+  std::size_t i = 0;
+  while (i < pages.size()) {
+    BufDesc& first = bufDescTable[pages[i].second];
+    std::unique_lock<std::mutex> first_latch(first.latch);
+    if (!take(first, pages[i++].first)) continue;
+    frame_latches.push_back(std::move(first_latch));
+    run.push_back(&first);
+
+    while (i < pages.size() && run.size() < writeBatchSize &&
+           pages[i].first == run.back()->pageNo + 1) {
+      BufDesc& desc = bufDescTable[pages[i].second];
+      std::unique_lock<std::mutex> frame_latch(desc.latch, std::try_to_lock);
+      // left for the next run to wait for
+      if (!frame_latch.owns_lock()) break;
+      if (!take(desc, pages[i++].first)) break;
+      frame_latches.push_back(std::move(frame_latch));
+      run.push_back(&desc);
+    }
+
+    run_pages.clear();
+    Lsn lsn = 0;
+    for (BufDesc* desc : run) {
+      run_pages.push_back(&bufPool[desc->frameNo]);
+      lsn = std::max(lsn, run_pages.back()->lsn());
+    }
+    try {
+      forceLog(lsn);
+      writeFrames(file, run_pages.data(), run_pages.size());
+    } catch (...) {
+      for (BufDesc* desc : run) markDirty(*desc);
+      throw;
+    }
+    addStat(BufStats::DISK_WRITES, run.size());
+    addFileStat(file, FILE_DISK_WRITES, run.size());
+    written += run.size();
+    run.clear();
+    frame_latches.clear();
   }
+  return written;
+}
+
+/**
+ * @brief Writes the page held by a latched frame to its file.  It goes out
+ * as it is in the frame, checksum and next page pointer set in place, so no
+ * copy of it is made.
+ */
+void BufMgr::writeBack(BufDesc& desc) {
+  forceLog(bufPool[desc.frameNo].lsn());
+  Page* const page = &bufPool[desc.frameNo];
+  writeFrames(desc.file, &page, 1);
+  addStat(BufStats::DISK_WRITES);
+  addFileStat(desc.file, FILE_DISK_WRITES);
+}
 
-  // set frame
-  frame = clockHand;
+/**
+ * @brief A read-only file's page map never changes, so its mapping is viewed
+ * without the file latch.
+ */
+void BufMgr::readFrames(File& file, const PageId first, Page* const* pages,
+                        const std::size_t count) {
+  if (file.isReadOnly() && file.viewPages(first, pages, count)) return;
+  {
+    std::lock_guard<std::mutex> file_latch(fileLatch);
+    file.checkUsed(first, count);
+  }
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  file.readUsedPages(first, pages, count);
+  recordLatency(readLatency, start);
+}
+
+/**
+ * @brief The frame latches keep the pages from changing or being disposed of
+ * while the file latch is not held.
+ */
+void BufMgr::writeFrames(File& file, Page* const* pages,
+                         const std::size_t count) {
+  {
+    std::lock_guard<std::mutex> file_latch(fileLatch);
+    file.prepareWrite(pages, count);
+  }
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  file.writePreparedPages(pages, count);
+  recordLatency(writeLatency, start);
+  std::lock_guard<std::mutex> file_latch(fileLatch);
+  file.afterPagesWritten(pages, count);
+}
+
+/**
+ * @brief Write-ahead logging: a page may only reach its file once the log
+ * records of its changes have.
+ */
+void BufMgr::forceLog(const Lsn lsn) {
+  if (wal == NULL || lsn <= wal->durableLsn()) return;
+  addStat(BufStats::LOG_FORCES);
+  wal->flush(lsn);
+}
+
+void BufMgr::markDirty(BufDesc& desc) {
+  if (desc.dirty.exchange(true)) return;
+  if (++dirtyPages == dirtyHigh) {
+    std::lock_guard<std::mutex> writer_latch(writerLatch);
+    writerWake.notify_one();
+  }
+}
+
+bool BufMgr::takeDirty(BufDesc& desc) {
+  if (!desc.dirty.exchange(false)) return false;
+  dirtyPages--;
+  return true;
+}
+
+bool BufMgr::addPin(BufDesc& desc) {
+  if (desc.pinCnt++ != 0) return false;
+  pinnedFrames++;
+  return true;
+}
+
+bool BufMgr::dropPin(BufDesc& desc) {
+  if (--desc.pinCnt != 0) return false;
+  pinnedFrames--;
+  frameUnpinned();
+  return true;
+}
+
+void BufMgr::setPins(BufDesc& desc, const int pins) {
+  const int old = desc.pinCnt.exchange(pins);
+  if (old == 0 && pins > 0) {
+    pinnedFrames++;
+  } else if (old > 0 && pins == 0) {
+    pinnedFrames--;
+    frameUnpinned();
+  }
+}
+
+/**
+ * @brief A waiter counts itself before testing the pinned count under the
+ * latch, so either it sees the unpin or the unpinning thread sees it.
+ */
+void BufMgr::frameUnpinned() {
+  if (pinWaiters == 0) return;
+  std::lock_guard<std::mutex> pin_latch(pinWaitLatch);
+  unpinWake.notify_all();
+}
+
+bool BufMgr::waitForUnpin(
+    const std::chrono::steady_clock::time_point deadline) {
+  std::unique_lock<std::mutex> pin_latch(pinWaitLatch);
+  pinWaiters++;
+  const bool unpinned = unpinWake.wait_until(
+      pin_latch, deadline, [this]() { return pinnedFrames < numBufs; });
+  pinWaiters--;
+  return unpinned;
+}
+
+/**
+ * @brief Sleeps until the high watermark is crossed or the interval passes,
+ * then writes pages back while that makes progress.
+ */
+void BufMgr::runWriter() {
+  std::unique_lock<std::mutex> writer_latch(writerLatch);
+  while (!stopWriter) {
+    if (dirtyPages >= dirtyHigh) {
+      writer_latch.unlock();
+      const std::uint32_t written = writeDirtyPages();
+      writer_latch.lock();
+
+      // if every dirty page was pinned, wait for the next interval
+      if (written > 0) continue;
+    }
+    writerWake.wait_for(writer_latch,
+                        std::chrono::milliseconds(writerConfig.intervalMs));
+  }
+}
+
+/**
+ * @brief Writes back dirty pages without evicting them.
+ *
+ * Frames that are latched are being loaded or evicted and are skipped, as are
+ * pinned pages, which will likely be dirtied again.  A page that is pinned
+ * and changed while it is written is marked dirty again when unpinned.
+ * Errors are left for the evicting thread to run into and report.
+ */
+std::uint32_t BufMgr::writeDirtyPages() {
+  std::uint32_t written = 0;
+  std::vector<std::unique_lock<std::mutex>> frame_latches;
+  std::vector<BufDesc*> batch;
+  for (std::uint32_t step = 0; step < numBufs && dirtyPages > dirtyLow;
+       step++) {
+    BufDesc& desc = bufDescTable[writerCursor];
+    writerCursor = (writerCursor + 1) % numBufs;
+
+    std::unique_lock<std::mutex> frame_latch(desc.latch, std::try_to_lock);
+    if (!frame_latch.owns_lock()) continue;
+    if (!desc.valid || desc.pinCnt > 0 || !takeDirty(desc)) continue;
+
+    frame_latches.push_back(std::move(frame_latch));
+    batch.push_back(&desc);
+    if (batch.size() == writeBatchSize) {
+      written += writeBatch(batch);
+      batch.clear();
+      frame_latches.clear();
+    }
+  }
+  if (!batch.empty()) written += writeBatch(batch);
+  return written;
+}
+
+std::future<CheckpointStats> BufMgr::checkpoint(
+    const CheckpointConfig& config) {
+  std::promise<CheckpointStats> promise;
+  std::future<CheckpointStats> result = promise.get_future();
+  // The thread waits for the previous checkpoint itself, since that one
+  // takes checkpointLatch to pause.
+  std::lock_guard<std::mutex> checkpoint_latch(checkpointLatch);
+  checkpointThread = std::thread(
+      [this, config](std::promise<CheckpointStats> done,
+                     std::thread previous) {
+        if (previous.joinable()) previous.join();
+        try {
+          done.set_value(runCheckpoint(config));
+        } catch (...) {
+          done.set_exception(std::current_exception());
+        }
+      },
+      std::move(promise), std::move(checkpointThread));
+  return result;
+}
+
+/**
+ * @brief Fuzzy: pages are written while others are read and changed, so the
+ * checkpoint is not a snapshot, but every page dirty when it begins is
+ * written once unpinned, and changes logged before then are on disk.
+ */
+CheckpointStats BufMgr::runCheckpoint(const CheckpointConfig& config) {
+  CheckpointStats stats;
+  stats.redoLsn = wal != NULL ? wal->endLsn() : 0;
+  const std::size_t slice = std::max<std::uint32_t>(1, config.sliceFrames);
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+
+  // every frame at first, then those holding pinned dirty pages
+  std::vector<FrameId> frames(numBufs);
+  for (FrameId i = 0; i < frames.size(); i++) frames[i] = i;
+  while (!frames.empty() && stats.passes <= config.revisits) {
+    if (stats.passes > 0 &&
+        !pauseCheckpoint(std::chrono::milliseconds(config.revisitDelayMs))) {
+      break;
+    }
+    stats.passes++;
+    std::vector<FrameId> pinned;
+    std::size_t next = 0;
+    while (next < frames.size()) {
+      const std::size_t count = std::min(slice, frames.size() - next);
+      stats.written += checkpointSlice(&frames[next], count, pinned);
+      next += count;
+
+      if (config.pagesPerSecond == 0 || next == frames.size()) continue;
+      const std::chrono::nanoseconds due(stats.written * 1000000000ull /
+                                         config.pagesPerSecond);
+      const std::chrono::nanoseconds spent =
+          std::chrono::steady_clock::now() - start;
+      if (due > spent && !pauseCheckpoint(due - spent)) break;
+    }
+    // frames not looked at count as pinned
+    pinned.insert(pinned.end(), frames.begin() + next, frames.end());
+    frames.swap(pinned);
+  }
+  stats.skipped = frames.size();
+  return stats;
+}
+
+bool BufMgr::pauseCheckpoint(const std::chrono::nanoseconds pause) {
+  std::unique_lock<std::mutex> checkpoint_latch(checkpointLatch);
+  return !checkpointWake.wait_for(checkpoint_latch, pause,
+                                  [this]() { return stopCheckpoint; });
+}
+
+std::uint32_t BufMgr::checkpointSlice(const FrameId* frames,
+                                      const std::size_t count,
+                                      std::vector<FrameId>& pinned) {
+  // dirty pages by file; the File copies are made and destroyed under
+  // fileLatch
+  typedef std::vector<std::pair<PageId, FrameId>> Pages;
+  std::unordered_map<FileId, std::pair<File, Pages>> files;
+  std::uint32_t written = 0;
+  try {
+    for (std::size_t k = 0; k < count; k++) {
+      if (frames[k] >= numBufs) continue;
+      BufDesc& desc = bufDescTable[frames[k]];
+      if (!desc.dirty) continue;
+      std::unique_lock<std::mutex> frame_latch(desc.latch, std::try_to_lock);
+      if (!frame_latch.owns_lock() || desc.pinCnt > 0) {
+        pinned.push_back(frames[k]);
+        continue;
+      }
+      if (!desc.valid) continue;
+      auto found = files.find(desc.file.id());
+      if (found == files.end()) {
+        std::lock_guard<std::mutex> file_latch(fileLatch);
+        found =
+            files.emplace(desc.file.id(), std::make_pair(desc.file, Pages()))
+                .first;
+      }
+      found->second.second.emplace_back(desc.pageNo, desc.frameNo);
+    }
+
+    for (auto& entry : files) {
+      Pages& pages = entry.second.second;
+      std::sort(pages.begin(), pages.end());
+      written += writeRuns(entry.second.first, pages);
+      // writeRuns() passes over pages pinned since
+      for (const std::pair<PageId, FrameId>& page : pages) {
+        const BufDesc& desc = bufDescTable[page.second];
+        if (desc.dirty && desc.pinCnt > 0) pinned.push_back(page.second);
+      }
+    }
+  } catch (...) {
+    std::lock_guard<std::mutex> file_latch(fileLatch);
+    files.clear();
+    throw;
+  }
+  std::lock_guard<std::mutex> file_latch(fileLatch);
+  files.clear();
+  return written;
+}
+
+/**
+ * @brief Submits all the writes before waiting for any, so that the device
+ * sees them together.  Durability is seen to once they are all done.
+ */
+std::uint32_t BufMgr::writeBatch(const std::vector<BufDesc*>& batch) {
+  std::mutex done_latch;
+  std::condition_variable all_done;
+  std::size_t remaining = 0;
+  // 0, the errno value a write failed with, or -1 if it was not submitted
+  std::vector<int> errors(batch.size(), -1);
+
+  // the log goes first, once for the whole batch
+  Lsn lsn = 0;
+  for (BufDesc* desc : batch) {
+    lsn = std::max(lsn, bufPool[desc->frameNo].lsn());
+  }
+  try {
+    forceLog(lsn);
+  } catch (const std::exception&) {
+    for (BufDesc* desc : batch) markDirty(*desc);
+    return 0;
+  }
+
+  for (std::size_t k = 0; k < batch.size(); k++) {
+    std::unique_ptr<IoRequest> request;
+    try {
+      std::lock_guard<std::mutex> file_latch(fileLatch);
+      request = batch[k]->file.writeRequest(bufPool[batch[k]->frameNo]);
+    } catch (const std::exception&) {
+      continue;
+    }
+    const std::chrono::steady_clock::time_point submitted =
+        std::chrono::steady_clock::now();
+    request->done = [&, k, submitted](const int error) {
+      recordLatency(writeLatency, submitted);
+      std::lock_guard<std::mutex> latch(done_latch);
+      errors[k] = error;
+      if (--remaining == 0) all_done.notify_one();
+    };
+    {
+      std::lock_guard<std::mutex> latch(done_latch);
+      remaining++;
+    }
+    io->submit(std::move(request));
+  }
+  {
+    std::unique_lock<std::mutex> latch(done_latch);
+    all_done.wait(latch, [&remaining]() { return remaining == 0; });
+  }
+
+  std::uint32_t written = 0;
+  for (std::size_t k = 0; k < batch.size(); k++) {
+    if (errors[k] != 0) {
+      markDirty(*batch[k]);
+      continue;
+    }
+    try {
+      Page* const page = &bufPool[batch[k]->frameNo];
+      std::lock_guard<std::mutex> file_latch(fileLatch);
+      batch[k]->file.afterPagesWritten(&page, 1);
+    } catch (const std::exception&) {
+      markDirty(*batch[k]);
+      continue;
+    }
+    addStat(BufStats::DISK_WRITES);
+    addStat(BufStats::BACKGROUND_WRITES);
+    addFileStat(batch[k]->file, FILE_DISK_WRITES);
+    written++;
+  }
+  return written;
 }
 
 /**
@@ -118,36 +938,650 @@ void BufMgr::allocBuf(FrameId& frame) {
  * @param page  	Reference to page pointer. Used to fetch the Page object
  * in which requested page from file is read in.
  */
-void BufMgr::readPage(File& file, const PageId pageNo, Page*& page) {
+void BufMgr::readPage(File& file, const PageId pageNo, Page*& page,
+                      const AccessIntent intent) {
 
+  addStat(BufStats::ACCESSES);
+  pinPage(file, pageNo, page, intent);
+}
+
+void BufMgr::pinPage(File& file, const PageId pageNo, Page*& page,
+                     const AccessIntent intent) {
+  // 1. allocate buffer frame and enter the page into the hash table with it,
+  // unless another thread got to the page first
   FrameId frame_id;
+  std::unique_lock<std::mutex> frame_latch;
+  for (;;) {
+    if (pinIfPresent(file, pageNo, page, intent)) return;
+    frame_latch = allocFor(intent, placeFor(file, pageNo), frame_id);
+    if (claim(file, pageNo, frame_id)) break;
+    frame_latch.unlock();
+    pushFree(frame_id);
+  }
+  BufDesc *buf_desc = &bufDescTable[frame_id];
+
+  // 2. take the page from the victim cache, or read it from disk, or view
+  // it in the file's mapping, and set frame
+  Page* const frame_page = &bufPool[frame_id];
+  const bool cached =
+      victimCache && victimCache->take(file.id(), pageNo, frame_page->bytes());
+  try {
+    if (!cached) readFrames(file, pageNo, &frame_page, 1);
+  } catch (...) {
+    // the frame holds no page yet: give it back
+    frame_latch.unlock();
+    unclaim(file, pageNo, frame_id);
+    pushFree(frame_id);
+    throw;
+  }
+  {
+    std::lock_guard<std::mutex> file_latch(fileLatch);
+    buf_desc->Set(file, pageNo);
+  }
+  applyIntent(*buf_desc, intent);
+  addResident(*buf_desc);
+  if (cached) {
+    addStat(BufStats::VICTIM_CACHE_HITS);
+  } else {
+    addStat(BufStats::DISK_READS);
+    addFileStat(file, FILE_DISK_READS);
+  }
+
+  // 3. hand the page to whoever waited for it
+  install(file, pageNo, frame_id);
+  frame_latch.unlock();
+  page = frame_page;
+  addNodeStat(frame_id);
+}
+
+/**
+ * @brief Reads several pages of a file into frames and pins them, like a
+ * readPage() call per page.  Pages already in the pool are pinned first;
+ * frames for the others are all allocated before anything is read, and each
+ * run of consecutive page numbers among them is read with a single request
+ * to the file.
+ *
+ * @param file   	File object
+ * @param pageNos Page numbers in the file to be read
+ * @param count   Number of pages to read
+ * @param pages 	The i-th gets the Page object page pageNos[i] is read in
+ */
+void BufMgr::readPages(File& file, const PageId* pageNos,
+                       const std::size_t count, Page** pages) {
+
+  addStat(BufStats::ACCESSES, count);
+  pinPages(file, pageNos, count, pages);
+}
+
+void BufMgr::pinPages(File& file, const PageId* pageNos,
+                      const std::size_t count, Page** pages) {
+  std::vector<std::size_t> misses;
+  for (std::size_t i = 0; i < count; i++) {
+    if (!pinIfPresent(file, pageNos[i], pages[i])) misses.push_back(i);
+  }
+  if (misses.empty()) return;
+  std::vector<bool> missed(count, false);
+  for (const std::size_t i : misses) missed[i] = true;
+
+  // in page order, so that runs are adjacent
+  std::sort(misses.begin(), misses.end(),
+            [pageNos](const std::size_t a, const std::size_t b) {
+              return pageNos[a] < pageNos[b];
+            });
+
+  // misses[k] gets frames[k], entered into the hash table for it; pages
+  // another thread got to first, or asked for twice, are pinned at the end
+  std::vector<FrameId> frames;
+  std::vector<std::unique_lock<std::mutex>> frame_latches;
+  std::vector<std::size_t> others;
+  frames.reserve(misses.size());
+  frame_latches.reserve(misses.size());
+  // frames[0, loaded) hold pages read in
+  std::size_t loaded = 0;
   try {
+    std::size_t claimed = 0;
+    for (const std::size_t i : misses) {
+      FrameId frame_id;
+      std::unique_lock<std::mutex> frame_latch =
+          allocBuf(frame_id, placeFor(file, pageNos[i]));
+      if (!claim(file, pageNos[i], frame_id)) {
+        frame_latch.unlock();
+        pushFree(frame_id);
+        others.push_back(i);
+        continue;
+      }
+      misses[claimed++] = i;
+      frames.push_back(frame_id);
+      frame_latches.push_back(std::move(frame_latch));
+    }
+    misses.resize(claimed);
+
+    // pages in the victim cache split the runs read from disk
+    std::vector<bool> cached(misses.size(), false);
+    for (std::size_t k = 0; k < misses.size() && victimCache; k++) {
+      cached[k] = victimCache->take(file.id(), pageNos[misses[k]],
+                                    bufPool[frames[k]].bytes());
+    }
 
-    // look up frame
-    hashTable.lookup(file, pageNo, frame_id);
+    std::vector<Page*> run;
+    while (loaded < misses.size()) {
+      const PageId first = pageNos[misses[loaded]];
+      if (cached[loaded]) {
+        {
+          std::lock_guard<std::mutex> file_latch(fileLatch);
+          bufDescTable[frames[loaded]].Set(file, first);
+        }
+        addStat(BufStats::VICTIM_CACHE_HITS);
+        loaded++;
+        continue;
+      }
+      run.clear();
+      do {
+        run.push_back(&bufPool[frames[loaded + run.size()]]);
+      } while (loaded + run.size() < misses.size() &&
+               !cached[loaded + run.size()] &&
+               pageNos[misses[loaded + run.size()]] == first + run.size());
+
+      readFrames(file, first, run.data(), run.size());
+      {
+        std::lock_guard<std::mutex> file_latch(fileLatch);
+        for (std::size_t k = 0; k < run.size(); k++) {
+          bufDescTable[frames[loaded + k]].Set(file, first + k);
+        }
+      }
+      addStat(BufStats::DISK_READS, run.size());
+      addFileStat(file, FILE_DISK_READS, run.size());
+      loaded += run.size();
+    }
+    for (std::size_t k = 0; k < loaded; k++) {
+      addResident(bufDescTable[frames[k]]);
+    }
+  } catch (...) {
+    // give the frames back and unpin what was pinned already
+    {
+      std::lock_guard<std::mutex> file_latch(fileLatch);
+      for (std::size_t k = 0; k < loaded; k++) {
+        bufDescTable[frames[k]].clear();
+      }
+    }
+    frame_latches.clear();
+    for (std::size_t k = 0; k < frames.size(); k++) {
+      unclaim(file, pageNos[misses[k]], frames[k]);
+      pushFree(frames[k]);
+    }
+    for (std::size_t i = 0; i < count; i++) {
+      if (!missed[i]) unPinPage(file, pageNos[i], false);
+    }
+    throw;
+  }
+
+  for (std::size_t k = 0; k < misses.size(); k++) {
+    install(file, pageNos[misses[k]], frames[k]);
+    pages[misses[k]] = &bufPool[frames[k]];
+  }
+  frame_latches.clear();
+
+  // only now, so as not to wait for a page while holding others back
+  for (std::size_t j = 0; j < others.size(); j++) {
+    try {
+      pinPage(file, pageNos[others[j]], pages[others[j]],
+              AccessIntent::NORMAL);
+    } catch (...) {
+      std::vector<bool> pinned(count, true);
+      for (std::size_t k = j; k < others.size(); k++) pinned[others[k]] = false;
+      for (std::size_t i = 0; i < count; i++) {
+        if (pinned[i]) unPinPage(file, pageNos[i], false);
+      }
+      throw;
+    }
+  }
+}
+
+void BufMgr::prefetch(File& file, const PageId* pageNos,
+                      const std::size_t count) {
+  if (count == 0) return;
+  std::unique_ptr<PrefetchRequest> request;
+  {
+    std::lock_guard<std::mutex> file_latch(fileLatch);
+    request.reset(new PrefetchRequest{file, {pageNos, pageNos + count}});
+  }
+  {
+    std::lock_guard<std::mutex> prefetch_latch(prefetchLatch);
+    prefetchQueue.push_back(std::move(request));
+  }
+  prefetchWake.notify_one();
+}
+
+/**
+ * @brief Takes prefetch requests off the queue one at a time until stopped.
+ */
+void BufMgr::runPrefetcher() {
+  std::unique_lock<std::mutex> prefetch_latch(prefetchLatch);
+  for (;;) {
+    prefetchWake.wait(prefetch_latch, [this]() {
+      return stopPrefetcher || !prefetchQueue.empty();
+    });
+    if (stopPrefetcher) return;
+
+    std::unique_ptr<PrefetchRequest> request =
+        std::move(prefetchQueue.front());
+    prefetchQueue.pop_front();
+    prefetchBusy = true;
+    prefetch_latch.unlock();
+
+    loadPrefetched(*request);
+    {
+      std::lock_guard<std::mutex> file_latch(fileLatch);
+      request.reset();
+    }
+
+    prefetch_latch.lock();
+    prefetchBusy = false;
+    prefetchDone.notify_all();
+  }
+}
+
+void BufMgr::loadPrefetched(PrefetchRequest& request) {
+  File& file = request.file;
+  std::vector<PageId> missing;
+  for (const PageId pageNo : request.pageNos) {
+    PageTableShard& shard = shardFor(file, pageNo);
+    FrameId frame_id;
+    std::lock_guard<std::mutex> shard_latch(shard.latch);
+    if (!shard.table.tryLookup(file, pageNo, frame_id)) {
+      missing.push_back(pageNo);
+    }
+  }
+  if (missing.empty()) return;
+
+  // one load per run of consecutive pages, left pinned until it is in
+  std::sort(missing.begin(), missing.end());
+  missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+  std::size_t start = 0;
+  while (start < missing.size()) {
+    std::size_t end = start + 1;
+    while (end < missing.size() &&
+           missing[end] == missing[start] + (end - start)) {
+      end++;
+    }
+    try {
+      loadAsync(file, missing[start], end - start, true,
+                [this](AsyncLoad& load, std::exception_ptr error) {
+                  if (error) return;
+                  addStat(BufStats::PREFETCH_READS, load.pages.size());
+                  for (std::size_t k = 0; k < load.pages.size(); k++) {
+                    if (load.claimed[k]) {
+                      unPinPage(load.file, load.first + k, false);
+                    }
+                  }
+                });
+    } catch (const std::exception&) {
+      return;
+    }
+    start = end;
+  }
+}
+
+void BufMgr::waitForPrefetches() {
+  {
+    std::unique_lock<std::mutex> prefetch_latch(prefetchLatch);
+    prefetchDone.wait(prefetch_latch, [this]() {
+      return prefetchQueue.empty() && !prefetchBusy;
+    });
+  }
+  std::unique_lock<std::mutex> load_latch(loadLatch);
+  loadDone.wait(load_latch,
+                [this]() { return prefetchLoadsInFlight == 0; });
+}
+
+/**
+ * @brief Reserves a frame per page, pinning the still invalid frames so that
+ * nothing claims them, and submits one read for all the pages.  A page found
+ * in the page table keeps its frame in the run, read into but never entered.
+ */
+bool BufMgr::loadAsync(
+    File& file, const PageId first, const std::size_t count,
+    const bool prefetch,
+    std::function<void(AsyncLoad&, std::exception_ptr)> done) {
+  std::vector<FrameId> frames;
+  std::vector<bool> claimed;
+  frames.reserve(count);
+  claimed.reserve(count);
+  std::unique_ptr<AsyncLoad> load;
+  std::unique_ptr<IoRequest> request;
+  try {
+    for (std::size_t k = 0; k < count; k++) {
+      FrameId frame_id;
+      std::unique_lock<std::mutex> frame_latch =
+          allocBuf(frame_id, placeFor(file, first + k));
+      const bool entered = claim(file, first + k, frame_id);
+      if (!entered) setPins(bufDescTable[frame_id], 1);
+      frames.push_back(frame_id);
+      claimed.push_back(entered);
+    }
+    if (std::find(claimed.begin(), claimed.end(), true) == claimed.end()) {
+      for (std::size_t k = 0; k < count; k++) {
+        releaseReserved(file, first + k, frames[k], false);
+      }
+      return false;
+    }
+
+    std::vector<Page*> pages(count);
+    for (std::size_t k = 0; k < count; k++) pages[k] = &bufPool[frames[k]];
+    // pages of mapped files are there already: nothing to wait for
+    const bool viewed =
+        file.isReadOnly() && file.viewPages(first, pages.data(), count);
+    std::lock_guard<std::mutex> file_latch(fileLatch);
+    if (!viewed) request = file.readRequest(first, pages.data(), count);
+    load.reset(new AsyncLoad{file, first, frames, pages, prefetch, claimed,
+                             std::move(done)});
+  } catch (...) {
+    for (std::size_t k = 0; k < frames.size(); k++) {
+      releaseReserved(file, first + k, frames[k], claimed[k]);
+    }
+    throw;
+  }
+
+  {
+    std::lock_guard<std::mutex> load_latch(loadLatch);
+    loadsInFlight++;
+    if (prefetch) prefetchLoadsInFlight++;
+  }
+  if (!request) {
+    completeLoad(std::move(load), 0);
+    return true;
+  }
+  load->submitted = std::chrono::steady_clock::now();
+  AsyncLoad* pending = load.release();
+  request->done = [this, pending](const int error) {
+    completeLoad(std::unique_ptr<AsyncLoad>(pending), error);
+  };
+  io->submit(std::move(request));
+  return true;
+}
+
+void BufMgr::completeLoad(std::unique_ptr<AsyncLoad> load, const int error) {
+  const std::size_t count = load->frames.size();
+  if (load->submitted != std::chrono::steady_clock::time_point()) {
+    recordLatency(readLatency, load->submitted);
+  }
+  std::exception_ptr failure;
+  if (error != 0) {
+    failure = std::make_exception_ptr(
+        FileIOException(load->file.filename(), "reading", error));
+  }
+  for (std::size_t k = 0; k < count && !failure; k++) {
+    const Page& page = bufPool[load->frames[k]];
+    if (page.page_number() != load->first + k) {
+      failure = std::make_exception_ptr(
+          InvalidPageException(load->first + k, load->file.filename()));
+      break;
+    }
+    try {
+      load->file.verifyPage(page);
+    } catch (...) {
+      failure = std::current_exception();
+    }
+  }
+
+  if (failure) {
+    for (std::size_t k = 0; k < count; k++) {
+      releaseReserved(load->file, load->first + k, load->frames[k],
+                      load->claimed[k]);
+    }
+  } else {
+    for (std::size_t k = 0; k < count; k++) {
+      const FrameId frame_id = load->frames[k];
+      if (!load->claimed[k]) {
+        releaseReserved(load->file, load->first + k, frame_id, false);
+        continue;
+      }
+      std::lock_guard<std::mutex> frame_latch(bufDescTable[frame_id].latch);
+      {
+        std::lock_guard<std::mutex> file_latch(fileLatch);
+        bufDescTable[frame_id].Set(load->file, load->first + k);
+      }
+      addResident(bufDescTable[frame_id]);
+      install(load->file, load->first + k, frame_id);
+    }
+    addStat(BufStats::DISK_READS, count);
+    addFileStat(load->file, FILE_DISK_READS, count);
+  }
+
+  try {
+    load->done(*load, failure);
+  } catch (...) {
+    // nobody to report it to on this thread
+  }
+  const bool prefetch = load->prefetch;
+  {
+    std::lock_guard<std::mutex> file_latch(fileLatch);
+    load.reset();
+  }
+  {
+    std::lock_guard<std::mutex> load_latch(loadLatch);
+    loadsInFlight--;
+    if (prefetch) prefetchLoadsInFlight--;
+  }
+  loadDone.notify_all();
+}
+
+void BufMgr::releaseReserved(File& file, const PageId pageNo,
+                             const FrameId frame, const bool claimed) {
+  if (claimed) {
+    unclaim(file, pageNo, frame);
+  } else {
+    std::lock_guard<std::mutex> frame_latch(bufDescTable[frame].latch);
+    setPins(bufDescTable[frame], 0);
+  }
+  pushFree(frame);
+}
+
+void BufMgr::setWatermarks(const std::uint32_t frames) {
+  const std::uint32_t high = std::max<std::uint32_t>(
+      1, writerConfig.highWatermark * frames);
+  dirtyLow = std::min<std::uint32_t>(writerConfig.lowWatermark * frames,
+                                     high - 1);
+  dirtyHigh = high;
+}
+
+/**
+ * @brief Frames past the new size are closed to allocations before they are
+ * emptied: allocations check the size under the frame latch, which resize()
+ * takes after lowering it, so a frame is either claimed before and then
+ * waited for, or never claimed.
+ */
+std::uint32_t BufMgr::resize(std::uint32_t frames) {
+  frames = std::min(std::max<std::uint32_t>(frames, 1), maxBufs);
+  std::lock_guard<std::mutex> resize_latch(resizeLatch);
+  const std::uint32_t old = numBufs;
+
+  if (frames > old) {
+    policy->onResize(frames);
+    numBufs = frames;
+    // taken from the back, so the lowest new frame goes first
+    for (FrameId i = frames; i > old; i--) pushFree(i - 1);
+  } else if (frames < old) {
+    numBufs = frames;
+    FrameId end = old;
+    try {
+      for (; end > frames; end--) {
+        BufDesc& desc = bufDescTable[end - 1];
+        std::lock_guard<std::mutex> frame_latch(desc.latch);
+        if (desc.valid) {
+          bool written;
+          if (!evict(desc, written, true /* demote */)) break;
+          addStat(written ? BufStats::DIRTY_EVICTIONS
+                          : BufStats::CLEAN_EVICTIONS);
+          policy->onRemove(end - 1);
+        } else if (desc.pinCnt > 0) {
+          // reserved for an asynchronous load
+          break;
+        }
+      }
+    } catch (...) {
+      numBufs = end;
+      policy->onResize(end);
+      arena.release(end, old - end);
+      throw;
+    }
+    numBufs = end;
+    policy->onResize(end);
+    arena.release(end, old - end);
+  }
+  if (writerThread.joinable()) setWatermarks(numBufs);
+
+  const std::uint32_t shards = shardMask + 1;
+  for (std::uint32_t i = 0; i < shards; i++) {
+    std::lock_guard<std::mutex> shard_latch(pageTable[i]->latch);
+    pageTable[i]->table.fit(HASHTABLE_SZ(numBufs) / shards + 1);
+  }
+  return numBufs;
+}
+
+std::future<Page*> BufMgr::readPageAsync(File& file, const PageId pageNo) {
+  addStat(BufStats::ACCESSES);
+  std::shared_ptr<std::promise<Page*>> promise =
+      std::make_shared<std::promise<Page*>>();
+  std::future<Page*> future = promise->get_future();
+
+  Page* page;
+  try {
+    // another thread may enter the page in between
+    while (!pinIfPresent(file, pageNo, page)) {
+      if (loadAsync(file, pageNo, 1, false,
+                    [promise](AsyncLoad& load, std::exception_ptr error) {
+                      if (error) {
+                        promise->set_exception(error);
+                      } else {
+                        promise->set_value(load.pages[0]);
+                      }
+                    })) {
+        return future;
+      }
+    }
+    promise->set_value(page);
+  } catch (...) {
+    promise->set_exception(std::current_exception());
+  }
+  return future;
+}
+
+/**
+ * @brief Pins a page if it is in the buffer pool.
+ */
+bool BufMgr::pinIfPresent(File& file, const PageId pageNo, Page*& page,
+                          const AccessIntent intent) {
+  const bool referenced =
+      intent == AccessIntent::NORMAL || intent == AccessIntent::KEEP;
+  PageTableShard& shard = shardFor(file, pageNo);
+  FrameId frame_id;
+  {
+    std::unique_lock<std::mutex> shard_latch(shard.latch);
+    for (;;) {
+      if (!shard.table.tryLookup(file, pageNo, frame_id)) {
+        addStat(BufStats::MISSES);
+        addFileStat(file, FILE_MISSES);
+        return false;
+      }
+      if (!bufDescTable[frame_id].loading) break;
+      // look again once read, as the read may have failed
+      waitForLoad(bufDescTable[frame_id], shard_latch);
+    }
 
     // modify frame stat
     BufDesc *buf_desc = &bufDescTable[frame_id];
-    buf_desc->refbit = 1;
-    buf_desc->pinCnt += 1;
+    if (referenced) {
+      buf_desc->refbit = true;
+      buf_desc->scanned = false;
+      if (intent == AccessIntent::KEEP) buf_desc->keep = true;
+    }
+    if (addPin(*buf_desc)) policy->onPin(frame_id);
+
+    page = &bufPool[frame_id];
+  }
+  addStat(BufStats::HITS);
+  addNodeStat(frame_id);
+  addFileStat(file, FILE_HITS);
+  if (referenced) policy->onAccess(frame_id);
+  return true;
+}
 
-  } catch (HashNotFoundException e) {
+void BufMgr::applyIntent(BufDesc& desc, const AccessIntent intent) {
+  switch (intent) {
+    case AccessIntent::NORMAL:
+      break;
+    case AccessIntent::SEQUENTIAL:
+      desc.scanned = scanRingSize > 0;
+      desc.refbit = false;
+      break;
+    case AccessIntent::ONCE:
+      desc.refbit = false;
+      break;
+    case AccessIntent::KEEP:
+      desc.keep = true;
+      break;
+  }
+}
 
-    // 1. allocate buffer frame
-    allocBuf(frame_id); // allocBuf here
+bool BufMgr::claim(File& file, const PageId pageNo, const FrameId frame_id) {
+  PageTableShard& shard = shardFor(file, pageNo);
+  std::lock_guard<std::mutex> shard_latch(shard.latch);
+  FrameId existing;
+  if (shard.table.tryLookup(file, pageNo, existing)) return false;
+  BufDesc& desc = bufDescTable[frame_id];
+  setPins(desc, 1);
+  desc.loading = true;
+  shard.table.insert(file, pageNo, frame_id);
+  return true;
+}
 
-    // 2. read page from disk
-    Page new_page = file.readPage(pageNo);
-    bufPool[frame_id] = new_page;
+/**
+ * @brief The policy learns of the frame before it stops loading, so that
+ * readers woken up find it loaded there too.
+ */
+void BufMgr::install(File& file, const PageId pageNo, const FrameId frame_id) {
+  policy->onLoad(frame_id, keyOf(file, pageNo));
+  policy->onPin(frame_id);
+  {
+    std::lock_guard<std::mutex> shard_latch(shardFor(file, pageNo).latch);
+    bufDescTable[frame_id].loading = false;
+  }
+  loadSettled();
+}
 
-    // 3. insert page into hash table
-    hashTable.insert(file, pageNo, frame_id);
+void BufMgr::unclaim(File& file, const PageId pageNo, const FrameId frame_id) {
+  {
+    PageTableShard& shard = shardFor(file, pageNo);
+    std::lock_guard<std::mutex> shard_latch(shard.latch);
+    shard.table.remove(file, pageNo);
+    bufDescTable[frame_id].loading = false;
+    setPins(bufDescTable[frame_id], 0);
+  }
+  loadSettled();
+}
 
-    // 4. set frame
-    bufDescTable[frame_id].Set(file, pageNo);
+/**
+ * @brief Like waitForUnpin(), a waiter counts itself before testing the flag
+ * under loadLatch, so either it sees the flag cleared or loadSettled() sees
+ * it waiting.
+ */
+void BufMgr::waitForLoad(BufDesc& desc,
+                         std::unique_lock<std::mutex>& shard_latch) {
+  shard_latch.unlock();
+  {
+    std::unique_lock<std::mutex> load_latch(loadLatch);
+    loadWaiters++;
+    pageLoaded.wait(load_latch, [&desc]() { return !desc.loading; });
+    loadWaiters--;
   }
+  shard_latch.lock();
+}
 
-  page = &bufPool[frame_id];
+void BufMgr::loadSettled() {
+  if (loadWaiters == 0) return;
+  std::lock_guard<std::mutex> load_latch(loadLatch);
+  pageLoaded.notify_all();
 }
 
 /**
@@ -164,29 +1598,74 @@ void BufMgr::unPinPage(File& file, const PageId pageNo, const bool dirty) {
 
   FrameId frameNo; // obtain frame number by reference using file, pageNo
 
-  try {
+  PageTableShard& shard = shardFor(file, pageNo);
+  std::lock_guard<std::mutex> shard_latch(shard.latch);
+
+  // Find the pageId in the frame of the buffer pool. If pageId in the frame
+  // is not in the buffer pool, do nothing
+  if (!shard.table.tryLookup(file, pageNo, frameNo)) return;
 
-    // Find the pageId in the frame of the buffer pool
-    hashTable.lookup(file, pageNo, frameNo);
+  // Retrieve BufDesc
+  BufDesc *f = &bufDescTable[frameNo];
+
+  // If pin count is already zero, throw PAGENOTPINNED
+  if (f->pinCnt == 0)
+    throw PageNotPinnedException(file.filename(), pageNo, frameNo);
+
+  // If dirty is true, set the dirty bit
+  if (dirty)
+    markDirty(*f);
+
+  // Decrement pin count
+  if (dropPin(*f)) policy->onUnpin(frameNo);
+}
 
-    // Retrieve BufDesc
-    BufDesc *f = &bufDescTable[frameNo];
-    
-    // If pin count is already zero, throw PAGENOTPINNED
-    if (f->pinCnt == 0)
-      throw PageNotPinnedException(file.filename(), pageNo, frameNo);
-    
-    // Decrement pin count
-    f->pinCnt--;
-  
-    // If dirty is true, set the dirty bit
-    if (dirty)
-      f->dirty = 1;
-    
-  } catch (HashNotFoundException e) {
-    // If pageId in the frame is not in the buffer pool, do nothing
+void BufMgr::unpinFrame(const FrameId frame, const bool dirty,
+                        const bool exclusive) {
+  BufDesc& desc = bufDescTable[frame];
+  if (exclusive) {
+    desc.content.unlock();
+  } else {
+    desc.content.unlockShared();
   }
 
+  // The frame's page cannot change while we hold a pin on it, so its shard
+  // can be found without the frame latch.
+  PageTableShard& shard = shardFor(desc.file, desc.pageNo);
+  std::lock_guard<std::mutex> shard_latch(shard.latch);
+
+  if (desc.pinCnt == 0)
+    throw PageNotPinnedException(desc.file.filename(), desc.pageNo, frame);
+
+  if (dirty) markDirty(desc);
+  if (dropPin(desc)) policy->onUnpin(frame);
+}
+
+ReadPageGuard BufMgr::pinForRead(File& file, const PageId pageNo,
+                                 const AccessIntent intent) {
+  Page* page;
+  readPage(file, pageNo, page, intent);
+  const FrameId frame = frameOf(page);
+  bufDescTable[frame].content.lockShared();
+  return ReadPageGuard(this, frame, page);
+}
+
+WritePageGuard BufMgr::pinForWrite(File& file, const PageId pageNo,
+                                   const AccessIntent intent) {
+  Page* page;
+  readPage(file, pageNo, page, intent);
+  const FrameId frame = frameOf(page);
+  bufDescTable[frame].content.lock();
+  return WritePageGuard(this, frame, page, false);
+}
+
+WritePageGuard BufMgr::allocForWrite(File& file, const AccessIntent intent) {
+  PageId pageNo;
+  Page* page;
+  allocPage(file, pageNo, page, intent);
+  const FrameId frame = frameOf(page);
+  bufDescTable[frame].content.lock();
+  return WritePageGuard(this, frame, page, true);
 }
 
 /**
@@ -199,75 +1678,102 @@ void BufMgr::unPinPage(File& file, const PageId pageNo, const bool dirty) {
  * @param page  	Reference to page pointer. The newly allocated in-memory
  * Page object is returned via this reference.
  */
-void BufMgr::allocPage(File& file, PageId& pageNo, Page*& page) {
+void BufMgr::allocPage(File& file, PageId& pageNo, Page*& page,
+                       const AccessIntent intent) {
 
+  addStat(BufStats::ACCESSES);
   FrameId frameNo;
-  // Allocate an empty page in the specified file
-  Page newPage = file.allocatePage();
-
-  // return page number of newly allocated page
-  pageNo = newPage.page_number();
 
-  // Call allocBuf() to obtain buffer pool frame
-  allocBuf(frameNo);
+  // Call allocBuf() to obtain buffer pool frame first, so a full pool does
+  // not leave a page allocated in the file
+  std::unique_lock<std::mutex> frame_latch =
+      allocFor(intent, placeFor(file, Page::INVALID_NUMBER), frameNo);
 
-  // insert entry and call Set() on the frame 
-  hashTable.insert(file, pageNo, frameNo);
-
-  // Update frame description
+  // Allocate an empty page in the specified file right in the frame, update
+  // frame description
   BufDesc *f = &bufDescTable[frameNo];
-  f->Set(file, pageNo);
+  try {
+    std::lock_guard<std::mutex> file_latch(fileLatch);
+    file.allocatePage(bufPool[frameNo]);
+    f->Set(file, bufPool[frameNo].page_number());
+    setPins(*f, 1);
+  } catch (...) {
+    frame_latch.unlock();
+    pushFree(frameNo);
+    throw;
+  }
+  applyIntent(*f, intent);
+  addResident(*f);
+  addStat(BufStats::DISK_READS);
+  addFileStat(file, FILE_DISK_READS);
 
-  // Allocate new allocated page to buffer pool frame
-  bufPool[frameNo] = newPage;
+  // return page number of newly allocated page
+  pageNo = bufPool[frameNo].page_number();
+
+  // insert entry; nobody else can know the page number yet
+  PageTableShard& shard = shardFor(file, pageNo);
+  {
+    std::lock_guard<std::mutex> shard_latch(shard.latch);
+    shard.table.insert(file, pageNo, frameNo);
+  }
+  policy->onLoad(frameNo, keyOf(file, pageNo));
+  policy->onPin(frameNo);
 
   // return new page by reference
   page = &bufPool[frameNo];
+  addNodeStat(frameNo);
 }
 
 /**
- * @brief Scan bufTable for pages belonging to the file, for each page encountered it should:
- * (a) if the page is dirty, call file.writePage() to flush the page to disk and then set the
- * dirty bit for the page to false,
- * (b) remove the page from the hashtable (whether the page is
- * clean or dirty) and 
- * (c) invoke the Clear() method of BufDesc for the page frame.
- * 
- * @param file 
+ * @brief Writes the file's dirty pages in runs, then evicts each of its pages
+ * from the pool; evict() only writes pages that were dirtied again meanwhile.
+ *
+ * @param file
  * @throws PagePinnedException If some page of the file is pinned
- * @throws BadBufferException If an invalid page belonging to the file is encoutered
  */
 void BufMgr::flushFile(File& file) {
 
-  // scan bufDescTable (frames)
-  for (auto& bd : bufDescTable) {
+  // a prefetch in progress holds its pages pinned
+  waitForPrefetches();
 
-    // finds page associated with the file
-    if (bd.file == file) {
+  const std::vector<std::pair<PageId, FrameId>> pages = residentPages(file);
+  writeRuns(file, pages);
 
-      // if page of file is pinned
-      if (bd.pinCnt > 0){
-        throw PagePinnedException(bd.file.filename(), bd.pageNo, bd.frameNo);
-      }
+  for (const std::pair<PageId, FrameId>& entry : pages) {
+    BufDesc& bd = bufDescTable[entry.second];
+    std::unique_lock<std::mutex> frame_latch(bd.latch);
 
-      // if invalid page
-      if (!bd.valid){
-        throw BadBufferException(bd.frameNo, bd.dirty, bd.valid, bd.refbit);
-      }
+    // the frame may have been given to another page before we latched it
+    if (!bd.valid || bd.file != file || bd.pageNo != entry.first) continue;
 
-      // if page is dirty, flush page to disk and set dirty bit to false
-      if (bd.dirty){
-        file.writePage(file.readPage(bd.pageNo));
-        bd.dirty = false;
-      }
+    // if page of file is pinned
+    if (bd.pinCnt > 0) {
+      throw PagePinnedException(bd.file.filename(), bd.pageNo, bd.frameNo);
+    }
 
-      // remove page from hashtable
-      hashTable.remove(file, bd.pageNo);
-      
-      // invoke clear method
-      bd.clear();
+    // remove page from hashtable and invoke clear method
+    bool written;
+    if (!evict(bd, written, false /* demote */)) {
+      throw PagePinnedException(file.filename(), bd.pageNo, bd.frameNo);
     }
+    policy->onRemove(bd.frameNo);
+    frame_latch.unlock();
+    pushFree(bd.frameNo);
   }
+
+  // the file may be closed now, and its pages never asked for again
+  if (victimCache) victimCache->dropFile(file.id());
+
+  // the file header is cached by File and written lazily, write it too
+  std::lock_guard<std::mutex> file_latch(fileLatch);
+  file.flush();
+}
+
+std::uint32_t BufMgr::flushDirty(File& file) {
+  const std::uint32_t written = writeRuns(file, residentPages(file));
+  std::lock_guard<std::mutex> file_latch(fileLatch);
+  file.flush();
+  return written;
 }
 
 /**
@@ -280,31 +1786,402 @@ void BufMgr::flushFile(File& file) {
  */
 void BufMgr::disposePage(File& file, const PageId PageNo) {
 
+  waitForPrefetches();
+
   FrameId frameNo;
+  PageTableShard& shard = shardFor(file, PageNo);
+
+  // if the page has a frame, free it and remove its hashtable entry
+  bool found;
+  {
+    std::lock_guard<std::mutex> shard_latch(shard.latch);
+    found = shard.table.tryLookup(file, PageNo, frameNo);
+    if (found && bufDescTable[frameNo].pinCnt > 0)
+      throw PagePinnedException(file.filename(), PageNo, frameNo);
+  }
+  if (found) {
+    BufDesc *bd = &bufDescTable[frameNo];
+    std::unique_lock<std::mutex> frame_latch(bd->latch);
+
+    // the frame may have been given to another page before we latched it
+    if (bd->valid && bd->file == file && bd->pageNo == PageNo) {
+      {
+        // or the page pinned again
+        std::lock_guard<std::mutex> shard_latch(shard.latch);
+        if (bd->pinCnt > 0)
+          throw PagePinnedException(file.filename(), PageNo, frameNo);
+        shard.table.remove(file, PageNo);
+      }
 
-  // get frameNo
-  hashTable.lookup(file, PageNo, frameNo);
-  
-  // finds frame and frees it, remove entry from hashtable
-  for (BufDesc bd: bufDescTable){
-    if (bd.frameNo == frameNo){
-      bd.clear();
-      hashTable.remove(file, PageNo);
+      // the page is going away, so its changes are dropped
+      takeDirty(*bd);
+      removeResident(*bd);
+      {
+        std::lock_guard<std::mutex> file_latch(fileLatch);
+        bd->clear();
+      }
+      policy->onRemove(frameNo);
+      frame_latch.unlock();
+      pushFree(frameNo);
     }
   }
+
+  if (victimCache) victimCache->drop(file.id(), PageNo);
+
+  // delete the page from the file itself
+  std::lock_guard<std::mutex> file_latch(fileLatch);
+  file.deletePage(PageNo);
 }
 
-void BufMgr::printSelf(void) {
-  int validFrames = 0;
+BufStats BufMgr::getBufStats() const {
+  BufStats stats;
+  stats.accesses = bufStats.value(BufStats::ACCESSES);
+  stats.hits = bufStats.value(BufStats::HITS);
+  stats.misses = bufStats.value(BufStats::MISSES);
+  stats.diskreads = bufStats.value(BufStats::DISK_READS);
+  stats.diskwrites = bufStats.value(BufStats::DISK_WRITES);
+  stats.backgroundwrites = bufStats.value(BufStats::BACKGROUND_WRITES);
+  stats.prefetchreads = bufStats.value(BufStats::PREFETCH_READS);
+  stats.cleanevictions = bufStats.value(BufStats::CLEAN_EVICTIONS);
+  stats.dirtyevictions = bufStats.value(BufStats::DIRTY_EVICTIONS);
+  stats.pinwaits = bufStats.value(BufStats::PIN_WAITS);
+  stats.victims = bufStats.value(BufStats::VICTIMS);
+  stats.sweepsteps = bufStats.value(BufStats::SWEEP_STEPS);
+  stats.cappedsweeps = bufStats.value(BufStats::CAPPED_SWEEPS);
+  stats.allpinned = bufStats.value(BufStats::ALL_PINNED);
+  stats.freeframes = bufStats.value(BufStats::FREE_FRAMES);
+  stats.ringreuses = bufStats.value(BufStats::RING_REUSES);
+  stats.crossnode = bufStats.value(BufStats::CROSS_NODE_ACCESSES);
+  stats.spills = bufStats.value(BufStats::PARTITION_SPILLS);
+  stats.victimputs = bufStats.value(BufStats::VICTIM_CACHE_PUTS);
+  stats.victimhits = bufStats.value(BufStats::VICTIM_CACHE_HITS);
+  stats.logforces = bufStats.value(BufStats::LOG_FORCES);
+  stats.readlatency = readLatency.snapshot();
+  stats.writelatency = writeLatency.snapshot();
+  return stats;
+}
+
+FileBufStats BufMgr::getFileStats(const File& file) const {
+  const ShardedCounters<NUM_FILE_BUF_COUNTERS>& counters =
+      file.state_->buffer_counters;
+  FileBufStats stats;
+  stats.hits = counters.value(FILE_HITS);
+  stats.misses = counters.value(FILE_MISSES);
+  stats.diskreads = counters.value(FILE_DISK_READS);
+  stats.diskwrites = counters.value(FILE_DISK_WRITES);
+  return stats;
+}
+
+bool BufMgr::peekFrame(BufDesc& desc, FileId& fileId, std::string& filename,
+                       PageId& pageNo) {
+  std::unique_lock<std::mutex> frameLatch(desc.latch, std::try_to_lock);
+  if (!frameLatch.owns_lock()) return false;
+  // the frame's File keeps the name alive while the latch is held
+  fileId = desc.valid ? desc.file.id() : 0;
+  if (desc.valid) filename = desc.file.filename();
+  pageNo = desc.pageNo;
+  return true;
+}
+
+BufPoolSummary BufMgr::summarize() {
+  BufPoolSummary summary;
+  summary.frames = numBufs;
 
+  std::unordered_map<FileId, std::size_t> fileIndex;
   for (FrameId i = 0; i < numBufs; i++) {
-    std::cout << "FrameNo:" << i << " ";
-    bufDescTable[i].Print();
+    BufDesc& desc = bufDescTable[i];
+    const bool pinned = desc.pinCnt.load(std::memory_order_relaxed) > 0;
+    const bool dirty = desc.dirty.load(std::memory_order_relaxed);
+    const bool referenced = desc.refbit.load(std::memory_order_relaxed);
+    if (pinned) summary.pinned++;
+    if (dirty) summary.dirty++;
+    if (referenced) summary.referenced++;
+    if (referenced && !pinned) summary.referencedUnpinned++;
+
+    FileId fileId;
+    std::string filename;
+    PageId pageNo;
+    if (!peekFrame(desc, fileId, filename, pageNo)) {
+      summary.busy++;
+      continue;
+    }
+    if (fileId == 0) continue;
+    summary.valid++;
 
-    if (bufDescTable[i].valid) validFrames++;
+    auto found = fileIndex.emplace(fileId, summary.files.size());
+    if (found.second) {
+      summary.files.emplace_back();
+      summary.files.back().filename = std::move(filename);
+    }
+    BufPoolFileSummary& perFile = summary.files[found.first->second];
+    perFile.frames++;
+    if (dirty) perFile.dirty++;
+    if (pinned) perFile.pinned++;
+  }
+  std::stable_sort(summary.files.begin(), summary.files.end(),
+                   [](const BufPoolFileSummary& a,
+                      const BufPoolFileSummary& b) {
+                     return a.frames > b.frames;
+                   });
+
+  for (const std::unique_ptr<PageTableShard>& shard : pageTable) {
+    std::uint64_t total;
+    std::uint32_t longest;
+    std::lock_guard<std::mutex> shardLatch(shard->latch);
+    shard->table.probeLengths(total, longest);
+    summary.hashEntries += shard->table.size();
+    summary.hashBuckets += shard->table.buckets();
+    summary.hashProbeTotal += total;
+    summary.hashProbeMax = std::max(summary.hashProbeMax, longest);
   }
+  return summary;
+}
+
+/**
+ * Appends a file name to a frame dump, quoted for the format.
+ */
+static void appendQuoted(std::string& text, const std::string& name,
+                         const FrameDumpFormat format) {
+  text += '"';
+  for (const char c : name) {
+    if (format == FrameDumpFormat::CSV) {
+      if (c == '"') text += '"';
+      text += c;
+    } else if (c == '"' || c == '\\') {
+      text += '\\';
+      text += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char escape[8];
+      std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+      text += escape;
+    } else {
+      text += c;
+    }
+  }
+  text += '"';
+}
+
+void BufMgr::dumpFrames(std::ostream& out, const FrameDumpFormat format) {
+  // Write in chunks this large instead of once per field or frame.
+  const std::size_t CHUNK_BYTES = 64 * 1024;
+  const bool json = format == FrameDumpFormat::JSON;
+
+  std::string text;
+  text.reserve(CHUNK_BYTES + 256);
+  text += json ? "[" : "frame,file,page,valid,busy,pins,dirty,refbit\n";
+
+  for (FrameId i = 0; i < numBufs; i++) {
+    BufDesc& desc = bufDescTable[i];
+    const int pins = desc.pinCnt.load(std::memory_order_relaxed);
+    const bool dirty = desc.dirty.load(std::memory_order_relaxed);
+    const bool referenced = desc.refbit.load(std::memory_order_relaxed);
+    FileId fileId = 0;
+    std::string filename;
+    PageId pageNo = Page::INVALID_NUMBER;
+    const bool busy = !peekFrame(desc, fileId, filename, pageNo);
+    const bool valid = fileId != 0;
+
+    char field[64];
+    if (json) {
+      std::snprintf(field, sizeof(field), "%s\n{\"frame\":%u,\"file\":",
+                    i == 0 ? "" : ",", i);
+      text += field;
+      if (valid)
+        appendQuoted(text, filename, format);
+      else
+        text += "null";
+      if (valid)
+        std::snprintf(field, sizeof(field), ",\"page\":%u", pageNo);
+      else
+        std::snprintf(field, sizeof(field), ",\"page\":null");
+      text += field;
+      std::snprintf(field, sizeof(field),
+                    ",\"valid\":%s,\"busy\":%s,\"pins\":%d,",
+                    valid ? "true" : "false", busy ? "true" : "false", pins);
+      text += field;
+      std::snprintf(field, sizeof(field), "\"dirty\":%s,\"refbit\":%s}",
+                    dirty ? "true" : "false", referenced ? "true" : "false");
+      text += field;
+    } else {
+      std::snprintf(field, sizeof(field), "%u,", i);
+      text += field;
+      if (valid) {
+        appendQuoted(text, filename, format);
+        std::snprintf(field, sizeof(field), ",%u", pageNo);
+        text += field;
+      } else {
+        text += ',';
+      }
+      std::snprintf(field, sizeof(field), ",%d,%d,%d,%d,%d\n", valid, busy,
+                    pins, dirty, referenced);
+      text += field;
+    }
+
+    if (text.size() >= CHUNK_BYTES) {
+      out.write(text.data(), text.size());
+      text.clear();
+    }
+  }
+  if (json) text += "\n]\n";
+  out.write(text.data(), text.size());
+}
+
+/**
+ * Reads back a file name written by appendQuoted() for JSON, which must run
+ * from the given position to the end of the text.
+ *
+ * @return  False if the name is not quoted as appendQuoted() does
+ */
+static bool parseQuoted(const std::string& text, std::size_t pos,
+                        std::string& name) {
+  if (pos >= text.size() || text[pos] != '"') return false;
+  name.clear();
+  for (pos++; pos < text.size(); pos++) {
+    const char c = text[pos];
+    if (c == '"') return pos + 1 == text.size();
+    if (static_cast<unsigned char>(c) < 0x20) return false;
+    if (c != '\\') {
+      name += c;
+      continue;
+    }
+    if (++pos == text.size()) return false;
+    if (text[pos] == '"' || text[pos] == '\\') {
+      name += text[pos];
+      continue;
+    }
+    // only control characters are written by their code
+    if (text.compare(pos, 3, "u00") != 0 || text.size() - pos < 5 ||
+        !std::isxdigit(static_cast<unsigned char>(text[pos + 3])) ||
+        !std::isxdigit(static_cast<unsigned char>(text[pos + 4]))) {
+      return false;
+    }
+    const unsigned long code =
+        std::strtoul(text.substr(pos + 3, 2).c_str(), NULL, 16);
+    if (code >= 0x20) return false;
+    name += static_cast<char>(code);
+    pos += 4;
+  }
+  return false;
+}
+
+/**
+ * Reads the decimal number at the given position and moves past it.
+ *
+ * @return  False if there are no digits there or the number does not fit
+ */
+static bool parseNumber(const std::string& text, std::size_t& pos,
+                        std::uint32_t& value) {
+  const std::size_t start = pos;
+  std::uint64_t number = 0;
+  for (; pos < text.size() && text[pos] >= '0' && text[pos] <= '9'; pos++) {
+    number = number * 10 + (text[pos] - '0');
+    if (number > std::numeric_limits<std::uint32_t>::max()) return false;
+  }
+  value = static_cast<std::uint32_t>(number);
+  return pos > start;
+}
+
+/**
+ * First line of a resident set written by saveResidentSet().
+ */
+static const char RESIDENT_SET_HEADER[] = "badgerdb resident set 2";
+
+std::size_t BufMgr::saveResidentSet(std::ostream& out) {
+  // pages by rank, hottest first; see the declaration
+  const int RANKS = 4;
+  std::vector<std::pair<FileId, PageId>> ranked[RANKS];
+  std::unordered_map<FileId, std::size_t> fileIndex;
+  std::vector<std::string> filenames;
+  for (FrameId i = 0; i < numBufs; i++) {
+    BufDesc& desc = bufDescTable[i];
+    FileId fileId = 0;
+    std::string filename;
+    PageId pageNo;
+    if (!peekFrame(desc, fileId, filename, pageNo) || fileId == 0) continue;
+    int rank = 2;
+    if (desc.scanned.load(std::memory_order_relaxed)) {
+      rank = 3;
+    } else if (desc.keep.load(std::memory_order_relaxed)) {
+      rank = 0;
+    } else if (desc.refbit.load(std::memory_order_relaxed)) {
+      rank = 1;
+    }
+    if (fileIndex.emplace(fileId, filenames.size()).second) {
+      filenames.push_back(std::move(filename));
+    }
+    ranked[rank].emplace_back(fileId, pageNo);
+  }
+
+  std::string text = RESIDENT_SET_HEADER;
+  text += '\n';
+  for (const std::string& name : filenames) {
+    text += "file ";
+    appendQuoted(text, name, FrameDumpFormat::JSON);
+    text += '\n';
+  }
+  std::size_t pages = 0;
+  for (const std::vector<std::pair<FileId, PageId>>& entries : ranked) {
+    for (const std::pair<FileId, PageId>& entry : entries) {
+      char line[32];
+      std::snprintf(line, sizeof(line), "%zu %u\n", fileIndex[entry.first],
+                    entry.second);
+      text += line;
+    }
+    pages += entries.size();
+  }
+  out.write(text.data(), text.size());
+  return pages;
+}
+
+std::size_t BufMgr::warmUp(std::istream& in, std::vector<File>& files,
+                           const bool wait) {
+  std::string line;
+  if (!std::getline(in, line) || line != RESIDENT_SET_HEADER) return 0;
+
+  // files of the saved set by index, NULL for those not given
+  std::unordered_map<std::string, File*> byName;
+  for (File& file : files) byName[file.filename()] = &file;
+  std::vector<File*> saved;
+  std::unordered_map<File*, std::vector<PageId>> pages;
+
+  const std::size_t room = unpinnedFrames();
+  std::size_t wanted = 0;
+  while (wanted < room && std::getline(in, line)) {
+    if (line.compare(0, 5, "file ") == 0) {
+      std::string name;
+      if (!parseQuoted(line, 5, name)) break;
+      const auto found = byName.find(name);
+      saved.push_back(found == byName.end() ? NULL : found->second);
+      continue;
+    }
+    // "<file index> <page number>", nothing else
+    std::size_t pos = 0;
+    std::uint32_t index;
+    PageId pageNo;
+    if (!parseNumber(line, pos, index) || pos == line.size() ||
+        line[pos++] != ' ' || !parseNumber(line, pos, pageNo) ||
+        pos != line.size() || index >= saved.size()) {
+      break;
+    }
+    if (saved[index] == NULL) continue;
+    pages[saved[index]].push_back(pageNo);
+    wanted++;
+  }
+
+  for (std::pair<File* const, std::vector<PageId>>& entry : pages) {
+    prefetch(*entry.first, entry.second.data(), entry.second.size());
+  }
+  if (wait) waitForPrefetches();
+  return wanted;
+}
+
+void BufMgr::printSelf(void) {
+  dumpFrames(std::cout, FrameDumpFormat::CSV);
 
-  std::cout << "Total Number of Valid Frames:" << validFrames << "\n";
+  const BufPoolSummary summary = summarize();
+  std::cout << "Total Number of Valid Frames:" << summary.valid
+            << " dirty:" << summary.dirty << " pinned:" << summary.pinned
+            << " referenced:" << summary.referenced << "\n";
 }
 
 }  // namespace badgerdb
@@ -8,11 +8,34 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include "bufHashTbl.h"
 #include "file.h"
+#include "frame_arena.h"
+#include "io_engine.h"
+#include "log_manager.h"
+#include "page_guard.h"
+#include "page_latch.h"
+#include "partitioned_policy.h"
+#include "replacement_policy.h"
+#include "sharded_counters.h"
+#include "victim_cache.h"
 
 namespace badgerdb {
 
@@ -21,15 +44,56 @@ namespace badgerdb {
  */
 class BufMgr;
 
+/**
+ * @brief How a page asked for from the buffer pool is going to be used, a
+ * hint for which pages to keep.
+ */
+enum class AccessIntent {
+  /**
+   * Ordinary access: the page counts as referenced.
+   */
+  NORMAL,
+
+  /**
+   * Part of a large scan: a page read for it goes into a small ring of
+   * frames that later scan pages reuse, and a hit does not make a page look
+   * recently used.
+   */
+  SEQUENTIAL,
+
+  /**
+   * Used once: the page is read in as not referenced, so it is among the
+   * first to be evicted, and a hit does not make a page look recently used.
+   */
+  ONCE,
+
+  /**
+   * Part of the working set: like NORMAL, and the frame is passed over once
+   * more than others when a victim is picked.
+   */
+  KEEP,
+};
+
 /**
  * @brief Class for maintaining information about buffer pool frames
+ *
+ * The frame latch is held by whoever is changing which page the frame holds
+ * (loading, evicting, flushing or disposing it) and serializes those; the
+ * file, pageNo and valid fields only change under it.  Pins only ever happen
+ * while the page is in the page table and are taken under its shard latch,
+ * so a frame latch holder that finds the pin count at zero under the shard
+ * latch knows nobody can reach the page any more once it is unmapped.
+ *
+ * A page missed is entered into the page table before it is read, in a
+ * frame pinned by the reader and marked loading, so a page is never read
+ * into two frames at once.
  */
 class BufDesc {
  public:
   /**
    * Constructor of BufDesc class
    */
-  BufDesc() { clear(); }
+  BufDesc() : pinCnt(0), loading(false) { clear(); }
 
  private:
   friend class BufMgr;
@@ -48,15 +112,22 @@ class BufDesc {
    */
   FrameId frameNo;
 
+  /**
+   * Partition the frame is in and the NUMA node its memory is placed on,
+   * see NumaConfig; fixed at construction
+   */
+  std::uint32_t partition;
+  std::uint32_t node;
+
   /**
    * Number of times this page has been pinned
    */
-  int pinCnt;
+  std::atomic<int> pinCnt;
 
   /**
    * True if page is dirty;  false otherwise
    */
-  bool dirty;
+  std::atomic<bool> dirty;
 
   /**
    * True if page is valid
@@ -66,24 +137,64 @@ class BufDesc {
   /**
    * Has this buffer frame been reference recently
    */
-  bool refbit;
+  std::atomic<bool> refbit;
+
+  /**
+   * Whether the page was read in for an AccessIntent::SEQUENTIAL access and
+   * not asked for otherwise since, which lets the scan ring reuse the frame
+   */
+  std::atomic<bool> scanned;
+
+  /**
+   * Whether the page was last asked for with AccessIntent::KEEP and not
+   * passed over for it yet
+   */
+  std::atomic<bool> keep;
+
+  /**
+   * Whether the frame is in the page table for a page that is still being
+   * read into it.  Changes under the page's shard latch; readers that find
+   * it set wait for the read instead of doing their own.
+   */
+  std::atomic<bool> loading;
+
+  /**
+   * Frame latch, see the class description
+   */
+  std::mutex latch;
 
   /**
-   * Initialize buffer frame for a new user
+   * Latch on the page contents, taken by page guards: shared by
+   * ReadPageGuard, exclusive by WritePageGuard.  The buffer manager itself
+   * never takes it, so it comes before all of its latches.
+   */
+  PageLatch content;
+
+  /**
+   * Position of the frame in its file's list in BufMgr::residentFrames while
+   * the frame is valid
+   */
+  std::uint32_t residentIndex;
+
+  /**
+   * Initialize buffer frame for a new user.  The pin count is left to
+   * BufMgr::setPins().
    */
   void clear() {
-    pinCnt = 0;
     file = File();
     pageNo = Page::INVALID_NUMBER;
     dirty = false;
     refbit = false;
+    scanned = false;
+    keep = false;
     valid = false;
   }
 
   /**
    * Set values of member variables corresponding to assignment of frame to a
    * page in the file. Called when a frame in buffer pool is allocated to any
-   * page in the file through readPage() or allocPage()
+   * page in the file through readPage() or allocPage().  The caller pins
+   * the frame with BufMgr::setPins().
    *
    * @param filePtr	File object
    * @param pageNum	Page number in the file
@@ -91,188 +202,1675 @@ class BufDesc {
   void Set(File& file, PageId pageNum) {
     this->file = file;
     pageNo = pageNum;
-    pinCnt = 1;
     dirty = false;
     valid = true;
     refbit = true;
+    scanned = false;
+    keep = false;
   }
 
-  void Print() {
-    if (file.isValid()) {
-      std::cout << "file:" << file.filename() << " ";
-      std::cout << "pageNo:" << pageNo << " ";
-    } else
-      std::cout << "file:NULL ";
-
-    std::cout << "valid:" << valid << " ";
-    std::cout << "pinCnt:" << pinCnt << " ";
-    std::cout << "dirty:" << dirty << " ";
-    std::cout << "refbit:" << refbit << "\n";
-  }
 };
 
 /**
- * @brief Class to maintain statistics of buffer usage
+ * @brief Snapshot of the statistics of buffer usage, see
+ * BufMgr::getBufStats()
  */
 struct BufStats {
+  /**
+   * Counters BufMgr keeps, one per field below
+   */
+  enum Counter {
+    ACCESSES,
+    HITS,
+    MISSES,
+    DISK_READS,
+    DISK_WRITES,
+    BACKGROUND_WRITES,
+    PREFETCH_READS,
+    CLEAN_EVICTIONS,
+    DIRTY_EVICTIONS,
+    PIN_WAITS,
+    VICTIMS,
+    SWEEP_STEPS,
+    CAPPED_SWEEPS,
+    ALL_PINNED,
+    FREE_FRAMES,
+    RING_REUSES,
+    CROSS_NODE_ACCESSES,
+    PARTITION_SPILLS,
+    VICTIM_CACHE_PUTS,
+    VICTIM_CACHE_HITS,
+    LOG_FORCES,
+    NUM_COUNTERS
+  };
+
   /**
    * Total number of accesses to buffer pool
    */
-  int accesses;
+  std::uint64_t accesses = 0;
+
+  /**
+   * Number of pages asked for that were in the pool
+   */
+  std::uint64_t hits = 0;
+
+  /**
+   * Number of pages asked for that were not in the pool
+   */
+  std::uint64_t misses = 0;
 
   /**
    * Number of pages read from disk (including allocs)
    */
-  int diskreads;
+  std::uint64_t diskreads = 0;
 
   /**
    * Number of pages written back to disk
    */
-  int diskwrites;
+  std::uint64_t diskwrites = 0;
+
+  /**
+   * Number of the diskwrites done by the background writer
+   */
+  std::uint64_t backgroundwrites = 0;
+
+  /**
+   * Number of the diskreads done ahead of time for prefetch()
+   */
+  std::uint64_t prefetchreads = 0;
+
+  /**
+   * Number of pages evicted to make room that did not need writing back
+   */
+  std::uint64_t cleanevictions = 0;
+
+  /**
+   * Number of pages evicted to make room that were written back first
+   */
+  std::uint64_t dirtyevictions = 0;
+
+  /**
+   * Number of times a frame allocation waited because every frame it could
+   * take was latched by another thread
+   */
+  std::uint64_t pinwaits = 0;
+
+  /**
+   * Number of victims the replacement policy picked
+   */
+  std::uint64_t victims = 0;
+
+  /**
+   * Number of frames the replacement policy looked at to pick them
+   */
+  std::uint64_t sweepsteps = 0;
+
+  /**
+   * Number of victim picks that used up AllocConfig::maxSweepSteps and took
+   * the next frame they could claim regardless of its reference bit
+   */
+  std::uint64_t cappedsweeps = 0;
+
+  /**
+   * Number of frame allocations that found every frame pinned, whether they
+   * then waited for an unpin or failed
+   */
+  std::uint64_t allpinned = 0;
+
+  /**
+   * Number of frames allocated from the free list without asking the
+   * replacement policy
+   */
+  std::uint64_t freeframes = 0;
+
+  /**
+   * Number of frames reused by the scan ring, see AccessIntent::SEQUENTIAL
+   */
+  std::uint64_t ringreuses = 0;
+
+  /**
+   * Number of page accesses from a thread on another NUMA node than the
+   * frame's partition, see NumaConfig
+   */
+  std::uint64_t crossnode = 0;
+
+  /**
+   * Number of frame allocations that had to look outside the partition the
+   * page was placed in, because that partition had no frame to spare
+   */
+  std::uint64_t spills = 0;
+
+  /**
+   * Number of evicted pages put in the victim cache, see VictimCacheConfig
+   */
+  std::uint64_t victimputs = 0;
+
+  /**
+   * Number of pages not in the pool that were taken from the victim cache
+   * instead of read from disk
+   */
+  std::uint64_t victimhits = 0;
+
+  /**
+   * Number of page writes that had to make the write-ahead log durable up
+   * to the page's LSN first, see BufMgr::setLog()
+   */
+  std::uint64_t logforces = 0;
 
   /**
-   * Clear all values
+   * Latencies of reads from disk, one per read request
    */
-  void clear() { accesses = diskreads = diskwrites = 0; }
+  LatencySnapshot readlatency;
 
   /**
-   * Constructor of BufStats class
+   * Latencies of writes to disk, one per write request
    */
-  BufStats() { clear(); }
+  LatencySnapshot writelatency;
+
+  /**
+   * Returns the average number of frames looked at per victim picked.
+   */
+  double sweepStepsPerVictim() const {
+    return victims > 0 ? static_cast<double>(sweepsteps) / victims : 0;
+  }
 };
 
 /**
- * @brief The central class which manages the buffer pool including frame
- * allocation and deallocation to pages in the file
+ * @brief Snapshot of the buffer pool statistics of one file, see
+ * BufMgr::getFileStats().  Counted by every BufMgr the file is used with.
  */
-class BufMgr {
- private:
+struct FileBufStats {
   /**
-   * Current position of clockhand in our buffer pool
+   * Number of the file's pages asked for that were in the pool
    */
-  FrameId clockHand;
+  std::uint64_t hits = 0;
 
   /**
-   * Number of frames in the buffer pool
+   * Number of the file's pages asked for that were not in the pool
    */
-  std::uint32_t numBufs;
+  std::uint64_t misses = 0;
 
   /**
-   * Hash table mapping (File, page) to frame
+   * Number of the file's pages read from disk
    */
-  BufHashTbl hashTable;
+  std::uint64_t diskreads = 0;
 
   /**
-   * Array of BufDesc objects to hold information corresponding to every frame
-   * allocation from 'bufPool' (the buffer pool)
+   * Number of the file's pages written back to disk
    */
-  std::vector<BufDesc> bufDescTable;
+  std::uint64_t diskwrites = 0;
+};
 
+/**
+ * @brief Frames of one file resident in the buffer pool, see BufPoolSummary
+ */
+struct BufPoolFileSummary {
   /**
-   * Maintains Buffer pool usage statistics
+   * Name of the file
    */
-  BufStats bufStats;
+  std::string filename;
 
   /**
-   * Advance clock to next frame in the buffer pool
+   * Number of frames holding pages of the file
    */
-  void advanceClock();
+  std::uint32_t frames = 0;
 
   /**
-   * Allocate a free frame.
-   *
-   * @param frame   	Frame reference, frame ID of allocated frame returned
-   * via this variable
-   * @throws BufferExceededException If no such buffer is found which can be
-   * allocated
+   * Number of those frames that are dirty
    */
-  void allocBuf(FrameId& frame);
+  std::uint32_t dirty = 0;
 
- public:
   /**
-   * Actual buffer pool from which frames are allocated
+   * Number of those frames that are pinned
    */
-  std::vector<Page> bufPool;
+  std::uint32_t pinned = 0;
+};
 
+/**
+ * @brief Summary of what the buffer pool holds, see BufMgr::summarize()
+ *
+ * Frames whose latch was held by a thread loading, evicting or flushing
+ * them are counted as busy; their flags are counted but not their file.
+ */
+struct BufPoolSummary {
   /**
-   * Constructor of BufMgr class
+   * Number of frames in the pool
    */
-  BufMgr(std::uint32_t bufs);
+  std::uint32_t frames = 0;
 
   /**
-   * Reads the given page from the file into a frame and returns the pointer to
-   * page. If the requested page is already present in the buffer pool pointer
-   * to that frame is returned otherwise a new frame is allocated from the
-   * buffer pool for reading the page.
-   *
-   * @param file   	File object
-   * @param PageNo  Page number in the file to be read
-   * @param page  	Reference to page pointer. Used to fetch the Page object
-   * in which requested page from file is read in.
+   * Number of frames holding a page
    */
-  void readPage(File& file, const PageId pageNo, Page*& page);
+  std::uint32_t valid = 0;
 
   /**
-   * Unpin a page from memory since it is no longer required for it to remain in
-   * memory.
-   *
-   * @param file   	File object
-   * @param PageNo  Page number
-   * @param dirty		True if the page to be unpinned needs to be
-   * marked dirty
-   * @throws  PageNotPinnedException If the page is not already pinned
+   * Number of frames that could not be looked at without waiting
    */
-  void unPinPage(File& file, const PageId pageNo, const bool dirty);
+  std::uint32_t busy = 0;
 
   /**
-   * Allocates a new, empty page in the file and returns the Page object.
-   * The newly allocated page is also assigned a frame in the buffer pool.
-   *
-   * @param file   	File object
-   * @param PageNo  Page number. The number assigned to the page in the file is
-   * returned via this reference.
-   * @param page  	Reference to page pointer. The newly allocated in-memory
-   * Page object is returned via this reference.
+   * Number of dirty frames
    */
-  void allocPage(File& file, PageId& pageNo, Page*& page);
+  std::uint32_t dirty = 0;
 
   /**
-   * Writes out all dirty pages of the file to disk.
-   * All the frames assigned to the file need to be unpinned from buffer pool
-   * before this function can be successfully called. Otherwise Error returned.
-   *
-   * @param file   	File object
-   * @throws  PagePinnedException If any page of the file is pinned in the
-   * buffer pool
-   * @throws BadBufferException If any frame allocated to the file is found to
-   * be invalid
+   * Number of pinned frames
    */
-  void flushFile(File& file);
+  std::uint32_t pinned = 0;
 
   /**
-   * Delete page from file and also from buffer pool if present.
-   * Since the page is entirely deleted from file, its unnecessary to see if the
-   * page is dirty.
-   *
-   * @param file   	File object
-   * @param PageNo  Page number
+   * Number of frames with the reference bit set
    */
-  void disposePage(File& file, const PageId PageNo);
+  std::uint32_t referenced = 0;
 
   /**
-   * Print member variable values.
+   * Number of unpinned frames with the reference bit set, which the clock
+   * hand has to pass once more before it can evict them
    */
-  void printSelf();
+  std::uint32_t referencedUnpinned = 0;
+
+  /**
+   * Frames per file, the files with most frames first
+   */
+  std::vector<BufPoolFileSummary> files;
+
+  /**
+   * Number of entries in the page table, over all shards
+   */
+  std::uint64_t hashEntries = 0;
+
+  /**
+   * Number of buckets in the page table, over all shards
+   */
+  std::uint64_t hashBuckets = 0;
+
+  /**
+   * Sum of the probe lengths of all page table entries, see
+   * BufHashTbl::probeLengths()
+   */
+  std::uint64_t hashProbeTotal = 0;
+
+  /**
+   * Longest probe length in the page table
+   */
+  std::uint32_t hashProbeMax = 0;
+
+  /**
+   * Returns the average number of buckets a lookup of a resident page looks
+   * at.
+   */
+  double meanProbeLength() const {
+    return hashEntries == 0 ? 0.0
+                            : static_cast<double>(hashProbeTotal) / hashEntries;
+  }
+};
+
+/**
+ * @brief Output formats of BufMgr::dumpFrames()
+ */
+enum class FrameDumpFormat {
+  /**
+   * A header line and one comma separated line per frame
+   */
+  CSV,
+
+  /**
+   * An array with one object per frame
+   */
+  JSON,
+};
+
+/**
+ * @brief Settings of the buffer manager's background writer
+ *
+ * Once the share of dirty frames reaches the high watermark the writer
+ * thread writes unpinned dirty pages back, without evicting them, until it
+ * is down to the low watermark.  Victims then rarely need a write before
+ * they can be reused.
+ */
+struct BackgroundWriterConfig {
+  /**
+   * Whether to run the writer thread at all
+   */
+  bool enabled = true;
+
+  /**
+   * Fraction of frames that may be dirty before the writer starts
+   */
+  double highWatermark = 0.25;
+
+  /**
+   * Fraction of frames left dirty when the writer stops
+   */
+  double lowWatermark = 0.10;
+
+  /**
+   * How often the writer checks the watermark on its own, in milliseconds.
+   * It is also woken as soon as the high watermark is crossed.
+   */
+  int intervalMs = 100;
+};
+
+/**
+ * @brief Settings of a checkpoint, see BufMgr::checkpoint()
+ */
+struct CheckpointConfig {
+  /**
+   * Frames looked at, and their dirty pages written, per slice
+   */
+  std::uint32_t sliceFrames = 1024;
+
+  /**
+   * Most pages written per second, spread over the slices; 0 for no limit
+   */
+  std::uint32_t pagesPerSecond = 0;
+
+  /**
+   * Passes over the pages that were pinned, and so skipped, after the first
+   * pass over the whole pool
+   */
+  std::uint32_t revisits = 3;
+
+  /**
+   * Pause before each of those passes, in milliseconds, for the pins to go
+   */
+  int revisitDelayMs = 10;
+};
+
+/**
+ * @brief Outcome of a checkpoint, see BufMgr::checkpoint()
+ */
+struct CheckpointStats {
+  /**
+   * Number of pages written
+   */
+  std::uint64_t written = 0;
+
+  /**
+   * Number of passes over the pool, the first included
+   */
+  std::uint32_t passes = 0;
+
+  /**
+   * Number of dirty pages still pinned after the last revisit, or not looked
+   * at as the buffer manager went away; not written
+   */
+  std::uint64_t skipped = 0;
+
+  /**
+   * End of the write-ahead log when the checkpoint began, 0 without one
+   * (see BufMgr::setLog()).  If no page was skipped, every change logged
+   * before it is on disk, so recovery can start replaying there.
+   */
+  Lsn redoLsn = 0;
+};
+
+/**
+ * @brief Settings of how the buffer manager finds a frame for a page
+ */
+struct AllocConfig {
+  /**
+   * Most frames the replacement policy may look at per victim before
+   * reference bits are ignored, so the pick ends at the next frame that can
+   * be claimed; 0 leaves the sweep to the policy
+   */
+  std::uint32_t maxSweepSteps = 1024;
+
+  /**
+   * How long an allocation waits for a page to be unpinned when every frame
+   * is pinned before throwing BufferExceededException; 0 fails at once
+   */
+  int pinWaitMs = 0;
+
+  /**
+   * Most frames in the ring AccessIntent::SEQUENTIAL reads reuse, which is
+   * also kept to an eighth of the pool; 0 reads scan pages like ONCE
+   */
+  std::uint32_t scanRingFrames = 32;
 
   /**
-   * Get buffer pool usage statistics
+   * Most frames BufMgr::resize() can grow the pool to, all reserved (but not
+   * touched) at construction; below the initial size the pool cannot grow
    */
-  BufStats& getBufStats() { return bufStats; }
+  std::uint32_t maxFrames = 0;
+};
+
+/**
+ * @brief Which partition of a partitioned buffer pool a page is read into
+ */
+enum class NumaPlacement {
+  /**
+   * By a hash of the page, the same one that picks its page table shard, so
+   * each shard's pages share a partition when the partition count divides
+   * the shard count.
+   */
+  HASH,
 
   /**
-   * Clear buffer pool usage statistics
+   * A partition on the NUMA node of the thread reading the page.
    */
-  void clearBufStats() { bufStats.clear(); }
+  LOCAL,
+};
+
+/**
+ * @brief Settings for splitting the buffer pool across NUMA nodes
+ *
+ * Each partition is a contiguous range of frames whose memory is placed on
+ * one node (partition i on node i modulo the node count) with its own
+ * replacement policy and free list.  A page goes to the partition its
+ * placement picks, or to another one if that has no frame to spare.
+ */
+struct NumaConfig {
+  /**
+   * Number of partitions; 1 keeps the pool whole, 0 makes one per NUMA node
+   * of the host.  At most one per frame.
+   */
+  std::uint32_t partitions = 1;
+
+  /**
+   * How pages are placed in partitions
+   */
+  NumaPlacement placement = NumaPlacement::HASH;
+};
+
+/**
+ * @brief The central class which manages the buffer pool including frame
+ * allocation and deallocation to pages in the file
+ *
+ * All public methods may be called concurrently.  The page table is split
+ * into shards with a latch each and every frame has its own latch (see
+ * BufDesc), so threads working on different pages do not contend.  Lock
+ * order is frame latch, then shard latch, then the file latch; the file
+ * latch is never held while acquiring another one.
+ *
+ * Which frame to reuse is left to a ReplacementPolicy chosen at
+ * construction.  Policies may take their own lock while a frame latch is
+ * held, but only claim frames without blocking.
+ *
+ * File objects are not threadsafe, so the buffer manager serializes the
+ * calls it makes into them that use a file's header or page map with the
+ * file latch.  Page reads and writes are checked against the page map under
+ * it, but go to the file's backend without it, so misses and write-backs on
+ * different threads overlap.  Page hits never take it.
+ */
+class BufMgr {
+ private:
+  friend class PageGuard;
+
+  /**
+   * @brief One independently latched partition of the page table
+   */
+  struct PageTableShard {
+    /**
+     * Protects the table, and pin count changes of the pages in it
+     */
+    std::mutex latch;
+
+    /**
+     * Hash table mapping (File, page) to frame for this shard's pages
+     */
+    BufHashTbl table;
+
+    explicit PageTableShard(const int htSize) : table(htSize) {}
+  };
+
+  /**
+   * @brief The frames as offered to the replacement policy.  A successful
+   * claim keeps the frame latched for the caller of pickVictim.
+   */
+  class ClaimableFrames : public FrameView {
+   public:
+    ClaimableFrames(std::vector<BufDesc>& descs,
+                    const std::atomic<std::uint32_t>& active,
+                    const std::uint32_t maxSteps)
+        : steps(0), busy(false), capped(false), spared(false), descs(descs),
+          active(active), maxSteps(maxSteps) {}
+
+    /**
+     * Past maxSteps every frame looks unreferenced, without its bit being
+     * cleared, so that the policy takes the next frame it can claim.
+     */
+    bool testAndClearRefbit(const FrameId frame) override {
+      if (++steps > maxSteps) {
+        capped = true;
+        return false;
+      }
+      return descs[frame].refbit.exchange(false);
+    }
+
+    bool tryClaim(const FrameId frame) override;
+
+    /**
+     * Latch of the claimed frame
+     */
+    std::unique_lock<std::mutex> claimed;
+
+    /**
+     * Number of times the policy looked at a frame
+     */
+    std::uint32_t steps;
+
+    /**
+     * Whether a frame was passed over because its latch was taken
+     */
+    bool busy;
+
+    /**
+     * Whether the policy looked at more than maxSteps frames
+     */
+    bool capped;
+
+    /**
+     * Whether a frame was passed over for AccessIntent::KEEP
+     */
+    bool spared;
+
+   private:
+    std::vector<BufDesc>& descs;
+
+    /**
+     * Number of frames in use; frames past it are never claimed
+     */
+    const std::atomic<std::uint32_t>& active;
+
+    const std::uint32_t maxSteps;
+  };
+
+  /**
+   * Number of frames in the buffer pool: frames [0, numBufs) are in use,
+   * the others wait for resize() to grow the pool into them
+   */
+  std::atomic<std::uint32_t> numBufs;
+
+  /**
+   * Most frames the pool can grow to, see AllocConfig::maxFrames
+   */
+  const std::uint32_t maxBufs;
+
+  /**
+   * Serializes resize() calls; taken before any other latch
+   */
+  std::mutex resizeLatch;
+
+  /**
+   * Shards of the hash table mapping (File, page) to frame
+   */
+  std::vector<std::unique_ptr<PageTableShard>> pageTable;
+
+  /**
+   * Number of page table shards minus one (shard count is a power of two)
+   */
+  std::uint32_t shardMask;
+
+  /**
+   * Array of BufDesc objects to hold information corresponding to every frame
+   * allocation from 'bufPool' (the buffer pool)
+   */
+  std::vector<BufDesc> bufDescTable;
+
+  /**
+   * Frames known to hold no page, one list per partition, taken by
+   * allocBuf() before the replacement policy is asked for a victim.  The
+   * policy may still claim a listed frame, so entries are checked when they
+   * are taken.
+   */
+  std::vector<std::vector<FrameId>> freeFrames;
+
+  /**
+   * Whether each frame is in freeFrames, so it is never listed twice
+   */
+  std::vector<bool> freeListed;
+
+  /**
+   * Protects freeFrames and freeListed; taken after all other latches
+   */
+  std::mutex freeLatch;
+
+  /**
+   * Frames holding pages of each file, in no particular order, so that
+   * flushing a file does not scan the whole pool.  Frames join after
+   * BufDesc::Set() and leave before BufDesc::clear(), under their frame
+   * latch.
+   */
+  std::unordered_map<FileId, std::vector<FrameId>> residentFrames;
+
+  /**
+   * Protects residentFrames and the residentIndex of frames; taken after all
+   * other latches
+   */
+  std::mutex residentLatch;
+
+  /**
+   * Frames of the scan ring, in the order they are reused; grows to
+   * scanRingSize
+   */
+  std::vector<FrameId> scanRing;
+
+  /**
+   * Number of frames in a full scan ring
+   */
+  std::uint32_t scanRingSize;
+
+  /**
+   * Position in scanRing of the frame to reuse next
+   */
+  std::uint32_t scanRingNext;
+
+  /**
+   * Protects scanRing and scanRingNext; taken after all other latches
+   */
+  std::mutex scanRingLatch;
+
+  /**
+   * Memory of the buffer pool frames, which the pages in bufPool are views of
+   */
+  FrameArena arena;
+
+  /**
+   * Maintains Buffer pool usage statistics, indexed by BufStats::Counter
+   */
+  ShardedCounters<BufStats::NUM_COUNTERS> bufStats;
+
+  /**
+   * Latencies of reads and writes, see BufStats
+   */
+  LatencyHistogram readLatency;
+  LatencyHistogram writeLatency;
+
+  /**
+   * Adds to a pool-wide statistics counter.
+   */
+  void addStat(const BufStats::Counter counter, const std::uint64_t n = 1) {
+    bufStats.add(counter, n);
+  }
+
+  /**
+   * Adds to a statistics counter of a file.
+   */
+  static void addFileStat(const File& file, const FileBufCounter counter,
+                           const std::uint64_t n = 1) {
+    file.state_->buffer_counters.add(counter, n);
+  }
+
+  /**
+   * Records the time since <start> in a latency histogram.
+   */
+  static void recordLatency(LatencyHistogram& histogram,
+                            const std::chrono::steady_clock::time_point start) {
+    histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         std::chrono::steady_clock::now() - start)
+                         .count());
+  }
+
+  /**
+   * Serializes the buffer manager's calls into File objects that use their
+   * header or page map; page I/O happens without it
+   */
+  std::mutex fileLatch;
+
+  /**
+   * Chooses the frames to be reused
+   */
+  std::unique_ptr<ReplacementPolicy> policy;
+
+  /**
+   * The policy if the pool is partitioned, otherwise NULL
+   */
+  PartitionedPolicy* partitionedPolicy;
+
+  /**
+   * How pages are placed in partitions
+   */
+  NumaPlacement placement;
+
+  /**
+   * Number of NUMA nodes of the host
+   */
+  std::uint32_t numaNodes;
+
+  /**
+   * Second tier holding evicted pages compressed, or NULL
+   */
+  std::unique_ptr<VictimCache> victimCache;
+
+  /**
+   * Write-ahead log pages are written back after, or NULL
+   */
+  LogManager* wal;
+
+  /**
+   * Spreads the pages allocPage() places, whose number is not known yet
+   */
+  std::atomic<std::uint32_t> nextPlacement;
+
+  /**
+   * Number of dirty frames
+   */
+  std::atomic<std::uint32_t> dirtyPages;
+
+  /**
+   * Number of frames with a nonzero pin count, kept up to date by addPin(),
+   * dropPin() and setPins()
+   */
+  std::atomic<std::uint32_t> pinnedFrames;
+
+  /**
+   * Number of allocations waiting in waitForUnpin()
+   */
+  std::atomic<std::uint32_t> pinWaiters;
+
+  /**
+   * Latch waitForUnpin() waits on unpinWake with
+   */
+  std::mutex pinWaitLatch;
+
+  /**
+   * Signalled when a frame's pin count drops to zero while allocations wait
+   */
+  std::condition_variable unpinWake;
+
+  const AllocConfig allocConfig;
+
+  /**
+   * Watermarks of the background writer, in frames
+   */
+  std::atomic<std::uint32_t> dirtyHigh;
+  std::atomic<std::uint32_t> dirtyLow;
+
+  const BackgroundWriterConfig writerConfig;
+
+  /**
+   * Next frame the background writer looks at; only used by its thread
+   */
+  FrameId writerCursor;
+
+  /**
+   * Protects stopWriter and is waited on by the background writer
+   */
+  std::mutex writerLatch;
+  std::condition_variable writerWake;
+  bool stopWriter;
+
+  /**
+   * The background writer thread, if enabled
+   */
+  std::thread writerThread;
+
+  /**
+   * Protects the checkpointer thread and stopCheckpoint, and is waited on by
+   * checkpoints pausing
+   */
+  std::mutex checkpointLatch;
+  std::condition_variable checkpointWake;
+  bool stopCheckpoint;
+
+  /**
+   * The thread running the last checkpoint started.  Each checkpoint thread
+   * joins the one before it, so joining this one joins them all; it is only
+   * replaced under checkpointLatch, and never joined with the latch held.
+   */
+  std::thread checkpointThread;
+
+  /**
+   * @brief Pages a prefetch() call asked for.  The File is a copy made and
+   * destroyed under fileLatch.
+   */
+  struct PrefetchRequest {
+    File file;
+    std::vector<PageId> pageNos;
+  };
+
+  /**
+   * Protects the prefetch queue and is waited on by the prefetcher and by
+   * waitForPrefetches()
+   */
+  std::mutex prefetchLatch;
+  std::condition_variable prefetchWake;
+  std::condition_variable prefetchDone;
+  std::deque<std::unique_ptr<PrefetchRequest>> prefetchQueue;
+  bool prefetchBusy;
+  bool stopPrefetcher;
+
+  /**
+   * The thread reading prefetched pages in
+   */
+  std::thread prefetchThread;
+
+  /**
+   * @brief Pages being read into frames through the I/O engine.  The frames
+   * are reserved: invalid, unlatched and with a pin count of 1, so that the
+   * replacement policy cannot hand them out.  The File is a copy made and
+   * destroyed under fileLatch.
+   */
+  struct AsyncLoad {
+    File file;
+    PageId first;
+    std::vector<FrameId> frames;
+    std::vector<Page*> pages;
+    bool prefetch;
+
+    /**
+     * Whether each frame is in the page table for its page; the pages of the
+     * others were there already, and are read only to be dropped
+     */
+    std::vector<bool> claimed;
+
+    /**
+     * Called with the pinned pages, or with why they could not be read
+     */
+    std::function<void(AsyncLoad& load, std::exception_ptr error)> done;
+
+    /**
+     * When the read was submitted
+     */
+    std::chrono::steady_clock::time_point submitted;
+  };
+
+  /**
+   * Does the I/O of readPageAsync() and of prefetches
+   */
+  std::unique_ptr<IoEngine> io;
+
+  /**
+   * Protects the counts of asynchronous loads in flight, and the wait for
+   * pages being read in (see BufDesc::loading), which readers count
+   * themselves in for like pinWaiters
+   */
+  std::mutex loadLatch;
+  std::condition_variable loadDone;
+  std::uint32_t loadsInFlight;
+  std::uint32_t prefetchLoadsInFlight;
+  std::condition_variable pageLoaded;
+  std::atomic<std::uint32_t> loadWaiters;
+
+  /**
+   * Most write-backs the background writer has in flight at once
+   */
+  std::uint32_t writeBatchSize;
+
+  /**
+   * Reserves frames for consecutive pages, enters those not in the page
+   * table yet into it as loading, and submits one read for them all.  If no
+   * read is submitted, the frames are given back and it throws.
+   *
+   * @param file   	File object
+   * @param first   Number of the first page
+   * @param count   Number of pages
+   * @param prefetch  Whether it is for a prefetch, see waitForPrefetches()
+   * @param done    Called like AsyncLoad::done once the pages are read
+   * @return False, with nothing submitted, if every page was in the page
+   * table already
+   */
+  bool loadAsync(File& file, const PageId first, const std::size_t count,
+                 const bool prefetch,
+                 std::function<void(AsyncLoad&, std::exception_ptr)> done);
+
+  /**
+   * Enters the pages of an asynchronous load into the pool, or gives their
+   * frames back if the read failed; runs on an I/O engine thread.
+   */
+  void completeLoad(std::unique_ptr<AsyncLoad> load, const int error);
+
+  /**
+   * Gives back a frame reserved for an asynchronous load of a page, taking
+   * the page out of the page table if the frame was entered for it.
+   */
+  void releaseReserved(File& file, const PageId pageNo, const FrameId frame,
+                       const bool claimed);
+
+  /**
+   * Sets the background writer's watermarks for a pool of the given size.
+   */
+  void setWatermarks(const std::uint32_t frames);
+
+  /**
+   * Writes the pages of latched, unpinned frames taken off the dirty count
+   * through the I/O engine, all in flight at once, and waits for them.
+   * Pages that cannot be written are marked dirty again.
+   *
+   * @return Number of pages written
+   */
+  std::uint32_t writeBatch(const std::vector<BufDesc*>& batch);
+
+  /**
+   * Body of the prefetcher thread.
+   */
+  void runPrefetcher();
+
+  /**
+   * Reads in the pages of a prefetch request that are not in the pool yet,
+   * leaving them unpinned.  Errors are dropped; a prefetch is only a hint.
+   */
+  void loadPrefetched(PrefetchRequest& request);
+
+  /**
+   * Waits until every prefetch requested so far is done, including their
+   * reads still in flight, so that none holds a frame pinned.
+   */
+  void waitForPrefetches();
+
+  /**
+   * Marks the page in a frame dirty, waking the background writer when this
+   * reaches the high watermark.
+   */
+  void markDirty(BufDesc& desc);
+
+  /**
+   * Marks the page in a frame clean.
+   *
+   * @return  True if it was dirty
+   */
+  bool takeDirty(BufDesc& desc);
+
+  /**
+   * Adds a pin to a frame.  Callers hold the shard latch of its page.
+   *
+   * @return  True if the frame was unpinned before
+   */
+  bool addPin(BufDesc& desc);
+
+  /**
+   * Removes a pin from a pinned frame.  Callers hold the shard latch of its
+   * page.
+   *
+   * @return  True if the frame is now unpinned
+   */
+  bool dropPin(BufDesc& desc);
+
+  /**
+   * Sets the pin count of a frame the caller has latched.
+   */
+  void setPins(BufDesc& desc, const int pins);
+
+  /**
+   * Wakes allocations waiting for an unpin, if there are any.
+   */
+  void frameUnpinned();
+
+  /**
+   * Waits until some frame is unpinned.
+   *
+   * @param deadline  When to give up
+   * @return  False if every frame was still pinned at the deadline
+   */
+  bool waitForUnpin(const std::chrono::steady_clock::time_point deadline);
+
+  /**
+   * Body of the background writer thread.
+   */
+  void runWriter();
+
+  /**
+   * Writes unpinned dirty pages back until the low watermark is reached or
+   * every frame has been looked at once.
+   *
+   * @return Number of pages written
+   */
+  std::uint32_t writeDirtyPages();
+
+  /**
+   * Body of a checkpoint, see checkpoint().
+   */
+  CheckpointStats runCheckpoint(const CheckpointConfig& config);
+
+  /**
+   * Writes the dirty, unpinned pages of some frames, per file in page order,
+   * leaving them resident.
+   *
+   * @param frames  Frames to look at
+   * @param count   Number of frames
+   * @param pinned  Gets the frames of dirty pages that were pinned or busy
+   * @return Number of pages written
+   */
+  std::uint32_t checkpointSlice(const FrameId* frames, const std::size_t count,
+                                std::vector<FrameId>& pinned);
+
+  /**
+   * Pauses a checkpoint, unless the buffer manager is going away.
+   *
+   * @param pause   How long to pause
+   * @return False if the checkpoint is to stop
+   */
+  bool pauseCheckpoint(const std::chrono::nanoseconds pause);
+
+  /**
+   * Returns the key the replacement policy knows a page by.
+   */
+  static PageKey keyOf(const File& file, const PageId pageNo) {
+    return (static_cast<PageKey>(file.id()) << 32) | pageNo;
+  }
+
+  /**
+   * Returns the hash that picks a page's page table shard and, for
+   * NumaPlacement::HASH, its partition.
+   */
+  static std::uint64_t hashOf(const File& file, const PageId pageNo) {
+    return (keyOf(file, pageNo) * 0xD6E8FEB86659FD93ULL) >> 40;
+  }
+
+  /**
+   * Returns the page table shard responsible for a page.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   */
+  PageTableShard& shardFor(const File& file, const PageId pageNo);
+
+  /**
+   * Releases the content latch of a page and unpins it by its frame, for a
+   * PageGuard holding it: no page table lookup is needed, only the latch of
+   * the page's shard.
+   *
+   * @param frame     Frame the page is pinned in
+   * @param dirty     True if the page needs to be marked dirty
+   * @param exclusive True if the guard holds the content latch exclusive
+   * @throws  PageNotPinnedException If the page is not pinned
+   */
+  void unpinFrame(const FrameId frame, const bool dirty, const bool exclusive);
+
+  /**
+   * Returns the frame a page returned by readPage() or allocPage() is in.
+   */
+  FrameId frameOf(const Page* page) const {
+    return static_cast<FrameId>(page - bufPool.data());
+  }
+
+  /**
+   * Allocate a free frame.
+   *
+   * @param frame   	Frame reference, frame ID of allocated frame returned
+   * via this variable
+   * @param partition Partition to take the frame from if it has one to spare
+   * @return Lock on the latch of the allocated frame, which is invalid
+   * @throws BufferExceededException If no such buffer is found which can be
+   * allocated
+   */
+  std::unique_lock<std::mutex> allocBuf(FrameId& frame,
+                                        const std::uint32_t partition);
+
+  /**
+   * Counts an access to a frame from a thread on another NUMA node.
+   */
+  void addNodeStat(const FrameId frame);
+
+  /**
+   * readPages() without counting the accesses.
+   */
+  void pinPages(File& file, const PageId* pageNos, const std::size_t count,
+                Page** pages);
+
+  /**
+   * readPage() without counting the access.
+   */
+  void pinPage(File& file, const PageId pageNo, Page*& page,
+               const AccessIntent intent);
+
+  /**
+   * Pins a page if it is in the buffer pool, waiting for it first if it is
+   * being read in.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   * @param page  	Set to the page if it is in the pool
+   * @param intent  How the page is going to be used
+   * @return True if the page is in the pool
+   */
+  bool pinIfPresent(File& file, const PageId pageNo, Page*& page,
+                    const AccessIntent intent = AccessIntent::NORMAL);
+
+  /**
+   * Marks a page just read into a frame for the way it is going to be used.
+   * The caller holds the frame latch.
+   */
+  void applyIntent(BufDesc& desc, const AccessIntent intent);
+
+  /**
+   * Allocates a frame for an AccessIntent::SEQUENTIAL read: the next frame of
+   * the scan ring if the page in it was only used by scans and can be had
+   * now, otherwise a frame from allocBuf() that then joins the ring.
+   *
+   * @param frame   Set to the allocated frame
+   * @param partition Partition to fill the ring from
+   * @return Lock on the latch of the allocated frame
+   * @throws BufferExceededException If no frame can be allocated
+   */
+  std::unique_lock<std::mutex> allocScanBuf(FrameId& frame,
+                                            const std::uint32_t partition);
+
+  /**
+   * Allocates a frame the way the intent asks for, for a page placed in the
+   * given partition.
+   */
+  std::unique_lock<std::mutex> allocFor(const AccessIntent intent,
+                                        const std::uint32_t partition,
+                                        FrameId& frame);
+
+  /**
+   * Enters a page about to be read into a frame into the page table, with
+   * the frame pinned and loading, so that other readers of the page wait for
+   * the read instead of reading it too.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   * @param frame   Frame the page is going to be read into
+   * @return False, with nothing entered, if the page is in the table already
+   */
+  bool claim(File& file, const PageId pageNo, const FrameId frame);
+
+  /**
+   * Makes a page read into a frame entered by claim() available, waking the
+   * readers waiting for it.  The page stays pinned for the caller.
+   */
+  void install(File& file, const PageId pageNo, const FrameId frame);
+
+  /**
+   * Takes a page that could not be read out of the page table and unpins
+   * its frame, which the caller then gives back.  The readers waiting for
+   * the page wake up and read it themselves.
+   */
+  void unclaim(File& file, const PageId pageNo, const FrameId frame);
+
+  /**
+   * Waits, with the shard latch let go meanwhile, until a frame is no longer
+   * loading.
+   */
+  void waitForLoad(BufDesc& desc, std::unique_lock<std::mutex>& shard_latch);
+
+  /**
+   * Wakes the readers waiting for a page to be read in, after a frame was
+   * marked as no longer loading.
+   */
+  void loadSettled();
+
+  /**
+   * Writes the page held by a frame back to disk if it is dirty, then removes
+   * it from the page table and clears the frame.  The caller holds the frame
+   * latch and the frame is valid.
+   *
+   * @param desc   	Descriptor of the frame
+   * @param written Set to whether the page was written back
+   * @param demote  Whether to put the page in the victim cache, if there is
+   *                one, as it is evicted to make room
+   * @return False, with the page left in the pool, if the page is pinned.
+   */
+  bool evict(BufDesc& desc, bool& written, const bool demote);
+
+  /**
+   * Adds a frame just set to a page to its file's resident frames.
+   */
+  void addResident(BufDesc& desc);
+
+  /**
+   * Removes a frame about to be cleared from its file's resident frames.
+   */
+  void removeResident(BufDesc& desc);
+
+  /**
+   * Returns the pages of a file in the pool and their frames, in page order.
+   * A frame may be given to another page once this returns, so callers check
+   * under its latch.
+   *
+   * @param file   	File object
+   */
+  std::vector<std::pair<PageId, FrameId>> residentPages(const File& file);
+
+  /**
+   * Writes the dirty, unpinned pages among a file's resident pages back
+   * without evicting them.  Consecutive pages go out with a single request,
+   * at most writeBatchSize pages long.
+   *
+   * @param file   	File object
+   * @param pages   Resident pages of the file, see residentPages()
+   * @return Number of pages written
+   */
+  std::uint32_t writeRuns(File& file,
+                          const std::vector<std::pair<PageId, FrameId>>& pages);
+
+  /**
+   * Puts a frame that no longer holds a page on the free list.  The caller
+   * must have let go of the frame latch: popFree() takes a frame it cannot
+   * latch to be claimed by someone else, and drops it from the list.
+   *
+   * @param frame   Frame just cleared
+   */
+  void pushFree(const FrameId frame);
+
+  /**
+   * Takes a frame from the free list that still holds no page and can be
+   * latched without waiting.  Entries that fail either test are dropped;
+   * the frames stay available to the replacement policy.
+   *
+   * @param frame   Set to the frame taken
+   * @param partition Partition whose list is tried first
+   * @param anyPartition  Whether to go on to the lists of other partitions
+   * @return  The latch of the frame, not owning a lock if the lists ran out
+   */
+  std::unique_lock<std::mutex> popFree(FrameId& frame,
+                                       const std::uint32_t partition,
+                                       const bool anyPartition);
+
+  /**
+   * Writes the page held by a frame to its file.
+   *
+   * @param desc   	Descriptor of the frame, latched by the caller
+   */
+  void writeBack(BufDesc& desc);
+
+  /**
+   * Reads consecutive pages of a file into latched frames, or points the
+   * frames at them if the file is mapped.  The file latch is only held to
+   * check the pages against the file's page map.
+   *
+   * @param file   	File object
+   * @param first   Number of the first page
+   * @param pages   Pages of the frames, the i-th getting page first + i
+   * @param count   Number of pages
+   */
+  void readFrames(File& file, const PageId first, Page* const* pages,
+                  const std::size_t count);
+
+  /**
+   * Writes pages of latched frames, with consecutive page numbers, to their
+   * file.  The file latch is only held before and after the write, to check
+   * the pages against the file's page map and to fix up what changed in it
+   * meanwhile.
+   *
+   * @param file   	File object
+   * @param pages   Pages of the frames
+   * @param count   Number of pages
+   */
+  void writeFrames(File& file, Page* const* pages, const std::size_t count);
+
+  /**
+   * Makes the write-ahead log, if there is one, durable up to a page LSN
+   * before pages stamped with it are written.
+   *
+   * @param lsn   Greatest LSN of the pages about to be written
+   */
+  void forceLog(const Lsn lsn);
+
+  /**
+   * Reads the file and page number of a frame for summarize(), dumpFrames()
+   * and saveResidentSet() if its latch can be had without waiting.  Only
+   * plain values are copied out, so no File reference is taken or dropped
+   * along the way.
+   *
+   * @param desc   	Descriptor of the frame
+   * @param fileId  Set to the id of the frame's file, 0 if the frame is empty
+   * @param filename  Set to the name of the frame's file
+   * @param pageNo  Set to the frame's page number
+   * @return False, leaving the rest alone, if the frame is busy.
+   */
+  bool peekFrame(BufDesc& desc, FileId& fileId, std::string& filename,
+                 PageId& pageNo);
+
+ public:
+  /**
+   * Actual buffer pool from which frames are allocated.  Frame i is a Page
+   * over the i-th Page::SIZE bytes of one contiguous page-aligned arena.
+   */
+  std::vector<Page> bufPool;
+
+  /**
+   * Constructor of BufMgr class
+   *
+   * @param bufs        Number of frames in the buffer pool
+   * @param policyType  Page replacement policy to use
+   * @param writer      Background writer settings
+   * @param io          Asynchronous I/O engine settings
+   * @param alloc       Frame allocation settings
+   * @param numa        NUMA partitioning settings
+   * @param victim      Victim cache settings
+   */
+  BufMgr(std::uint32_t bufs,
+         ReplacementPolicyType policyType = ReplacementPolicyType::CLOCK,
+         const BackgroundWriterConfig& writer = BackgroundWriterConfig(),
+         const IoEngineConfig& io = IoEngineConfig(),
+         const AllocConfig& alloc = AllocConfig(),
+         const NumaConfig& numa = NumaConfig(),
+         const VictimCacheConfig& victim = VictimCacheConfig());
+
+  /**
+   * Destructor of BufMgr class.  Stops the background writer; pages still
+   * dirty are not written.
+   */
+  ~BufMgr();
+
+  /**
+   * Reads the given page from the file into a frame and returns the pointer to
+   * page. If the requested page is already present in the buffer pool pointer
+   * to that frame is returned otherwise a new frame is allocated from the
+   * buffer pool for reading the page.
+   *
+   * @param file   	File object
+   * @param PageNo  Page number in the file to be read
+   * @param page  	Reference to page pointer. Used to fetch the Page object
+   * in which requested page from file is read in.
+   * @param intent  How the page is going to be used
+   */
+  void readPage(File& file, const PageId pageNo, Page*& page,
+                const AccessIntent intent = AccessIntent::NORMAL);
+
+  /**
+   * Reads several pages of a file into frames and pins them, like a readPage()
+   * call per page but with one read per run of consecutive pages that are not
+   * in the pool.  If it throws, no page is left pinned by the call.
+   *
+   * @param file   	File object
+   * @param pageNos Page numbers in the file to be read
+   * @param count   Number of pages to read
+   * @param pages 	Set to the pages: the i-th to the Page object page
+   * pageNos[i] is read in
+   * @throws  BufferExceededException If there are not enough frames for the
+   * pages not in the pool
+   * @throws  InvalidPageException  If one of the pages is not in the file
+   */
+  void readPages(File& file, const PageId* pageNos, const std::size_t count,
+                 Page** pages);
+
+  /**
+   * Asks for pages of a file to be read into the buffer pool ahead of their
+   * use.  Returns right away; a background thread reads the pages that are
+   * not in the pool yet with readPages() and leaves them unpinned.  Pages
+   * that cannot be read, or do not fit in the pool, are skipped.
+   *
+   * @param file   	File object
+   * @param pageNos Page numbers in the file to read
+   * @param count   Number of pages
+   */
+  void prefetch(File& file, const PageId* pageNos, const std::size_t count);
+
+  /**
+   * Starts reading a page into a frame and returns right away.  The page is
+   * pinned once the future is ready, exactly as by readPage(), so the caller
+   * can overlap the read with other work or with more reads.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file to be read
+   * @return Future of the page.  It holds the BufferExceededException,
+   * InvalidPageException or FileIOException if the page cannot be read.
+   */
+  std::future<Page*> readPageAsync(File& file, const PageId pageNo);
+
+  /**
+   * Unpin a page from memory since it is no longer required for it to remain in
+   * memory.
+   *
+   * @param file   	File object
+   * @param PageNo  Page number
+   * @param dirty		True if the page to be unpinned needs to be
+   * marked dirty
+   * @throws  PageNotPinnedException If the page is not already pinned
+   */
+  void unPinPage(File& file, const PageId pageNo, const bool dirty);
+
+  /**
+   * Allocates a new, empty page in the file and returns the Page object.
+   * The newly allocated page is also assigned a frame in the buffer pool.
+   *
+   * @param file   	File object
+   * @param PageNo  Page number. The number assigned to the page in the file is
+   * returned via this reference.
+   * @param page  	Reference to page pointer. The newly allocated in-memory
+   * Page object is returned via this reference.
+   * @param intent  How the page is going to be used
+   */
+  void allocPage(File& file, PageId& pageNo, Page*& page,
+                 const AccessIntent intent = AccessIntent::NORMAL);
+
+  /**
+   * Reads a page like readPage() and returns a guard holding it for reading,
+   * which unpins it clean when it goes away.  Waits while a WritePageGuard
+   * holds the page; other readers share it.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file to be read
+   * @param intent  How the page is going to be used
+   */
+  ReadPageGuard pinForRead(File& file, const PageId pageNo,
+                           const AccessIntent intent = AccessIntent::NORMAL);
+
+  /**
+   * Reads a page like readPage() and returns a guard holding it for writing,
+   * which unpins it dirty when it goes away if the page was accessed through
+   * it.  Waits until no other guard holds the page.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file to be read
+   * @param intent  How the page is going to be used
+   */
+  WritePageGuard pinForWrite(File& file, const PageId pageNo,
+                             const AccessIntent intent = AccessIntent::NORMAL);
+
+  /**
+   * Allocates a page like allocPage() and returns a guard holding it for
+   * writing, which unpins it dirty when it goes away.  The number of the new
+   * page is WritePageGuard::pageNumber().
+   *
+   * @param file   	File object
+   * @param intent  How the page is going to be used
+   */
+  WritePageGuard allocForWrite(
+      File& file, const AccessIntent intent = AccessIntent::NORMAL);
+
+  /**
+   * Writes out all dirty pages of the file, and its header, to disk, and
+   * drops the file's pages from the pool.  All the frames assigned to the
+   * file need to be unpinned from buffer pool before this function can be
+   * successfully called. Otherwise Error returned.  Takes time in proportion
+   * to the file's pages in the pool, not to the size of the pool.
+   *
+   * @param file   	File object
+   * @throws  PagePinnedException If any page of the file is pinned in the
+   * buffer pool
+   */
+  void flushFile(File& file);
+
+  /**
+   * Starts a fuzzy checkpoint on a background thread and returns right away.
+   * It writes every page that is dirty when it starts back to disk, leaving
+   * it resident and clean, while the pool is in use: unlike flushFile(), it
+   * evicts nothing and does not fail on pinned pages.
+   *
+   * The frames are walked in slices of CheckpointConfig::sliceFrames.  The
+   * dirty pages of a slice are written per file in page order, consecutive
+   * pages with a single request, each frame latched only while it is
+   * written, so readers of other pages are not held up.  Pinned pages are
+   * skipped, as they are likely being changed, and looked at again in later
+   * passes.  Writes are spread out to at most
+   * CheckpointConfig::pagesPerSecond.  One checkpoint runs at a time: this
+   * returns at once, and the checkpoint starts once the one before it has
+   * finished.
+   *
+   * @param config  Checkpoint settings
+   * @return Future of what the checkpoint did.  It holds the FileIOException
+   * if a write fails.
+   */
+  std::future<CheckpointStats> checkpoint(
+      const CheckpointConfig& config = CheckpointConfig());
+
+  /**
+   * Writes out the dirty pages of the file, and its header, to disk, keeping
+   * the pages in the pool, for checkpoints.  Pages go out in page order,
+   * consecutive ones with a single request.  Pinned pages are skipped and
+   * stay dirty.
+   *
+   * @param file   	File object
+   * @return Number of pages written
+   */
+  std::uint32_t flushDirty(File& file);
+
+  /**
+   * Grows or shrinks the pool while it is in use.  Growing puts frames
+   * reserved by AllocConfig::maxFrames into use.  Shrinking evicts the pages
+   * of the frames past the new size, writing dirty ones back, and gives
+   * their memory back to the OS; it stops early at a pinned page, which
+   * keeps its frame and those before it in the pool.  The page table is
+   * resized one shard at a time, so lookups in other shards go on meanwhile.
+   *
+   * @param frames  Number of frames wanted, limited to [1, maxFrames]
+   * @return Number of frames in the pool afterwards
+   * @throws  FileIOException If a dirty page cannot be written back; the
+   * pool keeps the frames not emptied yet
+   */
+  std::uint32_t resize(std::uint32_t frames);
+
+  /**
+   * Returns the number of frames in the pool.
+   */
+  std::uint32_t size() const { return numBufs; }
+
+  /**
+   * Returns the most frames resize() can grow the pool to.
+   */
+  std::uint32_t capacity() const { return maxBufs; }
+
+  /**
+   * Delete page from file and also from buffer pool if present.
+   * Since the page is entirely deleted from file, its unnecessary to see if the
+   * page is dirty.
+   *
+   * @param file   	File object
+   * @param PageNo  Page number
+   * @throws  PagePinnedException If the page is pinned in the buffer pool
+   */
+  void disposePage(File& file, const PageId PageNo);
+
+  /**
+   * Summarizes what the buffer pool holds in one pass over the frames and
+   * page table shards.  Frames are looked at without waiting for their
+   * latches, so the summary is not an atomic snapshot while other threads
+   * use the pool.
+   */
+  BufPoolSummary summarize();
+
+  /**
+   * Writes one record per frame (frame number, file, page number, valid,
+   * busy, pin count, dirty and reference bit) in the given format.  The
+   * output is built in large chunks rather than written field by field.
+   *
+   * @param out     Stream to write to
+   * @param format  Output format
+   */
+  void dumpFrames(std::ostream& out, const FrameDumpFormat format);
+
+  /**
+   * Writes the file name and page number of every page in the pool, hottest
+   * first, for warmUp() to read them back in after a restart.  Pages the
+   * replacement policy is told to keep (AccessIntent::KEEP) come first, then
+   * those referenced since the clock hand last passed, then the rest, with
+   * pages read by sequential scans last.  Frames busy loading or evicting
+   * are left out.  File names are quoted as in FrameDumpFormat::JSON, so any
+   * name reads back.  The pool can be in use meanwhile, so this can be called
+   * periodically as well as before shutting down.
+   *
+   * @param out     Stream to write to
+   * @return Number of pages written
+   */
+  std::size_t saveResidentSet(std::ostream& out);
+
+  /**
+   * Reads back pages listed by saveResidentSet() into the pool.  The hottest
+   * pages of the given files are taken, as many as there are unpinned
+   * frames, and handed to prefetch() per file, which reads them sorted, in
+   * runs of consecutive pages, asynchronously.  Pages of other files, or no
+   * longer in their file, are skipped.  Reading stops at the first line that
+   * cannot be parsed, taking only the pages listed before it.
+   *
+   * @param in      Stream to read from
+   * @param files   Files whose pages to read, matched by file name
+   * @param wait    Whether to return only once the pages are in
+   * @return Number of pages asked for
+   */
+  std::size_t warmUp(std::istream& in, std::vector<File>& files,
+                     const bool wait);
+
+  /**
+   * Print member variable values: the frames as CSV, then a summary line.
+   */
+  void printSelf();
+
+  /**
+   * Returns the name of the page replacement policy in use.
+   */
+  const char* policyName() const { return policy->name(); }
+
+  /**
+   * Returns the name of the asynchronous I/O engine in use.
+   */
+  const char* ioEngineName() const { return io->name(); }
+
+  /**
+   * Tells the buffer manager of the write-ahead log the pages' LSNs refer
+   * to (see Page::set_lsn()).  From then on no page is written back, by
+   * eviction, flushFile(), the background writer or anything else, before
+   * the log is durable up to the page's LSN.  Commits then only need
+   * LogManager::flush(), and dirty pages go out whenever the pool sees fit.
+   * Set it before pages are stamped; the log must outlive the buffer
+   * manager or be unset with NULL first.
+   *
+   * @param log   The log, or NULL for none
+   */
+  void setLog(LogManager* log) { wal = log; }
+
+  /**
+   * Returns the number of frames that are not pinned, which allocations may
+   * evict or fill.
+   */
+  std::uint32_t unpinnedFrames() const { return numBufs - pinnedFrames; }
+
+  /**
+   * Returns the number of pages in the victim cache, 0 without one.
+   */
+  std::size_t victimCachePages() const {
+    return victimCache ? victimCache->pages() : 0;
+  }
+
+  /**
+   * Returns the number of partitions of the pool, see NumaConfig.
+   */
+  std::uint32_t numPartitions() const {
+    return partitionedPolicy != NULL ? partitionedPolicy->numPartitions() : 1;
+  }
+
+  /**
+   * Returns the partition a frame is in.
+   */
+  std::uint32_t partitionOf(const FrameId frame) const {
+    return bufDescTable[frame].partition;
+  }
+
+  /**
+   * Returns the partition a page read in by the calling thread is placed in.
+   *
+   * @param file   	File object
+   * @param pageNo  Page number in the file, or Page::INVALID_NUMBER for a
+   * page about to be allocated
+   */
+  std::uint32_t placeFor(const File& file, const PageId pageNo);
+
+  /**
+   * Get buffer pool usage statistics: a snapshot of the counters, which
+   * threads using the pool keep adding to meanwhile.
+   */
+  BufStats getBufStats() const;
+
+  /**
+   * Get the buffer pool usage statistics of a file since it was opened,
+   * counted by every buffer manager it is used with.
+   *
+   * @param file   	File object
+   */
+  FileBufStats getFileStats(const File& file) const;
+
+  /**
+   * Clear buffer pool usage statistics, except those of files
+   */
+  void clearBufStats() {
+    bufStats.clear();
+    readLatency.clear();
+    writeLatency.clear();
+  }
 };
 
 }  // namespace badgerdb
@@ -0,0 +1,74 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "bulk_loader.h"
+
+#include <algorithm>
+
+#include "exceptions/insufficient_space_exception.h"
+
+namespace badgerdb {
+
+BulkLoader::BulkLoader(File &file, const std::size_t batch_pages)
+    : file_(file),
+      arena_(std::max<std::size_t>(1, batch_pages), Page::SIZE),
+      current_(0),
+      num_records_(0),
+      num_pages_written_(0) {
+  const std::size_t num_pages = std::max<std::size_t>(1, batch_pages);
+  pages_.reserve(num_pages);
+  for (std::size_t i = 0; i < num_pages; ++i) {
+    pages_.emplace_back(arena_.frame(i));
+  }
+}
+
+BulkLoader::~BulkLoader() {
+  try {
+    finish();
+  } catch (...) {
+  }
+}
+
+void BulkLoader::add(const RecordView &record) { add(&record, 1); }
+
+void BulkLoader::add(const RecordView *records, const std::size_t count) {
+  std::size_t done = 0;
+  while (done < count) {
+    const std::size_t inserted =
+        pages_[current_].insertRecords(records + done, count - done);
+    done += inserted;
+    num_records_ += inserted;
+    if (done == count) break;
+
+    // The page is full.
+    if (inserted == 0 && currentPageEmpty()) {
+      throw InsufficientSpaceException(Page::INVALID_NUMBER,
+                                       records[done].length,
+                                       pages_[current_].getFreeSpace());
+    }
+    if (++current_ == pages_.size()) writeBatch();
+  }
+}
+
+void BulkLoader::finish() { writeBatch(); }
+
+void BulkLoader::writeBatch() {
+  const std::size_t count =
+      current_ < pages_.size() && !currentPageEmpty() ? current_ + 1
+                                                      : current_;
+  if (count > 0) {
+    file_.appendPages(arena_.frame(0), count);
+    num_pages_written_ += count;
+  }
+  for (std::size_t i = 0; i < count; ++i) {
+    pages_[i].initialize();
+  }
+  current_ = 0;
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,152 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "frame_arena.h"
+#include "page.h"
+#include "record_view.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Loads a stream of records into new pages at the end of a file,
+ * bypassing the buffer pool.
+ *
+ * Records are packed into pages in the order they are added, each page filled
+ * as far as it goes (see Page::insertRecords()).  Full pages collect in a
+ * batch of contiguous memory, which goes to the file in one call to
+ * File::appendPages() once it is full, so a load costs a few large sequential
+ * writes instead of an allocation and a write per page.  Pages are only in
+ * the file once their batch has been written; finish() writes the last one.
+ *
+ * Nothing else may allocate pages in the file during a load, and the buffer
+ * pool knows nothing of the pages written.
+ *
+ * @warning This class is not threadsafe.
+ */
+class BulkLoader {
+ public:
+  /**
+   * Default number of pages written at a time.
+   */
+  static const std::size_t DEFAULT_BATCH_PAGES = 64;
+
+  /**
+   * Constructs a loader appending to a file.
+   *
+   * @param file          File to load into, open for writing.
+   * @param batch_pages   Number of pages written at a time.
+   */
+  BulkLoader(File &file, const std::size_t batch_pages = DEFAULT_BATCH_PAGES);
+
+  BulkLoader(const BulkLoader &) = delete;
+  BulkLoader &operator=(const BulkLoader &) = delete;
+
+  /**
+   * Writes the pages not written yet, as finish() does, ignoring errors;
+   * call finish() to see them.
+   */
+  ~BulkLoader();
+
+  /**
+   * Adds a record.
+   *
+   * @param record  Bytes that compose the record.
+   * @throws  InsufficientSpaceException  If the record does not fit in an
+   *                                      empty page.
+   */
+  void add(const RecordView &record);
+
+  /**
+   * Adds a record.
+   *
+   * @param record  Bytes that compose the record.
+   * @throws  InsufficientSpaceException  If the record does not fit in an
+   *                                      empty page.
+   */
+  void add(const std::string &record) { add(RecordView(record)); }
+
+  /**
+   * Adds records, in order.
+   *
+   * @param records   Records to add.
+   * @param count     Number of records.
+   * @throws  InsufficientSpaceException  If a record does not fit in an empty
+   *                                      page; the ones before it are added.
+   */
+  void add(const RecordView *records, const std::size_t count);
+
+  /**
+   * Writes the pages not written yet, including the last, partly filled one.
+   * Records added later go to a new page.
+   */
+  void finish();
+
+  /**
+   * Returns the number of records added so far.
+   */
+  std::size_t numRecords() const { return num_records_; }
+
+  /**
+   * Returns the number of pages written to the file so far.
+   */
+  std::size_t numPagesWritten() const { return num_pages_written_; }
+
+ private:
+  /**
+   * Writes the batch, the full pages and the current one if it is not
+   * empty, and starts a new one.
+   */
+  void writeBatch();
+
+  /**
+   * Returns whether the current page holds no records.
+   */
+  bool currentPageEmpty() const {
+    return pages_[current_].header_->num_slots == 0;
+  }
+
+  /**
+   * File records are loaded into.
+   */
+  File file_;
+
+  /**
+   * Memory of the batch, one page after the other.
+   */
+  FrameArena arena_;
+
+  /**
+   * Pages of the batch, over the memory in arena_.
+   */
+  std::vector<Page> pages_;
+
+  /**
+   * Index of the page records go into in pages_.
+   */
+  std::size_t current_;
+
+  /**
+   * Number of records added.
+   */
+  std::size_t num_records_;
+
+  /**
+   * Number of pages written to the file.
+   */
+  std::size_t num_pages_written_;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,38 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "clock_policy.h"
+
+namespace badgerdb {
+
+ClockPolicy::ClockPolicy(const std::uint32_t numFrames)
+    : numFrames_(numFrames), clockHand_(numFrames - 1) {}
+
+FrameId ClockPolicy::advanceClock(const std::uint32_t frames) {
+  return (clockHand_.fetch_add(1) + 1) % frames;
+}
+
+bool ClockPolicy::pickVictim(FrameView &frames, FrameId &victim) {
+  // read once, so a concurrent resize cannot leave the hand past the end
+  const std::uint32_t active = numFrames_;
+  for (std::uint32_t step = 0; step < 2 * active; step++) {
+    const FrameId hand = advanceClock(active);
+
+    // refbit is set, clear and continue
+    if (frames.testAndClearRefbit(hand)) continue;
+
+    // page is pinned or busy, continue
+    if (!frames.tryClaim(hand)) continue;
+
+    victim = hand;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,67 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief The classic clock algorithm over the frames' reference bits.
+ *
+ * The hand is advanced atomically, so several threads can sweep at the same
+ * time and no call takes a lock.
+ */
+class ClockPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructor of ClockPolicy class
+   *
+   * @param numFrames   Number of frames the buffer pool can grow to
+   */
+  explicit ClockPolicy(const std::uint32_t numFrames);
+
+  const char *name() const override { return "clock"; }
+
+  void onLoad(const FrameId frame, const PageKey key) override {}
+  void onAccess(const FrameId frame) override {}
+  void onEvict(const FrameId frame) override {}
+  void onRemove(const FrameId frame) override {}
+  void onResize(const std::uint32_t frames) override { numFrames_ = frames; }
+
+  /**
+   * Sweeps from the clock hand, clearing reference bits, and takes the
+   * first unreferenced frame that can be claimed.  Each frame is passed at
+   * most twice.
+   */
+  bool pickVictim(FrameView &frames, FrameId &victim) override;
+
+ private:
+  /**
+   * Advance clock to next frame in the buffer pool
+   *
+   * @param frames  Number of frames in use
+   * @return Frame the clock hand now points to
+   */
+  FrameId advanceClock(const std::uint32_t frames);
+
+  /**
+   * Number of frames in use, the ones the hand goes round
+   */
+  std::atomic<std::uint32_t> numFrames_;
+
+  /**
+   * Current position of clockhand in our buffer pool
+   */
+  std::atomic<FrameId> clockHand_;
+};
+
+}  // namespace badgerdb
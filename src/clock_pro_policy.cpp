@@ -0,0 +1,134 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "clock_pro_policy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+ClockProPolicy::ClockProPolicy(const std::uint32_t numFrames)
+    : numFrames_(numFrames),
+      state_(numFrames, FREE),
+      test_(numFrames, false),
+      fresh_(numFrames, false),
+      keys_(numFrames, 0),
+      coldHand_(0),
+      hotHand_(0),
+      coldTarget_(std::max<std::uint32_t>(1, numFrames / 4)),
+      hotCount_(0),
+      ghosts_(numFrames) {}
+
+void ClockProPolicy::onLoad(const FrameId frame, const PageKey key) {
+  std::lock_guard<std::mutex> latch(latch_);
+  release(frame);
+  keys_[frame] = key;
+  fresh_[frame] = true;
+
+  // A ghost hit means the page was reused within its test period but we
+  // evicted it anyway: give cold pages more room and keep this one.
+  if (ghosts_.remove(key)) {
+    coldTarget_ = std::min(coldTarget_ + 1,
+                           std::max<std::uint32_t>(1, numFrames_ - 1));
+    state_[frame] = HOT;
+    test_[frame] = false;
+    hotCount_++;
+  } else {
+    state_[frame] = COLD;
+    test_[frame] = true;
+  }
+}
+
+void ClockProPolicy::onEvict(const FrameId frame) {
+  std::lock_guard<std::mutex> latch(latch_);
+  if (state_[frame] == COLD && test_[frame] && ghosts_.add(keys_[frame])) {
+    // The oldest ghost finished its test period without being reused.
+    coldTarget_ = std::max<std::uint32_t>(1, coldTarget_ - 1);
+  }
+  release(frame);
+}
+
+void ClockProPolicy::onRemove(const FrameId frame) {
+  std::lock_guard<std::mutex> latch(latch_);
+  release(frame);
+}
+
+void ClockProPolicy::onResize(const std::uint32_t frames) {
+  std::lock_guard<std::mutex> latch(latch_);
+  for (FrameId frame = frames; frame < numFrames_; frame++) release(frame);
+  numFrames_ = frames;
+  if (coldHand_ >= frames) coldHand_ = 0;
+  if (hotHand_ >= frames) hotHand_ = 0;
+  coldTarget_ = std::min(coldTarget_, std::max<std::uint32_t>(1, frames - 1));
+  ghosts_.setCapacity(std::max<std::uint32_t>(1, frames));
+}
+
+void ClockProPolicy::release(const FrameId frame) {
+  if (state_[frame] == HOT) hotCount_--;
+  state_[frame] = FREE;
+  test_[frame] = false;
+}
+
+void ClockProPolicy::runHotHand(FrameView &frames) {
+  for (std::uint32_t step = 0;
+       step < 2 * numFrames_ && hotCount_ > numFrames_ - coldTarget_; step++) {
+    const FrameId hand = hotHand_;
+    hotHand_ = (hotHand_ + 1) % numFrames_;
+
+    if (state_[hand] == HOT) {
+      if (frames.testAndClearRefbit(hand)) continue;
+      state_[hand] = COLD;
+      hotCount_--;
+    } else if (state_[hand] == COLD) {
+      // The hot hand passing a cold page ends its test period.
+      test_[hand] = false;
+    }
+  }
+}
+
+bool ClockProPolicy::pickVictim(FrameView &frames, FrameId &victim) {
+  std::lock_guard<std::mutex> latch(latch_);
+
+  for (std::uint32_t step = 0; step < 3 * numFrames_; step++) {
+    const FrameId hand = coldHand_;
+    coldHand_ = (coldHand_ + 1) % numFrames_;
+
+    if (state_[hand] == HOT) continue;
+    if (state_[hand] == COLD && frames.testAndClearRefbit(hand)) {
+      if (fresh_[hand]) {
+        fresh_[hand] = false;
+      } else if (test_[hand]) {
+        // Reused within its test period: promote.
+        state_[hand] = HOT;
+        test_[hand] = false;
+        hotCount_++;
+        runHotHand(frames);
+      } else {
+        test_[hand] = true;
+      }
+      continue;
+    }
+    fresh_[hand] = false;
+
+    if (frames.tryClaim(hand)) {
+      victim = hand;
+      return true;
+    }
+  }
+
+  // Every cold page is pinned or busy; take any frame that can be had.
+  for (FrameId frame = 0; frame < numFrames_; frame++) {
+    if (frames.tryClaim(frame)) {
+      victim = frame;
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,107 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <mutex>
+#include <vector>
+
+#include "replacement_policy.h"
+#include "two_queue_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief CLOCK-Pro (Jiang, Chen and Zhang, USENIX ATC 2005).
+ *
+ * Resident pages are either hot or cold.  Only cold pages are evicted; a
+ * cold page gets a test period after it is loaded, and a re-reference within
+ * that period makes it hot.  Cold pages evicted while in test are remembered
+ * as non-resident ghosts.  The share of frames given to cold pages adapts: a
+ * ghost being requested again grows it, a ghost aging out unused shrinks it.
+ * When there are too many hot pages the hot hand demotes unreferenced ones.
+ *
+ * Reference bits are the frames' own, so hits cost nothing beyond what
+ * BufMgr already does; everything else runs under the policy latch.  The
+ * reference a page gets when it is loaded only earns it one pass of the
+ * cold hand, not a promotion.
+ */
+class ClockProPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructor of ClockProPolicy class
+   *
+   * @param numFrames   Number of frames the buffer pool can grow to
+   */
+  explicit ClockProPolicy(const std::uint32_t numFrames);
+
+  const char *name() const override { return "clockpro"; }
+
+  void onLoad(const FrameId frame, const PageKey key) override;
+  void onAccess(const FrameId frame) override {}
+  void onEvict(const FrameId frame) override;
+  void onRemove(const FrameId frame) override;
+  void onResize(const std::uint32_t frames) override;
+  bool pickVictim(FrameView &frames, FrameId &victim) override;
+
+ private:
+  enum State : std::uint8_t { FREE, COLD, HOT };
+
+  /**
+   * Moves the hot hand, demoting unreferenced hot pages, until the hot pages
+   * fit in the frames not reserved for cold ones.
+   */
+  void runHotHand(FrameView &frames);
+
+  /**
+   * Marks the frame free, keeping the hot page count right.
+   */
+  void release(const FrameId frame);
+
+  /**
+   * Protects everything below
+   */
+  std::mutex latch_;
+
+  /**
+   * Number of frames in use, the ones the hands go round
+   */
+  std::uint32_t numFrames_;
+
+  std::vector<State> state_;
+
+  /**
+   * Whether a cold page is in its test period
+   */
+  std::vector<bool> test_;
+
+  /**
+   * Whether the reference bit of the frame may still be the one set by the
+   * load rather than by a later request
+   */
+  std::vector<bool> fresh_;
+
+  std::vector<PageKey> keys_;
+
+  FrameId coldHand_;
+  FrameId hotHand_;
+
+  /**
+   * Number of frames the cold pages should get, between 1 and numFrames - 1
+   */
+  std::uint32_t coldTarget_;
+
+  std::uint32_t hotCount_;
+
+  /**
+   * Non-resident cold pages still in their test period
+   */
+  GhostList ghosts_;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,277 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "compressed_file_backend.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "exceptions/badgerdb_exception.h"
+#include "exceptions/file_format_exception.h"
+#include "exceptions/file_io_exception.h"
+#include "lz_codec.h"
+#include "page.h"
+
+namespace badgerdb {
+
+const std::uint32_t CompressedFileBackend::SLOT_ALIGNMENT;
+
+static_assert(Page::SIZE <= LZ_MAX_INPUT, "Pages must fit the LZ coder.");
+
+/**
+ * Rounds a size up to whole slots.
+ */
+static std::uint32_t slotSize(const std::uint64_t bytes) {
+  const std::uint32_t alignment = CompressedFileBackend::SLOT_ALIGNMENT;
+  return static_cast<std::uint32_t>((bytes + alignment - 1) / alignment *
+                                    alignment);
+}
+
+bool CompressedFileBackend::isCompressed(FileBackend &backend) {
+  std::uint32_t magic = 0;
+  backend.read(0 /* offset */, reinterpret_cast<char *>(&magic),
+               sizeof(magic));
+  return magic == MAGIC;
+}
+
+CompressedFileBackend::CompressedFileBackend(
+    const std::string &filename, const std::shared_ptr<FileBackend> &inner,
+    const bool create_new)
+    : FileBackend(filename),
+      inner_(inner),
+      map_slot_{0, 0, 0},
+      map_dirty_(false),
+      end_(SLOT_ALIGNMENT) {
+  static_assert(sizeof(Superblock) <= SLOT_ALIGNMENT,
+                "The superblock must fit in front of the first slot.");
+  if (!create_new) {
+    load();
+    return;
+  }
+  // an empty map, so the superblock is written and the file recognized
+  map_dirty_ = true;
+  storeMap(false /* durable */);
+}
+
+CompressedFileBackend::~CompressedFileBackend() {
+  try {
+    std::lock_guard<std::shared_timed_mutex> latch(latch_);
+    storeMap(false /* durable */);
+  } catch (const BadgerDbException &) {
+    // destructors must not throw; File flushes before letting go anyway
+  }
+}
+
+void CompressedFileBackend::load() {
+  Superblock superblock;
+  inner_->read(0 /* offset */, reinterpret_cast<char *>(&superblock),
+               sizeof(superblock));
+  if (superblock.version != VERSION) {
+    throw FileFormatException(filename_,
+                              "unsupported compressed format version " +
+                                  std::to_string(superblock.version));
+  }
+  map_slot_ = superblock.map;
+  map_.resize(superblock.pages);
+  if (!map_.empty()) {
+    inner_->read(map_slot_.offset, reinterpret_cast<char *>(map_.data()),
+                 map_.size() * sizeof(Slot));
+  }
+
+  // Whatever lies between the slots in use is free.
+  std::vector<Slot> used;
+  used.reserve(map_.size() + 1);
+  if (map_slot_.offset != 0) used.push_back(map_slot_);
+  for (const Slot &slot : map_) {
+    if (slot.offset != 0) used.push_back(slot);
+  }
+  std::sort(used.begin(), used.end(), [](const Slot &a, const Slot &b) {
+    return a.offset < b.offset;
+  });
+  end_ = SLOT_ALIGNMENT;
+  for (const Slot &slot : used) {
+    if (slot.offset > end_) {
+      free_.emplace(static_cast<std::uint32_t>(slot.offset - end_), end_);
+    }
+    end_ = std::max(end_, slot.offset + slot.capacity);
+  }
+}
+
+void CompressedFileBackend::read(const std::uint64_t offset, char *buffer,
+                                 const std::size_t length) {
+  std::shared_lock<std::shared_timed_mutex> latch(latch_);
+  std::size_t done = 0;
+  while (done < length) {
+    const std::uint64_t position = offset + done;
+    const std::uint64_t page_number = position / Page::SIZE;
+    const std::size_t within = position % Page::SIZE;
+    const std::size_t count = std::min(length - done, Page::SIZE - within);
+    if (count == Page::SIZE) {
+      readPage(page_number, buffer + done);
+    } else {
+      char page[Page::SIZE];
+      readPage(page_number, page);
+      std::memcpy(buffer + done, page + within, count);
+    }
+    done += count;
+  }
+}
+
+void CompressedFileBackend::write(const std::uint64_t offset,
+                                  const char *buffer,
+                                  const std::size_t length) {
+  std::lock_guard<std::shared_timed_mutex> latch(latch_);
+  std::size_t done = 0;
+  while (done < length) {
+    const std::uint64_t position = offset + done;
+    const std::uint64_t page_number = position / Page::SIZE;
+    const std::size_t within = position % Page::SIZE;
+    const std::size_t count = std::min(length - done, Page::SIZE - within);
+    if (count == Page::SIZE) {
+      writePage(page_number, buffer + done);
+    } else {
+      char page[Page::SIZE];
+      readPage(page_number, page);
+      std::memcpy(page + within, buffer + done, count);
+      writePage(page_number, page);
+    }
+    done += count;
+  }
+}
+
+void CompressedFileBackend::readPage(const std::uint64_t page_number,
+                                     char *page) const {
+  if (page_number >= map_.size() || map_[page_number].offset == 0) {
+    std::memset(page, 0, Page::SIZE);
+    return;
+  }
+  const Slot &slot = map_[page_number];
+  char stored[sizeof(SlotHeader) + Page::SIZE];
+  const std::size_t size =
+      std::min<std::size_t>(slot.capacity, sizeof(stored));
+  inner_->read(slot.offset, stored, size);
+
+  SlotHeader header;
+  std::memcpy(&header, stored, sizeof(header));
+  const char *bytes = stored + sizeof(header);
+  const bool intact =
+      header.length <= size - sizeof(header) &&
+      (header.encoding == RAW
+           ? header.length == Page::SIZE
+           : header.encoding == LZ &&
+                 lzDecompress(bytes, header.length, page, Page::SIZE));
+  if (!intact) throw FileIOException(filename_, "decompressing", EIO);
+  if (header.encoding == RAW) std::memcpy(page, bytes, Page::SIZE);
+}
+
+void CompressedFileBackend::writePage(const std::uint64_t page_number,
+                                      const char *page) {
+  char stored[sizeof(SlotHeader) + Page::SIZE];
+  SlotHeader header;
+  header.length = static_cast<std::uint32_t>(
+      lzCompress(page, Page::SIZE, stored + sizeof(header), Page::SIZE - 1));
+  header.encoding = LZ;
+  if (header.length == 0) {
+    // would not get smaller
+    header.length = Page::SIZE;
+    header.encoding = RAW;
+    std::memcpy(stored + sizeof(header), page, Page::SIZE);
+  }
+  std::memcpy(stored, &header, sizeof(header));
+  const std::uint32_t capacity = slotSize(sizeof(header) + header.length);
+
+  if (page_number >= map_.size()) {
+    map_.resize(page_number + 1, Slot{0, 0, 0});
+  }
+  Slot &slot = map_[page_number];
+  if (slot.capacity < capacity) {
+    const Slot moved = allocate(capacity);
+    if (slot.offset != 0) release(slot, false /* now */);
+    slot = moved;
+    map_dirty_ = true;
+  }
+  inner_->write(slot.offset, stored, sizeof(header) + header.length);
+}
+
+CompressedFileBackend::Slot CompressedFileBackend::allocate(
+    const std::uint32_t capacity) {
+  auto found = free_.lower_bound(capacity);
+  if (found == free_.end()) {
+    const Slot slot{end_, capacity, 0};
+    end_ += capacity;
+    return slot;
+  }
+  const Slot slot{found->second, capacity, 0};
+  // the rest of a bigger slot stays free
+  if (found->first > capacity) {
+    free_.emplace(found->first - capacity, found->second + capacity);
+  }
+  free_.erase(found);
+  return slot;
+}
+
+void CompressedFileBackend::release(const Slot &slot, const bool now) {
+  if (now) {
+    free_.emplace(slot.capacity, slot.offset);
+  } else {
+    released_.push_back(slot);
+  }
+}
+
+void CompressedFileBackend::storeMap(const bool durable) {
+  if (!map_dirty_) return;
+  if (durable) inner_->sync();
+
+  const std::uint64_t bytes = map_.size() * sizeof(Slot);
+  const Slot old_map = map_slot_;
+  Slot new_map{0, 0, 0};
+  if (bytes > 0) {
+    new_map = allocate(slotSize(bytes));
+    inner_->write(new_map.offset, reinterpret_cast<const char *>(map_.data()),
+                  bytes);
+    if (durable) inner_->sync();
+  }
+
+  const Superblock superblock = {MAGIC, VERSION, map_.size(), new_map};
+  inner_->write(0 /* offset */, reinterpret_cast<const char *>(&superblock),
+                sizeof(superblock));
+  map_slot_ = new_map;
+  map_dirty_ = false;
+
+  // The map on disk points at none of these any more.
+  if (old_map.offset != 0) release(old_map, true /* now */);
+  for (const Slot &slot : released_) release(slot, true /* now */);
+  released_.clear();
+}
+
+void CompressedFileBackend::flush() {
+  {
+    std::lock_guard<std::shared_timed_mutex> latch(latch_);
+    storeMap(false /* durable */);
+  }
+  inner_->flush();
+}
+
+void CompressedFileBackend::sync() {
+  {
+    std::lock_guard<std::shared_timed_mutex> latch(latch_);
+    storeMap(true /* durable */);
+  }
+  inner_->sync();
+}
+
+std::uint64_t CompressedFileBackend::storedBytes() const {
+  std::shared_lock<std::shared_timed_mutex> latch(latch_);
+  return end_;
+}
+
+}  // namespace badgerdb
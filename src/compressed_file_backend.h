@@ -0,0 +1,261 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "file_backend.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Backend storing every page of a file compressed on its own, on top
+ * of a backend holding the compressed bytes.
+ *
+ * Files see the usual layout, page n at n * Page::SIZE, so File and the
+ * buffer pool work on whole uncompressed pages as ever; only this backend
+ * knows a page is kept as a slot of a few hundred bytes somewhere on disk,
+ * found through a map from page number to slot.  Reading a page reads just
+ * its slot, which is what makes the mode pay where I/O is the bottleneck;
+ * writing a page compresses it into its slot, or a new one if it grew out
+ * of it.  Writes of less than a page, like File's header and next page
+ * pointers, rewrite the whole page.
+ *
+ * On disk there is a superblock at the start, telling where the map is, and
+ * slots aligned to SLOT_ALIGNMENT bytes.  Each slot starts with the length
+ * and encoding of what it holds: pages compressed with lzCompress(), or as
+ * they are if that does not make them smaller.  The map is written to a new
+ * slot by flush() and sync(), then the superblock pointing at it, and the
+ * slots it no longer uses are reused only after that, so a crash leaves the
+ * map of the last flush with the slots it points at.  Free space is not
+ * recorded: it is whatever the map does not point at when the file is
+ * opened.
+ *
+ * Reads run in parallel; writes exclude them and each other.
+ */
+class CompressedFileBackend : public FileBackend {
+ public:
+  /**
+   * Returns whether a backend's file holds compressed pages, that is, starts
+   * with the superblock of one.
+   *
+   * @param backend   Backend of the file.
+   */
+  static bool isCompressed(FileBackend &backend);
+
+  /**
+   * Opens a compressed file on the backend of its bytes.
+   *
+   * @param filename    Name of the file, for error messages
+   * @param inner       Backend holding the compressed bytes
+   * @param create_new  Whether the file was just created and is empty, so
+   *                    a superblock for a file without pages is written
+   * @throws  FileFormatException   If the file's superblock is of a version
+   *                                this code cannot read
+   * @throws  FileIOException       If the file cannot be read or written
+   */
+  CompressedFileBackend(const std::string &filename,
+                        const std::shared_ptr<FileBackend> &inner,
+                        const bool create_new);
+
+  /**
+   * Writes the map if it has changed since the last flush.
+   */
+  ~CompressedFileBackend() override;
+
+  /**
+   * Reads the pages the bytes are in, decompressing each.
+   *
+   * @throws  FileIOException   If the read fails or a page does not
+   *                            decompress (EIO)
+   */
+  void read(const std::uint64_t offset, char *buffer,
+            const std::size_t length) override;
+
+  /**
+   * Compresses the pages the bytes are in and writes them, reading pages not
+   * wholly written first.
+   *
+   * @throws  FileIOException   If the write fails
+   */
+  void write(const std::uint64_t offset, const char *buffer,
+             const std::size_t length) override;
+
+  /**
+   * Writes the map and superblock if the map has changed and flushes the
+   * backend below.
+   */
+  void flush() override;
+
+  /**
+   * Makes the pages durable before writing the map that points at them,
+   * and the map before the superblock.
+   */
+  void sync() override;
+
+  bool readOnly() const override { return inner_->readOnly(); }
+
+  void advise(const AccessPattern pattern) override {
+    inner_->advise(pattern);
+  }
+
+  /**
+   * Returns the number of bytes the file takes on disk.
+   */
+  std::uint64_t storedBytes() const;
+
+  /**
+   * Every slot starts and ends at a multiple of this many bytes.
+   */
+  static const std::uint32_t SLOT_ALIGNMENT = 256;
+
+ private:
+  /**
+   * Where a page, or the map, is stored.
+   */
+  struct Slot {
+    /**
+     * Position of the slot in the file, 0 for a page never written.
+     */
+    std::uint64_t offset;
+
+    /**
+     * Size of the slot, a multiple of SLOT_ALIGNMENT.
+     */
+    std::uint32_t capacity;
+
+    /**
+     * Unused, 0; the map is read and written as an array of slots.
+     */
+    std::uint32_t reserved;
+  };
+
+  /**
+   * First bytes of the file.
+   */
+  struct Superblock {
+    std::uint32_t magic;
+    std::uint32_t version;
+    /** Pages in the map */
+    std::uint64_t pages;
+    /** Slot holding the map */
+    Slot map;
+  };
+
+  /**
+   * Front of every page slot.
+   */
+  struct SlotHeader {
+    /** Number of stored bytes after the header */
+    std::uint32_t length;
+    /** RAW or LZ */
+    std::uint32_t encoding;
+  };
+
+  /**
+   * Value of Superblock::magic.
+   */
+  static const std::uint32_t MAGIC = 0x5a424442;
+
+  /**
+   * Version of the superblock and slot layout written by this code.
+   */
+  static const std::uint32_t VERSION = 1;
+
+  /**
+   * Encodings of SlotHeader::encoding.
+   */
+  static const std::uint32_t RAW = 0;
+  static const std::uint32_t LZ = 1;
+
+  /**
+   * Reads a page into <page>, zeros if it was never written.  The latch
+   * must be held, shared at least.
+   */
+  void readPage(const std::uint64_t page_number, char *page) const;
+
+  /**
+   * Compresses a page into its slot, moving it to a new slot if it does not
+   * fit.  The latch must be held exclusive.
+   */
+  void writePage(const std::uint64_t page_number, const char *page);
+
+  /**
+   * Returns a free slot of at least <capacity> bytes, at the end of the
+   * file if there is none.
+   */
+  Slot allocate(const std::uint32_t capacity);
+
+  /**
+   * Puts slots no longer in use back on the free list: from now on, if
+   * <now>, or once the map is next stored otherwise, since the map on disk
+   * may still point at them.
+   */
+  void release(const Slot &slot, const bool now);
+
+  /**
+   * Writes the map to a new slot and then the superblock, if the map has
+   * changed, syncing in between if <durable>.  The latch must be held
+   * exclusive.
+   */
+  void storeMap(const bool durable);
+
+  /**
+   * Reads the superblock and map, and finds the free space between slots.
+   */
+  void load();
+
+  /**
+   * Backend holding the compressed bytes
+   */
+  const std::shared_ptr<FileBackend> inner_;
+
+  /**
+   * Guards everything below: shared by reads, exclusive by writes
+   */
+  mutable std::shared_timed_mutex latch_;
+
+  /**
+   * Slot of each page, by page number
+   */
+  std::vector<Slot> map_;
+
+  /**
+   * Slot the map on disk is in
+   */
+  Slot map_slot_;
+
+  /**
+   * Whether map_ has changed since it was stored
+   */
+  bool map_dirty_;
+
+  /**
+   * Free slots, by capacity, with their offsets
+   */
+  std::multimap<std::uint32_t, std::uint64_t> free_;
+
+  /**
+   * Slots to free once the map is stored
+   */
+  std::vector<Slot> released_;
+
+  /**
+   * End of the last slot, where the file grows
+   */
+  std::uint64_t end_;
+};
+
+}  // namespace badgerdb
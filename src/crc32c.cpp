@@ -0,0 +1,116 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "crc32c.h"
+
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+namespace badgerdb {
+
+/**
+ * CRC-32C polynomial, bit reversed.
+ */
+static const std::uint32_t POLYNOMIAL = 0x82f63b78;
+
+/**
+ * Table of the CRC of each byte value, for processors without CRC32
+ * instructions.
+ */
+struct Crc32cTable {
+  Crc32cTable() {
+    for (std::uint32_t byte = 0; byte < 256; byte++) {
+      std::uint32_t crc = byte;
+      for (int bit = 0; bit < 8; bit++) {
+        crc = (crc >> 1) ^ (crc & 1 ? POLYNOMIAL : 0);
+      }
+      entries[byte] = crc;
+    }
+  }
+
+  std::uint32_t entries[256];
+};
+
+static std::uint32_t crc32cTable(const unsigned char *bytes, std::size_t size,
+                                 std::uint32_t crc) {
+  static const Crc32cTable table;
+  while (size-- > 0) {
+    crc = table.entries[(crc ^ *bytes++) & 0xff] ^ (crc >> 8);
+  }
+  return crc;
+}
+
+#if defined(__x86_64__)
+
+__attribute__((target("sse4.2"))) static std::uint32_t crc32cHardware(
+    const unsigned char *bytes, std::size_t size, std::uint32_t crc) {
+  std::uint64_t wide = crc;
+  for (; size >= sizeof(std::uint64_t); size -= sizeof(std::uint64_t)) {
+    std::uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    wide = _mm_crc32_u64(wide, word);
+    bytes += sizeof(word);
+  }
+  crc = static_cast<std::uint32_t>(wide);
+  while (size-- > 0) crc = _mm_crc32_u8(crc, *bytes++);
+  return crc;
+}
+
+/**
+ * Returns whether the processor has the SSE 4.2 CRC32 instruction.
+ */
+static bool hasHardwareCrc() {
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("sse4.2");
+}
+
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+
+static std::uint32_t crc32cHardware(const unsigned char *bytes,
+                                    std::size_t size, std::uint32_t crc) {
+  for (; size >= sizeof(std::uint64_t); size -= sizeof(std::uint64_t)) {
+    std::uint64_t word;
+    std::memcpy(&word, bytes, sizeof(word));
+    crc = __crc32cd(crc, word);
+    bytes += sizeof(word);
+  }
+  while (size-- > 0) crc = __crc32cb(crc, *bytes++);
+  return crc;
+}
+
+/**
+ * Compiled for ARMv8 with the CRC extension, which then always has it.
+ */
+static bool hasHardwareCrc() { return true; }
+
+#else
+
+static std::uint32_t crc32cHardware(const unsigned char *bytes,
+                                    std::size_t size, std::uint32_t crc) {
+  return crc32cTable(bytes, size, crc);
+}
+
+static bool hasHardwareCrc() { return false; }
+
+#endif
+
+std::uint32_t crc32c(const void *data, const std::size_t size,
+                     const std::uint32_t crc) {
+  static const bool hardware = hasHardwareCrc();
+  const unsigned char *bytes = static_cast<const unsigned char *>(data);
+  // The CRC is kept inverted while bytes are added.
+  return ~(hardware ? crc32cHardware(bytes, size, ~crc)
+                    : crc32cTable(bytes, size, ~crc));
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,30 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * Returns the CRC-32C (Castagnoli) of some bytes, continuing from the CRC of
+ * the bytes before them, so crc32c(b, n, crc32c(a, m)) is the CRC of a
+ * followed by b.  Uses the CRC32 instructions of SSE 4.2 or ARMv8 where the
+ * processor has them, eight bytes per instruction, and a table otherwise.
+ *
+ * @param data  Bytes to checksum
+ * @param size  Number of bytes
+ * @param crc   CRC of the bytes before, 0 for none
+ * @return  CRC of the bytes before and these
+ */
+std::uint32_t crc32c(const void *data, const std::size_t size,
+                     const std::uint32_t crc = 0);
+
+}  // namespace badgerdb
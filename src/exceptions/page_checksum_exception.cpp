@@ -0,0 +1,32 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "page_checksum_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+PageChecksumException::PageChecksumException(const PageId page_number,
+                                             const std::string &file,
+                                             const std::uint32_t stored,
+                                             const std::uint32_t computed)
+    : BadgerDbException(""),
+      page_number_(page_number),
+      filename_(file),
+      stored_(stored),
+      computed_(computed) {
+  std::stringstream ss;
+  ss << "Checksum mismatch on page " << page_number_ << " of file '"
+     << filename_ << "': stored " << std::hex << stored_ << ", computed "
+     << computed_;
+  message_.assign(ss.str());
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,88 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "badgerdb_exception.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a page read from a file does not
+ *        match the checksum it was written with.
+ *
+ * The page was damaged on disk or on its way from it: a torn write, a bad
+ * sector, a stray write into the file.
+ */
+class PageChecksumException : public BadgerDbException {
+ public:
+  /**
+   * Constructs a page checksum exception for the given page and filename.
+   *
+   * @param page_number  Number of the damaged page.
+   * @param file         Name of file the page was read from.
+   * @param stored       Checksum stored in the page.
+   * @param computed     Checksum of the page as read.
+   */
+  PageChecksumException(const PageId page_number, const std::string &file,
+                        const std::uint32_t stored,
+                        const std::uint32_t computed);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~PageChecksumException() throw() {}
+
+  /**
+   * Returns the number of the damaged page.
+   */
+  virtual PageId page_number() const { return page_number_; }
+
+  /**
+   * Returns name of the file that caused this exception.
+   */
+  virtual const std::string &filename() const { return filename_; }
+
+  /**
+   * Returns the checksum stored in the page.
+   */
+  virtual std::uint32_t stored() const { return stored_; }
+
+  /**
+   * Returns the checksum of the page as read.
+   */
+  virtual std::uint32_t computed() const { return computed_; }
+
+ protected:
+  /**
+   * Number of the damaged page.
+   */
+  const PageId page_number_;
+
+  /**
+   * Name of file which caused this exception.
+   */
+  const std::string filename_;
+
+  /**
+   * Checksum stored in the page.
+   */
+  const std::uint32_t stored_;
+
+  /**
+   * Checksum of the page as read.
+   */
+  const std::uint32_t computed_;
+};
+
+}  // namespace badgerdb
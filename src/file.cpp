@@ -8,31 +8,113 @@
 
 #include "file.h"
 
+#include <sys/stat.h>
+
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstddef>
 #include <cstdio>
-#include <fstream>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "exceptions/file_exists_exception.h"
+#include "exceptions/file_format_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/page_checksum_exception.h"
 #include "file_iterator.h"
 #include "page.h"
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
-File::CountMap File::open_counts_;
+namespace {
+
+/**
+ * Header of version 1 files, the only thing in front of page 1
+ */
+struct V1FileHeader {
+  PageId num_pages;
+  PageId first_used_page;
+  PageId num_free_pages;
+  PageId first_free_page;
+};
+
+/**
+ * Header of the pages of files up to version 4, PageHeader without the
+ * checksum
+ */
+struct V4PageHeader {
+  SlotId first_free_slot;
+  std::uint16_t free_space_upper_bound;
+  SlotId num_slots;
+  std::uint16_t fragmented_bytes;
+  PageId current_page_number;
+  PageId next_page_number;
+};
+
+/**
+ * Header of the pages of version 5 files, PageHeader without the LSN
+ */
+struct V5PageHeader {
+  V4PageHeader v4;
+  std::uint32_t checksum;
+};
+
+/**
+ * Returns the size of the page headers of an older file of the given version.
+ */
+std::size_t pageHeaderSize(const std::uint32_t version) {
+  return version < 5 ? sizeof(V4PageHeader) : sizeof(V5PageHeader);
+}
+
+/**
+ * Returns the size of the pages of a file from the header read from it; files
+ * that do not record it, version 1 files included, have pages of 8 KB.
+ */
+std::size_t pageSizeOf(const FileHeader &header) {
+  return header.magic == FILE_MAGIC && header.page_size != 0
+             ? header.page_size
+             : 8192;
+}
+
+}  // namespace
+
+static_assert(sizeof(FileHeader) <= PageMap::RESERVED_BYTES,
+              "File header must fit in front of the page map.");
+
+const PageId File::DEFAULT_EXTENT_SIZE;
+
+File::StateMap File::open_files_;
+std::mutex File::open_files_latch_;
+const std::string File::NO_FILENAME;
+FileId File::next_id_ = 1;
+FileBackendType File::default_backend_ = FileBackendType::POSIX;
 
 File File::create(const std::string &filename) {
-  return File(filename, true /* create_new */);
+  return File(filename, true /* create_new */, default_backend_);
+}
+
+File File::createCompressed(const std::string &filename) {
+  return File(filename, true /* create_new */, FileBackendType::COMPRESSED);
 }
 
 File File::open(const std::string &filename) {
-  return File(filename, false /* create_new */);
+  return File(filename, false /* create_new */, default_backend_);
+}
+
+File File::openMapped(const std::string &filename,
+                      const AccessPattern pattern) {
+  File file(filename, false /* create_new */, FileBackendType::MAPPED);
+  file.adviseAccess(pattern);
+  return file;
 }
 
 void File::remove(const std::string &filename) {
@@ -49,166 +131,350 @@ bool File::isOpen(const std::string &filename) {
   if (!exists(filename)) {
     return false;
   }
-  return open_counts_.find(filename) != open_counts_.end();
+  std::lock_guard<std::mutex> registry_latch(open_files_latch_);
+  return open_files_.find(filename) != open_files_.end();
 }
 
 bool File::exists(const std::string &filename) {
-  std::fstream file(filename);
-  if (file) {
-    file.close();
-    return true;
-  }
-
-  return false;
-}
-
-File::File(const File &other)
-    : filename_(other.filename_),
-      stream_(open_streams_[filename_]),
-      valid_(other.valid_) {
-  ++open_counts_[filename_];
+  struct stat status;
+  return ::stat(filename.c_str(), &status) == 0;
 }
 
 File &File::operator=(const File &rhs) {
-  // This accounts for self-assignment and assignment of a File object for the
-  // same file.
-  close();  // close my file and associate me with the new one
-  filename_ = rhs.filename_;
-  valid_ = rhs.valid_;
-  openIfNeeded(false /* create_new */);
+  // Taking the reference first accounts for self-assignment and assignment
+  // of a File object for the same file.
+  FileState *const state = rhs.state_;
+  if (state != NULL) state->refs.fetch_add(1, std::memory_order_relaxed);
+  close();
+  state_ = state;
   return *this;
 }
 
-File::~File() { close(); }
-
 Page File::allocatePage() {
-  FileHeader header = readHeader();
   Page new_page;
-  Page existing_page;
+  allocatePage(new_page);
+  return new_page;
+}
+
+void File::allocatePage(Page &new_page) {
+  checkWritable();
+  FileHeader header = readHeader();
+  PageMap &map = state_->map;
+  PageId page_number;
+  PageId previous_page_number;
   if (header.num_free_pages > 0) {
-    new_page = readPage(header.first_free_page, true /* allow_free */);
-    new_page.set_page_number(header.first_free_page);
-    header.first_free_page = new_page.next_page_number();
+    // Reuse the lowest free page; none is below the hint.
+    page_number = map.firstFree(header.first_free_page, header.num_pages);
+    assert(page_number < header.num_pages);
+    header.first_free_page = page_number + 1;
     --header.num_free_pages;
-
-    if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
-      // Either have no pages used or the head of the used list is a page
-      // later than the one we just allocated, so add the new page to the
-      // head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
-      }
-      header.first_used_page = new_page.page_number();
-    } else {
-      // New page is reused from somewhere after the beginning, so we need
-      // to find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
-    }
-
-    assert((header.num_free_pages == 0) ==
-           (header.first_free_page == Page::INVALID_NUMBER));
+    previous_page_number = map.prevUsed(page_number);
   } else {
-    new_page.set_page_number(header.num_pages);
-    if (header.first_used_page == Page::INVALID_NUMBER) {
-      header.first_used_page = new_page.page_number();
-    } else {
-      // If we have pages allocated, we need to add the new page to the
-      // tail of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
+    page_number = header.num_pages;
+    if (!map.covers(page_number)) {
+      // The first page of a chunk the bitmap does not cover yet holds its map.
+      map.addMapPage(page_number);
+      header.first_map_page = map.firstMapPage();
+      ++page_number;
+    }
+    header.num_pages = page_number + 1;
+    if (header.num_pages > header.reserved_pages) {
+      reserveExtent(header);
     }
-    ++header.num_pages;
+    previous_page_number = header.last_used_page;
   }
-  writePage(new_page.page_number(), new_page);
-  if (existing_page.page_number() != Page::INVALID_NUMBER) {
-    // If we updated an existing page by inserting the new page into the
-    // used list, we need to write it out.
-    writePage(existing_page.page_number(), existing_page);
+
+  const PageId next_page_number = map.nextUsed(page_number);
+  new_page.initialize();
+  new_page.set_page_number(page_number);
+  new_page.set_next_page_number(next_page_number);
+  map.setUsed(page_number, true);
+  writePage(page_number, new_page);
+  linkPage(previous_page_number, page_number, header);
+  if (next_page_number == Page::INVALID_NUMBER) {
+    header.last_used_page = page_number;
   }
   writeHeader(header);
+}
 
-  return new_page;
+PageId File::appendPages(char *pages, const std::size_t count) {
+  checkWritable();
+  if (count == 0) return Page::INVALID_NUMBER;
+  FileHeader header = readHeader();
+  PageMap &map = state_->map;
+
+  // Runs of pages that end up next to each other in the file, each written
+  // at once: (index of the first page, its number).
+  std::vector<std::pair<std::size_t, PageId>> runs;
+  PageHeader *previous = nullptr;
+  PageId page_number = header.num_pages;
+  for (std::size_t i = 0; i < count; ++i, ++page_number) {
+    if (!map.covers(page_number)) {
+      map.addMapPage(page_number);
+      header.first_map_page = map.firstMapPage();
+      ++page_number;
+      runs.emplace_back(i, page_number);
+    } else if (i == 0) {
+      runs.emplace_back(i, page_number);
+    }
+    PageHeader *page_header =
+        reinterpret_cast<PageHeader *>(pages + i * Page::SIZE);
+    page_header->current_page_number = page_number;
+    page_header->next_page_number = Page::INVALID_NUMBER;
+    page_header->checksum = checksumFor(
+        *page_header, pages + i * Page::SIZE + sizeof(PageHeader));
+    if (previous != nullptr) previous->next_page_number = page_number;
+    previous = page_header;
+    map.setUsed(page_number, true);
+  }
+  header.num_pages = page_number;
+  if (header.num_pages > header.reserved_pages) {
+    reserveExtent(header);
+  }
+
+  for (std::size_t r = 0; r < runs.size(); ++r) {
+    const std::size_t end = r + 1 < runs.size() ? runs[r + 1].first : count;
+    state_->backend->write(pagePosition(runs[r].second),
+                           pages + runs[r].first * Page::SIZE,
+                           (end - runs[r].first) * Page::SIZE);
+  }
+  afterPageWrite();
+  const PageId first_page_number = runs[0].second;
+  linkPage(header.last_used_page, first_page_number, header);
+  header.last_used_page = page_number - 1;
+  writeHeader(header);
+  return first_page_number;
 }
 
 Page File::readPage(const PageId page_number) const {
-  FileHeader header = readHeader();
-  if (page_number >= header.num_pages) {
-    throw InvalidPageException(page_number, filename_);
+  if (!state_->map.isUsed(page_number)) {
+    throw InvalidPageException(page_number, filename());
   }
   return readPage(page_number, false /* allow_free */);
 }
 
+void File::readPage(const PageId page_number, Page &page) const {
+  if (!state_->map.isUsed(page_number)) {
+    throw InvalidPageException(page_number, filename());
+  }
+  readPage(page_number, false /* allow_free */, page);
+}
+
+void File::readPages(const PageId first_page_number, Page *const *pages,
+                     const std::size_t count) const {
+  checkUsed(first_page_number, count);
+  readUsedPages(first_page_number, pages, count);
+}
+
+void File::checkUsed(const PageId first_page_number,
+                     const std::size_t count) const {
+  for (std::size_t i = 0; i < count; i++) {
+    if (!state_->map.isUsed(first_page_number + i)) {
+      throw InvalidPageException(first_page_number + i, filename());
+    }
+  }
+}
+
+void File::readUsedPages(const PageId first_page_number, Page *const *pages,
+                         const std::size_t count) const {
+  std::vector<char *> buffers(count);
+  for (std::size_t i = 0; i < count; i++) buffers[i] = pages[i]->bytes();
+  state_->backend->readv(pagePosition(first_page_number), buffers.data(),
+                         count, Page::SIZE);
+  for (std::size_t i = 0; i < count; i++) {
+    if (!pages[i]->isUsed()) {
+      throw InvalidPageException(first_page_number + i, filename());
+    }
+    verifyPage(*pages[i]);
+  }
+}
+
+Page File::viewPage(const PageId page_number) const {
+  if (!state_->map.isUsed(page_number)) {
+    throw InvalidPageException(page_number, filename());
+  }
+  const char *memory =
+      state_->backend->view(pagePosition(page_number), Page::SIZE);
+  if (memory == nullptr) return readPage(page_number, false /* allow_free */);
+
+  Page page(Page::View(), memory);
+  if (!page.isUsed()) throw InvalidPageException(page_number, filename());
+  verifyPage(page);
+  return page;
+}
+
+bool File::viewPages(const PageId first_page_number, Page *const *pages,
+                     const std::size_t count) const {
+  const char *memory = state_->backend->view(
+      pagePosition(first_page_number),
+      static_cast<std::size_t>(count) * Page::SIZE);
+  if (memory == nullptr) return false;
+
+  // Check every page before pointing any at the mapping.
+  for (std::size_t i = 0; i < count; i++) {
+    const PageHeader *header =
+        reinterpret_cast<const PageHeader *>(memory + i * Page::SIZE);
+    if (!state_->map.isUsed(first_page_number + i) ||
+        header->current_page_number == Page::INVALID_NUMBER) {
+      throw InvalidPageException(first_page_number + i, filename());
+    }
+    verifyPage(Page(Page::View(), memory + i * Page::SIZE));
+  }
+  for (std::size_t i = 0; i < count; i++) {
+    pages[i]->bind(const_cast<char *>(memory + i * Page::SIZE));
+  }
+  return true;
+}
+
+void File::checkWritable() const {
+  if (state_->backend->readOnly()) {
+    throw FileIOException(filename(), "writing", EROFS);
+  }
+}
+
+std::unique_ptr<IoRequest> File::readRequest(const PageId first_page_number,
+                                             Page *const *pages,
+                                             const std::size_t count) const {
+  std::unique_ptr<IoRequest> request(new IoRequest());
+  request->operation = IoRequest::READ;
+  request->backend = state_->backend;
+  request->offset = pagePosition(first_page_number);
+  request->buffers.resize(count);
+  for (std::size_t i = 0; i < count; i++) {
+    if (!state_->map.isUsed(first_page_number + i)) {
+      throw InvalidPageException(first_page_number + i, filename());
+    }
+    request->buffers[i].iov_base = pages[i]->bytes();
+    request->buffers[i].iov_len = Page::SIZE;
+  }
+  return request;
+}
+
+std::unique_ptr<IoRequest> File::writeRequest(Page &page) {
+  checkWritable();
+  const PageId page_number = page.page_number();
+  if (!state_->map.isUsed(page_number)) {
+    throw InvalidPageException(page_number, filename());
+  }
+  page.set_next_page_number(state_->map.nextUsed(page_number));
+  page.set_checksum(checksumFor(*page.header_, page.data_));
+
+  std::unique_ptr<IoRequest> request(new IoRequest());
+  request->operation = IoRequest::WRITE;
+  request->backend = state_->backend;
+  request->offset = pagePosition(page_number);
+  request->buffers.resize(1);
+  request->buffers[0].iov_base = page.bytes();
+  request->buffers[0].iov_len = Page::SIZE;
+  return request;
+}
+
 Page File::readPage(const PageId page_number, const bool allow_free) const {
   Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char *>(&page.header_), sizeof(page.header_));
-  stream_->read(&page.data_[0], Page::DATA_SIZE);
-  if (!allow_free && !page.isUsed()) {
-    throw InvalidPageException(page_number, filename_);
+  readPage(page_number, allow_free, page);
+  return page;
+}
+
+void File::readPage(const PageId page_number, const bool allow_free,
+                    Page &page) const {
+  state_->backend->read(pagePosition(page_number), page.bytes(), Page::SIZE);
+  if (!page.isUsed()) {
+    if (!allow_free) throw InvalidPageException(page_number, filename());
+    return;
   }
+  verifyPage(page);
+}
 
-  return page;
+void File::verifyPage(const Page &page) const {
+  if (!state_->checksums || page.checksumMatches()) return;
+  throw PageChecksumException(page.page_number(), filename(), page.checksum(),
+                              page.computeChecksum());
 }
 
 void File::writePage(const Page &new_page) {
-  PageHeader header = readPageHeader(new_page.page_number());
-  if (header.current_page_number == Page::INVALID_NUMBER) {
+  checkWritable();
+  const PageId page_number = new_page.page_number();
+  if (!state_->map.isUsed(page_number)) {
     // Page has been deleted since it was read.
-    throw InvalidPageException(new_page.page_number(), filename_);
+    throw InvalidPageException(page_number, filename());
+  }
+  // The used list may have changed since the page was read; we don't take
+  // the next page pointer from the page, but we do keep all the other
+  // modifications to the page header.
+  PageHeader header = *new_page.header_;
+  header.next_page_number = state_->map.nextUsed(page_number);
+  writePage(page_number, header, new_page);
+}
+
+void File::writePages(Page *const *pages, const std::size_t count) {
+  if (count == 0) return;
+  prepareWrite(pages, count);
+  writePreparedPages(pages, count);
+  afterPageWrite();
+}
+
+void File::prepareWrite(Page *const *pages, const std::size_t count) {
+  if (count == 0) return;
+  checkWritable();
+  const PageId first_page_number = pages[0]->page_number();
+  for (std::size_t i = 0; i < count; i++) {
+    const PageId page_number = pages[i]->page_number();
+    if (page_number != first_page_number + i ||
+        !state_->map.isUsed(page_number)) {
+      throw InvalidPageException(page_number, filename());
+    }
+    pages[i]->set_next_page_number(state_->map.nextUsed(page_number));
   }
-  // Page on disk may have had its next page pointer updated since it was read;
-  // we don't modify that, but we do keep all the other modifications to the
-  // page header.
-  const PageId next_page_number = header.next_page_number;
-  header = new_page.header_;
-  header.next_page_number = next_page_number;
-  writePage(new_page.page_number(), header, new_page);
+}
+
+void File::writePreparedPages(Page *const *pages,
+                              const std::size_t count) const {
+  if (count == 0) return;
+  std::vector<const char *> buffers(count);
+  for (std::size_t i = 0; i < count; i++) {
+    pages[i]->set_checksum(checksumFor(*pages[i]->header_, pages[i]->data_));
+    buffers[i] = pages[i]->bytes();
+  }
+  state_->backend->writev(pagePosition(pages[0]->page_number()),
+                          buffers.data(), count, Page::SIZE);
+}
+
+void File::afterPagesWritten(Page *const *pages, const std::size_t count) {
+  for (std::size_t i = 0; i < count; i++) {
+    const PageId page_number = pages[i]->page_number();
+    const PageId next_page_number = state_->map.nextUsed(page_number);
+    if (!state_->map.isUsed(page_number) ||
+        pages[i]->next_page_number() == next_page_number) {
+      continue;
+    }
+    pages[i]->set_next_page_number(next_page_number);
+    state_->backend->write(
+        pagePosition(page_number) + offsetof(PageHeader, next_page_number),
+        reinterpret_cast<const char *>(&next_page_number),
+        sizeof(next_page_number));
+  }
+  afterPageWrite();
 }
 
 void File::deletePage(const PageId page_number) {
+  checkWritable();
+  PageMap &map = state_->map;
+  if (!map.isUsed(page_number)) {
+    throw InvalidPageException(page_number, filename());
+  }
   FileHeader header = readHeader();
-  Page existing_page = readPage(page_number);
-  Page previous_page;
-  // If this page is the head of the used list, update the header to point to
-  // the next page in line.
-  if (page_number == header.first_used_page) {
-    header.first_used_page = existing_page.next_page_number();
-  } else {
-    // Walk the used list so we can update the page that points to this one.
-    for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
-        break;
-      }
-    }
+  const PageId previous_page_number = map.prevUsed(page_number);
+  linkPage(previous_page_number, map.nextUsed(page_number), header);
+  if (header.last_used_page == page_number) {
+    header.last_used_page = previous_page_number;
   }
-  // Clear the page and add it to the head of the free list.
-  existing_page.initialize();
-  existing_page.set_next_page_number(header.first_free_page);
-  header.first_free_page = page_number;
+  map.setUsed(page_number, false);
   ++header.num_free_pages;
-  if (previous_page.isUsed()) {
-    writePage(previous_page.page_number(), previous_page);
-  }
-  writePage(page_number, existing_page);
+  header.first_free_page = std::min(header.first_free_page, page_number);
+
+  // Clear the page on disk so that it reads as free.
+  const Page cleared_page;
+  writePage(page_number, cleared_page);
   writeHeader(header);
 }
 
@@ -219,86 +485,344 @@ FileIterator File::begin() {
 
 FileIterator File::end() { return FileIterator(this, Page::INVALID_NUMBER); }
 
-File::File(const std::string &name, const bool create_new)
-    : filename_(name), valid_(true) {
-  openIfNeeded(create_new);
+File::File(const std::string &name, const bool create_new,
+           const FileBackendType type)
+    : state_(NULL) {
+  openIfNeeded(name, create_new, type);
 
   if (create_new) {
-    // File starts with 1 page (the header).
-    FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+    // File starts with 1 page (the header and the first chunk of the map).
+    FileHeader header = {FILE_MAGIC,
+                         FILE_FORMAT_VERSION,
+                         1 /* num_pages */,
+                         Page::INVALID_NUMBER /* first_used_page */,
+                         0 /* num_free_pages */,
+                         1 /* first_free_page */,
+                         Page::INVALID_NUMBER /* last_used_page */,
+                         Page::INVALID_NUMBER /* first_map_page */,
+                         0 /* extent_size */,
+                         1 /* reserved_pages */,
+                         Page::SIZE /* page_size */};
     writeHeader(header);
+    flush();
   }
 }
 
-void File::openIfNeeded(const bool create_new) {
-  if (open_counts_.find(filename_) !=
-      open_counts_.end()) {  // exists an entry already
-    ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+void File::openIfNeeded(const std::string &name, const bool create_new,
+                        const FileBackendType type) {
+  std::lock_guard<std::mutex> registry_latch(open_files_latch_);
+  const StateMap::const_iterator open = open_files_.find(name);
+  if (open != open_files_.end()) {
+    state_ = open->second;
+    state_->refs.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+
+  const bool already_exists = exists(name);
+  if (create_new) {
+    // Error if we try to overwrite an existing file.
+    if (already_exists) {
+      throw FileExistsException(name);
+    }
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
-    const bool already_exists = exists(filename_);
-    if (create_new) {
-      // Error if we try to overwrite an existing file.
-      if (already_exists) {
-        throw FileExistsException(filename_);
+    // Error if we try to open a file that doesn't exist.
+    if (!already_exists) {
+      throw FileNotFoundException(name);
+    }
+  }
+  // New files are truncated on open; their header is written by the
+  // constructor.
+  std::unique_ptr<FileState> state(new FileState());
+  state_ = state.get();
+  state_->filename = name;
+  state_->id = 0;
+  state_->refs = 1;
+  state_->backend = FileBackend::open(type, name, create_new);
+  state_->header_dirty = false;
+  state_->durability = DurabilityMode::BUFFERED;
+  state_->group_interval = std::chrono::milliseconds(10);
+  state_->last_sync = std::chrono::steady_clock::now();
+  state_->checksums = true;
+  try {
+    if (!create_new) {
+      FileHeader &header = state_->header;
+      state_->backend->read(0 /* pos */, reinterpret_cast<char *>(&header),
+                            sizeof(header));
+      if (pageSizeOf(header) != Page::SIZE) {
+        throw FileFormatException(
+            name, "pages of " + std::to_string(pageSizeOf(header)) +
+                      " bytes, this build's are of " +
+                      std::to_string(Page::SIZE));
       }
-      // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
-    } else {
-      // Error if we try to open a file that doesn't exist.
-      if (!already_exists) {
-        valid_ = false;
-        throw FileNotFoundException(filename_);
+      if (header.magic != FILE_MAGIC || header.version < FILE_FORMAT_VERSION) {
+        if (state_->backend->readOnly()) {
+          throw FileFormatException(
+              name, "files in an older format must be opened for "
+                    "writing once to be converted");
+        }
+        if (header.magic != FILE_MAGIC) {
+          migrateFromVersion1(state_->backend);
+        } else {
+          migratePages(state_->backend);
+        }
+        state_->backend->read(0 /* pos */, reinterpret_cast<char *>(&header),
+                              sizeof(header));
+      } else if (header.version != FILE_FORMAT_VERSION) {
+        throw FileFormatException(
+            name,
+            "unsupported format version " + std::to_string(header.version));
       }
+      state_->map.load(*state_->backend, header.first_map_page);
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
-    open_counts_[filename_] = 1;
+  } catch (...) {
+    state_ = NULL;
+    throw;
   }
+  state_->id = next_id_++;
+  open_files_[name] = state.release();
+}
+
+void File::migrateFromVersion1(std::shared_ptr<FileBackend> &backend) {
+  V1FileHeader old_header;
+  backend->read(0 /* pos */, reinterpret_cast<char *>(&old_header),
+                sizeof(old_header));
+  const PageId old_num_pages = std::max<PageId>(1, old_header.num_pages);
+  const auto old_position = [](const PageId page_number) {
+    return sizeof(V1FileHeader) +
+           static_cast<std::uint64_t>(page_number - 1) * Page::SIZE;
+  };
+
+  // Map pages for the chunks beyond the first go after the existing pages.
+  FileHeader header = {FILE_MAGIC,
+                       FILE_FORMAT_VERSION,
+                       old_num_pages,
+                       Page::INVALID_NUMBER /* first_used_page */,
+                       0 /* num_free_pages */,
+                       1 /* first_free_page */,
+                       Page::INVALID_NUMBER /* last_used_page */,
+                       Page::INVALID_NUMBER /* first_map_page */,
+                       0 /* extent_size */,
+                       0 /* reserved_pages */,
+                       Page::SIZE /* page_size */};
+  PageMap map;
+  while (!map.covers(header.num_pages - 1)) {
+    map.addMapPage(header.num_pages++);
+  }
+  header.first_map_page = map.firstMapPage();
+  header.reserved_pages = header.num_pages;
+
+  for (PageId page_number = 1; page_number < old_num_pages; ++page_number) {
+    V4PageHeader page_header;
+    backend->read(old_position(page_number),
+                  reinterpret_cast<char *>(&page_header), sizeof(page_header));
+    if (page_header.current_page_number == Page::INVALID_NUMBER) {
+      ++header.num_free_pages;
+      continue;
+    }
+    map.setUsed(page_number, true);
+    if (header.first_used_page == Page::INVALID_NUMBER) {
+      header.first_used_page = page_number;
+    }
+    header.last_used_page = page_number;
+  }
+
+  const std::string new_filename = filename() + ".migrating";
+  std::shared_ptr<FileBackend> new_backend =
+      FileBackend::open(default_backend_, new_filename, true /* create_new */);
+  Page page;
+  for (PageId page_number = 1; page_number < old_num_pages; ++page_number) {
+    backend->read(old_position(page_number), page.bytes(), Page::SIZE);
+    if (map.isUsed(page_number)) {
+      page.set_next_page_number(map.nextUsed(page_number));
+      migratePage(page, sizeof(V4PageHeader));
+    }
+    new_backend->write(pagePosition(page_number), page.bytes(), Page::SIZE);
+  }
+  map.store(*new_backend, &header, sizeof(header), true /* header_dirty */);
+  replaceWithMigrated(backend, new_backend, new_filename);
+}
+
+void File::migratePages(std::shared_ptr<FileBackend> &backend) {
+  FileHeader header;
+  backend->read(0 /* pos */, reinterpret_cast<char *>(&header),
+                sizeof(header));
+  PageMap map;
+  map.load(*backend, header.first_map_page);
+
+  // Only the used pages change; the header page, map pages and free pages
+  // are copied as they are.
+  const std::string new_filename = filename() + ".migrating";
+  std::shared_ptr<FileBackend> new_backend =
+      FileBackend::open(default_backend_, new_filename, true /* create_new */);
+  const std::size_t old_header_size = pageHeaderSize(header.version);
+  Page page;
+  for (PageId page_number = 0; page_number < header.num_pages;
+       ++page_number) {
+    backend->read(pagePosition(page_number), page.bytes(), Page::SIZE);
+    if (map.isUsed(page_number)) migratePage(page, old_header_size);
+    new_backend->write(pagePosition(page_number), page.bytes(), Page::SIZE);
+  }
+  header.version = FILE_FORMAT_VERSION;
+  header.page_size = Page::SIZE;
+  new_backend->write(0 /* pos */, reinterpret_cast<const char *>(&header),
+                     sizeof(header));
+  if (header.reserved_pages > header.num_pages) {
+    new_backend->preallocate(
+        pagePosition(header.num_pages),
+        static_cast<std::uint64_t>(header.reserved_pages - header.num_pages) *
+            Page::SIZE);
+  }
+  replaceWithMigrated(backend, new_backend, new_filename);
+}
+
+void File::migratePage(Page &page, const std::size_t old_header_size) const {
+  if (!page.widenHeader(old_header_size)) {
+    throw FileFormatException(
+        filename(), "page " + std::to_string(page.page_number()) +
+                       " is too full for the current page header");
+  }
+  page.rebuildHeader();
+  page.set_checksum(checksumFor(*page.header_, page.data_));
+}
+
+void File::replaceWithMigrated(std::shared_ptr<FileBackend> &backend,
+                               std::shared_ptr<FileBackend> &new_backend,
+                               const std::string &new_filename) {
+  new_backend->sync();
+  new_backend.reset();
+  backend.reset();
+
+  if (std::rename(new_filename.c_str(), filename().c_str()) != 0) {
+    throw FileIOException(filename(), "migrating", errno);
+  }
+  backend = FileBackend::open(default_backend_, filename(),
+                              false /* create_new */);
 }
 
 void File::close() {
-  --open_counts_[filename_];
-  stream_.reset();
-  if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
-    open_counts_.erase(filename_);
+  if (state_ == NULL) return;
+  // Other references keep the state alive, so dropping one of them needs no
+  // latch; the last one is dropped under the registry latch, which openers
+  // take their reference under.
+  int refs = state_->refs.load(std::memory_order_relaxed);
+  while (refs > 1) {
+    if (state_->refs.compare_exchange_weak(refs, refs - 1,
+                                           std::memory_order_acq_rel)) {
+      state_ = NULL;
+      return;
+    }
+  }
+  std::lock_guard<std::mutex> registry_latch(open_files_latch_);
+  if (state_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    try {
+      flush();
+    } catch (const BadgerDbException &) {
+      // closing happens in destructors, which must not throw
+    }
+    open_files_.erase(state_->filename);
+    delete state_;
   }
+  state_ = NULL;
 }
 
 void File::writePage(const PageId page_number, const Page &new_page) {
-  writePage(page_number, new_page.header_, new_page);
+  writePage(page_number, *new_page.header_, new_page);
 }
 
 void File::writePage(const PageId page_number, const PageHeader &header,
                      const Page &new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char *>(&header), sizeof(header));
-  stream_->write(&new_page.data_[0], Page::DATA_SIZE);
-  stream_->flush();
+  // The page is one block as on disk, so it goes out in a single write; a
+  // different header needs a copy of the page, which does not allocate.
+  PageHeader sealed = header;
+  sealed.checksum = checksumFor(header, new_page.data_);
+  if (std::memcmp(&sealed, new_page.header_, sizeof(sealed)) == 0) {
+    state_->backend->write(pagePosition(page_number), new_page.bytes(),
+                           Page::SIZE);
+  } else {
+    Page page(new_page);
+    *page.header_ = sealed;
+    state_->backend->write(pagePosition(page_number), page.bytes(),
+                           Page::SIZE);
+  }
+  afterPageWrite();
 }
 
-FileHeader File::readHeader() const {
-  FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char *>(&header), sizeof(header));
+void File::afterPageWrite() {
+  switch (state_->durability) {
+    case DurabilityMode::SYNC:
+      state_->backend->sync();
+      state_->last_sync = std::chrono::steady_clock::now();
+      break;
+    case DurabilityMode::GROUP:
+      if (std::chrono::steady_clock::now() - state_->last_sync >=
+          state_->group_interval) {
+        sync();
+      }
+      break;
+    case DurabilityMode::BUFFERED:
+      break;
+  }
+}
 
-  return header;
+void File::flush() {
+  if (state_->durability != DurabilityMode::BUFFERED) {
+    sync();
+    return;
+  }
+  writeHeaderIfDirty();
+  state_->backend->flush();
 }
 
-void File::writeHeader(const FileHeader &header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char *>(&header), sizeof(header));
-  stream_->flush();
+void File::writeHeaderIfDirty() {
+  state_->map.store(*state_->backend, &state_->header, sizeof(state_->header),
+                    state_->header_dirty);
+  state_->header_dirty = false;
+}
+
+void File::sync() {
+  writeHeaderIfDirty();
+  state_->backend->sync();
+  state_->last_sync = std::chrono::steady_clock::now();
+}
+
+void File::setDurability(const DurabilityMode mode,
+                         const std::chrono::milliseconds group_interval) {
+  state_->durability = mode;
+  state_->group_interval = group_interval;
+}
+
+void File::setExtentSize(const PageId pages) {
+  checkWritable();
+  FileHeader header = readHeader();
+  header.extent_size = std::max<PageId>(1, pages);
+  writeHeader(header);
+}
+
+void File::reserveExtent(FileHeader &header) {
+  const PageId first = header.reserved_pages;
+  const PageId pages = std::max(header.num_pages - first, extentSize());
+  state_->backend->preallocate(pagePosition(first),
+                               static_cast<std::uint64_t>(pages) * Page::SIZE);
+  header.reserved_pages = first + pages;
+}
+
+void File::linkPage(const PageId page_number, const PageId next_page_number,
+                    FileHeader &header) {
+  if (page_number == Page::INVALID_NUMBER) {
+    header.first_used_page = next_page_number;
+    return;
+  }
+  state_->backend->write(
+      pagePosition(page_number) + offsetof(PageHeader, next_page_number),
+      reinterpret_cast<const char *>(&next_page_number),
+      sizeof(next_page_number));
+  afterPageWrite();
 }
 
 PageHeader File::readPageHeader(PageId page_number) const {
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char *>(&header), sizeof(header));
+  state_->backend->read(pagePosition(page_number),
+                        reinterpret_cast<char *>(&header), sizeof(header));
 
   return header;
 }
@@ -8,12 +8,18 @@
 
 #pragma once
 
-#include <fstream>
-#include <map>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
 #include <memory>
+#include <mutex>
 #include <string>
 
+#include "file_backend.h"
+#include "io_engine.h"
 #include "page.h"
+#include "page_map.h"
+#include "sharded_counters.h"
 
 namespace badgerdb {
 
@@ -21,10 +27,25 @@ class FileIterator;
 
 /**
  * @brief Header metadata for files on disk which contain pages.
+ *
+ * The header is at the start of page 0, followed by the first chunk of the
+ * file's allocation bitmap (see PageMap); it must fit in
+ * PageMap::RESERVED_BYTES.
  */
 struct FileHeader {
   /**
-   * Number of pages allocated in the file.
+   * Identifies files in this format, FILE_MAGIC.  Files written before the
+   * format had a version start with the number of pages instead.
+   */
+  std::uint32_t magic;
+
+  /**
+   * Version of the file format, FILE_FORMAT_VERSION.
+   */
+  std::uint32_t version;
+
+  /**
+   * Number of pages allocated in the file, including page 0 and map pages.
    */
   PageId num_pages;
 
@@ -39,10 +60,40 @@ struct FileHeader {
   PageId num_free_pages;
 
   /**
-   * Page number of the first free (allocated but unused) page in the file.
+   * No page before this one is free (allocated but unused); where the search
+   * for a free page to reuse starts.
    */
   PageId first_free_page;
 
+  /**
+   * Page number of the last used page in the file, the tail of the used list.
+   */
+  PageId last_used_page;
+
+  /**
+   * Page number of the map page holding the second chunk of the allocation
+   * bitmap, or Page::INVALID_NUMBER.
+   */
+  PageId first_map_page;
+
+  /**
+   * Number of pages the file grows by when it runs out of reserved space, 0
+   * for File::DEFAULT_EXTENT_SIZE.
+   */
+  PageId extent_size;
+
+  /**
+   * Disk space is reserved for every page below this one, see
+   * File::setExtentSize().
+   */
+  PageId reserved_pages;
+
+  /**
+   * Size of the file's pages, Page::SIZE of the code that created it; 0 in
+   * files created before it was recorded, whose pages are of 8 KB.
+   */
+  std::uint32_t page_size;
+
   /**
    * Returns true if this file header is equal to the other.
    *
@@ -50,29 +101,162 @@ struct FileHeader {
    * @return  True if the other header is equal to this one.
    */
   bool operator==(const FileHeader &rhs) const {
-    return num_pages == rhs.num_pages && num_free_pages == rhs.num_free_pages &&
+    return magic == rhs.magic && version == rhs.version &&
+           num_pages == rhs.num_pages && num_free_pages == rhs.num_free_pages &&
            first_used_page == rhs.first_used_page &&
-           first_free_page == rhs.first_free_page;
+           first_free_page == rhs.first_free_page &&
+           last_used_page == rhs.last_used_page &&
+           first_map_page == rhs.first_map_page &&
+           extent_size == rhs.extent_size &&
+           reserved_pages == rhs.reserved_pages && page_size == rhs.page_size;
   }
 };
 
+/**
+ * Value of FileHeader::magic.
+ */
+const std::uint32_t FILE_MAGIC = 0x32424442;
+
+/**
+ * Version of the file format written by this code.  Version 1 files (a bare
+ * 16-byte header, no bitmap), version 2 files (pages without a free slot
+ * chain, see PageHeader::first_free_slot), version 3 files (pages without
+ * a fragmented byte count, see PageHeader::fragmented_bytes), version 4
+ * files (pages without a checksum, see PageHeader::checksum) and version 5
+ * files (pages without an LSN, see PageHeader::lsn) are migrated when they
+ * are opened.
+ */
+const std::uint32_t FILE_FORMAT_VERSION = 6;
+
+/**
+ * @brief When writes to a file are made durable.
+ */
+enum class DurabilityMode {
+  /**
+   * Writes are handed to the operating system by flush() and made durable
+   * only by an explicit sync() (the default).
+   */
+  BUFFERED,
+
+  /**
+   * Every page and header write is made durable before it returns.
+   */
+  SYNC,
+
+  /**
+   * Group commit: writes are buffered and made durable together, at flush()
+   * and sync() and by the first write after the group interval has passed
+   * since the last sync.
+   */
+  GROUP
+};
+
+/**
+ * Counters BufMgr keeps per file, see BufMgr::getFileStats().
+ */
+enum FileBufCounter {
+  FILE_HITS,
+  FILE_MISSES,
+  FILE_DISK_READS,
+  FILE_DISK_WRITES,
+  NUM_FILE_BUF_COUNTERS
+};
+
+/**
+ * @brief What all File objects for the same open file share.
+ */
+struct FileState {
+  /**
+   * Name of the file.
+   */
+  std::string filename;
+
+  /**
+   * Identifier of the open file, see File::id().
+   */
+  FileId id;
+
+  /**
+   * Number of File objects for the file; the last one to go closes it.
+   * Only dropped to zero under File::open_files_latch_.
+   */
+  std::atomic<int> refs;
+
+  /**
+   * Does the I/O on the file.
+   */
+  std::shared_ptr<FileBackend> backend;
+
+  /**
+   * The file header, read from disk when the file is opened.  Changes are
+   * made here and written back by File::flush() and when the file is closed.
+   */
+  FileHeader header;
+
+  /**
+   * Which pages are in use, read from disk when the file is opened and
+   * written back with the header.
+   */
+  PageMap map;
+
+  /**
+   * Whether header has changed since it was last written.
+   */
+  bool header_dirty;
+
+  /**
+   * When writes are made durable, see File::setDurability().
+   */
+  DurabilityMode durability;
+
+  /**
+   * Longest time writes stay buffered in GROUP mode.
+   */
+  std::chrono::milliseconds group_interval;
+
+  /**
+   * When the file was last synced.
+   */
+  std::chrono::steady_clock::time_point last_sync;
+
+  /**
+   * Whether pages are checksummed, see File::setChecksums().
+   */
+  bool checksums;
+
+  /**
+   * Buffer pool events on the file's pages, counted by BufMgr.
+   */
+  ShardedCounters<NUM_FILE_BUF_COUNTERS> buffer_counters;
+};
+
 /**
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
- * fixed-sized pages, and they never deallocate space (though they do reuse
- * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * The File class wraps a FileBackend doing the I/O on an underlying file on
+ * disk.  Files contain fixed-sized pages, and they never deallocate space
+ * (though they do reuse deleted pages if possible).  If multiple File objects
+ * refer to the same underlying file, they will share the backend in memory.
  * If a file that has already been opened (possibly by another query), then the
- * File class detects this (by looking in the open_streams_ map) and just
- * returns a file object with the already created stream for the file without
- * actually opening the UNIX file again.
+ * File class detects this (by looking in the open_files_ map) and just
+ * returns a file object with the already created backend for the file without
+ * actually opening the UNIX file again.  The file header and the allocation
+ * bitmap are kept in memory with the backend and only written back when the
+ * file is flushed or closed, so allocating and deleting pages take a constant
+ * number of I/Os.  Newly opened files use the default backend, see
+ * setDefaultBackend().
  *
- * @warning This class is not threadsafe.
+ * @warning Copying and destroying File objects, and opening files, is
+ * threadsafe; the other methods are not.
  */
 class File {
  public:
+  /**
+   * Number of pages a file grows by at a time unless set otherwise.
+   */
+  static const PageId DEFAULT_EXTENT_SIZE = 64;
+
   /**
    * Creates a new file.
    *
@@ -81,21 +265,48 @@ class File {
    */
   static File create(const std::string &filename);
 
+  /**
+   * Creates a new file whose pages are stored compressed, for files read
+   * more than written where I/O costs more than the processor time to
+   * decompress.  Pages in memory, in File and BufMgr, are as in any other
+   * file; see CompressedFileBackend for how they are stored.  The file is
+   * recognized as compressed whenever it is opened later.
+   *
+   * @param filename  Name of the file.
+   * @throws  FileExistsException     If the requested file already exists.
+   */
+  static File createCompressed(const std::string &filename);
+
   /**
    * Opens the file named fileName and returns the corresponding File object.
    * It first checks if the file is already open. If so, then the new File
-   * object created uses the same input-output stream to read to or write fom
-   * that already open file. Reference count (open_counts_ static variable
-   * inside the File object) is incremented whenever an already open file is
-   * opened again. Otherwise the UNIX file is actually opened. The fileName and
-   * the stream associated with this File object are inserted into the
-   * open_streams_ map.
+   * object created uses the same backend to read to or write fom that already
+   * open file, and the reference count in its FileState is incremented.
+   * Otherwise the UNIX file is actually opened and its FileState inserted into
+   * the open_files_ map.
    *
    * @param filename  Name of the file.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
    */
   static File open(const std::string &filename);
 
+  /**
+   * Opens an existing file read-only, mapped into memory (the MAPPED
+   * backend), so that its pages can be handed out as views of the mapping
+   * instead of copies: by viewPage(), by FileIterator and by BufMgr, whose
+   * frames then point into the mapping.  Pages cannot be allocated, written
+   * or deleted; trying to throws FileIOException.  If the file is already
+   * open, the new object shares it in whatever mode it was opened in.
+   *
+   * @param filename  Name of the file.
+   * @param pattern   How the file is going to be read, see adviseAccess().
+   * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  FileFormatException     If the file is in a format that would
+   *                                  have to be converted first.
+   */
+  static File openMapped(const std::string &filename,
+                         const AccessPattern pattern = AccessPattern::NORMAL);
+
   /**
    * Deletes an existing file.
    *
@@ -113,19 +324,37 @@ class File {
   static bool isOpen(const std::string &filename);
 
   /**
-   * Returns true if the file exists and is open.
+   * Returns true if the file exists.
    *
    * @param filename  Name of the file.
    */
   static bool exists(const std::string &filename);
 
   /**
-   * Copy constructor.
+   * Sets the backend files opened or created from now on use.  Files that
+   * are already open keep theirs.
+   *
+   * @param type  Backend to use.
+   */
+  static void setDefaultBackend(const FileBackendType type) {
+    default_backend_ = type;
+  }
+
+  /**
+   * Returns the backend newly opened files use (POSIX unless changed).
+   */
+  static FileBackendType defaultBackend() { return default_backend_; }
+
+  /**
+   * Copy constructor.  The copy shares the open file's state, which only
+   * takes a reference to it.
    *
    * @param other File object to copy.
    * @return      A copy of the File object.
    */
-  File(const File &other);
+  File(const File &other) : state_(other.state_) {
+    if (state_ != NULL) state_->refs.fetch_add(1, std::memory_order_relaxed);
+  }
 
   /**
    * Assignment operator.
@@ -136,24 +365,24 @@ class File {
   File &operator=(const File &rhs);
 
   /**
-   * Check if two files are equal.
+   * Check if two files are equal, i.e. refer to the same open file.
    * @param rhs File object to compare.
    * @return True if the two files are equal.
    */
-  bool operator==(const File &rhs) const { return filename_ == rhs.filename_; }
+  bool operator==(const File &rhs) const { return state_ == rhs.state_; }
 
   /**
    * Check if two files are not equal.
    * @param rhs File object to compare.
    * @return True if the two files are not equal.
    */
-  bool operator!=(const File &rhs) const { return filename_ != rhs.filename_; }
+  bool operator!=(const File &rhs) const { return state_ != rhs.state_; }
 
   /**
    * Destructor that automatically closes the underlying file if no other
    * File objects are using it.
    */
-  ~File();
+  ~File() { close(); }
 
   /**
    * Allocates a new page in the file.
@@ -162,6 +391,28 @@ class File {
    */
   Page allocatePage();
 
+  /**
+   * Allocates a new page in the file, building it in a caller-supplied page
+   * so that no Page has to be copied or constructed.
+   *
+   * @param new_page  Set to the new page.
+   */
+  void allocatePage(Page &new_page);
+
+  /**
+   * Appends ready-made pages at the end of the file, after every page in it,
+   * in as few large writes as possible.  Free pages in the middle of the file
+   * are not reused.  Sets the page number and next page number of each page
+   * in memory before writing it; the numbers are consecutive except where a
+   * map page has to go in between.  Used by BulkLoader.
+   *
+   * @param pages   The pages, one after the other in memory, as on disk.
+   * @param count   Number of pages.
+   * @return  Number of the first page appended, or Page::INVALID_NUMBER if
+   *          there are none.
+   */
+  PageId appendPages(char *pages, const std::size_t count);
+
   /**
    * Reads an existing page from the file.
    *
@@ -169,22 +420,173 @@ class File {
    * @return  The page.
    * @throws  InvalidPageException  If the page doesn't exist in the file or is
    *                                not currently used.
+   * @throws  PageChecksumException  If the page does not match its checksum.
    */
   Page readPage(const PageId page_number) const;
 
+  /**
+   * Reads an existing page from the file directly into a caller-supplied page
+   * (a buffer pool frame, for instance), overwriting its contents.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Page to read into.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  PageChecksumException  If the page does not match its checksum.
+   */
+  void readPage(const PageId page_number, Page &page) const;
+
+  /**
+   * Reads consecutive existing pages into caller-supplied pages with a single
+   * request to the backend.
+   *
+   * @param first_page_number   Number of the first page to read.
+   * @param pages               Pages to read into, the i-th gets page
+   *                            first_page_number + i.
+   * @param count               Number of pages to read.
+   * @throws  InvalidPageException  If one of the pages doesn't exist in the
+   *                                file or is not currently used.
+   * @throws  PageChecksumException  If one of the pages does not match its
+   *                                 checksum.
+   */
+  void readPages(const PageId first_page_number, Page *const *pages,
+                 const std::size_t count) const;
+
+  /**
+   * Returns an existing page without copying it if the file is mapped (see
+   * openMapped()): the page is a view of the mapping, valid while the file is
+   * open and never to be modified.  Otherwise the same as readPage().
+   *
+   * @param page_number   Number of page to return.
+   * @return  The page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   * @throws  PageChecksumException  If the page does not match its checksum.
+   */
+  Page viewPage(const PageId page_number) const;
+
   /**
    * Writes a page into the file, replacing any existing contents.  The page
    * must have been already allocated in this file by a call to allocatePage().
    *
    * @see allocatePage()
    * @param new_page  Page to write.
+   * @throws  InvalidPageException  If the page is not currently used.
    */
   void writePage(const Page &new_page);
 
+  /**
+   * Writes pages with consecutive page numbers with a single request to the
+   * backend, like a writePage() call per page.  The next page pointer is set
+   * in each page itself so that they can be written as they are.
+   *
+   * @param pages   Pages to write, the i-th holding page
+   *                pages[0]->page_number() + i.
+   * @param count   Number of pages to write.
+   * @throws  InvalidPageException  If one of the pages is not currently used
+   *                                or out of sequence.
+   */
+  void writePages(Page *const *pages, const std::size_t count);
+
+  /**
+   * Writes the file header back to disk if it has changed and hands all
+   * buffered writes to the operating system; in SYNC and GROUP mode also
+   * makes them durable, so this is a commit point.  Happens automatically
+   * when the last File object for the file is closed.
+   */
+  void flush();
+
+  /**
+   * Makes every write so far, and the file header, durable whatever the
+   * durability mode.
+   *
+   * @throws  FileIOException   If the operating system reports an error
+   */
+  void sync();
+
+  /**
+   * Sets when writes to this file are made durable.  Applies to every File
+   * object for the file until it is closed; files start out BUFFERED.
+   *
+   * @param mode            Durability mode.
+   * @param group_interval  In GROUP mode, the longest time writes stay
+   *                        buffered.
+   */
+  void setDurability(const DurabilityMode mode,
+                     const std::chrono::milliseconds group_interval =
+                         std::chrono::milliseconds(10));
+
+  /**
+   * Returns when writes to this file are made durable.
+   */
+  DurabilityMode durability() const { return state_->durability; }
+
+  /**
+   * Sets whether pages written to this file get a checksum, and whether the
+   * checksums of pages read from it are checked.  Pages written while
+   * checksums are off store none and are never checked.  Applies to every
+   * File object for the file until it is closed; files start out with
+   * checksums on.
+   *
+   * @param enabled   Whether to checksum pages.
+   */
+  void setChecksums(const bool enabled) { state_->checksums = enabled; }
+
+  /**
+   * Returns whether pages of this file are checksummed.
+   */
+  bool checksums() const { return state_->checksums; }
+
+  /**
+   * Checks a used page read from this file into memory by other means than
+   * the read methods, which check what they read themselves.  Does nothing
+   * if checksums are off.
+   *
+   * @param page  Page as read.
+   * @throws  PageChecksumException  If the page does not match its checksum.
+   */
+  void verifyPage(const Page &page) const;
+
+  /**
+   * Returns whether the file was opened read-only, see openMapped().
+   */
+  bool isReadOnly() const { return state_->backend->readOnly(); }
+
+  /**
+   * Tells the operating system how the file is going to be read, so that it
+   * reads ahead for sequential scans and not for random lookups.  Only has
+   * an effect on mapped files.
+   *
+   * @param pattern   How the file is going to be read.
+   */
+  void adviseAccess(const AccessPattern pattern) {
+    state_->backend->advise(pattern);
+  }
+
+  /**
+   * Sets how many pages the file grows by at a time.  When allocatePage()
+   * runs out of pages with disk space reserved, the backend reserves the
+   * next <pages> pages in one go (with fallocate() where available), so a
+   * growing file is extended an extent at a time instead of a page at a
+   * time.  The setting is stored in the file header.
+   *
+   * @param pages   Pages per extent; 1 grows the file a page at a time.
+   */
+  void setExtentSize(const PageId pages);
+
+  /**
+   * Returns how many pages the file grows by at a time.
+   */
+  PageId extentSize() const {
+    const PageId pages = readHeader().extent_size;
+    return pages != 0 ? pages : DEFAULT_EXTENT_SIZE;
+  }
+
   /**
    * Deletes a page from the file.
    *
    * @param page_number   Number of page to delete.
+   * @throws  InvalidPageException  If the page is not currently used.
    */
   void deletePage(const PageId page_number);
 
@@ -193,7 +595,18 @@ class File {
    *
    * @return Name of file.
    */
-  const std::string &filename() const { return filename_; }
+  const std::string &filename() const {
+    return state_ != NULL ? state_->filename : NO_FILENAME;
+  }
+
+  /**
+   * Returns the identifier of the open file this object represents.  It is
+   * assigned when the file is first opened and shared by every File object
+   * for that file until it is closed.
+   *
+   * @return  Identifier of file, 0 if the file is not open.
+   */
+  FileId id() const { return state_ != NULL ? state_->id : 0; }
 
   /**
    * Returns an iterator at the first page in the file.
@@ -215,13 +628,13 @@ class File {
    *
    * @return  True if the file is valid
    */
-  constexpr bool isValid() const { return valid_; }
+  bool isValid() const { return state_ != NULL; }
 
   /**
    * Creates an empty file
-   * @return File object with valid_ bit set to false
+   * @return File object that is not valid
    */
-  File() : valid_(false) {}
+  File() : state_(NULL) {}
 
  private:
   friend class BufMgr;
@@ -235,12 +648,14 @@ class File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param type        Backend to open the file with if it is not open yet.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
    */
-  explicit File(const std::string &name, const bool create_new);
+  File(const std::string &name, const bool create_new,
+       const FileBackendType type);
 
   /**
    * Returns the position of the page with the given number in the file (as an
@@ -249,25 +664,187 @@ class File {
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
-    return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
+  static std::uint64_t pagePosition(const PageId page_number) {
+    return static_cast<std::uint64_t>(page_number) * Page::SIZE;
   }
 
   /**
-   * Opens the underlying file named in filename_.
+   * Points caller-supplied pages at consecutive existing pages in the file's
+   * mapping, if the file is mapped and the mapping covers them; they must not
+   * own their memory.  Otherwise leaves them alone so the caller can read
+   * them with readPages().
+   *
+   * @param first_page_number   Number of the first page.
+   * @param pages               Pages to point, the i-th at page
+   *                            first_page_number + i.
+   * @param count               Number of pages.
+   * @return  Whether the pages now view the mapping.
+   * @throws  InvalidPageException  If one of the pages doesn't exist in the
+   *                                file or is not currently used.
+   * @throws  PageChecksumException  If one of the pages does not match its
+   *                                 checksum.
+   */
+  bool viewPages(const PageId first_page_number, Page *const *pages,
+                 const std::size_t count) const;
+
+  /**
+   * Throws unless the file may be written.
+   *
+   * @throws  FileIOException   If the file was opened read-only.
+   */
+  void checkWritable() const;
+
+  /**
+   * Builds a request reading consecutive existing pages into caller-supplied
+   * pages, for an IoEngine; otherwise like readPages().  The pages read must
+   * still be checked with Page::isUsed().
+   *
+   * @param first_page_number   Number of the first page to read.
+   * @param pages               Pages to read into.
+   * @param count               Number of pages to read.
+   * @return  The request, without its done callback.
+   * @throws  InvalidPageException  If one of the pages doesn't exist in the
+   *                                file or is not currently used.
+   */
+  std::unique_ptr<IoRequest> readRequest(const PageId first_page_number,
+                                         Page *const *pages,
+                                         const std::size_t count) const;
+
+  /**
+   * Builds a request writing a page, for an IoEngine; otherwise like
+   * writePage(), but the next page pointer is set in <page> itself so that it
+   * can be written as one block.  Call afterPageWrite() once it is done.
+   *
+   * @param page  Page to write.
+   * @return  The request, without its done callback.
+   * @throws  InvalidPageException  If the page is not currently used.
+   */
+  std::unique_ptr<IoRequest> writeRequest(Page &page);
+
+  /**
+   * First half of readPages(): checks that consecutive pages exist and are
+   * in use, which takes the page map.
+   *
+   * @param first_page_number   Number of the first page.
+   * @param count               Number of pages.
+   * @throws  InvalidPageException  If one of the pages doesn't exist in the
+   *                                file or is not currently used.
+   */
+  void checkUsed(const PageId first_page_number,
+                 const std::size_t count) const;
+
+  /**
+   * Second half of readPages(): reads pages checked with checkUsed() and
+   * checks what was read.  Only the backend is used, which may be called
+   * from several threads at once, so this needs none of the latching the
+   * caller does around the other calls into the file.
+   *
+   * @param first_page_number   Number of the first page to read.
+   * @param pages               Pages to read into.
+   * @param count               Number of pages to read.
+   * @throws  InvalidPageException  If one of the pages is not in use on disk.
+   * @throws  PageChecksumException  If one of the pages does not match its
+   *                                 checksum.
+   */
+  void readUsedPages(const PageId first_page_number, Page *const *pages,
+                     const std::size_t count) const;
+
+  /**
+   * First step of writePages(): checks that the pages are in use and in
+   * sequence and sets their next page pointers from the page map.
+   *
+   * @param pages   Pages to write.
+   * @param count   Number of pages.
+   * @throws  InvalidPageException  If one of the pages is not currently used
+   *                                or out of sequence.
+   */
+  void prepareWrite(Page *const *pages, const std::size_t count);
+
+  /**
+   * Second step of writePages(): checksums and writes pages prepared with
+   * prepareWrite().  Like readUsedPages(), only the backend is used.
+   *
+   * @param pages   Pages to write.
+   * @param count   Number of pages.
+   */
+  void writePreparedPages(Page *const *pages, const std::size_t count) const;
+
+  /**
+   * Last step of a write of pages prepared with prepareWrite() or
+   * writeRequest() once it is done.  A page allocated or deleted meanwhile
+   * may have changed what follows one of them, so their next page pointers
+   * are rewritten where they are stale (the checksum does not cover them);
+   * then durability is seen to as by afterPageWrite().
+   *
+   * @param pages   Pages written.
+   * @param count   Number of pages.
+   */
+  void afterPagesWritten(Page *const *pages, const std::size_t count);
+
+  /**
+   * Opens the underlying file and points state_ at its state.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it takes a reference to their state.
    *
+   * @param name        Name of the file.
    * @param create_new  Whether to create a new file.
+   * @param type        Backend to open the file with.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  FileFormatException     If the underlying file is in a format
+   *                                  this code cannot read.
+   */
+  void openIfNeeded(const std::string &name, const bool create_new,
+                    const FileBackendType type);
+
+  /**
+   * Rewrites a version 1 file in the current format.  The new file is built
+   * next to the old one and renamed over it once it is synced, so a crash
+   * leaves one of the two intact.
+   *
+   * @param backend   Backend of the old file; replaced by one of the new file.
+   * @throws  FileIOException   If the operating system reports an error
    */
-  void openIfNeeded(const bool create_new);
+  void migrateFromVersion1(std::shared_ptr<FileBackend> &backend);
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Rewrites a version 2 to 5 file in the current format, laying every
+   * used page out anew; otherwise like migrateFromVersion1().
+   *
+   * @param backend   Backend of the old file; replaced by one of the new file.
+   * @throws  FileIOException   If the operating system reports an error
+   */
+  void migratePages(std::shared_ptr<FileBackend> &backend);
+
+  /**
+   * Converts a used page of an older file format to the current one, see
+   * Page::widenHeader(), and checksums it.
+   *
+   * @param page             Page as read from the old file.
+   * @param old_header_size  Size of the page headers of the old format.
+   * @throws  FileFormatException   If the page's records do not fit the
+   *                                current format.
+   */
+  void migratePage(Page &page, const std::size_t old_header_size) const;
+
+  /**
+   * Syncs a migrated copy of the file and renames it over the original.
+   *
+   * @param backend       Backend of the old file; replaced by one of the new
+   *                      file.
+   * @param new_backend   Backend of the copy; closed.
+   * @param new_filename  Name of the copy.
+   * @throws  FileIOException   If the operating system reports an error
+   */
+  void replaceWithMigrated(std::shared_ptr<FileBackend> &backend,
+                           std::shared_ptr<FileBackend> &new_backend,
+                           const std::string &new_filename);
+
+  /**
+   * Lets go of <state_>, closing the underlying file backend and writing the
+   * file header if it has changed.
    * This method only closes the file if no other File objects exist that access
    * the same file.
    */
@@ -277,17 +854,32 @@ class File {
    * Reads a page from the file.  If <allow_free> is not set, an exception
    * will be thrown if the page read from disk is not currently in use.
    *
-   * No bounds checking is performed; the underlying file stream will throw
-   * an exception if the page is past the end of the file.
+   * No bounds checking is performed; a page past the end of the file reads
+   * as all zeros, i.e. as a free page.
    *
    * @param page_number   Number of page to read.
    * @param allow_free    Whether to allow reading a free (unused) page.
    * @return  The page.
    * @throws  InvalidPageException  If the page is free (unused) and
    *                                allow_free is false.
+   * @throws  PageChecksumException  If the page does not match its checksum.
    */
   Page readPage(const PageId page_number, const bool allow_free) const;
 
+  /**
+   * Reads a page from the file into <page>; otherwise like
+   * readPage(page_number, allow_free).
+   *
+   * @param page_number   Number of page to read.
+   * @param allow_free    Whether to allow reading a free (unused) page.
+   * @param page          Page to read into.
+   * @throws  InvalidPageException  If the page is free (unused) and
+   *                                allow_free is false.
+   * @throws  PageChecksumException  If the page does not match its checksum.
+   */
+  void readPage(const PageId page_number, const bool allow_free,
+                Page &page) const;
+
   /**
    * Writes a page into the file at the given page number.  This does not
    * update ensure that the number in the header equals the position on disk.
@@ -311,18 +903,79 @@ class File {
                  const Page &new_page);
 
   /**
-   * Reads the header for this file from disk.
+   * Returns the header for this file (the copy cached in memory).
    *
    * @return  The file header.
    */
-  FileHeader readHeader() const;
+  const FileHeader &readHeader() const { return state_->header; }
 
   /**
-   * Writes the given header to the disk as the header for this file.
+   * Sets the header for this file.  It is written to disk lazily, see
+   * flush(), except in SYNC mode.
    *
    * @param header  File header to write.
    */
-  void writeHeader(const FileHeader &header);
+  void writeHeader(const FileHeader &header) {
+    state_->header = header;
+    state_->header_dirty = true;
+    if (state_->durability == DurabilityMode::SYNC) sync();
+  }
+
+  /**
+   * Writes the cached file header and the parts of the allocation bitmap that
+   * have changed to disk.
+   */
+  void writeHeaderIfDirty();
+
+  /**
+   * Makes a page write that was just issued durable if the durability mode
+   * asks for it now.
+   */
+  void afterPageWrite();
+
+  /**
+   * Reserves disk space for the next extent, which starts at the first page
+   * without reserved space and covers at least every page below
+   * <header.num_pages>.
+   *
+   * @param header  File header to update.
+   * @throws  FileIOException   If the operating system reports an error
+   */
+  void reserveExtent(FileHeader &header);
+
+  /**
+   * Returns the checksum to store in a page about to be written, 0 if
+   * checksums are off.
+   *
+   * @param header  Header the page is written with.
+   * @param data    Data of the page.
+   * @return  Checksum for the header.
+   */
+  std::uint32_t checksumFor(const PageHeader &header, const char *data) const {
+    return state_->checksums ? Page::computeChecksum(header, data) : 0;
+  }
+
+  /**
+   * Makes <next_page_number> follow <page_number> in the used list by
+   * rewriting only the next page pointer of page <page_number> on disk, or
+   * the head of the list in <header> if <page_number> is Page::INVALID_NUMBER.
+   *
+   * @param page_number       Page to update, or Page::INVALID_NUMBER.
+   * @param next_page_number  Page to follow it.
+   * @param header            File header to update.
+   */
+  void linkPage(const PageId page_number, const PageId next_page_number,
+                FileHeader &header);
+
+  /**
+   * Returns the lowest used page after the given one, or Page::INVALID_NUMBER;
+   * the page that follows it in the used list, without reading the disk.
+   *
+   * @param page_number   Number of page.
+   */
+  PageId nextUsedPage(const PageId page_number) const {
+    return state_->map.nextUsed(page_number);
+  }
 
   /**
    * Reads only the header of the given page from disk (not the record data
@@ -333,35 +986,45 @@ class File {
    */
   PageHeader readPageHeader(const PageId page_number) const;
 
-  typedef std::map<std::string, std::shared_ptr<std::fstream>> StreamMap;
-  typedef std::map<std::string, int> CountMap;
+  typedef std::unordered_map<std::string, FileState *> StateMap;
+
+  /**
+   * Shared state of opened files, by name, looked up only when a file is
+   * opened or closed.
+   */
+  static StateMap open_files_;
 
   /**
-   * Streams for opened files.
+   * Protects open_files_ and next_id_.  A file's last reference is only
+   * dropped under it, so that opening the file cannot take a reference to a
+   * state that is being closed.
    */
-  static StreamMap open_streams_;
+  static std::mutex open_files_latch_;
 
   /**
-   * Counts for opened files.
+   * Name of files that are not valid.
    */
-  static CountMap open_counts_;
+  static const std::string NO_FILENAME;
 
   /**
-   * Name of the file this object represents.
+   * Identifier handed to the next file that is opened.
    */
-  std::string filename_;
+  static FileId next_id_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Backend used for files opened from now on.
    */
-  std::shared_ptr<std::fstream> stream_;
+  static FileBackendType default_backend_;
 
   /**
-   * Whether this file is valid.
+   * Backend and cached header of the underlying filesystem object, shared by
+   * all File objects for it; NULL if the file is not valid.
    */
-  bool valid_;
+  FileState *state_;
 
   friend class FileIterator;
+  friend class ParallelScan;
+  friend class ScanIterator;
   friend class FileTest;
 };
 
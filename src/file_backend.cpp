@@ -0,0 +1,302 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "file_backend.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#include "compressed_file_backend.h"
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+/**
+ * Returns errno, or EIO if a failing call did not set it (std::fstream).
+ */
+static int lastError() { return errno != 0 ? errno : EIO; }
+
+std::shared_ptr<FileBackend> FileBackend::open(const FileBackendType type,
+                                               const std::string &filename,
+                                               const bool create_new) {
+  std::shared_ptr<FileBackend> backend;
+  if (type == FileBackendType::STREAM) {
+    backend = std::make_shared<StreamFileBackend>(filename, create_new);
+  } else if (type == FileBackendType::MAPPED) {
+    if (create_new) throw FileIOException(filename, "creating", EROFS);
+    backend = std::make_shared<MappedFileBackend>(filename);
+  } else {
+    backend = std::make_shared<PosixFileBackend>(filename, create_new);
+  }
+  if (create_new ? type == FileBackendType::COMPRESSED
+                 : CompressedFileBackend::isCompressed(*backend)) {
+    return std::make_shared<CompressedFileBackend>(filename, backend,
+                                                   create_new);
+  }
+  return backend;
+}
+
+void FileBackend::readv(const std::uint64_t offset, char *const *buffers,
+                        const std::size_t count, const std::size_t length) {
+  for (std::size_t i = 0; i < count; i++) {
+    read(offset + i * length, buffers[i], length);
+  }
+}
+
+void FileBackend::writev(const std::uint64_t offset,
+                         const char *const *buffers, const std::size_t count,
+                         const std::size_t length) {
+  for (std::size_t i = 0; i < count; i++) {
+    write(offset + i * length, buffers[i], length);
+  }
+}
+
+PosixFileBackend::PosixFileBackend(const std::string &filename,
+                                   const bool create_new)
+    : FileBackend(filename) {
+  const int flags = O_RDWR | O_CLOEXEC | (create_new ? O_CREAT | O_TRUNC : 0);
+  fd_ = ::open(filename.c_str(), flags, 0644);
+  if (fd_ < 0) throw FileIOException(filename_, "opening", errno);
+}
+
+PosixFileBackend::~PosixFileBackend() { ::close(fd_); }
+
+void PosixFileBackend::read(const std::uint64_t offset, char *buffer,
+                            const std::size_t length) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n = ::pread(fd_, buffer + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw FileIOException(filename_, "reading", errno);
+    }
+    if (n == 0) {
+      // end of file
+      std::memset(buffer + done, 0, length - done);
+      return;
+    }
+    done += n;
+  }
+}
+
+void PosixFileBackend::readv(const std::uint64_t offset,
+                             char *const *buffers, const std::size_t count,
+                             const std::size_t length) {
+  std::vector<struct iovec> blocks(count);
+  for (std::size_t i = 0; i < count; i++) {
+    blocks[i].iov_base = buffers[i];
+    blocks[i].iov_len = length;
+  }
+
+  // blocks[next] is the first one not completely read
+  std::size_t next = 0;
+  std::uint64_t position = offset;
+  while (next < count) {
+    const int num_blocks = std::min<std::size_t>(count - next, IOV_MAX);
+    const ssize_t n = ::preadv(fd_, &blocks[next], num_blocks, position);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw FileIOException(filename_, "reading", errno);
+    }
+    if (n == 0) {
+      // end of file
+      for (; next < count; next++) {
+        std::memset(blocks[next].iov_base, 0, blocks[next].iov_len);
+      }
+      return;
+    }
+    position += n;
+    std::size_t done = n;
+    while (next < count && done >= blocks[next].iov_len) {
+      done -= blocks[next].iov_len;
+      next++;
+    }
+    if (done > 0) {
+      blocks[next].iov_base = static_cast<char *>(blocks[next].iov_base) + done;
+      blocks[next].iov_len -= done;
+    }
+  }
+}
+
+void PosixFileBackend::write(const std::uint64_t offset, const char *buffer,
+                             const std::size_t length) {
+  std::size_t done = 0;
+  while (done < length) {
+    const ssize_t n =
+        ::pwrite(fd_, buffer + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw FileIOException(filename_, "writing", errno);
+    }
+    done += n;
+  }
+}
+
+void PosixFileBackend::writev(const std::uint64_t offset,
+                              const char *const *buffers,
+                              const std::size_t count,
+                              const std::size_t length) {
+  std::vector<struct iovec> blocks(count);
+  for (std::size_t i = 0; i < count; i++) {
+    blocks[i].iov_base = const_cast<char *>(buffers[i]);
+    blocks[i].iov_len = length;
+  }
+
+  // blocks[next] is the first one not completely written
+  std::size_t next = 0;
+  std::uint64_t position = offset;
+  while (next < count) {
+    const int num_blocks = std::min<std::size_t>(count - next, IOV_MAX);
+    const ssize_t n = ::pwritev(fd_, &blocks[next], num_blocks, position);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      throw FileIOException(filename_, "writing", errno);
+    }
+    position += n;
+    std::size_t done = n;
+    while (next < count && done >= blocks[next].iov_len) {
+      done -= blocks[next].iov_len;
+      next++;
+    }
+    if (done > 0) {
+      blocks[next].iov_base = static_cast<char *>(blocks[next].iov_base) + done;
+      blocks[next].iov_len -= done;
+    }
+  }
+}
+
+void PosixFileBackend::sync() {
+  if (::fdatasync(fd_) != 0) {
+    throw FileIOException(filename_, "syncing", errno);
+  }
+}
+
+void PosixFileBackend::preallocate(const std::uint64_t offset,
+                                   const std::uint64_t length) {
+  // posix_fallocate() returns the error instead of setting errno.
+  const int error = ::posix_fallocate(fd_, offset, length);
+  if (error != 0 && error != EINVAL && error != EOPNOTSUPP) {
+    throw FileIOException(filename_, "preallocating", error);
+  }
+}
+
+StreamFileBackend::StreamFileBackend(const std::string &filename,
+                                     const bool create_new)
+    : FileBackend(filename) {
+  std::ios_base::openmode mode =
+      std::fstream::in | std::fstream::out | std::fstream::binary;
+  if (create_new) mode = mode | std::fstream::trunc;
+  stream_.open(filename, mode);
+  if (!stream_) throw FileIOException(filename_, "opening", lastError());
+  sync_fd_ = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (sync_fd_ < 0) throw FileIOException(filename_, "opening", errno);
+}
+
+StreamFileBackend::~StreamFileBackend() { ::close(sync_fd_); }
+
+void StreamFileBackend::read(const std::uint64_t offset, char *buffer,
+                             const std::size_t length) {
+  std::lock_guard<std::mutex> latch(latch_);
+  stream_.seekg(offset, std::ios::beg);
+  stream_.read(buffer, length);
+  if (static_cast<std::size_t>(stream_.gcount()) < length) {
+    // end of file
+    std::memset(buffer + stream_.gcount(), 0, length - stream_.gcount());
+    stream_.clear();
+  }
+}
+
+void StreamFileBackend::write(const std::uint64_t offset, const char *buffer,
+                              const std::size_t length) {
+  std::lock_guard<std::mutex> latch(latch_);
+  stream_.seekp(offset, std::ios::beg);
+  stream_.write(buffer, length);
+  if (!stream_) {
+    stream_.clear();
+    throw FileIOException(filename_, "writing", lastError());
+  }
+}
+
+void StreamFileBackend::flush() {
+  std::lock_guard<std::mutex> latch(latch_);
+  stream_.flush();
+}
+
+void StreamFileBackend::sync() {
+  flush();
+  if (::fdatasync(sync_fd_) != 0) {
+    throw FileIOException(filename_, "syncing", errno);
+  }
+}
+
+MappedFileBackend::MappedFileBackend(const std::string &filename)
+    : FileBackend(filename), data_(nullptr), size_(0) {
+  fd_ = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) throw FileIOException(filename_, "opening", errno);
+  struct stat status;
+  if (::fstat(fd_, &status) != 0) {
+    const int error = errno;
+    ::close(fd_);
+    throw FileIOException(filename_, "opening", error);
+  }
+  size_ = status.st_size;
+  if (size_ == 0) return;
+
+  void *const mapping = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+  if (mapping == MAP_FAILED) {
+    const int error = errno;
+    ::close(fd_);
+    throw FileIOException(filename_, "mapping", error);
+  }
+  data_ = static_cast<char *>(mapping);
+}
+
+MappedFileBackend::~MappedFileBackend() {
+  if (data_ != nullptr) ::munmap(data_, size_);
+  ::close(fd_);
+}
+
+void MappedFileBackend::read(const std::uint64_t offset, char *buffer,
+                             const std::size_t length) {
+  // Bytes past the end of the file read as zeros.
+  const std::size_t available =
+      offset < size_ ? std::min<std::uint64_t>(length, size_ - offset) : 0;
+  if (available > 0) std::memcpy(buffer, data_ + offset, available);
+  std::memset(buffer + available, 0, length - available);
+}
+
+void MappedFileBackend::write(const std::uint64_t offset, const char *buffer,
+                              const std::size_t length) {
+  throw FileIOException(filename_, "writing", EROFS);
+}
+
+const char *MappedFileBackend::view(const std::uint64_t offset,
+                                    const std::size_t length) const {
+  if (offset > size_ || length > size_ - offset) return nullptr;
+  return data_ + offset;
+}
+
+void MappedFileBackend::advise(const AccessPattern pattern) {
+  if (data_ == nullptr) return;
+  int advice = MADV_NORMAL;
+  if (pattern == AccessPattern::SEQUENTIAL) advice = MADV_SEQUENTIAL;
+  if (pattern == AccessPattern::RANDOM) advice = MADV_RANDOM;
+  // only a hint, so failing is not an error
+  ::madvise(data_, size_, advice);
+}
+
+}  // namespace badgerdb
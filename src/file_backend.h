@@ -0,0 +1,322 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace badgerdb {
+
+/**
+ * @brief Ways File can do its I/O.
+ */
+enum class FileBackendType {
+  /**
+   * File descriptor with positional pread/pwrite (the default).
+   */
+  POSIX,
+
+  /**
+   * A std::fstream with seek plus read/write, as BadgerDB used originally.
+   */
+  STREAM,
+
+  /**
+   * A read-only memory mapping of an existing file, see File::openMapped().
+   */
+  MAPPED,
+
+  /**
+   * Pages compressed one by one on top of a POSIX backend, see
+   * CompressedFileBackend.  Only matters when a file is created: existing
+   * files are recognized as compressed or not whatever backend they are
+   * opened with.
+   */
+  COMPRESSED
+};
+
+/**
+ * @brief How a file is going to be read, so the operating system can read
+ * ahead or not.  Only a hint.
+ */
+enum class AccessPattern {
+  /**
+   * No particular order (the default).
+   */
+  NORMAL,
+
+  /**
+   * Mostly from the first page to the last, e.g. scans.
+   */
+  SEQUENTIAL,
+
+  /**
+   * In random order, e.g. index lookups.
+   */
+  RANDOM
+};
+
+/**
+ * @brief Byte-level access to one open file on disk.
+ *
+ * Every File object for the same open file shares one backend.  Reads and
+ * writes are positional and may be issued from several threads at once;
+ * BufMgr does its page reads and write-backs on the backend outside its file
+ * latch, so misses and write-backs on different threads overlap.
+ */
+class FileBackend {
+ public:
+  /**
+   * Opens a file for reading and writing, or only for reading with the
+   * MAPPED backend.  A file of compressed pages gets a CompressedFileBackend
+   * on top of the backend asked for.
+   *
+   * @param type        Backend to use
+   * @param filename    Name of the file
+   * @param create_new  Whether to create the file (truncating it if present)
+   * @throws  FileIOException   If the file cannot be opened, or is to be
+   *                            created with the MAPPED backend
+   */
+  static std::shared_ptr<FileBackend> open(const FileBackendType type,
+                                           const std::string &filename,
+                                           const bool create_new);
+
+  virtual ~FileBackend() {}
+
+  /**
+   * Reads <length> bytes at <offset>.  Bytes past the end of the file read as
+   * zeros.
+   *
+   * @throws  FileIOException   If the read fails
+   */
+  virtual void read(const std::uint64_t offset, char *buffer,
+                    const std::size_t length) = 0;
+
+  /**
+   * Writes <length> bytes at <offset>, extending the file if needed.
+   *
+   * @throws  FileIOException   If the write fails
+   */
+  virtual void write(const std::uint64_t offset, const char *buffer,
+                     const std::size_t length) = 0;
+
+  /**
+   * Reads <count> consecutive blocks of <length> bytes starting at <offset>,
+   * each into its own buffer.  Bytes past the end of the file read as zeros.
+   * By default a read() per block.
+   *
+   * @throws  FileIOException   If the read fails
+   */
+  virtual void readv(const std::uint64_t offset, char *const *buffers,
+                     const std::size_t count, const std::size_t length);
+
+  /**
+   * Writes <count> consecutive blocks of <length> bytes starting at <offset>,
+   * each from its own buffer.  By default a write() per block.
+   *
+   * @throws  FileIOException   If the write fails
+   */
+  virtual void writev(const std::uint64_t offset, const char *const *buffers,
+                      const std::size_t count, const std::size_t length);
+
+  /**
+   * Hands everything written so far to the operating system.
+   */
+  virtual void flush() = 0;
+
+  /**
+   * Makes everything written so far durable (flush plus fdatasync).
+   *
+   * @throws  FileIOException   If the operating system reports an error
+   */
+  virtual void sync() = 0;
+
+  /**
+   * Reserves disk space for a range of the file so that writing it later
+   * does not have to grow the file piecemeal.  Only a hint: backends that
+   * cannot do this leave the file as it is.
+   *
+   * @param offset  Position of the range.
+   * @param length  Number of bytes in the range.
+   * @throws  FileIOException   If the operating system reports an error
+   *                            other than not supporting it
+   */
+  virtual void preallocate(const std::uint64_t offset,
+                           const std::uint64_t length) {}
+
+  /**
+   * Returns the file descriptor the backend does its I/O on, for I/O engines
+   * that submit to the kernel directly, or -1 if it has none.
+   */
+  virtual int fd() const { return -1; }
+
+  /**
+   * Returns whether every write fails, as with the MAPPED backend.
+   */
+  virtual bool readOnly() const { return false; }
+
+  /**
+   * Returns where in memory the file's bytes from <offset> to
+   * <offset> + <length> can be read without copying them, or nullptr if
+   * they cannot.  The memory stays valid while the backend exists and must
+   * not be written to.
+   */
+  virtual const char *view(const std::uint64_t offset,
+                           const std::size_t length) const {
+    return nullptr;
+  }
+
+  /**
+   * Tells the operating system how the file is going to be read.
+   */
+  virtual void advise(const AccessPattern pattern) {}
+
+ protected:
+  explicit FileBackend(const std::string &filename) : filename_(filename) {}
+
+  /**
+   * Name of the file, for error messages
+   */
+  const std::string filename_;
+};
+
+/**
+ * @brief Backend on a file descriptor using pread and pwrite, so there is no
+ * shared file position and no locking.
+ */
+class PosixFileBackend : public FileBackend {
+ public:
+  PosixFileBackend(const std::string &filename, const bool create_new);
+  ~PosixFileBackend() override;
+
+  void read(const std::uint64_t offset, char *buffer,
+            const std::size_t length) override;
+  void write(const std::uint64_t offset, const char *buffer,
+             const std::size_t length) override;
+
+  /**
+   * Reads all blocks with as few preadv() calls as possible.
+   */
+  void readv(const std::uint64_t offset, char *const *buffers,
+             const std::size_t count, const std::size_t length) override;
+
+  /**
+   * Writes all blocks with as few pwritev() calls as possible.
+   */
+  void writev(const std::uint64_t offset, const char *const *buffers,
+              const std::size_t count, const std::size_t length) override;
+
+  /**
+   * Nothing to do: pwrite does not buffer in user space.
+   */
+  void flush() override {}
+
+  void sync() override;
+
+  /**
+   * Reserves the range with posix_fallocate().
+   */
+  void preallocate(const std::uint64_t offset,
+                   const std::uint64_t length) override;
+
+  int fd() const override { return fd_; }
+
+ private:
+  int fd_;
+};
+
+/**
+ * @brief Backend on a std::fstream.  Seeking and transferring are one step
+ * under a mutex, since the stream position is shared.
+ */
+class StreamFileBackend : public FileBackend {
+ public:
+  StreamFileBackend(const std::string &filename, const bool create_new);
+  ~StreamFileBackend() override;
+
+  void read(const std::uint64_t offset, char *buffer,
+            const std::size_t length) override;
+  void write(const std::uint64_t offset, const char *buffer,
+             const std::size_t length) override;
+  void flush() override;
+  void sync() override;
+
+ private:
+  std::mutex latch_;
+  std::fstream stream_;
+
+  /**
+   * Read-only descriptor of the same file, only used for fdatasync
+   */
+  int sync_fd_;
+};
+
+/**
+ * @brief Read-only backend mapping the whole file into memory when it is
+ * opened.  Reads copy out of the mapping and view() hands out pointers into
+ * it; writes fail with EROFS.  The file must not grow or shrink while it is
+ * open: pages appended by others later are not seen.
+ */
+class MappedFileBackend : public FileBackend {
+ public:
+  explicit MappedFileBackend(const std::string &filename);
+  ~MappedFileBackend() override;
+
+  void read(const std::uint64_t offset, char *buffer,
+            const std::size_t length) override;
+
+  /**
+   * Fails: the file is open read-only.
+   *
+   * @throws  FileIOException   Always
+   */
+  void write(const std::uint64_t offset, const char *buffer,
+             const std::size_t length) override;
+
+  /**
+   * Nothing to do: nothing is ever written.
+   */
+  void flush() override {}
+
+  /**
+   * Nothing to do: nothing is ever written.
+   */
+  void sync() override {}
+
+  int fd() const override { return fd_; }
+
+  bool readOnly() const override { return true; }
+
+  const char *view(const std::uint64_t offset,
+                   const std::size_t length) const override;
+
+  /**
+   * Passes the pattern on with madvise().
+   */
+  void advise(const AccessPattern pattern) override;
+
+ private:
+  int fd_;
+
+  /**
+   * Start of the mapping, nullptr for an empty file
+   */
+  char *data_;
+
+  /**
+   * Size of the file, and of the mapping
+   */
+  std::uint64_t size_;
+};
+
+}  // namespace badgerdb
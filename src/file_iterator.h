@@ -56,8 +56,7 @@ class FileIterator {
    */
   inline FileIterator &operator++() {
     assert(file_ != NULL);
-    const PageHeader &header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    current_page_number_ = file_->nextUsedPage(current_page_number_);
 
     return *this;
   }
@@ -67,8 +66,7 @@ class FileIterator {
     FileIterator tmp = *this;  // copy ourselves
 
     assert(file_ != NULL);
-    const PageHeader &header = file_->readPageHeader(current_page_number_);
-    current_page_number_ = header.next_page_number;
+    current_page_number_ = file_->nextUsedPage(current_page_number_);
 
     return tmp;
   }
@@ -91,12 +89,12 @@ class FileIterator {
 
   /**
    * Dereferences the iterator, returning a copy of the current page in the
-   * file.
+   * file, or a view of it if the file is mapped (see File::viewPage()).
    *
    * @return  Page in file.
    */
   inline Page operator*() const {
-    return file_->readPage(current_page_number_);
+    return file_->viewPage(current_page_number_);
   }
 
  private:
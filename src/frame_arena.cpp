@@ -0,0 +1,55 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "frame_arena.h"
+
+#include <sys/mman.h>
+
+#include <new>
+
+#include "numa.h"
+
+namespace badgerdb {
+
+static const std::size_t HUGE_PAGE_SIZE = 2 << 20;
+
+FrameArena::FrameArena(const std::size_t numFrames,
+                       const std::size_t frameSize)
+    : base_(nullptr), size_(numFrames * frameSize), frameSize_(frameSize) {
+  if (size_ == 0) return;
+
+  const bool huge = size_ >= HUGE_PAGE_SIZE;
+  if (huge) size_ = (size_ + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+  void *memory = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) throw std::bad_alloc();
+  base_ = static_cast<char *>(memory);
+
+#ifdef MADV_HUGEPAGE
+  // Only a hint; without transparent huge pages the arena still works.
+  if (huge) madvise(base_, size_, MADV_HUGEPAGE);
+#endif
+}
+
+void FrameArena::preferNode(const FrameId first, const std::size_t count,
+                            const std::uint32_t node) {
+  if (count == 0) return;
+  preferNumaNode(frame(first), count * frameSize_, node);
+}
+
+void FrameArena::release(const FrameId first, const std::size_t count) {
+  if (count == 0) return;
+  madvise(frame(first), count * frameSize_, MADV_DONTNEED);
+}
+
+FrameArena::~FrameArena() {
+  if (base_ != nullptr) munmap(base_, size_);
+}
+
+}  // namespace badgerdb
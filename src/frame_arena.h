@@ -0,0 +1,84 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief One contiguous, page-aligned block of memory cut into equally sized
+ * buffer pool frames.
+ *
+ * The memory is mapped anonymously, so it starts out zeroed and is aligned
+ * well enough for direct I/O.  Arenas of 2 MB or more are rounded up to whole
+ * huge pages and the kernel is asked to back them with transparent huge
+ * pages where it can.
+ */
+class FrameArena {
+ public:
+  /**
+   * Constructor of FrameArena class
+   *
+   * @param numFrames   Number of frames
+   * @param frameSize   Size of a frame in bytes, a multiple of the OS page size
+   * @throws std::bad_alloc If the memory cannot be mapped
+   */
+  FrameArena(const std::size_t numFrames, const std::size_t frameSize);
+
+  /**
+   * Unmaps the memory.
+   */
+  ~FrameArena();
+
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  /**
+   * Returns the memory of a frame.
+   *
+   * @param frame   Number of the frame
+   */
+  char *frame(const FrameId frame) const { return base_ + frame * frameSize_; }
+
+  /**
+   * Asks for the memory of a range of frames to be placed on a NUMA node.
+   * Only a hint, and only effective before the frames are first used.
+   *
+   * @param first   First frame of the range
+   * @param count   Number of frames
+   * @param node    NUMA node
+   */
+  void preferNode(const FrameId first, const std::size_t count,
+                  const std::uint32_t node);
+
+  /**
+   * Gives the memory of a range of frames back to the OS.  The frames stay
+   * usable and read as zeros until written again.
+   *
+   * @param first   First frame of the range
+   * @param count   Number of frames
+   */
+  void release(const FrameId first, const std::size_t count);
+
+  /**
+   * Returns the size of the mapping in bytes.
+   */
+  std::size_t size() const { return size_; }
+
+ private:
+  char *base_;
+  std::size_t size_;
+  const std::size_t frameSize_;
+};
+
+}  // namespace badgerdb
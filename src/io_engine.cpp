@@ -0,0 +1,61 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "io_engine.h"
+
+#include "exceptions/file_io_exception.h"
+#include "thread_pool_io_engine.h"
+#include "uring_io_engine.h"
+
+namespace badgerdb {
+
+std::size_t IoRequest::size() const {
+  std::size_t total = 0;
+  for (const struct iovec& buffer : buffers) total += buffer.iov_len;
+  return total;
+}
+
+std::unique_ptr<IoEngine> IoEngine::create(const IoEngineConfig& config) {
+  if (config.type == IoEngineType::IO_URING) {
+    std::unique_ptr<IoEngine> engine =
+        UringIoEngine::tryCreate(config.queueDepth);
+    if (engine) return engine;
+  }
+  return std::unique_ptr<IoEngine>(new ThreadPoolIoEngine(config.threads));
+}
+
+int IoEngine::perform(IoRequest& request, std::size_t skip) {
+  std::uint64_t position = request.offset;
+  try {
+    for (const struct iovec& buffer : request.buffers) {
+      char* base = static_cast<char*>(buffer.iov_base);
+      std::size_t length = buffer.iov_len;
+      if (skip >= length) {
+        skip -= length;
+        position += length;
+        continue;
+      }
+      base += skip;
+      position += skip;
+      length -= skip;
+      skip = 0;
+
+      if (request.operation == IoRequest::READ) {
+        request.backend->read(position, base, length);
+      } else {
+        request.backend->write(position, base, length);
+      }
+      position += length;
+    }
+  } catch (const FileIOException& e) {
+    return e.error();
+  }
+  return 0;
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,141 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "file_backend.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Kinds of asynchronous I/O engine.
+ */
+enum class IoEngineType {
+  /**
+   * Linux io_uring, falling back to THREAD_POOL where the kernel does not
+   * offer it (the default).
+   */
+  IO_URING,
+
+  /**
+   * Worker threads doing blocking reads and writes.
+   */
+  THREAD_POOL
+};
+
+/**
+ * @brief Settings of the asynchronous I/O engine of a buffer manager.
+ */
+struct IoEngineConfig {
+  /**
+   * Engine to use
+   */
+  IoEngineType type = IoEngineType::IO_URING;
+
+  /**
+   * Most requests in flight at once
+   */
+  std::uint32_t queueDepth = 64;
+
+  /**
+   * Worker threads of the thread pool engine
+   */
+  std::uint32_t threads = 4;
+};
+
+/**
+ * @brief One read or write submitted to an IoEngine: a range of a file to or
+ * from a list of buffers, in order.
+ */
+struct IoRequest {
+  enum Operation { READ, WRITE };
+
+  Operation operation;
+
+  /**
+   * File to do the I/O on, kept open until the request is done
+   */
+  std::shared_ptr<FileBackend> backend;
+
+  /**
+   * Position in the file
+   */
+  std::uint64_t offset;
+
+  /**
+   * Buffers filled or written one after the other
+   */
+  std::vector<struct iovec> buffers;
+
+  /**
+   * Called once the request is done with 0 or the errno value it failed
+   * with, on an engine thread or in the submitting one.  Bytes read past the
+   * end of the file are zeros.
+   */
+  std::function<void(int error)> done;
+
+  /**
+   * Returns the number of bytes the request transfers.
+   */
+  std::size_t size() const;
+};
+
+/**
+ * @brief Does I/O asynchronously, keeping several requests in flight.
+ *
+ * The buffer manager submits miss reads, prefetches and background
+ * write-backs through an engine, so that on devices with deep queues they
+ * overlap instead of going one at a time.
+ */
+class IoEngine {
+ public:
+  /**
+   * Creates an engine.
+   *
+   * @param config  Engine type and limits
+   */
+  static std::unique_ptr<IoEngine> create(const IoEngineConfig& config);
+
+  /**
+   * Waits for the requests in flight, then stops the engine.
+   */
+  virtual ~IoEngine() {}
+
+  /**
+   * Returns the name of the engine, e.g. "io_uring".
+   */
+  virtual const char* name() const = 0;
+
+  /**
+   * Starts a request.  May block while the engine has the most requests in
+   * flight it allows.
+   *
+   * @param request   Request to start; its done callback is always called
+   */
+  virtual void submit(std::unique_ptr<IoRequest> request) = 0;
+
+ protected:
+  /**
+   * Does (the rest of) a request with blocking calls on its backend.
+   *
+   * @param request   Request to do
+   * @param skip      Number of bytes at the start already transferred
+   * @return 0 or the errno value the request failed with
+   */
+  static int perform(IoRequest& request, std::size_t skip);
+};
+
+}  // namespace badgerdb
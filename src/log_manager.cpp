@@ -0,0 +1,185 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "log_manager.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cerrno>
+
+#include "crc32c.h"
+#include "exceptions/badgerdb_exception.h"
+#include "exceptions/file_format_exception.h"
+#include "exceptions/file_io_exception.h"
+#include "file.h"
+
+namespace badgerdb {
+
+const std::uint32_t LogManager::MAGIC;
+const std::uint32_t LogManager::VERSION;
+
+LogManager::LogManager(const std::string &filename)
+    : filename_(filename),
+      buffer_start_(sizeof(LogHeader)),
+      durable_(sizeof(LogHeader)),
+      syncing_(false) {
+  const bool create_new = !File::exists(filename);
+  backend_ = std::make_shared<PosixFileBackend>(filename, create_new);
+  if (create_new) {
+    const LogHeader header = {MAGIC, VERSION, 0};
+    backend_->write(0 /* offset */, reinterpret_cast<const char *>(&header),
+                    sizeof(header));
+    backend_->sync();
+    return;
+  }
+
+  LogHeader header;
+  backend_->read(0 /* offset */, reinterpret_cast<char *>(&header),
+                 sizeof(header));
+  if (header.magic != MAGIC || header.version != VERSION) {
+    throw FileFormatException(filename_, "not a log of this version");
+  }
+  struct stat status;
+  if (::fstat(backend_->fd(), &status) != 0) {
+    throw FileIOException(filename_, "opening", errno);
+  }
+
+  // The log ends at the first record that was not written whole.
+  const std::uint64_t size = status.st_size;
+  std::string record;
+  Lsn end = sizeof(LogHeader);
+  for (;;) {
+    const std::uint64_t next = readRecord(end, size, record);
+    if (next == 0) break;
+    end = next;
+  }
+  buffer_start_ = end;
+  durable_ = end;
+}
+
+LogManager::~LogManager() {
+  try {
+    flush(endLsn());
+  } catch (const BadgerDbException &) {
+    // destructors must not throw
+  }
+}
+
+std::uint32_t LogManager::recordCrc(const std::uint64_t position,
+                                    const std::uint32_t bytes_crc) {
+  const std::uint32_t crc = crc32c(&position, sizeof(position), bytes_crc);
+  // 0 is what a file reads as past its end
+  return crc != 0 ? crc : 1;
+}
+
+Lsn LogManager::append(const char *record, const std::size_t length) {
+  RecordHeader header;
+  header.length = static_cast<std::uint32_t>(length);
+  const std::uint32_t bytes_crc = crc32c(record, length);
+
+  std::lock_guard<std::mutex> latch(latch_);
+  const Lsn position = buffer_start_ + buffer_.size();
+  header.crc = recordCrc(position, bytes_crc);
+  buffer_.append(reinterpret_cast<const char *>(&header), sizeof(header));
+  buffer_.append(record, length);
+  stats_.appends++;
+  stats_.bytes += sizeof(header) + length;
+  return position + sizeof(header) + length;
+}
+
+void LogManager::flush(const Lsn lsn) {
+  std::unique_lock<std::mutex> latch(latch_);
+  const Lsn target = std::min<Lsn>(lsn, buffer_start_ + buffer_.size());
+  if (durable_ >= target) return;
+  stats_.flushes++;
+
+  while (durable_ < target) {
+    if (syncing_) {
+      // its sync may cover us; if not, we sync next
+      synced_.wait(latch);
+      continue;
+    }
+
+    // Take everything appended so far; what comes in meanwhile goes out
+    // with the next sync.
+    syncing_ = true;
+    std::string batch;
+    batch.swap(buffer_);
+    const Lsn start = buffer_start_;
+    buffer_start_ += batch.size();
+    latch.unlock();
+    try {
+      if (!batch.empty()) backend_->write(start, batch.data(), batch.size());
+      backend_->sync();
+    } catch (...) {
+      latch.lock();
+      batch += buffer_;
+      buffer_.swap(batch);
+      buffer_start_ = start;
+      syncing_ = false;
+      synced_.notify_all();
+      throw;
+    }
+    latch.lock();
+    durable_ = start + batch.size();
+    syncing_ = false;
+    stats_.syncs++;
+    synced_.notify_all();
+  }
+}
+
+Lsn LogManager::durableLsn() const {
+  std::lock_guard<std::mutex> latch(latch_);
+  return durable_;
+}
+
+Lsn LogManager::endLsn() const {
+  std::lock_guard<std::mutex> latch(latch_);
+  return buffer_start_ + buffer_.size();
+}
+
+std::uint64_t LogManager::readRecord(const std::uint64_t position,
+                                     const std::uint64_t end,
+                                     std::string &record) const {
+  RecordHeader header;
+  if (position + sizeof(header) > end) return 0;
+  backend_->read(position, reinterpret_cast<char *>(&header), sizeof(header));
+  const std::uint64_t next = position + sizeof(header) + header.length;
+  if (header.crc == 0 || next > end) return 0;
+  record.resize(header.length);
+  if (header.length > 0) {
+    backend_->read(position + sizeof(header), &record[0], header.length);
+  }
+  if (recordCrc(position, crc32c(record.data(), record.size())) !=
+      header.crc) {
+    return 0;
+  }
+  return next;
+}
+
+void LogManager::replay(
+    const std::function<void(const Lsn, const std::string &)> &apply,
+    const Lsn from) const {
+  const Lsn end = durableLsn();
+  std::string record;
+  Lsn position = sizeof(LogHeader);
+  while (position < end) {
+    const Lsn next = readRecord(position, end, record);
+    if (next == 0) break;
+    if (next > from) apply(next, record);
+    position = next;
+  }
+}
+
+LogStats LogManager::getStats() const {
+  std::lock_guard<std::mutex> latch(latch_);
+  return stats_;
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,248 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "file_backend.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Counters of a LogManager, see LogManager::getStats().
+ */
+struct LogStats {
+  /**
+   * Number of records appended
+   */
+  std::uint64_t appends = 0;
+
+  /**
+   * Number of record bytes appended, headers included
+   */
+  std::uint64_t bytes = 0;
+
+  /**
+   * Number of calls to flush() that found the log not yet durable far enough
+   */
+  std::uint64_t flushes = 0;
+
+  /**
+   * Number of syncs of the log file.  With group commit this stays below
+   * flushes when threads commit at once.
+   */
+  std::uint64_t syncs = 0;
+};
+
+/**
+ * @brief Write-ahead log: records appended at the end of one file, made
+ * durable by groups.
+ *
+ * A change to a page is described by a record appended here before the page
+ * is changed, and the page is stamped with the record's LSN (see
+ * Page::set_lsn()).  The buffer pool, once told of the log with
+ * BufMgr::setLog(), writes no page back before the log is durable up to its
+ * LSN, so whatever a page on disk holds can be redone from the log.  A
+ * transaction commits by making the log durable up to its last record with
+ * flush(): one sequential write and sync, with no page written at all.
+ *
+ * Records are kept in memory until flushed.  flush() is a group commit: one
+ * caller writes and syncs everything appended so far while the others wait
+ * for it, and the records appended meanwhile go out with the next sync, so
+ * a sync serves all the threads that committed during the one before.
+ *
+ * On disk the log is a header followed by the records, each a length and a
+ * CRC-32C in front of the bytes given to append().  The LSN of a record is
+ * its end, so the log is durable up to an LSN once that many bytes of it
+ * are.  Opening a log reads it to its first torn or corrupt record, where
+ * appends carry on.  The log only grows; truncating it after a checkpoint is
+ * up to its user.
+ *
+ * Every method is threadsafe.
+ */
+class LogManager {
+ public:
+  /**
+   * Opens a log, creating it if there is no file by that name.
+   *
+   * @param filename  Name of the log file
+   * @throws  FileIOException       If the file cannot be opened or read
+   * @throws  FileFormatException   If the file is not a log
+   */
+  explicit LogManager(const std::string &filename);
+
+  /**
+   * Makes every record appended durable.  Errors are dropped; call flush()
+   * first to see them.
+   */
+  ~LogManager();
+
+  LogManager(const LogManager &) = delete;
+  LogManager &operator=(const LogManager &) = delete;
+
+  /**
+   * Appends a record.  It is durable once flush() is called with its LSN or
+   * a later one.
+   *
+   * @param record  Bytes of the record
+   * @param length  Number of bytes
+   * @return  LSN of the record, greater than that of every record before it
+   */
+  Lsn append(const char *record, const std::size_t length);
+
+  /**
+   * Appends a record, see above.
+   */
+  Lsn append(const std::string &record) {
+    return append(record.data(), record.size());
+  }
+
+  /**
+   * Makes the log durable up to a record: returns once it and every record
+   * before it are synced, after syncing them itself or waiting for another
+   * caller's sync to cover them.
+   *
+   * @param lsn   LSN of the record; 0 returns right away
+   * @throws  FileIOException   If writing or syncing fails.  The records stay
+   *                            in memory for the next flush() to retry.
+   */
+  void flush(const Lsn lsn);
+
+  /**
+   * Returns the LSN up to which the log is durable.
+   */
+  Lsn durableLsn() const;
+
+  /**
+   * Returns the LSN the next record appended ends before, the end of the log.
+   */
+  Lsn endLsn() const;
+
+  /**
+   * Reads the durable records in order, passing each with its LSN to
+   * <apply>, to redo what they describe after a crash.
+   *
+   * @param apply   Called once per record
+   * @param from    Records with an LSN up to this one are skipped
+   * @throws  FileIOException   If the log cannot be read
+   */
+  void replay(const std::function<void(const Lsn, const std::string &)> &apply,
+              const Lsn from = 0) const;
+
+  /**
+   * Returns the log's counters.
+   */
+  LogStats getStats() const;
+
+  /**
+   * Returns the name of the log file.
+   */
+  const std::string &filename() const { return filename_; }
+
+ private:
+  /**
+   * Front of every record.
+   */
+  struct RecordHeader {
+    /** Bytes of the record after the header */
+    std::uint32_t length;
+    /** CRC-32C of the record's position and bytes */
+    std::uint32_t crc;
+  };
+
+  /**
+   * First bytes of the log file.
+   */
+  struct LogHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t reserved;
+  };
+
+  /**
+   * Value of LogHeader::magic.
+   */
+  static const std::uint32_t MAGIC = 0x4c424442;
+
+  /**
+   * Version of the log format written by this code.
+   */
+  static const std::uint32_t VERSION = 1;
+
+  /**
+   * Returns the CRC of a record starting at <position>, never 0, from the
+   * CRC of its bytes.  The position is in it so that a stale record left
+   * past a torn one does not pass for the one written there later.
+   */
+  static std::uint32_t recordCrc(const std::uint64_t position,
+                                 const std::uint32_t bytes_crc);
+
+  /**
+   * Reads the record at <position> of the file, if a whole and intact one is
+   * there before <end>.
+   *
+   * @return  Position just past the record, or 0 if there is none.
+   */
+  std::uint64_t readRecord(const std::uint64_t position,
+                           const std::uint64_t end, std::string &record) const;
+
+  /**
+   * Name of the log file.
+   */
+  const std::string filename_;
+
+  /**
+   * Backend of the log file.
+   */
+  std::shared_ptr<FileBackend> backend_;
+
+  /**
+   * Guards everything below.
+   */
+  mutable std::mutex latch_;
+
+  /**
+   * Signalled when a sync finishes.
+   */
+  std::condition_variable synced_;
+
+  /**
+   * Records appended since the last sync began, in their on-disk form.
+   */
+  std::string buffer_;
+
+  /**
+   * Position in the file of the start of buffer_.
+   */
+  Lsn buffer_start_;
+
+  /**
+   * The log is durable up to here.
+   */
+  Lsn durable_;
+
+  /**
+   * Whether a caller of flush() is writing and syncing, latch not held.
+   */
+  bool syncing_;
+
+  /**
+   * Counters, see getStats().
+   */
+  LogStats stats_;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,220 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "lz_codec.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+
+namespace badgerdb {
+
+/**
+ * Shortest copy worth coding: a token and an offset take three bytes.
+ */
+static const std::size_t MIN_MATCH = 4;
+
+/**
+ * Bits of the hash of a four-byte sequence, the log of the table size.
+ */
+static const int HASH_BITS = 12;
+
+/**
+ * Every 2^SKIP_SHIFT bytes without a match the search steps one byte
+ * further, so incompressible input is passed over quickly.
+ */
+static const int SKIP_SHIFT = 6;
+
+/**
+ * Length nibble value saying more length bytes follow.
+ */
+static const std::size_t MORE = 15;
+
+static std::uint32_t load32(const unsigned char *bytes) {
+  std::uint32_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+static std::uint64_t load64(const unsigned char *bytes) {
+  std::uint64_t value;
+  std::memcpy(&value, bytes, sizeof(value));
+  return value;
+}
+
+static std::uint32_t hashOf(const std::uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/**
+ * Appends the bytes of a length beyond its nibble: 255 while more follows.
+ */
+static bool putLength(std::size_t length, unsigned char *&out,
+                      const unsigned char *end) {
+  for (; length >= 255; length -= 255) {
+    if (out == end) return false;
+    *out++ = 255;
+  }
+  if (out == end) return false;
+  *out++ = static_cast<unsigned char>(length);
+  return true;
+}
+
+/**
+ * Appends one sequence: a token, literals, and unless it is the last, the
+ * offset and length of a copy.
+ */
+static bool putSequence(const unsigned char *literals,
+                        const std::size_t literal_length,
+                        const std::size_t offset,
+                        const std::size_t match_length, unsigned char *&out,
+                        const unsigned char *end) {
+  if (out == end) return false;
+  const std::size_t match_code = offset != 0 ? match_length - MIN_MATCH : 0;
+  unsigned char *token = out++;
+  *token = static_cast<unsigned char>(
+      (literal_length < MORE ? literal_length : MORE) << 4 |
+      (match_code < MORE ? match_code : MORE));
+  if (literal_length >= MORE && !putLength(literal_length - MORE, out, end)) {
+    return false;
+  }
+  if (static_cast<std::size_t>(end - out) < literal_length) return false;
+  if (literal_length > 0) std::memcpy(out, literals, literal_length);
+  out += literal_length;
+  if (offset == 0) return true;
+
+  if (end - out < 2) return false;
+  *out++ = static_cast<unsigned char>(offset);
+  *out++ = static_cast<unsigned char>(offset >> 8);
+  return match_code < MORE || putLength(match_code - MORE, out, end);
+}
+
+std::size_t lzCompress(const char *src, const std::size_t size, char *dst,
+                       const std::size_t capacity) {
+  assert(size <= LZ_MAX_INPUT);
+  const unsigned char *in = reinterpret_cast<const unsigned char *>(src);
+  unsigned char *out = reinterpret_cast<unsigned char *>(dst);
+  const unsigned char *const end = out + capacity;
+  // one past the last position seen with each hash, 0 for none
+  std::uint16_t table[1 << HASH_BITS] = {};
+
+  std::size_t anchor = 0;
+  std::size_t pos = 0;
+  while (pos + MIN_MATCH <= size) {
+    const std::uint32_t sequence = load32(in + pos);
+    std::uint16_t &seen = table[hashOf(sequence)];
+    const std::size_t candidate = seen;
+    seen = static_cast<std::uint16_t>(pos + 1);
+    if (candidate == 0 || load32(in + candidate - 1) != sequence) {
+      pos += 1 + ((pos - anchor) >> SKIP_SHIFT);
+      continue;
+    }
+
+    const std::size_t match = candidate - 1;
+    // a word at a time, then the bytes of the word that differs
+    std::size_t length = MIN_MATCH;
+    while (pos + length + sizeof(std::uint64_t) <= size &&
+           load64(in + match + length) == load64(in + pos + length)) {
+      length += sizeof(std::uint64_t);
+    }
+    while (pos + length < size && in[match + length] == in[pos + length]) {
+      length++;
+    }
+    if (!putSequence(in + anchor, pos - anchor, pos - match, length, out,
+                     end)) {
+      return 0;
+    }
+    pos += length;
+    anchor = pos;
+  }
+  if (!putSequence(in + anchor, size - anchor, 0, 0, out, end)) return 0;
+  return out - reinterpret_cast<unsigned char *>(dst);
+}
+
+/**
+ * Appends <length> bytes copied from <offset> bytes back, which may overlap
+ * them.  A copy from eight or more bytes back goes a word at a time; a
+ * shorter period repeats, so once the first word is done byte by byte the
+ * same bytes are found whole periods further back.
+ */
+static void copyMatch(char *out, const std::size_t offset,
+                      const std::size_t length) {
+  if (offset == 1) {
+    std::memset(out, out[-1], length);
+    return;
+  }
+  std::size_t done = 0;
+  const char *from = out - offset;
+  if (offset < sizeof(std::uint64_t)) {
+    for (; done < length && done < sizeof(std::uint64_t); done++) {
+      out[done] = from[done];
+    }
+    from = out - (sizeof(std::uint64_t) + offset - 1) / offset * offset;
+  }
+  for (; done + sizeof(std::uint64_t) <= length;
+       done += sizeof(std::uint64_t)) {
+    std::memcpy(out + done, from + done, sizeof(std::uint64_t));
+  }
+  for (; done < length; done++) out[done] = from[done];
+}
+
+/**
+ * Adds the bytes of a length beyond its nibble.
+ */
+static bool getLength(std::size_t &length, const unsigned char *&in,
+                      const unsigned char *end) {
+  unsigned char byte;
+  do {
+    if (in == end) return false;
+    byte = *in++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+bool lzDecompress(const char *src, const std::size_t size, char *dst,
+                  const std::size_t dst_size) {
+  const unsigned char *in = reinterpret_cast<const unsigned char *>(src);
+  const unsigned char *const in_end = in + size;
+  char *out = dst;
+  char *const out_end = dst + dst_size;
+
+  while (in < in_end) {
+    const unsigned char token = *in++;
+    std::size_t literal_length = token >> 4;
+    if (literal_length == MORE && !getLength(literal_length, in, in_end)) {
+      return false;
+    }
+    if (static_cast<std::size_t>(in_end - in) < literal_length ||
+        static_cast<std::size_t>(out_end - out) < literal_length) {
+      return false;
+    }
+    if (literal_length > 0) std::memcpy(out, in, literal_length);
+    in += literal_length;
+    out += literal_length;
+    // the last sequence has no copy
+    if (in == in_end) break;
+
+    if (in_end - in < 2) return false;
+    const std::size_t offset = in[0] | in[1] << 8;
+    in += 2;
+    std::size_t length = (token & MORE) + MIN_MATCH;
+    if ((token & MORE) == MORE && !getLength(length, in, in_end)) {
+      return false;
+    }
+    if (offset == 0 || offset > static_cast<std::size_t>(out - dst) ||
+        static_cast<std::size_t>(out_end - out) < length) {
+      return false;
+    }
+    copyMatch(out, offset, length);
+    out += length;
+  }
+  return out == out_end;
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,50 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * Largest input lzCompress() takes, the largest page: match offsets, and the
+ * positions of the sequences matches start at, are 16 bits.
+ */
+const std::size_t LZ_MAX_INPUT = 65536;
+
+/**
+ * Compresses bytes with a small LZ77 coder in the manner of LZ4: runs of
+ * literals alternate with copies of up to 64 KB back, found through a hash
+ * table of four-byte sequences, one pass, no entropy coding.  It is built
+ * for speed over ratio, which suits pages of text records and the free
+ * space of pages, which is zeros.
+ *
+ * @param src       Bytes to compress
+ * @param size      Number of bytes, at most LZ_MAX_INPUT
+ * @param dst       Where the compressed bytes go
+ * @param capacity  Size of dst
+ * @return  Number of compressed bytes, or 0 if they would not fit dst
+ */
+std::size_t lzCompress(const char *src, const std::size_t size, char *dst,
+                       const std::size_t capacity);
+
+/**
+ * Decompresses what lzCompress() made, checking every length and offset
+ * against the buffers so damaged input cannot write out of bounds.
+ *
+ * @param src       Compressed bytes
+ * @param size      Number of compressed bytes
+ * @param dst       Where the bytes go
+ * @param dst_size  Number of bytes they decompress to
+ * @return  Whether src was valid and decompressed to dst_size bytes exactly
+ */
+bool lzDecompress(const char *src, const std::size_t size, char *dst,
+                  const std::size_t dst_size);
+
+}  // namespace badgerdb
@@ -2,19 +2,39 @@
 
 #include <iostream>
 //#include <stdio.h>
+#include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <fstream>
+#include <future>
 #include <memory>
 #include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
 
 #include "buffer.h"
+#include "bulk_loader.h"
+#include "compressed_file_backend.h"
+#include "crc32c.h"
 #include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/file_format_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
+#include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/page_checksum_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "file_iterator.h"
+#include "log_manager.h"
+#include "numa.h"
 #include "page.h"
 #include "page_iterator.h"
+#include "parallel_scan.h"
+#include "record_filter.h"
+#include "scan_iterator.h"
 
 #define PRINT_ERROR(str)                            \
   {                                                 \
@@ -40,8 +60,41 @@ void test3(File &file4);
 void test4(File &file4);
 void test5(File &file4);
 void test6(File &file1);
+void test7(File &file1, File &file2);
+void test8(File &file1);
+void test9(File &file1);
+void test10(File &file1);
+void test11();
+void test12(File &file1);
+void test13();
+void test14();
+void test15();
+void test16();
+void test17(File &file1);
+void test18(File &file1);
+void test19(File &file1);
+void test20(File &file1);
+void test21(File &file1, File &file2);
+void test22(File &file1);
+void test23(File &file1);
+void test24(File &file1);
+void test25(File &file1);
+void test26(File &file1);
+void test27(File &file1);
+void test28();
+void test29();
+void test30(File &file1);
+void test31(File &file1);
+void test32();
+void test33(File &file1);
+void test34();
+void test35(File &file1);
+void test36();
+void test37();
+void test38();
+void test39();
 // Calls the above tests
-void testBufMgr();
+void testBufMgr(const ReplacementPolicyType policy);
 
 int main() {
   // Following code shows how to you File and Page classes
@@ -54,8 +107,10 @@ int main() {
   }
 
   {
-    // Create a new database file.
+    // Create a new database file.  Its writes are made durable in groups, at
+    // the latest when it is synced or closed.
     File new_file = File::create(filename);
+    new_file.setDurability(DurabilityMode::GROUP);
 
     // Allocate some pages and put data on them.
     PageId third_page_number;
@@ -93,17 +148,104 @@ int main() {
   }
   // new_file_ptr goes out of scope here, so file is automatically closed.
 
+  {
+    // Closing wrote the file header kept in memory back; reopen to check.
+    File old_file = File::open(filename);
+    int num_pages = 0;
+    for (FileIterator iter = old_file.begin(); iter != old_file.end(); ++iter) {
+      num_pages++;
+    }
+    if (num_pages != 5) {
+      PRINT_ERROR("ERROR :: FILE HEADER NOT PERSISTED ON CLOSE");
+    }
+
+    // A deleted page is the next one handed out again.
+    const PageId second_page_number = (*++old_file.begin()).page_number();
+    old_file.deletePage(second_page_number);
+    if (old_file.allocatePage().page_number() != second_page_number) {
+      PRINT_ERROR("ERROR :: DELETED PAGE NOT REUSED");
+    }
+  }
+
+  {
+    // The file grew by a whole extent when its first page was allocated.
+    std::ifstream on_disk(filename, std::ios::binary | std::ios::ate);
+    const std::streamoff size = on_disk.tellg();
+    if (size < std::streamoff((1 + File::DEFAULT_EXTENT_SIZE) * Page::SIZE)) {
+      PRINT_ERROR("ERROR :: FILE EXTENT NOT PREALLOCATED");
+    }
+  }
+
+  // Delete the file since we're done with it.
+  File::remove(filename);
+
+  {
+    // Files in the format without an allocation bitmap (a bare 16-byte header
+    // in front of page 1) are converted when they are opened.  Pages 1 and 3
+    // of this one are used, page 2 is free.
+    std::ofstream old_format(filename, std::ios::binary);
+    const PageId old_header[4] = {4 /* num_pages */, 1 /* first_used_page */,
+                                  1 /* num_free_pages */,
+                                  2 /* first_free_page */};
+    old_format.write(reinterpret_cast<const char *>(old_header),
+                     sizeof(old_header));
+    for (PageId n = 1; n <= 3; ++n) {
+      std::vector<char> bytes(Page::SIZE, 0);
+      PageHeader header = {0, Page::DATA_SIZE, 0, 0, n, Page::INVALID_NUMBER};
+      if (n == 1) header.next_page_number = 3;
+      if (n == 2) header.current_page_number = Page::INVALID_NUMBER;
+      std::memcpy(bytes.data(), &header, sizeof(header));
+      old_format.write(bytes.data(), bytes.size());
+    }
+  }
+  if (Page::SIZE != 8192) {
+    // Files of that format have pages of 8 KB, which other builds refuse.
+    try {
+      File::open(filename);
+      PRINT_ERROR("ERROR :: FILE OF ANOTHER PAGE SIZE OPENED");
+    } catch (const FileFormatException &) {
+    }
+  } else {
+    File old_file = File::open(filename);
+    std::vector<PageId> used;
+    for (FileIterator iter = old_file.begin(); iter != old_file.end(); ++iter) {
+      used.push_back((*iter).page_number());
+    }
+    if (used != std::vector<PageId>{1, 3} ||
+        old_file.allocatePage().page_number() != 2) {
+      PRINT_ERROR("ERROR :: OLD FILE FORMAT NOT MIGRATED");
+    }
+  }
+
   // Delete the file since we're done with it.
   File::remove(filename);
 
   // This function tests buffer manager, comment this line if you don't wish to
-  // test buffer manager
-  testBufMgr();
+  // test buffer manager.  The tests are run once for every replacement policy.
+  testBufMgr(ReplacementPolicyType::CLOCK);
+  testBufMgr(ReplacementPolicyType::TWO_QUEUE);
+  testBufMgr(ReplacementPolicyType::CLOCK_PRO);
+
+  // and once more on files doing their I/O through std::fstream
+  File::setDefaultBackend(FileBackendType::STREAM);
+  testBufMgr(ReplacementPolicyType::CLOCK);
+
+  // and once more on files storing their pages compressed
+  File::setDefaultBackend(FileBackendType::COMPRESSED);
+  testBufMgr(ReplacementPolicyType::CLOCK);
+  File::setDefaultBackend(FileBackendType::POSIX);
+
+  std::cout << "\n"
+            << "Passed all tests."
+            << "\n";
 }
 
-void testBufMgr() {
+void testBufMgr(const ReplacementPolicyType policy) {
   // Create buffer manager
-  bufMgr = std::make_shared<BufMgr>(num);
+  bufMgr = std::make_shared<BufMgr>(num, policy);
+  std::cout << "\nTesting with the " << bufMgr->policyName()
+            << " replacement policy and " << bufMgr->ioEngineName()
+            << " I/O\n";
 
   // Create dummy files
   const std::string filename1 = "test.1";
@@ -140,6 +282,39 @@ void testBufMgr() {
     test4(file4);
     test5(file5);
     test6(file1);
+    test7(file1, file2);
+    test8(file1);
+    test9(file1);
+    test10(file1);
+    test11();
+    test12(file1);
+    test13();
+    test14();
+    test15();
+    test16();
+    test17(file1);
+    test18(file1);
+    test19(file1);
+    test20(file1);
+    test21(file1, file2);
+    test22(file1);
+    test23(file1);
+    test24(file1);
+    test25(file1);
+    test26(file1);
+    test27(file1);
+    test28();
+    test29();
+    test30(file1);
+    test31(file1);
+    test32();
+    test33(file1);
+    test34();
+    test35(file1);
+    test36();
+    test37();
+    test38();
+    test39();
 
     // Close the files by going out of scope
   }
@@ -152,10 +327,6 @@ void testBufMgr() {
   File::remove(filename3);
   File::remove(filename4);
   File::remove(filename5);
-
-  std::cout << "\n"
-            << "Passed all tests."
-            << "\n";
 }
 
 void test1(File &file1) {
@@ -299,3 +470,2071 @@ void test6(File &file1) {
 
   bufMgr->flushFile(file1);
 }
+
+void test7(File &file1, File &file2) {
+  // Several threads reading pages of two files that together do not fit in
+  // the pool, so frames are evicted and reloaded concurrently.
+  const int num_threads = 4;
+  std::vector<std::thread> threads;
+  std::vector<int> errors(num_threads, 0);
+  for (int t = 0; t < num_threads; t++) {
+    threads.emplace_back([&, t]() {
+      char buf[100];
+      unsigned int seed = t;
+      for (int n = 0; n < 2000; n++) {
+        const bool first = rand_r(&seed) % 2;
+        File &file = first ? file1 : file2;
+        const PageId pageNo = first ? (rand_r(&seed) % num) + 1
+                                    : (rand_r(&seed) % (num / 3)) + 1;
+        Page *p;
+        bufMgr->readPage(file, pageNo, p);
+        sprintf(buf, "test.%d Page %u %7.1f", first ? 1 : 2, pageNo,
+                (float)pageNo);
+        const RecordId record = {pageNo, 1};
+        if (strncmp(p->getRecord(record).c_str(), buf, strlen(buf)) != 0) {
+          errors[t]++;
+        }
+        bufMgr->unPinPage(file, pageNo, false);
+      }
+    });
+  }
+  for (auto &thread : threads) thread.join();
+
+  for (int t = 0; t < num_threads; t++) {
+    if (errors[t] != 0) PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+  }
+
+  std::cout << "Test 7 passed"
+            << "\n";
+
+  bufMgr->flushFile(file1);
+  bufMgr->flushFile(file2);
+}
+
+void test8(File &file1) {
+  // Reading pages in batches, some of them already in the pool and not in
+  // page order
+  bufMgr->readPage(file1, 5, page);
+  PageId batch[num / 2];
+  Page *pages[num / 2];
+  for (i = 0; i < num / 2; i++) batch[i] = (i * 7) % (num / 2) + 1;
+  bufMgr->readPages(file1, batch, num / 2, pages);
+  for (i = 0; i < num / 2; i++) {
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", batch[i], (float)batch[i]);
+    const RecordId record = {batch[i], 1};
+    if (strncmp(pages[i]->getRecord(record).c_str(), tmpbuf,
+                strlen(tmpbuf)) != 0) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+  }
+  for (i = 0; i < num / 2; i++) bufMgr->unPinPage(file1, batch[i], false);
+  bufMgr->unPinPage(file1, 5, false);
+
+  // A batch with a page not in the file leaves nothing pinned.
+  const PageId invalid_batch[3] = {1, num + 1, 2};
+  try {
+    bufMgr->readPages(file1, invalid_batch, 3, pages);
+    PRINT_ERROR(
+        "ERROR :: Page is not in the file. Exception should have been "
+        "thrown before execution reaches this point.");
+  } catch (const InvalidPageException &e) {
+  }
+  bufMgr->flushFile(file1);
+
+  std::cout << "Test 8 passed"
+            << "\n";
+}
+
+void test9(File &file1) {
+  // Scanning the whole file through the buffer pool, with read-ahead
+  PageId scanned = 0;
+  for (ScanIterator iter(bufMgr.get(), &file1); iter != ScanIterator();
+       ++iter) {
+    const PageId pageNo = iter->page_number();
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", pageNo, (float)pageNo);
+    const RecordId record = {pageNo, 1};
+    if (strncmp(iter->getRecord(record).c_str(), tmpbuf, strlen(tmpbuf)) !=
+        0) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    scanned++;
+  }
+  if (scanned != num) PRINT_ERROR("ERROR :: SCAN MISSED PAGES");
+
+  // nothing is left pinned, by the scan or by prefetching
+  bufMgr->flushFile(file1);
+
+  std::cout << "Test 9 passed"
+            << "\n";
+}
+
+/**
+ * Reads half of file1 asynchronously through a buffer manager, checking the
+ * contents, then asks for a page that is not in the file.
+ */
+static void readAsync(BufMgr &mgr, File &file1) {
+  std::vector<std::future<Page *>> futures;
+  for (i = 1; i <= num / 2; i++) futures.push_back(mgr.readPageAsync(file1, i));
+  for (i = 1; i <= num / 2; i++) {
+    Page *const async_page = futures[i - 1].get();
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", i, (float)i);
+    const RecordId record = {i, 1};
+    if (strncmp(async_page->getRecord(record).c_str(), tmpbuf,
+                strlen(tmpbuf)) != 0) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+  }
+  for (i = 1; i <= num / 2; i++) mgr.unPinPage(file1, i, false);
+
+  std::future<Page *> invalid = mgr.readPageAsync(file1, num + 1);
+  try {
+    invalid.get();
+    PRINT_ERROR(
+        "ERROR :: Page is not in the file. Exception should have been "
+        "thrown before execution reaches this point.");
+  } catch (const InvalidPageException &e) {
+  }
+  mgr.flushFile(file1);
+}
+
+void test10(File &file1) {
+  // Reading pages asynchronously, with this buffer manager's engine and
+  // with the thread pool one
+  readAsync(*bufMgr, file1);
+
+  IoEngineConfig io;
+  io.type = IoEngineType::THREAD_POOL;
+  io.threads = 2;
+  BufMgr thread_pool_mgr(num, ReplacementPolicyType::CLOCK,
+                         BackgroundWriterConfig(), io);
+  readAsync(thread_pool_mgr, file1);
+
+  std::cout << "Test 10 passed"
+            << "\n";
+}
+
+void test11() {
+  // Reading a file mapped read-only, through the buffer pool and directly
+  const std::string filename6 = "test.6";
+  try {
+    File::remove(filename6);
+  } catch (const FileNotFoundException &e) {
+  }
+  {
+    File file6 = File::create(filename6);
+    for (i = 0; i < num / 4; i++) {
+      Page new_page = file6.allocatePage();
+      sprintf(tmpbuf, "test.6 Page %u %7.1f", new_page.page_number(),
+              (float)new_page.page_number());
+      new_page.insertRecord(tmpbuf);
+      file6.writePage(new_page);
+    }
+  }
+
+  {
+    File file6 = File::openMapped(filename6, AccessPattern::SEQUENTIAL);
+    PageId pageNos[num / 4];
+    Page *pages[num / 4];
+    for (i = 0; i < num / 4; i++) pageNos[i] = i + 1;
+    bufMgr->readPages(file6, pageNos, num / 4, pages);
+    std::future<Page *> async_page = bufMgr->readPageAsync(file6, 1);
+    bufMgr->readPage(file6, 2, page);
+    if (async_page.get() != pages[0] || page != pages[1]) {
+      PRINT_ERROR("ERROR :: MAPPED PAGE READ TWICE");
+    }
+
+    PageId iterated = 0;
+    for (FileIterator iter = file6.begin(); iter != file6.end(); ++iter) {
+      const Page view = *iter;
+      const PageId pageNo = view.page_number();
+      sprintf(tmpbuf, "test.6 Page %u %7.1f", pageNo, (float)pageNo);
+      const RecordId record = {pageNo, 1};
+      if (strncmp(pages[iterated]->getRecord(record).c_str(), tmpbuf,
+                  strlen(tmpbuf)) != 0 ||
+          view.getRecord(record) != pages[iterated]->getRecord(record)) {
+        PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+      }
+      iterated++;
+    }
+    if (iterated != num / 4) PRINT_ERROR("ERROR :: ITERATION MISSED PAGES");
+
+    for (i = 0; i < num / 4; i++) bufMgr->unPinPage(file6, pageNos[i], false);
+    bufMgr->unPinPage(file6, 1, false);
+    bufMgr->unPinPage(file6, 2, false);
+
+    // The file cannot be changed.
+    try {
+      bufMgr->allocPage(file6, pageno1, page);
+      PRINT_ERROR(
+          "ERROR :: File is read-only. Exception should have been thrown "
+          "before execution reaches this point.");
+    } catch (const FileIOException &e) {
+    }
+    try {
+      file6.deletePage(1);
+      PRINT_ERROR(
+          "ERROR :: File is read-only. Exception should have been thrown "
+          "before execution reaches this point.");
+    } catch (const FileIOException &e) {
+    }
+    bufMgr->flushFile(file6);
+  }
+  File::remove(filename6);
+
+  std::cout << "Test 11 passed"
+            << "\n";
+}
+
+void test12(File &file1) {
+  // Working on records in place through views
+  bufMgr->readPage(file1, 1, page);
+  const RecordId record = {1, 1};
+  sprintf(tmpbuf, "test.1 Page %u %7.1f", 1, 1.0f);
+  const RecordView view = page->getRecordView(record);
+  if (view.length < strlen(tmpbuf) ||
+      strncmp(view.data, tmpbuf, strlen(tmpbuf)) != 0 ||
+      view.str() != page->getRecord(record)) {
+    PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+  }
+
+  // copies of a view, including into the record it points at
+  const RecordId copy = page->insertRecord(view);
+  page->updateRecord(record, page->getRecordView(copy));
+  std::size_t records = 0;
+  for (PageIterator iter = page->begin(); iter != page->end(); ++iter) {
+    if (iter.view() != RecordView(*iter) || iter.view().str() != *iter) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    records++;
+  }
+  if (records != 2 ||
+      page->getRecordView(record) != page->getRecordView(copy)) {
+    PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+  }
+  page->deleteRecord(copy);
+  bufMgr->unPinPage(file1, 1, true);
+  bufMgr->flushFile(file1);
+
+  std::cout << "Test 12 passed"
+            << "\n";
+}
+
+void test13() {
+  // Slots freed by deletes are reused, last freed first
+  Page slots;
+  std::vector<RecordId> rids;
+  for (int i = 0; i < 8; i++) {
+    sprintf(tmpbuf, "slot record %d", i);
+    rids.push_back(slots.insertRecord(tmpbuf));
+  }
+  slots.deleteRecord(rids[2]);
+  slots.deleteRecord(rids[5]);
+  if (slots.insertRecord("reused").slot_number != rids[5].slot_number ||
+      slots.insertRecord("reused").slot_number != rids[2].slot_number) {
+    PRINT_ERROR("ERROR :: FREED SLOT NOT REUSED");
+  }
+
+  // Free slots at the end of the slot array are trimmed with the last one
+  slots.deleteRecord(rids[6]);
+  slots.deleteRecord(rids[7]);
+  if (slots.insertRecord("appended").slot_number != rids[6].slot_number) {
+    PRINT_ERROR("ERROR :: TRAILING FREE SLOTS NOT TRIMMED");
+  }
+  std::size_t records = 0;
+  for (PageIterator iter = slots.begin(); iter != slots.end(); ++iter) {
+    records++;
+  }
+  if (records != 7 || slots.getRecord(rids[4]) != "slot record 4") {
+    PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+  }
+
+  std::cout << "Test 13 passed"
+            << "\n";
+}
+
+void test14() {
+  // Deletes leave holes, which count as free space until an insert needs
+  // them and the page is compacted
+  Page holes;
+  std::vector<RecordId> rids;
+  const std::string record(100, 'x');
+  while (holes.hasSpaceForRecord(record)) {
+    rids.push_back(holes.insertRecord(record));
+  }
+  for (std::size_t i = 0; i < rids.size(); i += 2) {
+    holes.deleteRecord(rids[i]);
+  }
+  std::string big(holes.getFreeSpace(), 'y');
+  if (big.size() < 2 * record.size() || !holes.hasSpaceForRecord(big)) {
+    PRINT_ERROR("ERROR :: DELETED SPACE NOT FREE");
+  }
+  const RecordId big_rid = holes.insertRecord(big);
+  if (holes.getFreeSpace() != 0 || holes.getRecord(big_rid) != big) {
+    PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+  }
+  for (std::size_t i = 1; i < rids.size(); i += 2) {
+    if (holes.getRecord(rids[i]) != record) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+  }
+
+  // Shrinking a record in place, then compacting explicitly
+  holes.updateRecord(big_rid, "small");
+  const std::uint16_t free_space = holes.getFreeSpace();
+  holes.compact();
+  if (holes.getFreeSpace() != free_space ||
+      holes.getRecord(big_rid) != "small" ||
+      holes.getRecord(rids[1]) != record) {
+    PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+  }
+
+  // Patching part of a record, but not past its end
+  holes.patchRecord(big_rid, 1, "pe");
+  if (holes.getRecord(big_rid) != "spell" ||
+      holes.getFreeSpace() != free_space) {
+    PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+  }
+  try {
+    holes.patchRecord(big_rid, 4, "xx");
+    PRINT_ERROR("ERROR :: PATCH PAST END OF RECORD SHOULD FAIL");
+  } catch (const InsufficientSpaceException &e) {
+  }
+
+  std::cout << "Test 14 passed"
+            << "\n";
+}
+
+void test15() {
+  // Loading records into new pages behind the file's existing ones
+  const std::string filename7 = "test.7";
+  try {
+    File::remove(filename7);
+  } catch (const FileNotFoundException &e) {
+  }
+  const int num_records = 2000 * Page::SIZE / 8192;
+  std::size_t num_pages_written;
+  {
+    File file7 = File::create(filename7);
+    Page first_page = file7.allocatePage();
+    first_page.insertRecord("existing");
+    file7.writePage(first_page);
+
+    BulkLoader loader(file7, 4 /* batch_pages */);
+    for (i = 0; i < num_records; i++) {
+      sprintf(tmpbuf, "test.7 record %8d", i);
+      loader.add(std::string(tmpbuf));
+    }
+    loader.finish();
+    num_pages_written = loader.numPagesWritten();
+    if (loader.numRecords() != num_records || num_pages_written <= 4) {
+      PRINT_ERROR("ERROR :: RECORDS NOT LOADED");
+    }
+  }
+
+  {
+    File file7 = File::open(filename7);
+    int record = -1;
+    std::size_t num_pages = 0;
+    for (FileIterator iter = file7.begin(); iter != file7.end(); ++iter) {
+      Page curr_page = *iter;
+      for (PageIterator page_iter = curr_page.begin();
+           page_iter != curr_page.end(); ++page_iter) {
+        if (record < 0) {
+          if (*page_iter != "existing") {
+            PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+          }
+        } else {
+          sprintf(tmpbuf, "test.7 record %8d", record);
+          if (*page_iter != tmpbuf) {
+            PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+          }
+        }
+        record++;
+      }
+      num_pages++;
+    }
+    if (record != num_records || num_pages != num_pages_written + 1) {
+      PRINT_ERROR("ERROR :: ITERATION MISSED RECORDS");
+    }
+
+    // Loaded pages go through the buffer pool like any other.
+    bufMgr->readPage(file7, num_pages, page);
+    if (page->begin() == page->end()) {
+      PRINT_ERROR("ERROR :: CONTENTS DID NOT MATCH");
+    }
+    bufMgr->unPinPage(file7, num_pages, false);
+    bufMgr->flushFile(file7);
+  }
+  File::remove(filename7);
+
+  std::cout << "Test 15 passed"
+            << "\n";
+}
+
+void test16() {
+  // Filtering the records of a page on a field at a fixed offset; they fit
+  // the smallest pages
+  Page filtered;
+  for (std::int32_t key = 0; key < 150; key++) {
+    char record[24] = {};
+    const std::int64_t wide = -key;
+    std::memcpy(record, &key, sizeof(key));
+    std::memcpy(record + 4, &wide, sizeof(wide));
+    sprintf(record + 12, "%s%03d", key % 3 == 0 ? "fizz" : "buzz", key);
+    filtered.insertRecord(RecordView(record, 12 + strlen(record + 12)));
+  }
+  filtered.insertRecord("fiz");  // too short for every field
+  filtered.deleteRecord({filtered.page_number(), 2});
+
+  const RecordFilter filters[] = {
+      RecordFilter::int32Range(0, 10, 99),
+      RecordFilter::int64Range(4, -139, -90),
+      RecordFilter::equal(12, RecordView("fizz", 4)),
+      RecordFilter::prefix(RecordView("fiz", 3))};
+  const std::size_t expected[] = {90, 50, 50, 1};
+  for (std::size_t f = 0; f < 4; f++) {
+    std::vector<RecordId> selection;
+    const std::size_t selected = filters[f].select(filtered, selection);
+    std::size_t matching = 0;
+    for (PageIterator iter = filtered.begin(); iter != filtered.end();
+         ++iter) {
+      if (!filters[f].matches(iter.view())) continue;
+      if (matching >= selection.size() ||
+          !(selection[matching] == iter.recordId())) {
+        PRINT_ERROR("ERROR :: SELECTION DID NOT MATCH");
+      }
+      matching++;
+    }
+    if (selected != expected[f] || matching != selected) {
+      PRINT_ERROR("ERROR :: SELECTION DID NOT MATCH");
+    }
+  }
+
+  std::cout << "Test 16 passed"
+            << "\n";
+}
+
+void test17(File &file1) {
+  // Scanning all records of a file with several threads
+  std::size_t num_pages = 0;
+  std::size_t num_records = 0;
+  std::size_t record_bytes = 0;
+  for (FileIterator iter = file1.begin(); iter != file1.end(); ++iter) {
+    Page curr_page = *iter;
+    for (PageIterator page_iter = curr_page.begin();
+         page_iter != curr_page.end(); ++page_iter) {
+      num_records++;
+      record_bytes += page_iter.view().length;
+    }
+    num_pages++;
+  }
+
+  ParallelScan scan(bufMgr.get(), &file1, 4 /* num_threads */,
+                    4 /* morsel_pages */);
+  std::atomic<std::size_t> scanned_records(0);
+  std::atomic<std::size_t> scanned_bytes(0);
+  std::atomic<bool> bad_worker(false);
+  const std::size_t scanned_pages =
+      scan.run([&](std::uint32_t worker, const ParallelScan::Batch &batch) {
+        if (worker >= scan.numThreads()) bad_worker = true;
+        scanned_records += batch.count;
+        for (std::size_t r = 0; r < batch.count; r++) {
+          scanned_bytes += batch.records[r].length;
+        }
+      });
+  if (scanned_pages != num_pages || scanned_records != num_records ||
+      scanned_bytes != record_bytes || bad_worker) {
+    PRINT_ERROR("ERROR :: PARALLEL SCAN MISSED RECORDS");
+  }
+
+  // An error in one worker stops the scan and reaches the caller, with no
+  // page left pinned.
+  try {
+    scan.run([&](std::uint32_t, const ParallelScan::Batch &batch) {
+      if (batch.page->page_number() == 3) throw std::runtime_error("stop");
+    });
+    PRINT_ERROR("ERROR :: Exception should have been thrown");
+  } catch (const std::runtime_error &e) {
+  }
+  bufMgr->flushFile(file1);
+
+  std::cout << "Test 17 passed"
+            << "\n";
+}
+
+void test18(File &file1) {
+  // Statistics of the pool and of a file
+  bufMgr->flushFile(file1);
+  bufMgr->clearBufStats();
+  const FileBufStats before = bufMgr->getFileStats(file1);
+  Page *again;
+  bufMgr->readPage(file1, 1, page);
+  bufMgr->readPage(file1, 1, again);
+  bufMgr->unPinPage(file1, 1, false);
+  bufMgr->unPinPage(file1, 1, true);
+  bufMgr->flushFile(file1);
+
+  const BufStats stats = bufMgr->getBufStats();
+  const FileBufStats after = bufMgr->getFileStats(file1);
+  if (stats.accesses != 2 || stats.hits != 1 || stats.misses != 1 ||
+      stats.diskreads != 1 || stats.diskwrites != 1 ||
+      stats.readlatency.count() != 1 || stats.writelatency.count() != 1 ||
+      after.hits != before.hits + 1 || after.misses != before.misses + 1 ||
+      after.diskreads != before.diskreads + 1 ||
+      after.diskwrites != before.diskwrites + 1) {
+    PRINT_ERROR("ERROR :: STATISTICS DID NOT MATCH");
+  }
+
+  std::cout << "Test 18 passed"
+            << "\n";
+}
+
+void test19(File &file1) {
+  // Summary and per-frame dump of what the pool holds
+  bufMgr->flushFile(file1);
+  Page *second;
+  bufMgr->readPage(file1, 1, page);
+  bufMgr->readPage(file1, 2, second);
+  bufMgr->unPinPage(file1, 2, true);
+
+  const BufPoolSummary summary = bufMgr->summarize();
+  const BufPoolFileSummary *perFile = nullptr;
+  for (const BufPoolFileSummary &f : summary.files) {
+    if (f.filename == file1.filename()) perFile = &f;
+  }
+  if (summary.frames != num || summary.busy != 0 || perFile == nullptr ||
+      perFile->frames != 2 || perFile->dirty != 1 || perFile->pinned != 1 ||
+      summary.hashEntries != summary.valid || summary.hashProbeMax < 1 ||
+      summary.meanProbeLength() < 1.0) {
+    PRINT_ERROR("ERROR :: POOL SUMMARY DID NOT MATCH");
+  }
+
+  std::ostringstream csv;
+  bufMgr->dumpFrames(csv, FrameDumpFormat::CSV);
+  const std::string csvText = csv.str();
+  if (static_cast<PageId>(std::count(csvText.begin(), csvText.end(), '\n')) !=
+          num + 1 ||
+      csvText.find("\"" + file1.filename() + "\",1,1,0,1,0,1\n") ==
+          std::string::npos) {
+    PRINT_ERROR("ERROR :: CSV FRAME DUMP DID NOT MATCH");
+  }
+
+  std::ostringstream json;
+  bufMgr->dumpFrames(json, FrameDumpFormat::JSON);
+  const std::string jsonText = json.str();
+  std::size_t objects = 0;
+  for (std::size_t at = jsonText.find("{\"frame\":"); at != std::string::npos;
+       at = jsonText.find("{\"frame\":", at + 1)) {
+    objects++;
+  }
+  if (jsonText.compare(0, 1, "[") != 0 || objects != num ||
+      jsonText.compare(jsonText.size() - 2, 2, "]\n") != 0 ||
+      jsonText.find("\"page\":2,\"valid\":true,\"busy\":false,\"pins\":0,"
+                    "\"dirty\":true") == std::string::npos) {
+    PRINT_ERROR("ERROR :: JSON FRAME DUMP DID NOT MATCH");
+  }
+
+  bufMgr->unPinPage(file1, 1, false);
+  bufMgr->flushFile(file1);
+
+  std::cout << "Test 19 passed"
+            << "\n";
+}
+
+void test20(File &file1) {
+  // With every frame pinned an allocation fails without sweeping, or waits
+  // for an unpin; sweeps stop clearing reference bits after a few frames
+  {
+    BufMgr tiny(2, ReplacementPolicyType::CLOCK);
+    Page *first, *second;
+    tiny.readPage(file1, 1, first);
+    tiny.readPage(file1, 2, second);
+    const std::uint64_t steps = tiny.getBufStats().sweepsteps;
+    try {
+      tiny.readPage(file1, 3, page);
+      PRINT_ERROR("ERROR :: No frames left, exception should have been thrown");
+    } catch (const BufferExceededException &e) {
+    }
+    const BufStats stats = tiny.getBufStats();
+    if (tiny.unpinnedFrames() != 0 || stats.allpinned != 1 ||
+        stats.sweepsteps != steps) {
+      PRINT_ERROR("ERROR :: FULL POOL WAS SWEPT");
+    }
+    tiny.unPinPage(file1, 1, false);
+    tiny.unPinPage(file1, 2, false);
+  }
+
+  AllocConfig alloc;
+  alloc.maxSweepSteps = 2;
+  alloc.pinWaitMs = 10000;
+  BufMgr small(4, ReplacementPolicyType::CLOCK, BackgroundWriterConfig(),
+               IoEngineConfig(), alloc);
+  Page *pages[4];
+  for (PageId k = 0; k < 4; k++) small.readPage(file1, k + 1, pages[k]);
+
+  // unpin once the allocation below found the pool full
+  std::thread unpinner([&small, &file1]() {
+    while (small.getBufStats().allpinned == 0) std::this_thread::yield();
+    small.unPinPage(file1, 1, false);
+  });
+  small.readPage(file1, 5, page);
+  unpinner.join();
+  if (small.unpinnedFrames() != 0 || page->page_number() != 5) {
+    PRINT_ERROR("ERROR :: ALLOCATION DID NOT WAIT FOR THE UNPIN");
+  }
+  small.unPinPage(file1, 5, false);
+  for (PageId k = 1; k < 4; k++) small.unPinPage(file1, k + 1, false);
+
+  // every resident page is referenced, so only the cap ends this sweep
+  small.readPage(file1, 6, page);
+  small.unPinPage(file1, 6, false);
+  if (small.unpinnedFrames() != 4 || small.getBufStats().cappedsweeps < 1) {
+    PRINT_ERROR("ERROR :: SWEEP WAS NOT CAPPED");
+  }
+
+  std::cout << "Test 20 passed"
+            << "\n";
+}
+
+void test21(File &file1, File &file2) {
+  // Frames released by flushFile are reused before any resident page is
+  // evicted
+  BufMgr small(4, ReplacementPolicyType::CLOCK);
+  for (PageId k = 1; k <= 2; k++) {
+    small.readPage(file1, k, page);
+    small.unPinPage(file1, k, false);
+    small.readPage(file2, k, page);
+    small.unPinPage(file2, k, false);
+  }
+  small.flushFile(file2);
+  const BufStats before = small.getBufStats();
+  for (PageId k = 3; k <= 4; k++) {
+    small.readPage(file1, k, page);
+    small.unPinPage(file1, k, false);
+  }
+  for (PageId k = 1; k <= 2; k++) {
+    small.readPage(file1, k, page);
+    small.unPinPage(file1, k, false);
+  }
+
+  const BufStats after = small.getBufStats();
+  if (after.freeframes != before.freeframes + 2 ||
+      after.sweepsteps != before.sweepsteps ||
+      after.hits != before.hits + 2 || before.freeframes != 4) {
+    PRINT_ERROR("ERROR :: FREED FRAMES WERE NOT REUSED FIRST");
+  }
+
+  std::cout << "Test 21 passed"
+            << "\n";
+}
+
+void test22(File &file1) {
+  // Checkpoint writes of a file's dirty pages, consecutive ones together,
+  // keep the pages in the pool; flushing the file then has nothing to write
+  BackgroundWriterConfig writer;
+  writer.enabled = false;
+  // runs are up to a quarter of the pool long
+  BufMgr small(16, ReplacementPolicyType::CLOCK, writer);
+  const PageId dirtied[] = {6, 1, 2, 3, 4};
+  for (const PageId pageNo : dirtied) {
+    small.readPage(file1, pageNo, page);
+    small.unPinPage(file1, pageNo, true);
+  }
+  small.readPage(file1, 5, page);
+  small.unPinPage(file1, 5, false);
+
+  const BufStats before = small.getBufStats();
+  const std::uint32_t written = small.flushDirty(file1);
+  for (const PageId pageNo : dirtied) {
+    small.readPage(file1, pageNo, page);
+    small.unPinPage(file1, pageNo, false);
+  }
+  const BufStats after = small.getBufStats();
+  if (written != 5 || after.diskwrites != before.diskwrites + 5 ||
+      after.writelatency.count() != before.writelatency.count() + 2 ||
+      after.hits != before.hits + 5) {
+    PRINT_ERROR("ERROR :: DIRTY PAGES WERE NOT WRITTEN IN RUNS");
+  }
+
+  small.flushFile(file1);
+  const BufStats flushed = small.getBufStats();
+  small.readPage(file1, 1, page);
+  small.unPinPage(file1, 1, false);
+  if (flushed.diskwrites != after.diskwrites ||
+      small.getBufStats().misses != flushed.misses + 1 ||
+      small.summarize().valid != 1) {
+    PRINT_ERROR("ERROR :: FLUSHED FILE LEFT PAGES IN THE POOL");
+  }
+
+  std::cout << "Test 22 passed"
+            << "\n";
+}
+
+void test23(File &file1) {
+  // A scan cycles through the scan ring instead of evicting the working set
+  BufMgr pool(16, ReplacementPolicyType::CLOCK);
+  for (PageId pageNo = 1; pageNo <= 4; pageNo++) {
+    pool.readPage(file1, pageNo, page);
+    pool.unPinPage(file1, pageNo, false);
+  }
+  for (PageId pageNo = 10; pageNo < 50; pageNo++) {
+    pool.readPage(file1, pageNo, page, AccessIntent::SEQUENTIAL);
+    pool.unPinPage(file1, pageNo, false);
+  }
+  const BufStats scanned = pool.getBufStats();
+  for (PageId pageNo = 1; pageNo <= 4; pageNo++) {
+    pool.readPage(file1, pageNo, page);
+    pool.unPinPage(file1, pageNo, false);
+  }
+  if (scanned.ringreuses != 38 ||
+      pool.getBufStats().hits != scanned.hits + 4) {
+    PRINT_ERROR("ERROR :: SCAN EVICTED THE WORKING SET");
+  }
+
+  // A page kept by its reader outlives those read after it once
+  BufMgr tiny(4, ReplacementPolicyType::CLOCK);
+  tiny.readPage(file1, 1, page, AccessIntent::KEEP);
+  tiny.unPinPage(file1, 1, false);
+  for (PageId pageNo = 2; pageNo <= 6; pageNo++) {
+    tiny.readPage(file1, pageNo, page);
+    tiny.unPinPage(file1, pageNo, false);
+  }
+  const BufStats before = tiny.getBufStats();
+  tiny.readPage(file1, 1, page);
+  tiny.unPinPage(file1, 1, false);
+  if (tiny.getBufStats().hits != before.hits + 1) {
+    PRINT_ERROR("ERROR :: KEPT PAGE WAS EVICTED FIRST");
+  }
+
+  std::cout << "Test 23 passed"
+            << "\n";
+}
+
+void test24(File &file1) {
+  // Guards pin their page until released or destroyed
+  BufMgr pool(8, ReplacementPolicyType::CLOCK);
+  PageId pageNo;
+  RecordId rid;
+  {
+    WritePageGuard written = pool.allocForWrite(file1);
+    pageNo = written.pageNumber();
+    rid = written->insertRecord("guarded");
+    if (pool.unpinnedFrames() != 7) {
+      PRINT_ERROR("ERROR :: GUARD DID NOT PIN ITS PAGE");
+    }
+
+    // A moved guard unpins once, through its new owner
+    WritePageGuard moved(std::move(written));
+    if (written || !moved || pool.unpinnedFrames() != 7) {
+      PRINT_ERROR("ERROR :: MOVED GUARD CHANGED THE PIN COUNT");
+    }
+  }
+  if (pool.unpinnedFrames() != 8) {
+    PRINT_ERROR("ERROR :: GUARD DID NOT UNPIN ITS PAGE");
+  }
+
+  // Readers share the page; releasing leaves the guard empty
+  ReadPageGuard first = pool.pinForRead(file1, pageNo);
+  ReadPageGuard second = pool.pinForRead(file1, pageNo);
+  if (first->getRecord(rid) != "guarded" || pool.unpinnedFrames() != 7) {
+    PRINT_ERROR("ERROR :: READ GUARDS DID NOT SHARE THE PAGE");
+  }
+  first.release();
+  first.release();
+  second = std::move(first);
+  if (first || second || pool.unpinnedFrames() != 8) {
+    PRINT_ERROR("ERROR :: RELEASED GUARDS STILL PIN THE PAGE");
+  }
+
+  // Writes through a guard reach the file; reads alone write nothing
+  pool.flushFile(file1);
+  const BufStats flushed = pool.getBufStats();
+  pool.pinForRead(file1, pageNo).release();
+  pool.pinForWrite(file1, pageNo).release();
+  pool.flushFile(file1);
+  if (pool.getBufStats().diskwrites != flushed.diskwrites) {
+    PRINT_ERROR("ERROR :: UNTOUCHED GUARDS DIRTIED THE PAGE");
+  }
+  {
+    WritePageGuard update = pool.pinForWrite(file1, pageNo);
+    update->updateRecord(rid, "updated");
+  }
+  pool.flushFile(file1);
+  BufMgr fresh(4, ReplacementPolicyType::CLOCK);
+  {
+    ReadPageGuard check = fresh.pinForRead(file1, pageNo);
+    if (check->getRecord(rid) != "updated") {
+      PRINT_ERROR("ERROR :: GUARDED WRITE WAS LOST");
+    }
+  }
+  {
+    // the page stays while a guard holds it
+    WritePageGuard held = fresh.pinForWrite(file1, pageNo);
+    try {
+      fresh.disposePage(file1, pageNo);
+      PRINT_ERROR("ERROR :: DISPOSED A PAGE HELD BY A GUARD");
+    } catch (const PagePinnedException &e) {
+    }
+    if (held->getRecord(rid) != "updated") {
+      PRINT_ERROR("ERROR :: PAGE CHANGED BY A FAILED DISPOSE");
+    }
+  }
+  fresh.disposePage(file1, pageNo);
+  fresh.flushFile(file1);
+
+  std::cout << "Test 24 passed"
+            << "\n";
+}
+
+void test25(File &file1) {
+  // Writers through guards take turns on a page that readers share
+  BufMgr pool(8, ReplacementPolicyType::CLOCK);
+  PageId pageNo;
+  RecordId shared;
+  {
+    WritePageGuard created = pool.allocForWrite(file1);
+    pageNo = created.pageNumber();
+    shared = created->insertRecord("aaaaaaaa");
+  }
+
+  const int writers = 4;
+  const int readers = 4;
+  const int inserts = 50;
+  std::vector<std::vector<RecordId>> inserted(writers);
+  std::atomic<int> torn(0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < writers; t++) {
+    threads.emplace_back([&, t] {
+      const std::string mine(8, static_cast<char>('b' + t));
+      for (int k = 0; k < inserts; k++) {
+        WritePageGuard page = pool.pinForWrite(file1, pageNo);
+        inserted[t].push_back(page->insertRecord(mine));
+        page->updateRecord(shared, mine);
+      }
+    });
+  }
+  for (int t = 0; t < readers; t++) {
+    threads.emplace_back([&] {
+      for (int k = 0; k < inserts; k++) {
+        ReadPageGuard page = pool.pinForRead(file1, pageNo);
+        const std::string record = page->getRecord(shared);
+        if (record.size() != 8 ||
+            std::count(record.begin(), record.end(), record[0]) != 8) {
+          torn++;
+        }
+      }
+    });
+  }
+  for (std::thread &thread : threads) thread.join();
+
+  if (torn != 0 || pool.unpinnedFrames() != 8) {
+    PRINT_ERROR("ERROR :: READER SAW A WRITE IN PROGRESS");
+  }
+  {
+    ReadPageGuard page = pool.pinForRead(file1, pageNo);
+    for (int t = 0; t < writers; t++) {
+      const std::string mine(8, static_cast<char>('b' + t));
+      for (const RecordId &rid : inserted[t]) {
+        if (page->getRecord(rid) != mine) {
+          PRINT_ERROR("ERROR :: CONCURRENT INSERTS LOST A RECORD");
+        }
+      }
+    }
+  }
+  pool.disposePage(file1, pageNo);
+  pool.flushFile(file1);
+
+  std::cout << "Test 25 passed"
+            << "\n";
+}
+
+void test26(File &file1) {
+  // Pages go to the partition they are placed in while it has frames
+  NumaConfig numa;
+  numa.partitions = 2;
+  BufMgr pool(16, ReplacementPolicyType::CLOCK, BackgroundWriterConfig(),
+              IoEngineConfig(), AllocConfig(), numa);
+  if (pool.numPartitions() != 2 || pool.partitionOf(0) != 0 ||
+      pool.partitionOf(15) != 1) {
+    PRINT_ERROR("ERROR :: POOL WAS NOT SPLIT IN TWO");
+  }
+  for (PageId pageNo = 1; pageNo <= 40; pageNo++) {
+    pool.readPage(file1, pageNo, page);
+    const FrameId frame = static_cast<FrameId>(page - pool.bufPool.data());
+    if (pool.partitionOf(frame) != pool.placeFor(file1, pageNo)) {
+      PRINT_ERROR("ERROR :: PAGE READ INTO THE WRONG PARTITION");
+    }
+    pool.unPinPage(file1, pageNo, false);
+  }
+  if (pool.getBufStats().spills != 0) {
+    PRINT_ERROR("ERROR :: PAGE SPILLED WITH FRAMES TO SPARE");
+  }
+
+  // A partition with every frame pinned spills into the other one
+  std::vector<PageId> pinned;
+  PageId pageNo = 41;
+  for (; pinned.size() < 8; pageNo++) {
+    if (pool.placeFor(file1, pageNo) != 0) continue;
+    pool.readPage(file1, pageNo, page);
+    pinned.push_back(pageNo);
+  }
+  while (pool.placeFor(file1, pageNo) != 0) pageNo++;
+  pool.readPage(file1, pageNo, page);
+  const FrameId spilled = static_cast<FrameId>(page - pool.bufPool.data());
+  if (pool.partitionOf(spilled) != 1 || pool.getBufStats().spills != 1) {
+    PRINT_ERROR("ERROR :: FULL PARTITION DID NOT SPILL");
+  }
+  pool.unPinPage(file1, pageNo, false);
+  for (const PageId p : pinned) pool.unPinPage(file1, p, false);
+
+  // Local placement keeps to the partitions of the thread's node
+  numa.placement = NumaPlacement::LOCAL;
+  BufMgr local(16, ReplacementPolicyType::TWO_QUEUE, BackgroundWriterConfig(),
+               IoEngineConfig(), AllocConfig(), numa);
+  const std::uint32_t nodes = numaNodeCount();
+  for (PageId p = 1; p <= 8 && nodes <= 2; p++) {
+    if (local.placeFor(file1, p) % nodes != currentNumaNode() % nodes) {
+      PRINT_ERROR("ERROR :: LOCAL PLACEMENT LEFT THE THREAD'S NODE");
+    }
+  }
+
+  // One partition per node by default
+  numa.partitions = 0;
+  BufMgr perNode(16, ReplacementPolicyType::CLOCK, BackgroundWriterConfig(),
+                 IoEngineConfig(), AllocConfig(), numa);
+  if (perNode.numPartitions() != std::min<std::uint32_t>(nodes, 16)) {
+    PRINT_ERROR("ERROR :: POOL WAS NOT SPLIT PER NODE");
+  }
+
+  std::cout << "Test 26 passed"
+            << "\n";
+}
+
+void test27(File &file1) {
+  // Growing makes room without evicting
+  AllocConfig alloc;
+  alloc.maxFrames = 32;
+  BufMgr pool(8, ReplacementPolicyType::CLOCK, BackgroundWriterConfig(),
+              IoEngineConfig(), alloc);
+  if (pool.size() != 8 || pool.capacity() != 32 || pool.resize(32) != 32) {
+    PRINT_ERROR("ERROR :: POOL DID NOT GROW");
+  }
+  std::vector<FrameId> frames(31);
+  for (PageId pageNo = 1; pageNo <= 30; pageNo++) {
+    pool.readPage(file1, pageNo, page);
+    frames[pageNo] = static_cast<FrameId>(page - pool.bufPool.data());
+    pool.unPinPage(file1, pageNo, false);
+  }
+  const BufStats before = pool.getBufStats();
+  if (before.cleanevictions + before.dirtyevictions != 0 ||
+      pool.unpinnedFrames() != 32) {
+    PRINT_ERROR("ERROR :: GROWN POOL EVICTED PAGES");
+  }
+
+  // Shrinking evicts the tail, writing dirty pages back, but stops at a pin
+  std::uint64_t dirtied = 0;
+  for (PageId pageNo = 1; pageNo <= 30; pageNo++) {
+    if (frames[pageNo] <= frames[20]) continue;
+    pool.readPage(file1, pageNo, page);
+    pool.unPinPage(file1, pageNo, true);
+    dirtied++;
+  }
+  pool.readPage(file1, 20, page);
+  if (pool.resize(4) != frames[20] + 1 ||
+      pool.getBufStats().diskwrites != before.diskwrites + dirtied) {
+    PRINT_ERROR("ERROR :: SHRINK DID NOT STOP AT THE PINNED PAGE");
+  }
+  pool.unPinPage(file1, 20, false);
+  if (pool.resize(4) != 4 || pool.unpinnedFrames() != 4) {
+    PRINT_ERROR("ERROR :: POOL DID NOT SHRINK");
+  }
+  for (PageId pageNo = 1; pageNo <= 30; pageNo++) {
+    pool.readPage(file1, pageNo, page);
+    if (page - pool.bufPool.data() >= 4 || page->page_number() != pageNo) {
+      PRINT_ERROR("ERROR :: SHRUNK POOL USED A FRAME PAST ITS END");
+    }
+    pool.unPinPage(file1, pageNo, false);
+  }
+
+  // Readers keep going while the pool is resized under them
+  std::atomic<bool> done(false);
+  std::atomic<int> wrong(0);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 3; t++) {
+    readers.emplace_back([&, t] {
+      for (PageId k = 0; !done; k++) {
+        const PageId pageNo = 1 + (k * 7 + t) % 50;
+        Page *mine;
+        try {
+          pool.readPage(file1, pageNo, mine);
+        } catch (const BufferExceededException &) {
+          continue;
+        }
+        if (mine->page_number() != pageNo) wrong++;
+        pool.unPinPage(file1, pageNo, false);
+      }
+    });
+  }
+  for (int k = 0; k < 40; k++) pool.resize(k % 2 == 0 ? 32 : 4);
+  done = true;
+  for (std::thread &reader : readers) reader.join();
+  if (wrong != 0 || pool.unpinnedFrames() != pool.size()) {
+    PRINT_ERROR("ERROR :: RESIZE DISTURBED CONCURRENT READERS");
+  }
+  if (pool.resize(0) != 1 || pool.resize(1000) != 32) {
+    PRINT_ERROR("ERROR :: POOL SIZE WAS NOT KEPT IN BOUNDS");
+  }
+  pool.flushFile(file1);
+
+  std::cout << "Test 27 passed"
+            << "\n";
+}
+
+void test28() {
+  // CRC-32C of the usual check string, at once and in two pieces
+  const char check[] = "123456789";
+  if (crc32c(check, 9) != 0xe3069283 ||
+      crc32c(check + 4, 5, crc32c(check, 4)) != 0xe3069283) {
+    PRINT_ERROR("ERROR :: WRONG CRC32C");
+  }
+
+  // The damage, and the old format, are made byte by byte on disk, which
+  // takes pages stored as they are
+  const FileBackendType backend = File::defaultBackend();
+  File::setDefaultBackend(FileBackendType::POSIX);
+  const std::string filename8 = "test.8";
+  try {
+    File::remove(filename8);
+  } catch (const FileNotFoundException &e) {
+  }
+  const std::string record = "checksummed";
+  PageId pageNo8;
+  RecordId rid8;
+  {
+    // Pages written back from the pool carry their checksum
+    File file8 = File::create(filename8);
+    BufMgr pool(4);
+    pool.allocPage(file8, pageNo8, page);
+    rid8 = page->insertRecord(record);
+    pool.unPinPage(file8, pageNo8, true);
+    pool.flushFile(file8);
+    const Page on_disk = file8.readPage(pageNo8);
+    if (on_disk.checksum() == 0 || !on_disk.checksumMatches()) {
+      PRINT_ERROR("ERROR :: PAGE WRITTEN WITHOUT CHECKSUM");
+    }
+  }
+  {
+    // Damage the last byte of the page, the last of the record
+    std::fstream raw(filename8,
+                     std::ios::in | std::ios::out | std::ios::binary);
+    const std::streamoff last =
+        static_cast<std::streamoff>(pageNo8 + 1) * Page::SIZE - 1;
+    char byte;
+    raw.seekg(last);
+    raw.read(&byte, 1);
+    byte ^= 0x20;
+    raw.seekp(last);
+    raw.write(&byte, 1);
+  }
+  {
+    File file8 = File::open(filename8);
+    BufMgr pool(4);
+    bool caught = false;
+    try {
+      pool.readPage(file8, pageNo8, page);
+    } catch (const PageChecksumException &e) {
+      caught = e.page_number() == pageNo8 && e.stored() != e.computed();
+    }
+    if (!caught) PRINT_ERROR("ERROR :: DAMAGED PAGE READ WITHOUT ERROR");
+    caught = false;
+    try {
+      pool.readPageAsync(file8, pageNo8).get();
+    } catch (const PageChecksumException &e) {
+      caught = true;
+    }
+    if (!caught) PRINT_ERROR("ERROR :: DAMAGED PAGE LOADED WITHOUT ERROR");
+
+    // With checksums off the damaged page is read as it is
+    file8.setChecksums(false);
+    pool.readPage(file8, pageNo8, page);
+    if (page->getRecord(rid8) == record) {
+      PRINT_ERROR("ERROR :: DAMAGE NOT ON DISK");
+    }
+    pool.unPinPage(file8, pageNo8, false);
+  }
+  File::remove(filename8);
+
+  // Versions 4 and 5 had pages with 16 and 20-byte headers
+  for (const std::uint32_t version : {4u, 5u}) {
+    RecordId kept, deleted;
+    {
+      File file8 = File::create(filename8);
+      Page new_page = file8.allocatePage();
+      pageNo8 = new_page.page_number();
+      deleted = new_page.insertRecord("deleted before migration");
+      kept = new_page.insertRecord("kept across migration");
+      new_page.deleteRecord(deleted);
+      file8.writePage(new_page);
+    }
+    {
+      // Turn the file back into the old version: pages with smaller headers
+      // and no checksum or LSN, records where they are relative to the data
+      std::fstream raw(filename8,
+                       std::ios::in | std::ios::out | std::ios::binary);
+      const std::size_t header_size = version == 4 ? 16 : 20;
+      raw.seekp(sizeof(std::uint32_t));
+      raw.write(reinterpret_cast<const char *>(&version), sizeof(version));
+      std::vector<char> bytes(Page::SIZE);
+      std::vector<char> old_bytes(Page::SIZE, 0);
+      const std::streamoff position =
+          static_cast<std::streamoff>(pageNo8) * Page::SIZE;
+      raw.seekg(position);
+      raw.read(bytes.data(), Page::SIZE);
+      std::memcpy(old_bytes.data(), bytes.data(), header_size);
+      std::memcpy(old_bytes.data() + header_size,
+                  bytes.data() + sizeof(PageHeader), Page::DATA_SIZE);
+      raw.seekp(position);
+      raw.write(old_bytes.data(), Page::SIZE);
+    }
+    {
+      File file8 = File::open(filename8);
+      Page migrated = file8.readPage(pageNo8);
+      if (migrated.getRecord(kept) != "kept across migration" ||
+          migrated.checksum() == 0 || migrated.lsn() != 0 ||
+          migrated.insertRecord("new").slot_number != deleted.slot_number) {
+        PRINT_ERROR("ERROR :: OLD VERSION PAGE NOT MIGRATED");
+      }
+    }
+    File::remove(filename8);
+  }
+  File::setDefaultBackend(backend);
+
+  std::cout << "Test 28 passed"
+            << "\n";
+}
+
+/**
+ * Returns <length> bytes that do not compress, the same for the same seed.
+ */
+std::string noiseRecord(std::uint32_t seed, const std::size_t length) {
+  std::string noise(length, '\0');
+  for (char &c : noise) {
+    seed = seed * 1103515245 + 12345;
+    c = static_cast<char>(seed >> 24);
+  }
+  return noise;
+}
+
+void test29() {
+  // Sizes on disk are those of POSIX files below the compressed pages
+  const FileBackendType backend = File::defaultBackend();
+  File::setDefaultBackend(FileBackendType::POSIX);
+  const std::string filename9 = "test.9";
+  try {
+    File::remove(filename9);
+  } catch (const FileNotFoundException &e) {
+  }
+  PageId pages9[num];
+  RecordId rids9[num];
+  {
+    File file9 = File::createCompressed(filename9);
+    BufMgr pool(16);
+    for (i = 0; i < num; i++) {
+      pool.allocPage(file9, pages9[i], page);
+      sprintf(tmpbuf, "test.9 Page %u %7.1f", pages9[i], (float)pages9[i]);
+      rids9[i] = page->insertRecord(tmpbuf);
+      pool.unPinPage(file9, pages9[i], true);
+    }
+    pool.flushFile(file9);
+  }
+  {
+    // Pages of a short text record take a slot or two each
+    std::ifstream on_disk(filename9, std::ios::binary | std::ios::ate);
+    if (on_disk.tellg() >
+        std::streamoff(num * std::max<std::size_t>(
+                                 Page::SIZE / 16,
+                                 2 * CompressedFileBackend::SLOT_ALIGNMENT))) {
+      PRINT_ERROR("ERROR :: COMPRESSED PAGES NOT SMALLER ON DISK");
+    }
+  }
+
+  RecordId noise_rids[num];
+  {
+    // Opened like any file; pages that grow move to bigger slots
+    File file9 = File::open(filename9);
+    BufMgr pool(16);
+    for (i = 0; i < num; i++) {
+      pool.readPage(file9, pages9[i], page);
+      sprintf(tmpbuf, "test.9 Page %u %7.1f", pages9[i], (float)pages9[i]);
+      if (page->getRecord(rids9[i]) != tmpbuf) {
+        PRINT_ERROR("ERROR :: COMPRESSED PAGE READ BACK WRONG");
+      }
+      noise_rids[i] = page->insertRecord(noiseRecord(i, 1000));
+      pool.unPinPage(file9, pages9[i], true);
+    }
+    pool.flushFile(file9);
+  }
+  {
+    File file9 = File::open(filename9);
+    BufMgr pool(num);
+    std::vector<std::future<Page *>> loads;
+    for (i = 0; i < num; i++) {
+      loads.push_back(pool.readPageAsync(file9, pages9[i]));
+    }
+    for (i = 0; i < num; i++) {
+      Page *loaded = loads[i].get();
+      sprintf(tmpbuf, "test.9 Page %u %7.1f", pages9[i], (float)pages9[i]);
+      if (loaded->getRecord(rids9[i]) != tmpbuf ||
+          loaded->getRecord(noise_rids[i]) != noiseRecord(i, 1000)) {
+        PRINT_ERROR("ERROR :: MOVED COMPRESSED PAGE READ BACK WRONG");
+      }
+      pool.unPinPage(file9, pages9[i], false);
+    }
+  }
+  File::remove(filename9);
+  File::setDefaultBackend(backend);
+
+  std::cout << "Test 29 passed"
+            << "\n";
+}
+
+void test30(File &file1) {
+  // A pool of 8 frames with room for the pages of file1 behind it
+  VictimCacheConfig victim;
+  victim.bytes = 1 << 20;
+  BufMgr pool(8, ReplacementPolicyType::CLOCK, BackgroundWriterConfig(),
+              IoEngineConfig(), AllocConfig(), NumaConfig(), victim);
+  for (i = 0; i < 40; i++) {
+    pool.readPage(file1, pid[i], page);
+    pool.unPinPage(file1, pid[i], false);
+  }
+  const BufStats streamed = pool.getBufStats();
+  if (streamed.victimputs != 32 || pool.victimCachePages() != 32) {
+    PRINT_ERROR("ERROR :: EVICTED PAGES NOT PUT IN THE VICTIM CACHE");
+  }
+
+  // Evicted pages come back from the cache, as they are in the file
+  PageId pageNos[5];
+  for (i = 0; i < 5; i++) pageNos[i] = pid[10 + i];
+  for (i = 0; i < 10; i++) {
+    pool.readPage(file1, pid[i], page);
+    sprintf(tmpbuf, "test.1 Page %u %7.1f", pid[i], (float)pid[i]);
+    if (page->page_number() != pid[i] || page->getRecord(rid[i]) != tmpbuf) {
+      PRINT_ERROR("ERROR :: VICTIM CACHE RETURNED THE WRONG PAGE");
+    }
+    pool.unPinPage(file1, pid[i], false);
+  }
+  Page *pages[5];
+  pool.readPages(file1, pageNos, 5, pages);
+  for (i = 0; i < 5; i++) pool.unPinPage(file1, pageNos[i], false);
+  const BufStats reread = pool.getBufStats();
+  if (reread.victimhits != 15 || reread.diskreads != streamed.diskreads) {
+    PRINT_ERROR("ERROR :: EVICTED PAGES READ FROM DISK AGAIN");
+  }
+
+  // Dirty pages are written back before they are cached
+  pool.allocPage(file1, pageNos[0], page);
+  const RecordId rid = page->insertRecord("test.1 victim cache");
+  pool.unPinPage(file1, pageNos[0], true);
+  for (i = 20; i < 30; i++) {
+    pool.readPage(file1, pid[i], page);
+    pool.unPinPage(file1, pid[i], false);
+  }
+  if (file1.readPage(pageNos[0]).getRecord(rid) != "test.1 victim cache") {
+    PRINT_ERROR("ERROR :: DIRTY PAGE NOT WRITTEN BEFORE IT WAS CACHED");
+  }
+  const std::uint64_t hits = pool.getBufStats().victimhits;
+  pool.readPage(file1, pageNos[0], page);
+  if (page->getRecord(rid) != "test.1 victim cache" ||
+      pool.getBufStats().victimhits != hits + 1) {
+    PRINT_ERROR("ERROR :: DIRTY PAGE NOT TAKEN FROM THE VICTIM CACHE");
+  }
+  pool.unPinPage(file1, pageNos[0], false);
+
+  // Deleted pages and those of flushed files are forgotten
+  for (i = 30; i < 40; i++) {
+    pool.readPage(file1, pid[i], page);
+    pool.unPinPage(file1, pid[i], false);
+  }
+  const std::size_t cached = pool.victimCachePages();
+  pool.disposePage(file1, pageNos[0]);
+  if (pool.victimCachePages() != cached - 1) {
+    PRINT_ERROR("ERROR :: DELETED PAGE LEFT IN THE VICTIM CACHE");
+  }
+  pool.flushFile(file1);
+  if (pool.victimCachePages() != 0) {
+    PRINT_ERROR("ERROR :: FLUSHED FILE LEFT IN THE VICTIM CACHE");
+  }
+
+  // A copy too big for the cache still replaces the older one, and a copy
+  // that does not decompress is dropped rather than handed out
+  const std::string zeros(Page::SIZE, '\0');
+  std::string noise(Page::SIZE, '\0');
+  std::uint64_t state = 88172645463325252ull;
+  for (std::size_t k = 0; k < noise.size(); k++) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    noise[k] = static_cast<char>(state >> 56);
+  }
+  const std::string small = VictimCache::compress(zeros.data());
+  if (VictimCache::compress(noise.data()).size() != Page::SIZE) {
+    PRINT_ERROR("ERROR :: NOISE PAGE COMPRESSED");
+  }
+  VictimCache tight(small.size() + VictimCache::ENTRY_OVERHEAD);
+  std::string out(Page::SIZE, '\0');
+  tight.insert(1, 7, small);
+  tight.insert(1, 7, VictimCache::compress(noise.data()));
+  if (tight.pages() != 0 || tight.take(1, 7, &out[0])) {
+    PRINT_ERROR("ERROR :: STALE PAGE LEFT IN THE VICTIM CACHE");
+  }
+  tight.insert(1, 8, std::string(small.size(), '\xff'));
+  if (tight.take(1, 8, &out[0]) || tight.pages() != 0) {
+    PRINT_ERROR("ERROR :: CORRUPT PAGE TAKEN FROM THE VICTIM CACHE");
+  }
+
+  std::cout << "Test 30 passed"
+            << "\n";
+}
+
+void test31(File &file1) {
+  // The resident set of a pool, hottest first
+  std::stringstream saved;
+  std::vector<PageId> resident;
+  {
+    BufMgr pool(8);
+    for (i = 0; i < 30; i++) {
+      pool.readPage(file1, pid[i], page);
+      pool.unPinPage(file1, pid[i], false);
+    }
+    pool.readPage(file1, pid[0], page, AccessIntent::KEEP);
+    pool.unPinPage(file1, pid[0], false);
+    if (pool.saveResidentSet(saved) != 8) {
+      PRINT_ERROR("ERROR :: RESIDENT SET NOT SAVED");
+    }
+    std::stringstream lines(saved.str());
+    std::string line;
+    while (std::getline(lines, line)) {
+      std::istringstream fields(line);
+      std::size_t index;
+      PageId pageNo;
+      if (fields >> index >> pageNo) resident.push_back(pageNo);
+    }
+    if (resident.size() != 8 || resident.front() != pid[0]) {
+      PRINT_ERROR("ERROR :: KEPT PAGE NOT SAVED FIRST");
+    }
+    pool.flushFile(file1);
+  }
+
+  // A new pool reads it back in ahead of the accesses
+  std::vector<File> files(1, file1);
+  {
+    BufMgr pool(16);
+    std::stringstream in(saved.str());
+    if (pool.warmUp(in, files, true) != 8 ||
+        pool.getBufStats().prefetchreads != 8) {
+      PRINT_ERROR("ERROR :: RESIDENT SET NOT READ BACK");
+    }
+    for (const PageId pageNo : resident) {
+      pool.readPage(file1, pageNo, page);
+      pool.unPinPage(file1, pageNo, false);
+    }
+    const BufStats stats = pool.getBufStats();
+    if (stats.hits != 8 || stats.diskreads != 8) {
+      PRINT_ERROR("ERROR :: WARMED UP POOL MISSED");
+    }
+    pool.flushFile(file1);
+  }
+
+  // Only as many pages as fit, and only of the files given
+  {
+    BufMgr pool(4);
+    std::stringstream in(saved.str());
+    if (pool.warmUp(in, files, true) != 4 || pool.unpinnedFrames() != 4) {
+      PRINT_ERROR("ERROR :: WARM-UP OVERFILLED THE POOL");
+    }
+    pool.flushFile(file1);
+    std::vector<File> others;
+    std::stringstream again(saved.str());
+    if (pool.warmUp(again, others, true) != 0) {
+      PRINT_ERROR("ERROR :: WARM-UP READ PAGES OF ANOTHER FILE");
+    }
+  }
+
+  // Any file name reads back, and reading stops at a line it cannot parse
+  const std::string filename13 = "test.13 \"odd\"\nname\\";
+  try {
+    File::remove(filename13);
+  } catch (const FileNotFoundException &e) {
+  }
+  {
+    File file13 = File::create(filename13);
+    std::vector<File> odd(1, file13);
+    std::stringstream odd_saved;
+    PageId pid13[3];
+    {
+      // no writer to latch the dirty frames while the set is saved
+      BackgroundWriterConfig no_writer;
+      no_writer.enabled = false;
+      BufMgr pool(8, ReplacementPolicyType::CLOCK, no_writer);
+      for (i = 0; i < 3; i++) {
+        pool.allocPage(file13, pid13[i], page);
+        pool.unPinPage(file13, pid13[i], true);
+      }
+      if (pool.saveResidentSet(odd_saved) != 3) {
+        PRINT_ERROR("ERROR :: RESIDENT SET NOT SAVED");
+      }
+      pool.flushFile(file13);
+    }
+    {
+      BufMgr pool(8);
+      std::stringstream in(odd_saved.str());
+      if (pool.warmUp(in, odd, true) != 3) {
+        PRINT_ERROR("ERROR :: FILE NAME NOT READ BACK");
+      }
+      pool.flushFile(file13);
+    }
+    std::string text = odd_saved.str();
+    text.insert(text.find('\n', text.find("\n0 ") + 1) + 1, "0 1x\n");
+    {
+      BufMgr pool(8);
+      std::stringstream in(text);
+      if (pool.warmUp(in, odd, true) != 1) {
+        PRINT_ERROR("ERROR :: MALFORMED PAGE LINE NOT REJECTED");
+      }
+      pool.flushFile(file13);
+    }
+
+    // A malformed file line ends the set, even with good lines after it
+    text = odd_saved.str();
+    const std::size_t files = text.find('\n') + 1;
+    std::string pages = text.substr(files, text.find("\n0 ") + 1 - files);
+    for (i = 0; i < 3; i++) pages += "1 " + std::to_string(pid13[i]) + "\n";
+    for (const char *quoted : {"test.13", "\"test.13", "\"a\\q\"",
+                               "\"a\" \"", "\"\\u0041\"", "\"a\"\"\""}) {
+      std::stringstream in(text.substr(0, files) + "file " + quoted + "\n" +
+                           pages);
+      BufMgr pool(8);
+      if (pool.warmUp(in, odd, true) != 0) {
+        PRINT_ERROR("ERROR :: MALFORMED FILE LINE NOT REJECTED");
+      }
+    }
+    std::stringstream in(text.substr(0, files) + "file \"a\\u0001\"\n" +
+                         pages);
+    BufMgr pool(8);
+    if (pool.warmUp(in, odd, true) != 3) {
+      PRINT_ERROR("ERROR :: ESCAPED FILE LINE REJECTED");
+    }
+    pool.flushFile(file13);
+  }
+  File::remove(filename13);
+
+  std::cout << "Test 31 passed"
+            << "\n";
+}
+
+void test32() {
+  const std::string filename10 = "test.10";
+  const std::string logname = "test.wal";
+  for (const std::string &name : {filename10, logname}) {
+    try {
+      File::remove(name);
+    } catch (const FileNotFoundException &e) {
+    }
+  }
+
+  // Commits sync the log only; the pages stay dirty in the pool, and are
+  // lost with it as in a crash
+  BackgroundWriterConfig no_writer;
+  no_writer.enabled = false;
+  PageId pages10[4];
+  Lsn committed = 0;
+  {
+    File file10 = File::create(filename10);
+    LogManager log(logname);
+    BufMgr pool(8, ReplacementPolicyType::CLOCK, no_writer);
+    pool.setLog(&log);
+    for (int k = 0; k < 4; k++) {
+      pool.allocPage(file10, pages10[k], page);
+      pool.unPinPage(file10, pages10[k], true);
+    }
+    pool.flushFile(file10);
+    if (pool.getBufStats().logforces != 0) {
+      PRINT_ERROR("ERROR :: PAGES WITHOUT LSN WAITED FOR THE LOG");
+    }
+    for (int k = 0; k < 4; k++) {
+      pool.readPage(file10, pages10[k], page);
+      sprintf(tmpbuf, "test.10 Page %u", pages10[k]);
+      const std::string redo = std::to_string(pages10[k]) + " " + tmpbuf;
+      page->insertRecord(tmpbuf);
+      page->set_lsn(committed = log.append(redo));
+      pool.unPinPage(file10, pages10[k], true);
+    }
+    if (log.durableLsn() >= committed) {
+      PRINT_ERROR("ERROR :: LOG DURABLE BEFORE IT WAS FLUSHED");
+    }
+    log.flush(committed);
+    if (log.durableLsn() != committed || log.getStats().syncs != 1 ||
+        file10.readPage(pages10[3]).lsn() != 0) {
+      PRINT_ERROR("ERROR :: COMMIT DID NOT SYNC THE LOG ALONE");
+    }
+    pool.setLog(NULL);
+  }
+
+  // Recovery redoes what the pages on disk lack, which their LSN tells
+  {
+    File file10 = File::open(filename10);
+    LogManager log(logname);
+    if (log.endLsn() != committed) {
+      PRINT_ERROR("ERROR :: LOG END NOT FOUND ON OPEN");
+    }
+    int redone = 0;
+    log.replay([&](const Lsn lsn, const std::string &redo) {
+      const PageId pageNo = std::stoul(redo);
+      Page target = file10.readPage(pageNo);
+      if (target.lsn() >= lsn) return;
+      target.insertRecord(redo.substr(redo.find(' ') + 1));
+      target.set_lsn(lsn);
+      file10.writePage(target);
+      redone++;
+    });
+    for (int k = 0; k < 4; k++) {
+      Page recovered = file10.readPage(pages10[k]);
+      sprintf(tmpbuf, "test.10 Page %u", pages10[k]);
+      if (redone != 4 || recovered.lsn() == 0 ||
+          recovered.getRecord({pages10[k], 1}) != tmpbuf) {
+        PRINT_ERROR("ERROR :: COMMITTED CHANGE NOT REDONE");
+      }
+    }
+  }
+
+  // A dirty page is not written back before its log record is durable
+  {
+    File file10 = File::open(filename10);
+    LogManager log(logname);
+    BufMgr pool(2, ReplacementPolicyType::CLOCK, no_writer);
+    pool.setLog(&log);
+    pool.readPage(file10, pages10[0], page);
+    page->insertRecord("logged");
+    const Lsn lsn = log.append("update of the first page");
+    page->set_lsn(lsn);
+    pool.unPinPage(file10, pages10[0], true);
+    for (int k = 1; k < 4; k++) {
+      pool.readPage(file10, pages10[k], page);
+      pool.unPinPage(file10, pages10[k], false);
+    }
+    if (log.durableLsn() != lsn || pool.getBufStats().logforces != 1 ||
+        file10.readPage(pages10[0]).lsn() != lsn) {
+      PRINT_ERROR("ERROR :: PAGE EVICTED BEFORE ITS LOG RECORD");
+    }
+    pool.flushFile(file10);
+    pool.setLog(NULL);
+  }
+
+  // Threads committing at once share syncs, and a torn last record is
+  // dropped when the log is opened again
+  Lsn end;
+  {
+    LogManager log(logname);
+    std::vector<std::thread> committers;
+    for (int t = 0; t < 4; t++) {
+      committers.emplace_back([&log, t] {
+        for (int n = 0; n < 50; n++) {
+          log.flush(log.append("commit " + std::to_string(t * 50 + n)));
+        }
+      });
+    }
+    for (std::thread &committer : committers) committer.join();
+    const LogStats stats = log.getStats();
+    end = log.endLsn();
+    if (log.durableLsn() != end || stats.appends != 200 ||
+        stats.syncs > stats.flushes || stats.flushes > 200) {
+      PRINT_ERROR("ERROR :: GROUP COMMIT LOST A RECORD");
+    }
+  }
+  {
+    std::ofstream torn(logname, std::ios::binary | std::ios::app);
+    torn.write("\x20\0\0\0\x01\x02\x03\x04half", 12);
+  }
+  {
+    LogManager log(logname);
+    int commits = 0;
+    log.replay([&commits](const Lsn lsn, const std::string &record) {
+      if (record.compare(0, 7, "commit ") == 0) commits++;
+    });
+    if (log.endLsn() != end || commits != 200 ||
+        log.append("after the tear") <= end) {
+      PRINT_ERROR("ERROR :: TORN LOG RECORD NOT DROPPED");
+    }
+  }
+  File::remove(filename10);
+  File::remove(logname);
+
+  std::cout << "Test 32 passed"
+            << "\n";
+}
+
+void test33(File &file1) {
+  // Dirty pages are written and stay resident; a pinned one is skipped
+  BackgroundWriterConfig no_writer;
+  no_writer.enabled = false;
+  BufMgr pool(16, ReplacementPolicyType::CLOCK, no_writer);
+  for (i = 0; i < 12; i++) {
+    pool.readPage(file1, pid[i], page);
+    pool.unPinPage(file1, pid[i], true);
+  }
+  pool.readPage(file1, pid[0], page);
+  CheckpointConfig config;
+  config.sliceFrames = 4;
+  config.revisits = 1;
+  config.revisitDelayMs = 1;
+  CheckpointStats stats = pool.checkpoint(config).get();
+  BufStats after = pool.getBufStats();
+  if (stats.written != 11 || stats.skipped != 1 || stats.passes != 2 ||
+      after.diskwrites != 11 ||
+      after.cleanevictions + after.dirtyevictions != 0) {
+    PRINT_ERROR("ERROR :: CHECKPOINT DID NOT SKIP THE PINNED PAGE");
+  }
+  for (i = 0; i < 12; i++) {
+    pool.readPage(file1, pid[i], page);
+    pool.unPinPage(file1, pid[i], false);
+  }
+  if (pool.getBufStats().diskreads != after.diskreads) {
+    PRINT_ERROR("ERROR :: CHECKPOINT EVICTED PAGES");
+  }
+
+  // The pinned page is written once it is unpinned, on a later pass
+  config.revisitDelayMs = 100;
+  std::future<CheckpointStats> pending = pool.checkpoint(config);
+  pool.unPinPage(file1, pid[0], false);
+  stats = pending.get();
+  if (stats.written != 1 || stats.skipped != 0) {
+    PRINT_ERROR("ERROR :: CHECKPOINT DID NOT REVISIT THE PINNED PAGE");
+  }
+
+  // Writes are spread out to the rate asked for
+  for (i = 0; i < 12; i++) {
+    pool.readPage(file1, pid[i], page);
+    pool.unPinPage(file1, pid[i], true);
+  }
+  config.sliceFrames = 1;
+  config.pagesPerSecond = 200;
+  const std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  stats = pool.checkpoint(config).get();
+  if (stats.written != 12 ||
+      std::chrono::steady_clock::now() - start <
+          std::chrono::milliseconds(50)) {
+    PRINT_ERROR("ERROR :: CHECKPOINT NOT RATE LIMITED");
+  }
+
+  // A checkpoint started while another pauses returns at once and runs after
+  for (i = 0; i < 4; i++) {
+    pool.readPage(file1, pid[i], page);
+    pool.unPinPage(file1, pid[i], true);
+  }
+  config.pagesPerSecond = 20;
+  std::future<CheckpointStats> first = pool.checkpoint(config);
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  const std::chrono::steady_clock::time_point asked =
+      std::chrono::steady_clock::now();
+  std::future<CheckpointStats> second = pool.checkpoint(config);
+  if (std::chrono::steady_clock::now() - asked >
+      std::chrono::milliseconds(50)) {
+    PRINT_ERROR("ERROR :: CHECKPOINT WAITED FOR THE ONE BEFORE");
+  }
+  if (first.get().written != 4 || second.get().written != 0) {
+    PRINT_ERROR("ERROR :: BACK TO BACK CHECKPOINTS DID NOT BOTH RUN");
+  }
+
+  // Readers and writers go on while checkpoints run
+  std::atomic<bool> done(false);
+  std::atomic<int> wrong(0);
+  std::vector<std::thread> users;
+  for (int t = 0; t < 3; t++) {
+    users.emplace_back([&, t] {
+      for (PageId k = 0; !done; k++) {
+        const PageId pageNo = pid[(k * 5 + t) % 12];
+        Page *mine;
+        pool.readPage(file1, pageNo, mine);
+        if (mine->page_number() != pageNo) wrong++;
+        pool.unPinPage(file1, pageNo, k % 2 == 0);
+      }
+    });
+  }
+  config.pagesPerSecond = 0;
+  config.revisitDelayMs = 1;
+  for (int k = 0; k < 20; k++) pool.checkpoint(config).get();
+  done = true;
+  for (std::thread &user : users) user.join();
+  stats = pool.checkpoint(config).get();
+  if (wrong != 0 || stats.skipped != 0 ||
+      pool.getBufStats().cleanevictions != 0) {
+    PRINT_ERROR("ERROR :: CHECKPOINT DISTURBED CONCURRENT USERS");
+  }
+  pool.flushFile(file1);
+
+  std::cout << "Test 33 passed"
+            << "\n";
+}
+
+void test34() {
+  const std::string filename11 = "test.11";
+  try {
+    File::remove(filename11);
+  } catch (const FileNotFoundException &e) {
+  }
+
+  // Copies share the open file and the last one closes it
+  {
+    File file11 = File::create(filename11);
+    const FileId id = file11.id();
+    File copy(file11);
+    File assigned;
+    if (assigned.isValid() || assigned.id() != 0 ||
+        !assigned.filename().empty() || assigned == file11) {
+      PRINT_ERROR("ERROR :: EMPTY FILE NOT INVALID");
+    }
+    assigned = copy;
+    assigned = assigned;
+    if (!assigned.isValid() || assigned != file11 || copy.id() != id ||
+        assigned.filename() != filename11 ||
+        File::open(filename11).id() != id) {
+      PRINT_ERROR("ERROR :: FILE COPIES DO NOT SHARE THE OPEN FILE");
+    }
+    file11 = File();
+    copy = File();
+    if (!File::isOpen(filename11) || assigned.id() != id) {
+      PRINT_ERROR("ERROR :: FILE CLOSED WITH A COPY LEFT");
+    }
+  }
+  if (File::isOpen(filename11) || !File::exists(filename11)) {
+    PRINT_ERROR("ERROR :: FILE NOT CLOSED BY ITS LAST COPY");
+  }
+
+  // A file opened anew gets a new identifier
+  FileId first;
+  {
+    File file11 = File::open(filename11);
+    first = file11.id();
+  }
+  if (File::open(filename11).id() == first) {
+    PRINT_ERROR("ERROR :: REOPENED FILE KEPT ITS IDENTIFIER");
+  }
+  File::remove(filename11);
+  if (File::exists(filename11)) {
+    PRINT_ERROR("ERROR :: REMOVED FILE STILL EXISTS");
+  }
+
+  std::cout << "Test 34 passed"
+            << "\n";
+}
+
+void test35(File &file1) {
+  // Frames reserved for growing are not swept over by any policy
+  const ReplacementPolicyType types[] = {ReplacementPolicyType::CLOCK,
+                                         ReplacementPolicyType::TWO_QUEUE,
+                                         ReplacementPolicyType::CLOCK_PRO};
+  const std::uint32_t frames = 16;
+  AllocConfig alloc;
+  alloc.maxFrames = 64 * frames;
+  for (const ReplacementPolicyType type : types) {
+    for (std::uint32_t partitions = 1; partitions <= 2; partitions++) {
+      NumaConfig numa;
+      numa.partitions = partitions;
+      BufMgr pool(frames, type, BackgroundWriterConfig(), IoEngineConfig(),
+                  alloc, numa);
+      for (int round = 0; round < 2; round++) {
+        // grown and shrunk back, the policy keeps to the frames in use
+        if (round == 1 && (pool.resize(4 * frames) != 4 * frames ||
+                           pool.resize(frames) != frames)) {
+          PRINT_ERROR("ERROR :: POOL DID NOT RESIZE");
+        }
+        pool.clearBufStats();
+        for (PageId k = 0; k < 200; k++) {
+          const PageId pageNo = 1 + k % 50;
+          pool.readPage(file1, pageNo, page);
+          pool.unPinPage(file1, pageNo, false);
+        }
+        const BufStats stats = pool.getBufStats();
+        if (stats.victims == 0 ||
+            stats.sweepsteps > stats.victims * 2 * frames) {
+          PRINT_ERROR("ERROR :: SWEEP VISITED FRAMES NOT IN USE");
+        }
+      }
+      pool.flushFile(file1);
+    }
+  }
+
+  std::cout << "Test 35 passed"
+            << "\n";
+}
+
+void test36() {
+  const FileBackendType backend = File::defaultBackend();
+  File::setDefaultBackend(FileBackendType::POSIX);
+  const std::string filename12 = "test.12";
+  try {
+    File::remove(filename12);
+  } catch (const FileNotFoundException &e) {
+  }
+  PageId pid12[5];
+  {
+    File file12 = File::create(filename12);
+    for (int k = 0; k < 5; k++) {
+      Page new_page = file12.allocatePage();
+      new_page.insertRecord("frame");
+      file12.writePage(new_page);
+      pid12[k] = new_page.page_number();
+    }
+  }
+  {
+    // Damage the last page
+    std::fstream raw(filename12,
+                     std::ios::in | std::ios::out | std::ios::binary);
+    const std::streamoff last =
+        static_cast<std::streamoff>(pid12[4] + 1) * Page::SIZE - 1;
+    char byte;
+    raw.seekg(last);
+    raw.read(&byte, 1);
+    byte ^= 0x20;
+    raw.seekp(last);
+    raw.write(&byte, 1);
+  }
+
+  // A failed read gives its frame back, so the pool never runs short
+  {
+    File file12 = File::open(filename12);
+    BufMgr small(4);
+    for (int k = 0; k < 3; k++) small.readPage(file12, pid12[k], page);
+    int failed = 0;
+    for (int k = 0; k < 20; k++) {
+      try {
+        if (k % 2 == 0) {
+          small.readPage(file12, pid12[4], page);
+        } else {
+          Page *pages[1];
+          small.readPages(file12, &pid12[4], 1, pages);
+        }
+      } catch (const PageChecksumException &e) {
+        failed++;
+      }
+    }
+    small.readPage(file12, pid12[3], page);
+    if (failed != 20 || small.getBufStats().victims != 0 ||
+        small.unpinnedFrames() != 0) {
+      PRINT_ERROR("ERROR :: FAILED READS KEPT THEIR FRAMES");
+    }
+    for (int k = 0; k < 4; k++) small.unPinPage(file12, pid12[k], false);
+  }
+  File::remove(filename12);
+  File::setDefaultBackend(backend);
+
+  std::cout << "Test 36 passed"
+            << "\n";
+}
+
+void test37() {
+  const std::string filename14 = "test.14";
+  try {
+    File::remove(filename14);
+  } catch (const FileNotFoundException &e) {
+  }
+  PageId pid14[80];
+  {
+    File file14 = File::create(filename14);
+    for (int k = 0; k < 80; k++) {
+      pid14[k] = file14.allocatePage().page_number();
+    }
+  }
+
+  // A hot set of 4 pages asked for again and again among other pages, then
+  // a scan through 50 pages once, more than the 16 frames.  Only clock
+  // lets the scan push the hot set out.
+  File file14 = File::open(filename14);
+  const ReplacementPolicyType types[] = {ReplacementPolicyType::CLOCK,
+                                         ReplacementPolicyType::TWO_QUEUE,
+                                         ReplacementPolicyType::CLOCK_PRO};
+  for (const ReplacementPolicyType type : types) {
+    BufMgr pool(16, type);
+    for (int round = 0; round < 6; round++) {
+      for (int k = 0; k < 4; k++) {
+        pool.readPage(file14, pid14[k], page);
+        pool.unPinPage(file14, pid14[k], false);
+      }
+      for (int k = 0; k < 6; k++) {
+        const PageId other = pid14[10 + (round * 6 + k) % 20];
+        pool.readPage(file14, other, page);
+        pool.unPinPage(file14, other, false);
+      }
+    }
+    for (int k = 30; k < 80; k++) {
+      pool.readPage(file14, pid14[k], page);
+      pool.unPinPage(file14, pid14[k], false);
+    }
+    const std::uint64_t reads = pool.getBufStats().diskreads;
+    for (int k = 0; k < 4; k++) {
+      pool.readPage(file14, pid14[k], page);
+      pool.unPinPage(file14, pid14[k], false);
+    }
+    const bool kept = pool.getBufStats().diskreads == reads;
+    if (type != ReplacementPolicyType::CLOCK && !kept) {
+      PRINT_ERROR("ERROR :: SCAN FLUSHED THE HOT SET");
+    }
+    if (type == ReplacementPolicyType::CLOCK && kept) {
+      PRINT_ERROR("ERROR :: CLOCK KEPT THE HOT SET THROUGH A SCAN");
+    }
+    pool.flushFile(file14);
+  }
+  file14 = File();
+  File::remove(filename14);
+
+  std::cout << "Test 37 passed"
+            << "\n";
+}
+
+void test38() {
+  const std::string filename15 = "test.15";
+  try {
+    File::remove(filename15);
+  } catch (const FileNotFoundException &e) {
+  }
+  File file15 = File::create(filename15);
+  PageId pid15[16];
+  for (int k = 0; k < 16; k++) {
+    pid15[k] = file15.allocatePage().page_number();
+  }
+
+  // The last of 16 pages dirtied in 32 frames reaches the high watermark,
+  // which wakes the writer long before its interval is up; until then it
+  // does not run
+  BackgroundWriterConfig writer;
+  writer.highWatermark = 0.5;
+  writer.lowWatermark = 0.1;
+  writer.intervalMs = 60000;
+  std::unique_ptr<BufMgr> pool(
+      new BufMgr(32, ReplacementPolicyType::CLOCK, writer));
+  for (int k = 0; k < 16; k++) {
+    pool->readPage(file15, pid15[k], page);
+    page->insertRecord("written back");
+    pool->unPinPage(file15, pid15[k], true);
+  }
+  const std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  // the writer clears the dirty bits before its writes are done
+  while ((pool->summarize().dirty > 3 ||
+          pool->getBufStats().backgroundwrites < 13) &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  // Down to the low watermark of 3 frames, the pages written on disk and
+  // none of them evicted
+  const BufStats stats = pool->getBufStats();
+  if (pool->summarize().dirty > 3 || stats.backgroundwrites < 13) {
+    PRINT_ERROR("ERROR :: BACKGROUND WRITER DID NOT WRITE DIRTY PAGES");
+  }
+  if (stats.victims != 0 || stats.cleanevictions != 0 ||
+      stats.dirtyevictions != 0 || pool->summarize().valid != 16) {
+    PRINT_ERROR("ERROR :: BACKGROUND WRITER EVICTED PAGES");
+  }
+  int on_disk = 0;
+  for (int k = 0; k < 16; k++) {
+    Page written = file15.readPage(pid15[k]);
+    for (PageIterator it = written.begin(); it != written.end(); ++it) {
+      if (*it == "written back") on_disk++;
+    }
+  }
+  if (on_disk < 13) {
+    PRINT_ERROR("ERROR :: BACKGROUND WRITES NOT ON DISK");
+  }
+
+  // Stopping wakes the idle writer rather than waiting out its interval
+  pool->flushFile(file15);
+  std::future<void> stopped =
+      std::async(std::launch::async, [&pool]() { pool.reset(); });
+  if (stopped.wait_for(std::chrono::seconds(10)) !=
+      std::future_status::ready) {
+    PRINT_ERROR("ERROR :: BACKGROUND WRITER NOT STOPPED");
+  }
+  file15 = File();
+  File::remove(filename15);
+
+  std::cout << "Test 38 passed"
+            << "\n";
+}
+
+void test39() {
+  const std::string filename16 = "test.16";
+  try {
+    File::remove(filename16);
+  } catch (const FileNotFoundException &e) {
+  }
+  File file16 = File::create(filename16);
+  PageId pid16[4];
+  for (int k = 0; k < 4; k++) {
+    Page new_page = file16.allocatePage();
+    new_page.insertRecord("read");
+    file16.writePage(new_page);
+    pid16[k] = new_page.page_number();
+  }
+
+  {
+    AllocConfig alloc;
+    alloc.pinWaitMs = 10000;
+    BufMgr small(3, ReplacementPolicyType::CLOCK, BackgroundWriterConfig(),
+                 IoEngineConfig(), alloc);
+    small.readPage(file16, pid16[2], page);
+    small.readPage(file16, pid16[3], page);
+
+    // The batch gets a frame for its first page, then waits for one for the
+    // second in the pinned full pool; a reader of the first page meanwhile
+    // waits for the batch instead of reading the page as well
+    std::future<void> batch =
+        std::async(std::launch::async, [&small, &file16, &pid16]() {
+          Page *pages[2];
+          small.readPages(file16, pid16, 2, pages);
+          small.unPinPage(file16, pid16[0], false);
+          small.unPinPage(file16, pid16[1], false);
+        });
+    while (small.getBufStats().allpinned == 0) std::this_thread::yield();
+    std::future<Page *> reader =
+        std::async(std::launch::async, [&small, &file16, &pid16]() {
+          Page *read;
+          small.readPage(file16, pid16[0], read);
+          return read;
+        });
+    if (reader.wait_for(std::chrono::milliseconds(50)) !=
+        std::future_status::timeout) {
+      PRINT_ERROR("ERROR :: PAGE BEING READ IN WAS NOT WAITED FOR");
+    }
+    small.unPinPage(file16, pid16[3], false);
+    batch.get();
+    Page *first = reader.get();
+    if (first->page_number() != pid16[0] ||
+        small.getBufStats().diskreads != 4) {
+      PRINT_ERROR("ERROR :: PAGE BEING READ IN WAS READ TWICE");
+    }
+
+    // The reader's change is what is left of the page once it is evicted
+    // and read again
+    first->insertRecord("changed");
+    small.unPinPage(file16, pid16[0], true);
+    small.unPinPage(file16, pid16[2], false);
+    small.flushFile(file16);
+    small.readPage(file16, pid16[0], page);
+    int changed = 0;
+    for (PageIterator it = page->begin(); it != page->end(); ++it) {
+      if (*it == "changed") changed++;
+    }
+    small.unPinPage(file16, pid16[0], false);
+    if (changed != 1) {
+      PRINT_ERROR("ERROR :: CHANGE TO A PAGE READ IN TWICE WAS LOST");
+    }
+  }
+  file16 = File();
+  File::remove(filename16);
+
+  std::cout << "Test 39 passed"
+            << "\n";
+}
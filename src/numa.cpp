@@ -0,0 +1,83 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "numa.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+
+namespace badgerdb {
+
+/**
+ * Calls to currentNumaNode() between two lookups of a thread's node.
+ */
+static const std::uint32_t NODE_REFRESH_CALLS = 256;
+
+/**
+ * MPOL_PREFERRED of <numaif.h>, which needs libnuma's headers.
+ */
+static const int PREFER_NODE_POLICY = 1;
+
+/**
+ * Returns one more than the highest node number in the list of online nodes
+ * sysfs gives, like "0-1,3".
+ */
+static std::uint32_t readNodeCount() {
+  std::ifstream online("/sys/devices/system/node/online");
+  std::string list;
+  if (!(online >> list)) return 1;
+
+  std::uint32_t count = 1;
+  std::string::size_type start = 0;
+  while (start < list.size()) {
+    std::string::size_type end = list.find_first_of(",-", start);
+    if (end == std::string::npos) end = list.size();
+    const unsigned long node =
+        std::strtoul(list.substr(start, end - start).c_str(), NULL, 10);
+    count = std::max<std::uint32_t>(count, node + 1);
+    start = end + 1;
+  }
+  return count;
+}
+
+std::uint32_t numaNodeCount() {
+  static const std::uint32_t count = readNodeCount();
+  return count;
+}
+
+std::uint32_t currentNumaNode() {
+  thread_local std::uint32_t node = 0;
+  thread_local std::uint32_t calls = 0;
+  if (calls++ % NODE_REFRESH_CALLS == 0) {
+#ifdef SYS_getcpu
+    unsigned cpu = 0;
+    unsigned current = 0;
+    if (syscall(SYS_getcpu, &cpu, &current, NULL) == 0) node = current;
+#endif
+  }
+  return node;
+}
+
+void preferNumaNode(void *memory, const std::size_t size,
+                    const std::uint32_t node) {
+#ifdef SYS_mbind
+  unsigned long mask = 0;
+  if (node >= sizeof(mask) * 8) return;
+  mask = 1UL << node;
+  // best effort, like the huge page hint of FrameArena
+  syscall(SYS_mbind, memory, size, PREFER_NODE_POLICY, &mask,
+          sizeof(mask) * 8 + 1, 0);
+#endif
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,41 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+ * Returns the number of NUMA nodes of the host, 1 if it has no NUMA or the
+ * kernel does not say.  Read once, on the first call.
+ */
+std::uint32_t numaNodeCount();
+
+/**
+ * Returns the NUMA node the calling thread runs on, 0 if it cannot be told.
+ * The node is looked up again every few hundred calls, so a thread that
+ * moves to another node is noticed soon without a system call per page
+ * access.
+ */
+std::uint32_t currentNumaNode();
+
+/**
+ * Asks the kernel to place memory not touched yet on a NUMA node.  Only a
+ * hint: the memory is usable whether or not it is followed.
+ *
+ * @param memory  Start of the memory, aligned to the OS page size
+ * @param size    Size of the memory in bytes
+ * @param node    Node to place it on
+ */
+void preferNumaNode(void *memory, const std::size_t size,
+                    const std::uint32_t node);
+
+}  // namespace badgerdb
@@ -8,8 +8,10 @@
 
 #include "page.h"
 
-#include <cassert>
+#include <algorithm>
+#include <cstring>
 
+#include "crc32c.h"
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/invalid_record_exception.h"
 #include "exceptions/invalid_slot_exception.h"
@@ -18,44 +20,176 @@
 
 namespace badgerdb {
 
-Page::Page() { initialize(); }
+Page::Page() {
+  bind(storage_);
+  initialize();
+}
+
+Page::Page(char *memory) {
+  bind(memory);
+  initialize();
+}
+
+Page::Page(View, const char *memory) { bind(const_cast<char *>(memory)); }
+
+Page::Page(const Page &other) {
+  bind(storage_);
+  std::memcpy(bytes(), other.bytes(), SIZE);
+}
+
+Page::Page(Page &&other) noexcept {
+  if (other.ownsMemory()) {
+    bind(storage_);
+    std::memcpy(bytes(), other.bytes(), SIZE);
+    return;
+  }
+  bind(other.bytes());
+  other.header_ = nullptr;
+  other.data_ = nullptr;
+}
+
+Page &Page::operator=(const Page &rhs) {
+  if (this != &rhs) {
+    if (header_ == nullptr) bind(storage_);
+    std::memcpy(bytes(), rhs.bytes(), SIZE);
+  }
+  return *this;
+}
+
+Page &Page::operator=(Page &&rhs) noexcept {
+  if (this == &rhs) return *this;
+  if (header_ == nullptr && !rhs.ownsMemory()) {
+    bind(rhs.bytes());
+    rhs.header_ = nullptr;
+    rhs.data_ = nullptr;
+  } else {
+    if (header_ == nullptr) bind(storage_);
+    std::memcpy(bytes(), rhs.bytes(), SIZE);
+  }
+  return *this;
+}
+
+void Page::bind(char *memory) {
+  header_ = reinterpret_cast<PageHeader *>(memory);
+  data_ = memory + sizeof(PageHeader);
+}
 
 void Page::initialize() {
-  header_.free_space_lower_bound = 0;
-  header_.free_space_upper_bound = DATA_SIZE;
-  header_.num_slots = 0;
-  header_.num_free_slots = 0;
-  header_.current_page_number = INVALID_NUMBER;
-  header_.next_page_number = INVALID_NUMBER;
-  data_.assign(DATA_SIZE, char());
+  header_->first_free_slot = INVALID_SLOT;
+  header_->free_space_upper_bound = DATA_SIZE;
+  header_->num_slots = 0;
+  header_->fragmented_bytes = 0;
+  header_->current_page_number = INVALID_NUMBER;
+  header_->next_page_number = INVALID_NUMBER;
+  header_->checksum = 0;
+  header_->reserved = 0;
+  header_->lsn = 0;
+  std::memset(data_, 0, DATA_SIZE);
 }
 
 RecordId Page::insertRecord(const std::string &record_data) {
+  return insertRecord(RecordView(record_data));
+}
+
+RecordId Page::insertRecord(const RecordView &record_data) {
   if (!hasSpaceForRecord(record_data)) {
-    throw InsufficientSpaceException(page_number(), record_data.length(),
+    throw InsufficientSpaceException(page_number(), record_data.length,
                                      getFreeSpace());
   }
+  if (header_->first_free_slot == INVALID_SLOT) {
+    reserveContiguousSpace(record_data.length + sizeof(PageSlot));
+  }
   const SlotId slot_number = getAvailableSlot();
   insertRecordInSlot(slot_number, record_data);
   return {page_number(), slot_number};
 }
 
+std::size_t Page::insertRecords(const RecordView *records,
+                                const std::size_t count,
+                                RecordId *record_ids) {
+  std::size_t inserted = 0;
+  for (; inserted < count && header_->first_free_slot != INVALID_SLOT;
+       ++inserted) {
+    if (!hasSpaceForRecord(records[inserted])) return inserted;
+    const RecordId record_id = insertRecord(records[inserted]);
+    if (record_ids != nullptr) record_ids[inserted] = record_id;
+  }
+
+  // Count the records that fit in new slots, then place them all.
+  std::size_t needed = 0;
+  std::size_t end = inserted;
+  while (end < count &&
+         needed + records[end].length + sizeof(PageSlot) <= getFreeSpace()) {
+    needed += records[end].length + sizeof(PageSlot);
+    ++end;
+  }
+  reserveContiguousSpace(needed);
+  PageOffset upper_bound = header_->free_space_upper_bound;
+  for (; inserted < end; ++inserted) {
+    const RecordView &record = records[inserted];
+    PageSlot *slot = getSlot(++header_->num_slots);
+    upper_bound -= record.length;
+    slot->used = true;
+    slot->item_offset = upper_bound;
+    slot->item_length = record.length;
+    if (record.length > 0) {
+      std::memcpy(data_ + upper_bound, record.data, record.length);
+    }
+    if (record_ids != nullptr) {
+      record_ids[inserted] = {page_number(), header_->num_slots};
+    }
+  }
+  header_->free_space_upper_bound = upper_bound;
+  return inserted;
+}
+
 std::string Page::getRecord(const RecordId &record_id) const {
   validateRecordId(record_id);
   const PageSlot *slot = getSlot(record_id.slot_number);
-  return data_.substr(slot->item_offset, slot->item_length);
+  return std::string(data_ + slot->item_offset, slot->item_length);
+}
+
+RecordView Page::getRecordView(const RecordId &record_id) const {
+  validateRecordId(record_id);
+  const PageSlot *slot = getSlot(record_id.slot_number);
+  return RecordView(data_ + slot->item_offset, slot->item_length);
 }
 
 void Page::updateRecord(const RecordId &record_id,
                         const std::string &record_data) {
+  updateRecord(record_id, RecordView(record_data));
+}
+
+void Page::updateRecord(const RecordId &record_id,
+                        const RecordView &record_data) {
   validateRecordId(record_id);
-  const PageSlot *slot = getSlot(record_id.slot_number);
+  PageSlot *slot = getSlot(record_id.slot_number);
+  if (record_data.length <= slot->item_length) {
+    // Fits where the old version is; what is left over becomes a hole.
+    if (record_data.length > 0) {
+      std::memmove(data_ + slot->item_offset, record_data.data,
+                   record_data.length);
+    }
+    const PageOffset left_over = slot->item_length - record_data.length;
+    std::memset(data_ + slot->item_offset + record_data.length, 0, left_over);
+    header_->fragmented_bytes += left_over;
+    slot->item_length = record_data.length;
+    return;
+  }
   const std::size_t free_space_after_delete =
       getFreeSpace() + slot->item_length;
-  if (record_data.length() > free_space_after_delete) {
-    throw InsufficientSpaceException(page_number(), record_data.length(),
+  if (record_data.length > free_space_after_delete) {
+    throw InsufficientSpaceException(page_number(), record_data.length,
                                      free_space_after_delete);
   }
+  if (record_data.data >= bytes() && record_data.data < bytes() + SIZE) {
+    // Deleting the old version clears it and inserting may compact the page,
+    // so a view of a record on the page has to be copied first.
+    const std::string copy = record_data.str();
+    deleteRecord(record_id, false /* allow_slot_compaction */);
+    insertRecordInSlot(record_id.slot_number, RecordView(copy));
+    return;
+  }
   // We have to disallow slot compaction here because we're going to place the
   // record data in the same slot, and compaction might delete the slot if we
   // permit it.
@@ -63,6 +197,26 @@ void Page::updateRecord(const RecordId &record_id,
   insertRecordInSlot(record_id.slot_number, record_data);
 }
 
+void Page::patchRecord(const RecordId &record_id, const std::size_t offset,
+                       const std::string &bytes) {
+  patchRecord(record_id, offset, RecordView(bytes));
+}
+
+void Page::patchRecord(const RecordId &record_id, const std::size_t offset,
+                       const RecordView &bytes) {
+  validateRecordId(record_id);
+  const PageSlot *slot = getSlot(record_id.slot_number);
+  if (offset > slot->item_length ||
+      bytes.length > slot->item_length - offset) {
+    throw InsufficientSpaceException(page_number(), offset + bytes.length,
+                                     slot->item_length);
+  }
+  if (bytes.length > 0) {
+    std::memmove(data_ + slot->item_offset + offset, bytes.data,
+                 bytes.length);
+  }
+}
+
 void Page::deleteRecord(const RecordId &record_id) {
   deleteRecord(record_id, true /* allow_slot_compaction */);
 }
@@ -71,60 +225,73 @@ void Page::deleteRecord(const RecordId &record_id,
                         const bool allow_slot_compaction) {
   validateRecordId(record_id);
   PageSlot *slot = getSlot(record_id.slot_number);
-  data_.replace(slot->item_offset, slot->item_length, slot->item_length, '\0');
-
-  // Compact the data by removing the hole left by this record (if necessary).
-  std::uint16_t move_offset = slot->item_offset;
-  std::size_t move_bytes = 0;
-  for (SlotId i = 1; i <= header_.num_slots; ++i) {
-    PageSlot *other_slot = getSlot(i);
-    if (other_slot->used && other_slot->item_offset < slot->item_offset) {
-      if (other_slot->item_offset < move_offset) {
-        move_offset = other_slot->item_offset;
-      }
-      move_bytes += other_slot->item_length;
-      // Update the slot for the other data to reflect the soon-to-be-new
-      // location.
-      other_slot->item_offset += slot->item_length;
-    }
+  std::memset(data_ + slot->item_offset, 0, slot->item_length);
+
+  // The data stays where it is as a hole, unless it borders on the free space.
+  if (slot->item_offset == header_->free_space_upper_bound) {
+    header_->free_space_upper_bound += slot->item_length;
+  } else {
+    header_->fragmented_bytes += slot->item_length;
   }
-  // If we have data to move, shift it to the right.
-  if (move_bytes > 0) {
-    const std::string &data_to_move = data_.substr(move_offset, move_bytes);
-    data_.replace(move_offset + slot->item_length, move_bytes, data_to_move);
+
+  if (!allow_slot_compaction || record_id.slot_number != header_->num_slots) {
+    pushFreeSlot(record_id.slot_number);
+    return;
   }
-  header_.free_space_upper_bound += slot->item_length;
 
-  // Mark slot as unused.
-  slot->used = false;
-  slot->item_offset = 0;
-  slot->item_length = 0;
-  ++header_.num_free_slots;
-
-  if (allow_slot_compaction && record_id.slot_number == header_.num_slots) {
-    // Last slot in the list, so we need to free any unused slots that are at
-    // the end of the slot list.
-    int num_slots_to_delete = 1;
-    for (SlotId i = 1; i < header_.num_slots; ++i) {
-      // Traverse list backwards, looking for unused slots.
-      const PageSlot *other_slot = getSlot(header_.num_slots - i);
-      if (!other_slot->used) {
-        ++num_slots_to_delete;
-      } else {
-        // Stop at the first used slot we find, since we can't move used
-        // slots without affecting record IDs.
-        break;
-      }
-    }
-    header_.num_slots -= num_slots_to_delete;
-    header_.num_free_slots -= num_slots_to_delete;
-    header_.free_space_lower_bound -= sizeof(PageSlot) * num_slots_to_delete;
+  // Last slot in the list, so it goes away along with any unused slots right
+  // before it.  We stop at the first used slot we find, since we can't move
+  // used slots without affecting record IDs.  Every slot dropped here was
+  // put on the free chain once, so this is constant time amortized.
+  std::memset(slot, 0, sizeof(PageSlot));
+  --header_->num_slots;
+  while (header_->num_slots > 0 && !getSlot(header_->num_slots)->used) {
+    unlinkFreeSlot(header_->num_slots);
+    std::memset(getSlot(header_->num_slots), 0, sizeof(PageSlot));
+    --header_->num_slots;
   }
 }
 
 bool Page::hasSpaceForRecord(const std::string &record_data) const {
-  std::size_t record_size = record_data.length();
-  if (header_.num_free_slots == 0) {
+  return hasSpaceForRecord(RecordView(record_data));
+}
+
+void Page::compact() {
+  if (header_->fragmented_bytes == 0) return;
+
+  // Move the records in order of decreasing offset, so each one only moves
+  // up into space already vacated.
+  SlotId order[DATA_SIZE / sizeof(PageSlot)];
+  std::size_t num_records = 0;
+  for (SlotId i = 1; i <= header_->num_slots; ++i) {
+    if (getSlot(i)->used) order[num_records++] = i;
+  }
+  std::sort(order, order + num_records, [this](SlotId a, SlotId b) {
+    return getSlot(a)->item_offset > getSlot(b)->item_offset;
+  });
+  const PageOffset old_upper_bound = header_->free_space_upper_bound;
+  PageOffset upper_bound = DATA_SIZE;
+  for (std::size_t i = 0; i < num_records; ++i) {
+    PageSlot *slot = getSlot(order[i]);
+    upper_bound -= slot->item_length;
+    if (upper_bound != slot->item_offset) {
+      std::memmove(data_ + upper_bound, data_ + slot->item_offset,
+                   slot->item_length);
+      slot->item_offset = upper_bound;
+    }
+  }
+  std::memset(data_ + old_upper_bound, 0, upper_bound - old_upper_bound);
+  header_->free_space_upper_bound = upper_bound;
+  header_->fragmented_bytes = 0;
+}
+
+void Page::reserveContiguousSpace(const std::size_t length) {
+  if (getContiguousFreeSpace() < length) compact();
+}
+
+bool Page::hasSpaceForRecord(const RecordView &record_data) const {
+  std::size_t record_size = record_data.length;
+  if (header_->first_free_slot == INVALID_SLOT) {
     record_size += sizeof(PageSlot);
   }
   return record_size <= getFreeSpace();
@@ -141,45 +308,123 @@ const PageSlot *Page::getSlot(const SlotId slot_number) const {
 }
 
 SlotId Page::getAvailableSlot() {
-  SlotId slot_number = INVALID_SLOT;
-  if (header_.num_free_slots > 0) {
-    // Have an allocated but unused slot that we can reuse.
-    for (SlotId i = 1; i <= header_.num_slots; ++i) {
-      const PageSlot *slot = getSlot(i);
-      if (!slot->used) {
-        // We don't decrement the number of free slots until someone
-        // actually puts data in the slot.
-        slot_number = i;
-        break;
-      }
-    }
-  } else {
+  if (header_->first_free_slot == INVALID_SLOT) {
     // Have to allocate a new slot.
-    slot_number = header_.num_slots + 1;
-    ++header_.num_slots;
-    ++header_.num_free_slots;
-    header_.free_space_lower_bound = sizeof(PageSlot) * header_.num_slots;
+    ++header_->num_slots;
+    pushFreeSlot(header_->num_slots);
   }
-  assert(slot_number != INVALID_SLOT);
-  return slot_number;
+  // We don't take the slot off the chain until someone actually puts data in
+  // it.
+  return header_->first_free_slot;
+}
+
+void Page::pushFreeSlot(const SlotId slot_number) {
+  PageSlot *slot = getSlot(slot_number);
+  slot->used = false;
+  slot->item_offset = header_->first_free_slot;
+  slot->item_length = INVALID_SLOT;
+  if (header_->first_free_slot != INVALID_SLOT) {
+    getSlot(header_->first_free_slot)->item_length = slot_number;
+  }
+  header_->first_free_slot = slot_number;
+}
+
+void Page::unlinkFreeSlot(const SlotId slot_number) {
+  const PageSlot *slot = getSlot(slot_number);
+  const SlotId next = slot->item_offset;
+  const SlotId previous = slot->item_length;
+  if (previous != INVALID_SLOT) {
+    getSlot(previous)->item_offset = next;
+  } else {
+    header_->first_free_slot = next;
+  }
+  if (next != INVALID_SLOT) getSlot(next)->item_length = previous;
+}
+
+void Page::rebuildHeader() {
+  // Pushed from the top down, so the lowest unused slot ends up first.
+  header_->first_free_slot = INVALID_SLOT;
+  std::size_t record_bytes = 0;
+  for (SlotId i = header_->num_slots; i >= 1; --i) {
+    const PageSlot *slot = getSlot(i);
+    if (slot->used) {
+      record_bytes += slot->item_length;
+    } else {
+      pushFreeSlot(i);
+    }
+  }
+  header_->fragmented_bytes =
+      DATA_SIZE - header_->free_space_upper_bound - record_bytes;
+}
+
+bool Page::widenHeader(const std::size_t old_header_size) {
+  const std::size_t old_data_size = SIZE - old_header_size;
+  const std::size_t slot_bytes = header_->num_slots * sizeof(PageSlot);
+  if (slot_bytes > DATA_SIZE) return false;
+  char old[SIZE];
+  std::memcpy(old, bytes(), SIZE);
+  const char *old_data = old + old_header_size;
+  const PageSlot *old_slots = reinterpret_cast<const PageSlot *>(old_data);
+
+  // Check the records fit before anything is overwritten.
+  std::size_t record_bytes = 0;
+  for (SlotId i = 0; i < header_->num_slots; ++i) {
+    if (!old_slots[i].used) continue;
+    if (old_slots[i].item_offset + old_slots[i].item_length > old_data_size) {
+      return false;
+    }
+    record_bytes += old_slots[i].item_length;
+  }
+  if (slot_bytes + record_bytes > DATA_SIZE) return false;
+
+  // fields newer than the old header start out 0
+  std::memset(bytes() + old_header_size, 0,
+              sizeof(PageHeader) - old_header_size);
+  header_->checksum = 0;
+  std::memset(data_, 0, DATA_SIZE);
+  std::memcpy(data_, old_data, slot_bytes);
+  PageOffset upper_bound = DATA_SIZE;
+  for (SlotId i = 1; i <= header_->num_slots; ++i) {
+    PageSlot *slot = getSlot(i);
+    if (!slot->used) continue;
+    upper_bound -= slot->item_length;
+    std::memcpy(data_ + upper_bound, old_data + slot->item_offset,
+                slot->item_length);
+    slot->item_offset = upper_bound;
+  }
+  header_->free_space_upper_bound = upper_bound;
+  header_->fragmented_bytes = 0;
+  return true;
+}
+
+std::uint32_t Page::computeChecksum(const PageHeader &header,
+                                    const char *data) {
+  std::uint32_t crc = crc32c(&header, offsetof(PageHeader, next_page_number));
+  crc = crc32c(&header.lsn, sizeof(header.lsn), crc);
+  crc = crc32c(data, DATA_SIZE, crc);
+  // 0 stands for no checksum.
+  return crc != 0 ? crc : 1;
 }
 
 void Page::insertRecordInSlot(const SlotId slot_number,
-                              const std::string &record_data) {
-  if (slot_number > header_.num_slots || slot_number == INVALID_SLOT) {
+                              const RecordView &record_data) {
+  if (slot_number > header_->num_slots || slot_number == INVALID_SLOT) {
     throw InvalidSlotException(page_number(), slot_number);
   }
   PageSlot *slot = getSlot(slot_number);
   if (slot->used) {
     throw SlotInUseException(page_number(), slot_number);
   }
-  const int record_length = record_data.length();
+  const int record_length = record_data.length;
+  reserveContiguousSpace(record_length);
+  unlinkFreeSlot(slot_number);
   slot->used = true;
   slot->item_length = record_length;
-  slot->item_offset = header_.free_space_upper_bound - record_length;
-  header_.free_space_upper_bound = slot->item_offset;
-  --header_.num_free_slots;
-  data_.replace(slot->item_offset, slot->item_length, record_data);
+  slot->item_offset = header_->free_space_upper_bound - record_length;
+  header_->free_space_upper_bound = slot->item_offset;
+  if (record_length > 0) {
+    std::memcpy(data_ + slot->item_offset, record_data.data, record_length);
+  }
 }
 
 void Page::validateRecordId(const RecordId &record_id) const {
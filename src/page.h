@@ -14,8 +14,17 @@
 #include <memory>
 #include <string>
 
+#include "record_view.h"
 #include "types.h"
 
+#ifndef BADGERDB_PAGE_SIZE
+/**
+ * Page size in bytes BadgerDB is built with, see Page::SIZE; set it with
+ * make PAGE_SIZE=<bytes>.
+ */
+#define BADGERDB_PAGE_SIZE 8192
+#endif
+
 namespace badgerdb {
 
 /**
@@ -26,16 +35,18 @@ namespace badgerdb {
  */
 struct PageHeader {
   /**
-   * Lower bound of the free space.  This is the offset of the first unused byte
-   * after the slot array.
+   * First slot of the chain of slots that are allocated but not in use, or
+   * Page::INVALID_SLOT.  The chain is doubly linked through the unused slots
+   * themselves, see PageSlot.  (Before format version 3 this was the lower
+   * bound of the free space, which is always just past the slot array.)
    */
-  std::uint16_t free_space_lower_bound;
+  SlotId first_free_slot;
 
   /**
    * Upper bound of the free space.  This is the offset of the last unused byte
    * before the first data record.
    */
-  std::uint16_t free_space_upper_bound;
+  PageOffset free_space_upper_bound;
 
   /**
    * Number of slots currently allocated.  This number may include slots which
@@ -45,9 +56,12 @@ struct PageHeader {
   SlotId num_slots;
 
   /**
-   * Number of slots allocated but not in use.
+   * Number of bytes between the free space upper bound and the end of the
+   * page that belong to no record: holes left by deletes and by updates that
+   * shrank a record, given back by Page::compact().  (Before format version 4
+   * this was the number of unused slots, when pages were always compact.)
    */
-  SlotId num_free_slots;
+  PageOffset fragmented_bytes;
 
   /**
    * Number of the page within the file.
@@ -59,6 +73,28 @@ struct PageHeader {
    */
   PageId next_page_number;
 
+  /**
+   * CRC-32C of the page as last written to its file, or 0 if the page was
+   * written without one (see File::setChecksums()).  It covers the rest of
+   * the header up to next_page_number, the LSN and the data;
+   * next_page_number is left out as the file relinks pages by writing just
+   * that field.  (Added in format version 5.)
+   */
+  std::uint32_t checksum;
+
+  /**
+   * Unused, 0; keeps lsn aligned.
+   */
+  std::uint32_t reserved;
+
+  /**
+   * LSN of the last log record describing a change to the page, or 0 if
+   * none did (see LogManager).  The buffer pool does not write the page
+   * back before the log is durable up to here.  Covered by the checksum.
+   * (Added in format version 6.)
+   */
+  Lsn lsn;
+
   /**
    * Returns true if this page header is equal to the other.
    *
@@ -66,7 +102,8 @@ struct PageHeader {
    * @return  True if the other header is equal to this one.
    */
   bool operator==(const PageHeader &rhs) const {
-    return num_slots == rhs.num_slots && num_free_slots == rhs.num_free_slots &&
+    return num_slots == rhs.num_slots &&
+           fragmented_bytes == rhs.fragmented_bytes &&
            current_page_number == rhs.current_page_number &&
            next_page_number == rhs.next_page_number;
   }
@@ -83,14 +120,16 @@ struct PageSlot {
   bool used;
 
   /**
-   * Offset of the data item in the page.
+   * Offset of the data item in the page.  In an unused slot, the next slot in
+   * the page's free slot chain, or Page::INVALID_SLOT.
    */
-  std::uint16_t item_offset;
+  PageOffset item_offset;
 
   /**
-   * Length of the data item in this slot.
+   * Length of the data item in this slot.  In an unused slot, the previous
+   * slot in the free slot chain, or Page::INVALID_SLOT.
    */
-  std::uint16_t item_length;
+  PageOffset item_length;
 };
 
 class PageIterator;
@@ -103,15 +142,22 @@ class PageIterator;
  * slots and identified by a RecordId.  Although a record's actual contents may
  * be moved on the page, accessing a record by its slot is consistent.
  *
+ * Deleting or shrinking a record leaves a hole in the data; the holes count
+ * as free space and are squeezed out by compact(), which inserts and updates
+ * call only when the contiguous free space is too small.
+ *
  * @warning This class is not threadsafe.
  */
 class Page {
  public:
   /**
-   * Page size in bytes.  If this is changed, database files created with a
-   * different page size value will be unreadable by the resulting binaries.
+   * Page size in bytes, a power of two from 4 KB to 64 KB fixed when BadgerDB
+   * is built (BADGERDB_PAGE_SIZE): small pages for files read and written a
+   * record at a time, large ones for files scanned, in fewer I/Os.  Every
+   * file records the size of its pages, and opening a file whose pages are
+   * of another size throws FileFormatException.
    */
-  static const std::size_t SIZE = 8192;
+  static const std::size_t SIZE = BADGERDB_PAGE_SIZE;
 
   /**
    * Size of page free space area in bytes.
@@ -129,10 +175,45 @@ class Page {
   static const SlotId INVALID_SLOT = 0;
 
   /**
-   * Constructs a new, uninitialized page.
+   * Constructs a new, uninitialized page in the page's own memory, which is
+   * part of the object: nothing is allocated.
    */
   Page();
 
+  /**
+   * Constructs a new, uninitialized page whose contents live in memory owned
+   * by the caller, such as a frame of the buffer pool.  The memory holds
+   * SIZE bytes laid out as on disk: header first, then data.  The page never
+   * lets go of it: moving or assigning a page into this one copies contents.
+   *
+   * @param memory  Memory for the page, which must outlive it.
+   */
+  explicit Page(char *memory);
+
+  /**
+   * Copy constructor.  The copy has memory of its own.
+   */
+  Page(const Page &other);
+
+  /**
+   * Move constructor.  Takes over the memory of <other> if it lives
+   * elsewhere (a buffer pool frame, a mapped file), in which case <other>
+   * must not be used afterwards other than being assigned to or destroyed;
+   * a page in its own memory is copied.
+   */
+  Page(Page &&other) noexcept;
+
+  /**
+   * Copies the contents of <rhs> into this page's memory.
+   */
+  Page &operator=(const Page &rhs);
+
+  /**
+   * Copies the contents of <rhs> into this page's memory, or takes over the
+   * memory of <rhs> as the move constructor does if this page has none.
+   */
+  Page &operator=(Page &&rhs) noexcept;
+
   /**
    * Inserts a new record into the page.
    *
@@ -141,20 +222,54 @@ class Page {
    */
   RecordId insertRecord(const std::string &record_data);
 
+  /**
+   * Inserts a new record into the page, copying it from wherever the view
+   * points.
+   *
+   * @param record_data  Bytes that compose the record.
+   * @return  ID of the newly inserted record.
+   */
+  RecordId insertRecord(const RecordView &record_data);
+
+  /**
+   * Inserts as many of the given records as fit, in order, stopping at the
+   * first one that does not.  Records that do not reuse a free slot are laid
+   * out in a single pass over new slots at the end of the slot array.
+   *
+   * @param records     Records to insert.
+   * @param count       Number of records.
+   * @param record_ids  If not null, set to the IDs of the records inserted.
+   * @return  Number of records inserted.
+   */
+  std::size_t insertRecords(const RecordView *records, const std::size_t count,
+                            RecordId *record_ids = nullptr);
+
   /**
    * Returns the record with the given ID.  Returned data is a copy of what is
    * stored on the page; use updateRecord to change it.
    *
    * @see updateRecord
+   * @see getRecordView
    * @param record_id  ID of the record to return.
    * @return  The record.
    */
   std::string getRecord(const RecordId &record_id) const;
 
+  /**
+   * Returns the record with the given ID as a view of the page's memory,
+   * without copying it.  The view is valid until the page is changed or its
+   * memory reused.
+   *
+   * @param record_id  ID of the record to return.
+   * @return  View of the record.
+   */
+  RecordView getRecordView(const RecordId &record_id) const;
+
   /**
    * Updates the record with the given ID, replacing its data with a new
    * version.  This is equivalent to deleting the old record and inserting a
-   * new one, with the exception that the record ID will not change.
+   * new one, with the exception that the record ID will not change.  A new
+   * version no longer than the old one is written in place of it.
    *
    * @param record_id   ID of record to update.
    * @param record_data Updated bytes that compose the record.
@@ -162,14 +277,55 @@ class Page {
   void updateRecord(const RecordId &record_id, const std::string &record_data);
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array.
+   * Updates the record with the given ID from a view; otherwise like
+   * updateRecord(record_id, record_data).  The view may point into this page.
+   *
+   * @param record_id   ID of record to update.
+   * @param record_data Updated bytes that compose the record.
+   */
+  void updateRecord(const RecordId &record_id, const RecordView &record_data);
+
+  /**
+   * Overwrites part of the record with the given ID in place, leaving its
+   * length and the rest of its bytes as they are.
+   *
+   * @param record_id   ID of record to patch.
+   * @param offset      Offset of the bytes to overwrite within the record.
+   * @param bytes       New bytes.
+   * @throws  InsufficientSpaceException  Thrown if the bytes would extend past
+   *                                      the end of the record.
+   */
+  void patchRecord(const RecordId &record_id, const std::size_t offset,
+                   const std::string &bytes);
+
+  /**
+   * Overwrites part of a record from a view; otherwise like
+   * patchRecord(record_id, offset, bytes).  The view may point into this
+   * page.
+   *
+   * @param record_id   ID of record to patch.
+   * @param offset      Offset of the bytes to overwrite within the record.
+   * @param bytes       New bytes.
+   */
+  void patchRecord(const RecordId &record_id, const std::size_t offset,
+                   const RecordView &bytes);
+
+  /**
+   * Deletes the record with the given ID.  Its data is left as a hole until
+   * the page is compacted.  Slot array is compacted if the slot deleted is at
+   * the end of the slot array.
    *
    * @param record_id   ID of the record to delete.
    */
   void deleteRecord(const RecordId &record_id);
 
+  /**
+   * Moves the records' data together at the end of the page, turning the
+   * holes left by deletes and updates into contiguous free space.  Record IDs
+   * do not change, but views of records on the page are invalidated.
+   */
+  void compact();
+
   /**
    * Returns true if the page has enough free space to hold the given data.
    *
@@ -179,12 +335,21 @@ class Page {
   bool hasSpaceForRecord(const std::string &record_data) const;
 
   /**
-   * Returns this page's free space in bytes.
+   * Returns true if the page has enough free space to hold the given data.
+   *
+   * @param record_data Bytes that compose the record.
+   * @return  Whether the page can hold the data.
+   */
+  bool hasSpaceForRecord(const RecordView &record_data) const;
+
+  /**
+   * Returns this page's free space in bytes, including the holes compact()
+   * would give back.
    *
    * @return  Free space in bytes.
    */
-  std::uint16_t getFreeSpace() const {
-    return header_.free_space_upper_bound - header_.free_space_lower_bound;
+  PageOffset getFreeSpace() const {
+    return getContiguousFreeSpace() + header_->fragmented_bytes;
   }
 
   /**
@@ -192,14 +357,48 @@ class Page {
    *
    * @return  Page number.
    */
-  PageId page_number() const { return header_.current_page_number; }
+  PageId page_number() const { return header_->current_page_number; }
 
   /**
    * Returns the number of the next used page this page in its file.
    *
    * @return  Page number of next used page in file.
    */
-  PageId next_page_number() const { return header_.next_page_number; }
+  PageId next_page_number() const { return header_->next_page_number; }
+
+  /**
+   * Returns the checksum the page was last written with, 0 if none.
+   *
+   * @return  Stored checksum.
+   */
+  std::uint32_t checksum() const { return header_->checksum; }
+
+  /**
+   * Returns the LSN of the last logged change to the page, 0 if none.
+   *
+   * @return  Page LSN.
+   */
+  Lsn lsn() const { return header_->lsn; }
+
+  /**
+   * Stamps the page with the LSN of a log record describing a change just
+   * made to it, so it is not written back before the record is durable.
+   * The caller holds the page pinned, and its content latch exclusive if
+   * others may use it.
+   *
+   * @param new_lsn   LSN returned by LogManager::append().
+   */
+  void set_lsn(const Lsn new_lsn) { header_->lsn = new_lsn; }
+
+  /**
+   * Returns whether the page's contents match its stored checksum, which is
+   * true of a page stored without one.
+   *
+   * @return  Whether the page is intact.
+   */
+  bool checksumMatches() const {
+    return header_->checksum == 0 || header_->checksum == computeChecksum();
+  }
 
   /**
    * Returns an iterator at the first record in the page.
@@ -217,6 +416,21 @@ class Page {
   PageIterator end();
 
  private:
+  /**
+   * Tag selecting the constructor of views.
+   */
+  struct View {};
+
+  /**
+   * Constructs a page over memory it must never write to, such as a
+   * read-only mapping of its file, leaving the contents as they are.  Like
+   * Page(char *memory) the page does not own the memory; modifying it is not
+   * allowed.
+   *
+   * @param memory  Memory of the page, which must outlive it.
+   */
+  Page(View, const char *memory);
+
   /**
    * Initializes this page as a new page with no header information or data.
    */
@@ -228,7 +442,7 @@ class Page {
    * @param page_number   Number of page in file.
    */
   void set_page_number(const PageId new_page_number) {
-    header_.current_page_number = new_page_number;
+    header_->current_page_number = new_page_number;
   }
 
   /**
@@ -237,14 +451,39 @@ class Page {
    * @param next_page_number  Page number of next used page in file.
    */
   void set_next_page_number(const PageId new_next_page_number) {
-    header_.next_page_number = new_next_page_number;
+    header_->next_page_number = new_next_page_number;
+  }
+
+  /**
+   * Returns the checksum of a page with the given header and data, never 0.
+   *
+   * @param header  Header of the page; its checksum field is not used.
+   * @param data    DATA_SIZE bytes of data of the page.
+   * @return  Checksum to store in the header.
+   */
+  static std::uint32_t computeChecksum(const PageHeader &header,
+                                       const char *data);
+
+  /**
+   * Returns the checksum of this page as it is now, never 0.
+   */
+  std::uint32_t computeChecksum() const {
+    return computeChecksum(*header_, data_);
+  }
+
+  /**
+   * Stores a checksum in the header, 0 for none.
+   *
+   * @param new_checksum  Checksum to store.
+   */
+  void set_checksum(const std::uint32_t new_checksum) {
+    header_->checksum = new_checksum;
   }
 
   /**
-   * Deletes the record with the given ID.  Page is compacted upon delete to
-   * ensure that data of all records is contiguous.  Slot array is compacted if
-   * the slot deleted is at the end of the slot array and
-   * <allow_slot_compaction> is set.
+   * Deletes the record with the given ID.  Its data is left as a hole until
+   * the page is compacted.  Slot array is compacted if the slot deleted is at
+   * the end of the slot array and <allow_slot_compaction> is set.
    *
    * @param record_id             ID of the record to delete.
    * @param allow_slot_compaction If true, the slot array will be compacted if
@@ -274,13 +513,13 @@ class Page {
   const PageSlot *getSlot(const SlotId slot_number) const;
 
   /**
-   * Returns the slot number of an available slot.  If no slots are available
-   * to be reused, allocates a new slot.  Updates available slot count in the
-   * header metadata, but does not mark returned slot as used.  If a new slot is
-   * allocated, updates the free space lower bound.
+   * Returns the slot number of an available slot, the head of the free slot
+   * chain, in constant time.  If no slots are available to be reused,
+   * allocates a new slot and puts it on the chain.  Does not take the
+   * returned slot off the chain or mark it as used.
    *
-   * Callers are responsible for making sure there is enough space to allocate a
-   * new slot before calling this method.
+   * Callers are responsible for making sure there is enough contiguous space
+   * to allocate a new slot before calling this method.
    *
    * Since the returned slot is not marked as used, callers must take care to
    * fill the slot or mark it used before someone else calls this method.
@@ -289,12 +528,65 @@ class Page {
    */
   SlotId getAvailableSlot();
 
+  /**
+   * Puts an unused slot at the head of the free slot chain.
+   *
+   * @param slot_number   Number of the slot.
+   */
+  void pushFreeSlot(const SlotId slot_number);
+
+  /**
+   * Takes an unused slot off the free slot chain, wherever it is in it.
+   *
+   * @param slot_number   Number of the slot.
+   */
+  void unlinkFreeSlot(const SlotId slot_number);
+
+  /**
+   * Returns the free space between the slot array and the first record.
+   */
+  PageOffset getContiguousFreeSpace() const {
+    return header_->free_space_upper_bound -
+           header_->num_slots * sizeof(PageSlot);
+  }
+
+  /**
+   * Compacts the page if there are fewer than <length> bytes of contiguous
+   * free space.  Callers are responsible for making sure there is enough free
+   * space in all.
+   *
+   * @param length  Number of bytes needed.
+   */
+  void reserveContiguousSpace(const std::size_t length);
+
+  /**
+   * Rebuilds the free slot chain and the fragmented byte count from the slot
+   * array, for pages written in an older file format (version 3 and older),
+   * whose header held other fields in their place.
+   */
+  void rebuildHeader();
+
+  /**
+   * Lays a page written in an older file format, whose header was
+   * <old_header_size> bytes and so smaller than a PageHeader, out anew: the
+   * old header fields are kept, the slot array moves to just past the
+   * header, and the records are packed at the end of the page without
+   * changing slot numbers.  The header still needs rebuildHeader()
+   * afterwards.
+   *
+   * @param old_header_size  Size of the header the page was written with.
+   * @return  False if the records do not fit the smaller data area, in which
+   *          case the page is left as it was.
+   */
+  bool widenHeader(const std::size_t old_header_size);
+
   /**
    * Inserts record data into the given slot.  The slot should not be currently
-   * in use.  <slot_number> must be less than <header_.num_slots>.
+   * in use.  <slot_number> must be less than <header_->num_slots>.
    *
-   * Callers are responsible for making sure there is enough space to hold the
-   * record before calling this method.
+   * Callers are responsible for making sure there is enough free space to
+   * hold the record before calling this method; the page is compacted if it
+   * is not contiguous.
    *
    * @param slot_number   Number of slot to insert record into.
    * @param record_data   Bytes that compose the record.
@@ -303,7 +595,7 @@ class Page {
    * @throws  SlotInUseException  Thrown when given slot is in use.
    */
   void insertRecordInSlot(const SlotId slot_number,
-                          const std::string &record_data);
+                          const RecordView &record_data);
 
   /**
    * Throws an exception if the given record ID is not valid for this page
@@ -323,19 +615,42 @@ class Page {
   bool isUsed() const { return page_number() != INVALID_NUMBER; }
 
   /**
-   * Header metadata.
+   * Points this page at its memory, storage_ or memory elsewhere.
+   */
+  void bind(char *memory);
+
+  /**
+   * Returns whether the page's memory is its own storage_.
    */
-  PageHeader header_;
+  bool ownsMemory() const { return bytes() == storage_; }
 
   /**
-   * Data stored on the page.  Includes bookkeeping information about slots as
-   * well as actual content.
+   * Returns the start of the page's memory.
    */
+  char *bytes() const { return reinterpret_cast<char *>(header_); }
 
-  std::string data_;
+  /**
+   * Header metadata, at the start of the page's memory.
+   */
+  PageHeader *header_;
+
+  /**
+   * Data stored on the page, right after the header.  Includes bookkeeping
+   * information about slots as well as actual content.
+   */
+  char *data_;
+
+  /**
+   * The page's own memory, laid out as on disk; unused (and so never
+   * touched) by pages whose memory lives elsewhere.
+   */
+  alignas(std::uint64_t) char storage_[SIZE];
 
+  friend class BufMgr;
+  friend class BulkLoader;
   friend class File;
   friend class PageIterator;
+  friend class RecordFilter;
   friend class PageTest;
   friend class BufferTest;
 };
@@ -343,5 +658,10 @@ class Page {
 static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0, "Page must have some space to hold data.");
+static_assert(Page::SIZE >= 4096 && Page::SIZE <= 65536 &&
+                  (Page::SIZE & (Page::SIZE - 1)) == 0,
+              "Page size must be a power of two from 4 KB to 64 KB.");
+static_assert(Page::DATA_SIZE <= PageOffset(~0),
+              "Offsets within a page must fit PageOffset.");
 
 }  // namespace badgerdb
@@ -0,0 +1,61 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "page_guard.h"
+
+#include "buffer.h"
+
+namespace badgerdb {
+
+PageGuard::PageGuard()
+    : buf_mgr_(NULL),
+      frame_(0),
+      page_(NULL),
+      dirty_(false),
+      exclusive_(false) {}
+
+PageGuard::PageGuard(BufMgr *buf_mgr, const FrameId frame, Page *page,
+                     const bool dirty, const bool exclusive)
+    : buf_mgr_(buf_mgr),
+      frame_(frame),
+      page_(page),
+      dirty_(dirty),
+      exclusive_(exclusive) {}
+
+PageGuard::PageGuard(PageGuard &&other)
+    : buf_mgr_(other.buf_mgr_),
+      frame_(other.frame_),
+      page_(other.page_),
+      dirty_(other.dirty_),
+      exclusive_(other.exclusive_) {
+  other.page_ = NULL;
+  other.dirty_ = false;
+}
+
+PageGuard &PageGuard::operator=(PageGuard &&rhs) {
+  if (this != &rhs) {
+    release();
+    buf_mgr_ = rhs.buf_mgr_;
+    frame_ = rhs.frame_;
+    page_ = rhs.page_;
+    dirty_ = rhs.dirty_;
+    exclusive_ = rhs.exclusive_;
+    rhs.page_ = NULL;
+    rhs.dirty_ = false;
+  }
+  return *this;
+}
+
+void PageGuard::release() {
+  if (page_ == NULL) return;
+  page_ = NULL;
+  buf_mgr_->unpinFrame(frame_, dirty_, exclusive_);
+  dirty_ = false;
+}
+
+}  // namespace badgerdb
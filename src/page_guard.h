@@ -0,0 +1,149 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+class BufMgr;
+
+/**
+ * @brief Pin on a page in the buffer pool, released when the guard goes away.
+ *
+ * A guard remembers the frame the page is pinned in, so releasing it unpins
+ * the frame without looking the page up in the page table again, which
+ * BufMgr::unPinPage() has to do.  Guards can be moved but not copied, so a
+ * page pinned through a guard is unpinned exactly once.
+ *
+ * Guards come from BufMgr::pinForRead(), BufMgr::pinForWrite() and
+ * BufMgr::allocForWrite().  A page pinned through a guard must not also be
+ * unpinned with BufMgr::unPinPage(), and the guard must be released before
+ * the buffer manager is destroyed or the file flushed.
+ *
+ * A guard also holds the latch on the page contents (see PageLatch): shared
+ * for a ReadPageGuard, exclusive for a WritePageGuard, so threads reading and
+ * writing one page through guards do not see each other's half-done changes.
+ * A thread must not take a second guard on a page it already holds one on.
+ *
+ * @warning A guard is not threadsafe, though guards on the same page held by
+ * different threads are.
+ */
+class PageGuard {
+ public:
+  /**
+   * Constructs a guard holding no page.
+   */
+  PageGuard();
+
+  PageGuard(PageGuard &&other);
+  PageGuard &operator=(PageGuard &&rhs);
+
+  PageGuard(const PageGuard &) = delete;
+  PageGuard &operator=(const PageGuard &) = delete;
+
+  /**
+   * Unpins the page, if the guard still holds it.
+   */
+  ~PageGuard() { release(); }
+
+  /**
+   * Returns whether the guard holds a page.
+   */
+  explicit operator bool() const { return page_ != NULL; }
+
+  /**
+   * Returns the number of the page held.
+   */
+  PageId pageNumber() const { return page_->page_number(); }
+
+  /**
+   * Unpins the page, dirty if it was written through the guard, and leaves
+   * the guard empty.  Does nothing on an empty guard.
+   */
+  void release();
+
+ protected:
+  PageGuard(BufMgr *buf_mgr, const FrameId frame, Page *page,
+            const bool dirty, const bool exclusive);
+
+  /**
+   * Buffer manager the page is pinned in.
+   */
+  BufMgr *buf_mgr_;
+
+  /**
+   * Frame the page is pinned in.
+   */
+  FrameId frame_;
+
+  /**
+   * The page, in its frame; NULL once released.
+   */
+  Page *page_;
+
+  /**
+   * Whether the page is to be unpinned dirty.
+   */
+  bool dirty_;
+
+  /**
+   * Whether the content latch is held exclusive.
+   */
+  bool exclusive_;
+};
+
+/**
+ * @brief Guard giving read-only access to a pinned page.
+ */
+class ReadPageGuard : public PageGuard {
+ public:
+  ReadPageGuard() {}
+
+  const Page &operator*() const { return *page_; }
+  const Page *operator->() const { return page_; }
+  const Page *get() const { return page_; }
+
+ private:
+  friend class BufMgr;
+  ReadPageGuard(BufMgr *buf_mgr, const FrameId frame, Page *page)
+      : PageGuard(buf_mgr, frame, page, false, false) {}
+};
+
+/**
+ * @brief Guard giving write access to a pinned page.  Any access to the page
+ * through the guard marks it dirty, so it is written back once evicted or
+ * flushed after the guard unpins it.
+ */
+class WritePageGuard : public PageGuard {
+ public:
+  WritePageGuard() {}
+
+  Page &operator*() {
+    dirty_ = true;
+    return *page_;
+  }
+  Page *operator->() {
+    dirty_ = true;
+    return page_;
+  }
+  Page *get() {
+    dirty_ = true;
+    return page_;
+  }
+
+ private:
+  friend class BufMgr;
+  WritePageGuard(BufMgr *buf_mgr, const FrameId frame, Page *page,
+                 const bool dirty)
+      : PageGuard(buf_mgr, frame, page, dirty, true) {}
+};
+
+}  // namespace badgerdb
@@ -99,6 +99,21 @@ class PageIterator {
     return page_->getRecord(current_record_);
   }
 
+  /**
+   * Returns the current record in the page as a view of the page's memory,
+   * without copying it; see Page::getRecordView().
+   *
+   * @return  View of the record in page.
+   */
+  inline RecordView view() const {
+    return page_->getRecordView(current_record_);
+  }
+
+  /**
+   * Returns the ID of the current record.
+   */
+  inline const RecordId &recordId() const { return current_record_; }
+
   /**
    * Returns the next used slot in the page after the given slot or
    * Page::INVALID_SLOT if no slots are used after the given slot.
@@ -108,7 +123,7 @@ class PageIterator {
    */
   SlotId getNextUsedSlot(const SlotId start) const {
     SlotId slot_number = Page::INVALID_SLOT;
-    for (SlotId i = start + 1; i <= page_->header_.num_slots; ++i) {
+    for (SlotId i = start + 1; i <= page_->header_->num_slots; ++i) {
       const PageSlot *slot = page_->getSlot(i);
       if (slot->used) {
         slot_number = i;
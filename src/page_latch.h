@@ -0,0 +1,101 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+
+namespace badgerdb {
+
+/**
+ * @brief Reader/writer latch on the contents of a page in a frame.
+ *
+ * Many readers or one writer hold it at a time.  The whole latch is one
+ * atomic word, so taking it uncontended costs a single compare-and-swap and
+ * it adds no more than that to a frame.  Waiters spin, yielding the processor
+ * between attempts, which suits latches held for the few page operations of
+ * a record access.  A waiting writer keeps new readers out, so a hot page
+ * being read all the time still gets written.
+ *
+ * Not recursive: a thread holding the latch must not take it again.
+ */
+class PageLatch {
+ public:
+  PageLatch() : state_(0) {}
+
+  PageLatch(const PageLatch &) = delete;
+  PageLatch &operator=(const PageLatch &) = delete;
+
+  /**
+   * Takes the latch shared, waiting while a writer holds it or waits for it.
+   */
+  void lockShared() {
+    for (std::uint32_t spins = 0;; spins++) {
+      std::uint32_t state = state_.load(std::memory_order_relaxed);
+      if ((state & (WRITER | WRITER_WAITING)) == 0 &&
+          state_.compare_exchange_weak(state, state + 1,
+                                       std::memory_order_acquire)) {
+        return;
+      }
+      pause(spins);
+    }
+  }
+
+  void unlockShared() { state_.fetch_sub(1, std::memory_order_release); }
+
+  /**
+   * Takes the latch exclusive, waiting for the readers holding it to leave.
+   */
+  void lock() {
+    for (std::uint32_t spins = 0;; spins++) {
+      std::uint32_t state = state_.load(std::memory_order_relaxed);
+      if ((state & ~WRITER_WAITING) == 0) {
+        if (state_.compare_exchange_weak(state, WRITER,
+                                         std::memory_order_acquire)) {
+          return;
+        }
+      } else if ((state & WRITER_WAITING) == 0) {
+        state_.fetch_or(WRITER_WAITING, std::memory_order_relaxed);
+      }
+      pause(spins);
+    }
+  }
+
+  /**
+   * Releases the exclusive latch.  Writers still waiting set their flag
+   * again on their next attempt.
+   */
+  void unlock() { state_.store(0, std::memory_order_release); }
+
+ private:
+  /**
+   * Set while a writer holds the latch.
+   */
+  static const std::uint32_t WRITER = 1u << 31;
+
+  /**
+   * Set while a writer waits for the readers to leave.
+   */
+  static const std::uint32_t WRITER_WAITING = 1u << 30;
+
+  /**
+   * Spins a little before the first yields; latches are held briefly.
+   */
+  static void pause(const std::uint32_t spins) {
+    if (spins >= 16) std::this_thread::yield();
+  }
+
+  /**
+   * WRITER, WRITER_WAITING, and the number of readers in the low bits.
+   */
+  std::atomic<std::uint32_t> state_;
+};
+
+}  // namespace badgerdb
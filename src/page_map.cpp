@@ -0,0 +1,169 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "page_map.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Reserved bytes at the start of map pages other than page 0
+ */
+struct MapPageHeader {
+  /**
+   * Header of a page not in use, so reading the map page as a data page
+   * fails cleanly.
+   */
+  PageHeader page;
+
+  /**
+   * Number of the map page holding the next chunk
+   */
+  PageId next_map_page;
+};
+
+static_assert(sizeof(MapPageHeader) <= PageMap::RESERVED_BYTES,
+              "Map page header must fit in the reserved bytes.");
+
+std::uint64_t mapPagePosition(const PageId page_number) {
+  return static_cast<std::uint64_t>(page_number) * Page::SIZE;
+}
+
+}  // namespace
+
+const std::size_t PageMap::RESERVED_BYTES;
+const std::size_t PageMap::PAGES_PER_MAP_PAGE;
+const std::size_t PageMap::WORDS_PER_MAP_PAGE;
+
+PageMap::PageMap()
+    : bits_(WORDS_PER_MAP_PAGE, 0), map_pages_(1, 0), dirty_(1, true) {}
+
+void PageMap::load(FileBackend &backend, const PageId first_map_page) {
+  bits_.assign(WORDS_PER_MAP_PAGE, 0);
+  map_pages_.assign(1, 0);
+  dirty_.assign(1, false);
+  backend.read(RESERVED_BYTES, reinterpret_cast<char *>(&bits_[0]),
+               WORDS_PER_MAP_PAGE * sizeof(std::uint64_t));
+
+  for (PageId map_page = first_map_page; map_page != Page::INVALID_NUMBER;) {
+    MapPageHeader header;
+    backend.read(mapPagePosition(map_page), reinterpret_cast<char *>(&header),
+                 sizeof(header));
+    map_pages_.push_back(map_page);
+    dirty_.push_back(false);
+    bits_.resize(bits_.size() + WORDS_PER_MAP_PAGE);
+    backend.read(mapPagePosition(map_page) + RESERVED_BYTES,
+                 reinterpret_cast<char *>(&bits_[bits_.size() -
+                                                 WORDS_PER_MAP_PAGE]),
+                 WORDS_PER_MAP_PAGE * sizeof(std::uint64_t));
+    map_page = header.next_map_page;
+  }
+}
+
+void PageMap::store(FileBackend &backend, const void *header,
+                    const std::size_t header_size, const bool header_dirty) {
+  for (std::size_t chunk = 0; chunk < map_pages_.size(); ++chunk) {
+    if (dirty_[chunk] || (chunk == 0 && header_dirty)) {
+      storeChunk(backend, chunk, header, header_size);
+      dirty_[chunk] = false;
+    }
+  }
+}
+
+void PageMap::storeChunk(FileBackend &backend, const std::size_t chunk,
+                         const void *header, const std::size_t header_size) {
+  char buffer[Page::SIZE];
+  std::memset(buffer, 0, RESERVED_BYTES);
+  if (chunk == 0) {
+    assert(header_size <= RESERVED_BYTES);
+    std::memcpy(buffer, header, header_size);
+  } else {
+    MapPageHeader map_header;
+    std::memset(&map_header, 0, sizeof(map_header));
+    map_header.page.current_page_number = Page::INVALID_NUMBER;
+    map_header.page.next_page_number = Page::INVALID_NUMBER;
+    map_header.next_map_page = chunk + 1 < map_pages_.size()
+                                   ? map_pages_[chunk + 1]
+                                   : Page::INVALID_NUMBER;
+    std::memcpy(buffer, &map_header, sizeof(map_header));
+  }
+  std::memcpy(buffer + RESERVED_BYTES, &bits_[chunk * WORDS_PER_MAP_PAGE],
+              WORDS_PER_MAP_PAGE * sizeof(std::uint64_t));
+  backend.write(mapPagePosition(map_pages_[chunk]), buffer, Page::SIZE);
+}
+
+void PageMap::addMapPage(const PageId page_number) {
+  map_pages_.push_back(page_number);
+  bits_.resize(bits_.size() + WORDS_PER_MAP_PAGE, 0);
+  dirty_.push_back(true);
+  // The previous map page points to the new one; for chunk 0 that pointer is
+  // in the file header, which the caller updates.
+  if (map_pages_.size() > 2) dirty_[map_pages_.size() - 2] = true;
+}
+
+bool PageMap::isMapPage(const PageId page_number) const {
+  return page_number == 0 ||
+         std::binary_search(map_pages_.begin() + 1, map_pages_.end(),
+                            page_number);
+}
+
+void PageMap::setUsed(const PageId page_number, const bool used) {
+  assert(covers(page_number));
+  const std::uint64_t bit = std::uint64_t(1) << (page_number % 64);
+  if (used) {
+    bits_[page_number / 64] |= bit;
+  } else {
+    bits_[page_number / 64] &= ~bit;
+  }
+  dirty_[page_number / PAGES_PER_MAP_PAGE] = true;
+}
+
+PageId PageMap::nextUsed(const PageId page_number) const {
+  const std::uint64_t end = bits_.size() * 64;
+  for (std::uint64_t i = std::uint64_t(page_number) + 1; i < end;) {
+    const std::uint64_t word = bits_[i / 64] >> (i % 64);
+    if (word != 0) return i + __builtin_ctzll(word);
+    i = (i / 64 + 1) * 64;
+  }
+  return Page::INVALID_NUMBER;
+}
+
+PageId PageMap::prevUsed(const PageId page_number) const {
+  if (page_number == 0) return Page::INVALID_NUMBER;
+  std::int64_t i = std::min<std::int64_t>(page_number - 1,
+                                          bits_.size() * 64 - 1);
+  while (i >= 0) {
+    const unsigned shift = 63 - i % 64;
+    const std::uint64_t word = bits_[i / 64] << shift;
+    if (word != 0) return i - __builtin_clzll(word);
+    i = (i / 64) * 64 - 1;
+  }
+  return Page::INVALID_NUMBER;
+}
+
+PageId PageMap::firstFree(const PageId page_number, const PageId end) const {
+  for (std::uint64_t i = page_number; i < end && i / 64 < bits_.size();) {
+    const std::uint64_t word = ~bits_[i / 64] >> (i % 64);
+    if (word == 0) {
+      i = (i / 64 + 1) * 64;
+      continue;
+    }
+    i += __builtin_ctzll(word);
+    if (i >= end) break;
+    if (!isMapPage(i)) return i;
+    ++i;
+  }
+  return end;
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,162 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "file_backend.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Allocation bitmap of a file: one bit per page, set while the page is
+ * in use.
+ *
+ * On disk the bitmap is cut into chunks of PAGES_PER_MAP_PAGE bits, one per
+ * map page.  Chunk 0 lives in the file's header page (page 0) after the file
+ * header, later chunks in map pages appended to the file as it grows, chained
+ * through the pointer stored after their page header.  Every map page starts
+ * with RESERVED_BYTES bytes that are not bitmap: the file header on page 0,
+ * and on the others a PageHeader marking the page as not in use followed by
+ * the number of the next map page.
+ *
+ * The whole bitmap is kept in memory; chunks that change are marked dirty and
+ * written by store().  Bits of the header and map pages themselves are never
+ * set, so they are neither used nor free; isMapPage() tells them apart.
+ *
+ * @warning This class is not threadsafe.
+ */
+class PageMap {
+ public:
+  /**
+   * Bytes at the start of each map page that do not belong to the bitmap.
+   */
+  static const std::size_t RESERVED_BYTES = 256;
+
+  /**
+   * Number of pages one map page keeps track of.
+   */
+  static const std::size_t PAGES_PER_MAP_PAGE =
+      (Page::SIZE - RESERVED_BYTES) * 8;
+
+  /**
+   * Constructs the map of a new, empty file: only chunk 0 in page 0.
+   */
+  PageMap();
+
+  /**
+   * Reads the bitmap of an existing file.
+   *
+   * @param backend         Backend of the file.
+   * @param first_map_page  Number of the map page holding chunk 1, or
+   *                        Page::INVALID_NUMBER.
+   */
+  void load(FileBackend &backend, const PageId first_map_page);
+
+  /**
+   * Writes the chunks that changed since the last call, and page 0 if chunk
+   * 0 or the file header changed.
+   *
+   * @param backend       Backend of the file.
+   * @param header        File header to put at the start of page 0.
+   * @param header_size   Size of the file header.
+   * @param header_dirty  Whether the file header changed.
+   */
+  void store(FileBackend &backend, const void *header,
+             const std::size_t header_size, const bool header_dirty);
+
+  /**
+   * Returns whether the chunk covering a page exists yet.
+   */
+  bool covers(const PageId page_number) const {
+    return page_number / PAGES_PER_MAP_PAGE < map_pages_.size();
+  }
+
+  /**
+   * Adds the map page for the next chunk.  The page may be anywhere in the
+   * file, but the file must grow to have chunks covering it before it is
+   * stored.
+   *
+   * @param page_number   Number of the new map page.
+   */
+  void addMapPage(const PageId page_number);
+
+  /**
+   * Returns the number of the map page holding chunk 1, or
+   * Page::INVALID_NUMBER if the file has a single chunk.
+   */
+  PageId firstMapPage() const {
+    return map_pages_.size() > 1 ? map_pages_[1] : Page::INVALID_NUMBER;
+  }
+
+  /**
+   * Returns whether a page is page 0 or a map page.
+   */
+  bool isMapPage(const PageId page_number) const;
+
+  /**
+   * Returns whether a page is in use.
+   */
+  bool isUsed(const PageId page_number) const {
+    return covers(page_number) &&
+           (bits_[page_number / 64] >> (page_number % 64) & 1) != 0;
+  }
+
+  /**
+   * Marks a page as used or not.
+   */
+  void setUsed(const PageId page_number, const bool used);
+
+  /**
+   * Returns the lowest used page after the given one, or Page::INVALID_NUMBER.
+   */
+  PageId nextUsed(const PageId page_number) const;
+
+  /**
+   * Returns the highest used page before the given one, or
+   * Page::INVALID_NUMBER.
+   */
+  PageId prevUsed(const PageId page_number) const;
+
+  /**
+   * Returns the lowest page from <page_number> on that is neither used nor a
+   * map page, or <end> if there is none below it.
+   */
+  PageId firstFree(const PageId page_number, const PageId end) const;
+
+ private:
+  static const std::size_t WORDS_PER_MAP_PAGE = PAGES_PER_MAP_PAGE / 64;
+
+  /**
+   * Writes one chunk with its map page's reserved bytes.
+   */
+  void storeChunk(FileBackend &backend, const std::size_t chunk,
+                  const void *header, const std::size_t header_size);
+
+  /**
+   * One bit per page, PAGES_PER_MAP_PAGE bits per chunk
+   */
+  std::vector<std::uint64_t> bits_;
+
+  /**
+   * Page holding each chunk; chunk 0 is in page 0
+   */
+  std::vector<PageId> map_pages_;
+
+  /**
+   * Chunks changed since they were last stored
+   */
+  std::vector<bool> dirty_;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,102 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "parallel_scan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "page_iterator.h"
+
+namespace badgerdb {
+
+const std::uint32_t ParallelScan::DEFAULT_MORSEL_PAGES;
+
+ParallelScan::ParallelScan(BufMgr *buf_mgr, File *file,
+                           const std::uint32_t num_threads,
+                           const std::uint32_t morsel_pages)
+    : buf_mgr_(buf_mgr),
+      file_(file),
+      num_threads_(num_threads),
+      morsel_pages_(std::max<std::uint32_t>(1, morsel_pages)) {
+  assert(buf_mgr_ != NULL && file_ != NULL);
+  if (num_threads_ == 0) {
+    num_threads_ = std::max(1u, std::thread::hardware_concurrency());
+  }
+}
+
+std::size_t ParallelScan::run(const Callback &callback) {
+  std::vector<PageId> pages;
+  for (PageId page_number = file_->readHeader().first_used_page;
+       page_number != Page::INVALID_NUMBER;
+       page_number = file_->nextUsedPage(page_number)) {
+    pages.push_back(page_number);
+  }
+  const std::size_t num_morsels =
+      (pages.size() + morsel_pages_ - 1) / morsel_pages_;
+
+  std::atomic<std::size_t> next_morsel(0);
+  std::atomic<bool> failed(false);
+  std::mutex error_latch;
+  std::exception_ptr error;
+  auto work = [&](const std::uint32_t worker) {
+    std::vector<Page *> pinned(morsel_pages_);
+    std::vector<RecordId> record_ids;
+    std::vector<RecordView> records;
+    while (!failed) {
+      const std::size_t morsel = next_morsel++;
+      if (morsel >= num_morsels) break;
+      const PageId *page_numbers = &pages[morsel * morsel_pages_];
+      const std::size_t count = std::min<std::size_t>(
+          morsel_pages_, pages.size() - morsel * morsel_pages_);
+
+      // Pages [done, count) are still pinned once readPages() returns.
+      std::size_t done = count;
+      try {
+        buf_mgr_->readPages(*file_, page_numbers, count, pinned.data());
+        for (done = 0; done < count; ++done) {
+          Page *page = pinned[done];
+          record_ids.clear();
+          records.clear();
+          for (PageIterator iter = page->begin(); iter != page->end();
+               ++iter) {
+            record_ids.push_back(iter.recordId());
+            records.push_back(iter.view());
+          }
+          const Batch batch = {page, records.size(), record_ids.data(),
+                               records.data()};
+          callback(worker, batch);
+          buf_mgr_->unPinPage(*file_, page_numbers[done], false);
+        }
+      } catch (...) {
+        for (; done < count; ++done) {
+          buf_mgr_->unPinPage(*file_, page_numbers[done], false);
+        }
+        std::lock_guard<std::mutex> latch(error_latch);
+        if (!error) error = std::current_exception();
+        failed = true;
+      }
+    }
+  };
+
+  std::vector<std::thread> workers;
+  for (std::uint32_t worker = 1; worker < num_threads_; ++worker) {
+    workers.emplace_back(work, worker);
+  }
+  work(0);
+  for (std::thread &worker : workers) worker.join();
+  if (error) std::rethrow_exception(error);
+  return pages.size();
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,128 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "record_view.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Scan of all records of a file by a pool of threads, through the
+ * buffer pool.
+ *
+ * The used pages are taken from the file's allocation bitmap up front and cut
+ * into morsels of consecutive pages.  Each worker thread grabs the next
+ * morsel, pins its pages with one BufMgr::readPages() call and hands the
+ * records of each page to the callback as a batch, unpinning the page when
+ * the callback returns.  Morsels are handed out in page order, but pages of
+ * different morsels are processed concurrently in no particular order.
+ *
+ * The file must not change during the scan, and the buffer pool must hold at
+ * least as many frames as the workers pin at once: the number of threads
+ * times the morsel size.
+ */
+class ParallelScan {
+ public:
+  /**
+   * @brief The records of one page, valid while the callback runs.
+   */
+  struct Batch {
+    /**
+     * Page the records are on, pinned in the buffer pool.
+     */
+    const Page *page;
+
+    /**
+     * Number of records
+     */
+    std::size_t count;
+
+    /**
+     * IDs of the records, in slot order
+     */
+    const RecordId *record_ids;
+
+    /**
+     * The records themselves, in the page
+     */
+    const RecordView *records;
+  };
+
+  /**
+   * Function called for every page, with the number of the worker calling
+   * it (0 to numThreads() - 1, for per-thread state) and the page's records.
+   * Called from several threads at once.
+   */
+  typedef std::function<void(std::uint32_t worker, const Batch &batch)>
+      Callback;
+
+  /**
+   * Default number of pages in a morsel.
+   */
+  static const std::uint32_t DEFAULT_MORSEL_PAGES = 16;
+
+  /**
+   * Constructs a scan of a file.
+   *
+   * @param buf_mgr       Buffer manager to go through.
+   * @param file          File to scan.
+   * @param num_threads   Number of worker threads; 0 for one per hardware
+   *                      thread.
+   * @param morsel_pages  Number of pages a worker takes at a time.
+   */
+  ParallelScan(BufMgr *buf_mgr, File *file, const std::uint32_t num_threads = 0,
+               const std::uint32_t morsel_pages = DEFAULT_MORSEL_PAGES);
+
+  /**
+   * Returns the number of worker threads.
+   */
+  std::uint32_t numThreads() const { return num_threads_; }
+
+  /**
+   * Scans the file, calling <callback> for every used page, and returns once
+   * all pages are done.  If reading a page or the callback throws, the
+   * workers stop after the morsels they are on and the first exception is
+   * rethrown here.
+   *
+   * @param callback  Function to call.
+   * @return  Number of pages scanned.
+   */
+  std::size_t run(const Callback &callback);
+
+ private:
+  /**
+   * Buffer manager the pages are pinned in.
+   */
+  BufMgr *buf_mgr_;
+
+  /**
+   * File being scanned.
+   */
+  File *file_;
+
+  /**
+   * Number of worker threads.
+   */
+  std::uint32_t num_threads_;
+
+  /**
+   * Number of pages in a morsel.
+   */
+  std::uint32_t morsel_pages_;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,110 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "partitioned_policy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * The frames of one partition, numbered from 0 as its policy knows them.
+ */
+class PartitionView : public FrameView {
+ public:
+  PartitionView(FrameView &frames, const FrameId first)
+      : frames_(frames), first_(first) {}
+
+  bool testAndClearRefbit(const FrameId frame) override {
+    return frames_.testAndClearRefbit(first_ + frame);
+  }
+
+  bool tryClaim(const FrameId frame) override {
+    return frames_.tryClaim(first_ + frame);
+  }
+
+ private:
+  FrameView &frames_;
+  const FrameId first_;
+};
+
+}  // namespace
+
+PartitionedPolicy::PartitionedPolicy(const ReplacementPolicyType type,
+                                     const std::uint32_t numFrames,
+                                     const std::uint32_t numPartitions)
+    : numFrames_(numFrames), partitionOf_(numFrames), nextPartition_(0) {
+  partitions_.resize(numPartitions);
+  for (std::uint32_t p = 0; p < numPartitions; p++) {
+    const FrameId first = firstFrame(p);
+    const FrameId end = firstFrame(p + 1);
+    partitions_[p] = ReplacementPolicy::create(type, end - first);
+    for (FrameId frame = first; frame < end; frame++) partitionOf_[frame] = p;
+  }
+}
+
+void PartitionedPolicy::onLoad(const FrameId frame, const PageKey key) {
+  const std::uint32_t p = partitionOf_[frame];
+  partitions_[p]->onLoad(frame - firstFrame(p), key);
+}
+
+void PartitionedPolicy::onAccess(const FrameId frame) {
+  const std::uint32_t p = partitionOf_[frame];
+  partitions_[p]->onAccess(frame - firstFrame(p));
+}
+
+void PartitionedPolicy::onPin(const FrameId frame) {
+  const std::uint32_t p = partitionOf_[frame];
+  partitions_[p]->onPin(frame - firstFrame(p));
+}
+
+void PartitionedPolicy::onUnpin(const FrameId frame) {
+  const std::uint32_t p = partitionOf_[frame];
+  partitions_[p]->onUnpin(frame - firstFrame(p));
+}
+
+void PartitionedPolicy::onEvict(const FrameId frame) {
+  const std::uint32_t p = partitionOf_[frame];
+  partitions_[p]->onEvict(frame - firstFrame(p));
+}
+
+void PartitionedPolicy::onRemove(const FrameId frame) {
+  const std::uint32_t p = partitionOf_[frame];
+  partitions_[p]->onRemove(frame - firstFrame(p));
+}
+
+void PartitionedPolicy::onResize(const std::uint32_t frames) {
+  for (std::uint32_t p = 0; p < numPartitions(); p++) {
+    const FrameId first = firstFrame(p);
+    const FrameId end = std::min<FrameId>(firstFrame(p + 1), frames);
+    partitions_[p]->onResize(end > first ? end - first : 0);
+  }
+}
+
+bool PartitionedPolicy::pickVictim(FrameView &frames, FrameId &victim) {
+  const std::uint32_t start = nextPartition_++;
+  for (std::uint32_t k = 0; k < numPartitions(); k++) {
+    if (pickVictimIn((start + k) % numPartitions(), frames, victim)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PartitionedPolicy::pickVictimIn(const std::uint32_t partition,
+                                     FrameView &frames, FrameId &victim) {
+  const FrameId first = firstFrame(partition);
+  PartitionView view(frames, first);
+  if (!partitions_[partition]->pickVictim(view, victim)) return false;
+  victim += first;
+  return true;
+}
+
+}  // namespace badgerdb
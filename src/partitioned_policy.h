@@ -0,0 +1,117 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Runs one replacement policy per partition of the buffer pool.
+ *
+ * The frames are cut into contiguous partitions of nearly equal size, each
+ * with a policy of its own (and so a clock hand or queues of its own) that
+ * knows its frames by their number within the partition.
+ */
+class PartitionedPolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructor of PartitionedPolicy class
+   *
+   * @param type          Policy to run in each partition
+   * @param numFrames     Number of frames the buffer pool can grow to
+   * @param numPartitions Number of partitions, at most numFrames
+   */
+  PartitionedPolicy(const ReplacementPolicyType type,
+                    const std::uint32_t numFrames,
+                    const std::uint32_t numPartitions);
+
+  const char *name() const override { return partitions_[0]->name(); }
+
+  void onLoad(const FrameId frame, const PageKey key) override;
+  void onAccess(const FrameId frame) override;
+  void onPin(const FrameId frame) override;
+  void onUnpin(const FrameId frame) override;
+  void onEvict(const FrameId frame) override;
+  void onRemove(const FrameId frame) override;
+
+  /**
+   * Gives each partition the frames in use that fall in it; partitions
+   * wholly past them are left with none.
+   */
+  void onResize(const std::uint32_t frames) override;
+
+  /**
+   * Looks for a victim in each partition in turn, starting from a different
+   * one each call.
+   */
+  bool pickVictim(FrameView &frames, FrameId &victim) override;
+
+  /**
+   * Looks for a victim in one partition only.
+   *
+   * @param partition   Partition to look in
+   * @param frames      Frames of the whole pool
+   * @param victim      Set to the frame claimed
+   * @return False if the partition had no frame that could be claimed.
+   */
+  bool pickVictimIn(const std::uint32_t partition, FrameView &frames,
+                    FrameId &victim);
+
+  /**
+   * Returns the number of partitions.
+   */
+  std::uint32_t numPartitions() const {
+    return static_cast<std::uint32_t>(partitions_.size());
+  }
+
+  /**
+   * Returns the first frame of a partition; partition numPartitions() starts
+   * past the last frame.
+   */
+  FrameId firstFrame(const std::uint32_t partition) const {
+    return static_cast<FrameId>(static_cast<std::uint64_t>(partition) *
+                                numFrames_ / partitions_.size());
+  }
+
+  /**
+   * Returns the partition a frame is in.
+   */
+  std::uint32_t partitionOf(const FrameId frame) const {
+    return partitionOf_[frame];
+  }
+
+ private:
+  /**
+   * Number of frames in the buffer pool
+   */
+  const std::uint32_t numFrames_;
+
+  /**
+   * Policy of each partition
+   */
+  std::vector<std::unique_ptr<ReplacementPolicy>> partitions_;
+
+  /**
+   * Partition of each frame
+   */
+  std::vector<std::uint32_t> partitionOf_;
+
+  /**
+   * Partition pickVictim() starts from next
+   */
+  std::atomic<std::uint32_t> nextPartition_;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,193 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "record_filter.h"
+
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Most records a page can hold, one per slot
+ */
+const std::size_t MAX_RECORDS = Page::DATA_SIZE / sizeof(PageSlot);
+
+/**
+ * Sets match[i] to whether the <width> bytes at data + offsets[i] are
+ * <value>.
+ */
+void matchEqual(const char *data, const std::size_t data_size,
+                const PageOffset *offsets, const std::size_t count,
+                const std::string &value, bool *match) {
+  const std::size_t width = value.size();
+  std::size_t i = 0;
+#if defined(__SSE2__)
+  if (width <= 16) {
+    char padded[16] = {};
+    std::memcpy(padded, value.data(), width);
+    const __m128i expected =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(padded));
+    const int wanted = (1 << width) - 1;
+    for (; i < count; ++i) {
+      // 16 bytes are loaded whatever the width, so not at the end of the data.
+      if (offsets[i] + sizeof(__m128i) > data_size) {
+        match[i] = std::memcmp(data + offsets[i], value.data(), width) == 0;
+        continue;
+      }
+      const __m128i field =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + offsets[i]));
+      const int equal = _mm_movemask_epi8(_mm_cmpeq_epi8(field, expected));
+      match[i] = (equal & wanted) == wanted;
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    match[i] = std::memcmp(data + offsets[i], value.data(), width) == 0;
+  }
+}
+
+/**
+ * Sets match[i] to whether the 32-bit integer at data + offsets[i] is in
+ * [low, high].
+ */
+void matchInt32Range(const char *data, const PageOffset *offsets,
+                     const std::size_t count, const std::int32_t low,
+                     const std::int32_t high, bool *match) {
+  std::size_t i = 0;
+#if defined(__SSE2__)
+  const __m128i lows = _mm_set1_epi32(low);
+  const __m128i highs = _mm_set1_epi32(high);
+  for (; i + 4 <= count; i += 4) {
+    alignas(16) std::int32_t values[4];
+    for (std::size_t k = 0; k < 4; ++k) {
+      std::memcpy(&values[k], data + offsets[i + k], sizeof(values[k]));
+    }
+    const __m128i v = _mm_load_si128(reinterpret_cast<const __m128i *>(values));
+    const __m128i outside =
+        _mm_or_si128(_mm_cmplt_epi32(v, lows), _mm_cmpgt_epi32(v, highs));
+    const int outside_mask = _mm_movemask_ps(_mm_castsi128_ps(outside));
+    for (std::size_t k = 0; k < 4; ++k) {
+      match[i + k] = (outside_mask >> k & 1) == 0;
+    }
+  }
+#endif
+  for (; i < count; ++i) {
+    std::int32_t value;
+    std::memcpy(&value, data + offsets[i], sizeof(value));
+    match[i] = value >= low && value <= high;
+  }
+}
+
+/**
+ * Sets match[i] to whether the 64-bit integer at data + offsets[i] is in
+ * [low, high].  SSE2 has no 64-bit comparisons, so this is left to the
+ * compiler.
+ */
+void matchInt64Range(const char *data, const PageOffset *offsets,
+                     const std::size_t count, const std::int64_t low,
+                     const std::int64_t high, bool *match) {
+  for (std::size_t i = 0; i < count; ++i) {
+    std::int64_t value;
+    std::memcpy(&value, data + offsets[i], sizeof(value));
+    match[i] = value >= low && value <= high;
+  }
+}
+
+}  // namespace
+
+RecordFilter RecordFilter::equal(const std::size_t offset,
+                                 const RecordView &value) {
+  RecordFilter filter(Kind::EQUAL, offset, value.length);
+  filter.value_ = value.str();
+  return filter;
+}
+
+RecordFilter RecordFilter::int32Range(const std::size_t offset,
+                                      const std::int32_t low,
+                                      const std::int32_t high) {
+  RecordFilter filter(Kind::INT32_RANGE, offset, sizeof(std::int32_t));
+  filter.low_ = low;
+  filter.high_ = high;
+  return filter;
+}
+
+RecordFilter RecordFilter::int64Range(const std::size_t offset,
+                                      const std::int64_t low,
+                                      const std::int64_t high) {
+  RecordFilter filter(Kind::INT64_RANGE, offset, sizeof(std::int64_t));
+  filter.low_ = low;
+  filter.high_ = high;
+  return filter;
+}
+
+bool RecordFilter::matches(const RecordView &record) const {
+  if (record.length < offset_ + width_) return false;
+  const char *field = record.data + offset_;
+  switch (kind_) {
+    case Kind::EQUAL:
+      return width_ == 0 || std::memcmp(field, value_.data(), width_) == 0;
+    case Kind::INT32_RANGE: {
+      std::int32_t value;
+      std::memcpy(&value, field, sizeof(value));
+      return value >= low_ && value <= high_;
+    }
+    case Kind::INT64_RANGE: {
+      std::int64_t value;
+      std::memcpy(&value, field, sizeof(value));
+      return value >= low_ && value <= high_;
+    }
+  }
+  return false;
+}
+
+std::size_t RecordFilter::select(const Page &page,
+                                 std::vector<RecordId> &selection) const {
+  // Collect where the field is in every record long enough to have it, then
+  // test all of them in one go.
+  SlotId slots[MAX_RECORDS];
+  PageOffset offsets[MAX_RECORDS];
+  std::size_t count = 0;
+  const SlotId num_slots = page.header_->num_slots;
+  for (SlotId i = 1; i <= num_slots; ++i) {
+    const PageSlot *slot = page.getSlot(i);
+    if (slot->used && slot->item_length >= offset_ + width_) {
+      slots[count] = i;
+      offsets[count] = slot->item_offset + offset_;
+      ++count;
+    }
+  }
+
+  bool match[MAX_RECORDS];
+  switch (kind_) {
+    case Kind::EQUAL:
+      matchEqual(page.data_, Page::DATA_SIZE, offsets, count, value_, match);
+      break;
+    case Kind::INT32_RANGE:
+      matchInt32Range(page.data_, offsets, count,
+                      static_cast<std::int32_t>(low_),
+                      static_cast<std::int32_t>(high_), match);
+      break;
+    case Kind::INT64_RANGE:
+      matchInt64Range(page.data_, offsets, count, low_, high_, match);
+      break;
+  }
+
+  const std::size_t old_size = selection.size();
+  for (std::size_t i = 0; i < count; ++i) {
+    if (match[i]) selection.push_back({page.page_number(), slots[i]});
+  }
+  return selection.size() - old_size;
+}
+
+}  // namespace badgerdb
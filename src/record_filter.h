@@ -0,0 +1,134 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "page.h"
+#include "record_view.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief A simple predicate on a field at a fixed offset in records,
+ * evaluated over whole pages at a time.
+ *
+ * select() walks the slot directory of a page and tests the field of every
+ * record in place in the page's memory, with SIMD instructions where the
+ * target has them (SSE2 on x86): up to 16 bytes of an equality or prefix test
+ * are compared at once, and the values of 32-bit ranges are gathered and
+ * compared four at a time.  The IDs of matching records are appended to a
+ * selection vector.  Pages come from anywhere: a FileIterator, a ScanIterator
+ * over the buffer pool, or BufMgr::readPage().
+ *
+ * Integers are read in the machine's byte order.  Records too short to hold
+ * the field never match.
+ */
+class RecordFilter {
+ public:
+  /**
+   * Returns a filter for records whose bytes at <offset> are <value>.
+   *
+   * @param offset  Offset of the field in the record.
+   * @param value   Bytes the field must hold; copied.
+   */
+  static RecordFilter equal(const std::size_t offset, const RecordView &value);
+
+  /**
+   * Returns a filter for records starting with <value>.
+   *
+   * @param value   Bytes the record must start with; copied.
+   */
+  static RecordFilter prefix(const RecordView &value) {
+    return equal(0, value);
+  }
+
+  /**
+   * Returns a filter for records holding a 32-bit signed integer in
+   * [<low>, <high>] at <offset>.
+   *
+   * @param offset  Offset of the field in the record.
+   * @param low     Smallest value that matches.
+   * @param high    Largest value that matches.
+   */
+  static RecordFilter int32Range(const std::size_t offset,
+                                 const std::int32_t low,
+                                 const std::int32_t high);
+
+  /**
+   * Returns a filter for records holding a 64-bit signed integer in
+   * [<low>, <high>] at <offset>.
+   *
+   * @param offset  Offset of the field in the record.
+   * @param low     Smallest value that matches.
+   * @param high    Largest value that matches.
+   */
+  static RecordFilter int64Range(const std::size_t offset,
+                                 const std::int64_t low,
+                                 const std::int64_t high);
+
+  /**
+   * Returns whether a single record matches.
+   *
+   * @param record  Bytes that compose the record.
+   */
+  bool matches(const RecordView &record) const;
+
+  /**
+   * Appends the IDs of the records in a page that match to <selection>, in
+   * slot order.
+   *
+   * @param page        Page to scan.
+   * @param selection   Selection vector to append to.
+   * @return  Number of records appended.
+   */
+  std::size_t select(const Page &page, std::vector<RecordId> &selection) const;
+
+ private:
+  /**
+   * Kinds of predicates.
+   */
+  enum class Kind { EQUAL, INT32_RANGE, INT64_RANGE };
+
+  RecordFilter(const Kind kind, const std::size_t offset,
+               const std::size_t width)
+      : kind_(kind), offset_(offset), width_(width), low_(0), high_(0) {}
+
+  /**
+   * Kind of predicate
+   */
+  Kind kind_;
+
+  /**
+   * Offset of the field in the record
+   */
+  std::size_t offset_;
+
+  /**
+   * Size of the field in bytes
+   */
+  std::size_t width_;
+
+  /**
+   * Bytes an EQUAL field must hold
+   */
+  std::string value_;
+
+  /**
+   * Bounds of a range, inclusive
+   */
+  std::int64_t low_;
+  std::int64_t high_;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,71 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace badgerdb {
+
+/**
+ * @brief The bytes of a record where they are stored, e.g. in a page, without
+ * a copy: a pointer and a length.
+ *
+ * Like a pointer, a view does not keep what it points at alive.  A view of a
+ * record in a page is only valid until the page changes (any insert, update
+ * or delete may move records) or its memory is reused, e.g. by unpinning the
+ * page in the buffer pool.
+ */
+struct RecordView {
+  /**
+   * Constructs an empty view.
+   */
+  RecordView() : data(nullptr), length(0) {}
+
+  /**
+   * Constructs a view of <length> bytes at <data>.
+   */
+  RecordView(const char *data, const std::size_t length)
+      : data(data), length(length) {}
+
+  /**
+   * Constructs a view of the bytes of a string, valid as long as the string
+   * is not changed or destroyed.
+   */
+  RecordView(const std::string &bytes)
+      : data(bytes.data()), length(bytes.size()) {}
+
+  /**
+   * Returns a copy of the bytes.
+   */
+  std::string str() const { return std::string(data, length); }
+
+  /**
+   * Returns true if both views hold the same bytes.
+   */
+  bool operator==(const RecordView &rhs) const {
+    return length == rhs.length &&
+           (length == 0 || std::memcmp(data, rhs.data, length) == 0);
+  }
+
+  bool operator!=(const RecordView &rhs) const { return !(*this == rhs); }
+
+  /**
+   * First byte of the record
+   */
+  const char *data;
+
+  /**
+   * Number of bytes in the record
+   */
+  std::size_t length;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,30 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "replacement_policy.h"
+
+#include "clock_policy.h"
+#include "clock_pro_policy.h"
+#include "two_queue_policy.h"
+
+namespace badgerdb {
+
+std::unique_ptr<ReplacementPolicy> ReplacementPolicy::create(
+    const ReplacementPolicyType type, const std::uint32_t numFrames) {
+  switch (type) {
+    case ReplacementPolicyType::TWO_QUEUE:
+      return std::unique_ptr<ReplacementPolicy>(new TwoQueuePolicy(numFrames));
+    case ReplacementPolicyType::CLOCK_PRO:
+      return std::unique_ptr<ReplacementPolicy>(new ClockProPolicy(numFrames));
+    case ReplacementPolicyType::CLOCK:
+    default:
+      return std::unique_ptr<ReplacementPolicy>(new ClockPolicy(numFrames));
+  }
+}
+
+}  // namespace badgerdb
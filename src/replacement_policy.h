@@ -0,0 +1,172 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Identifier of a page across files: the file identifier in the upper
+ * and the page number in the lower 32 bits.
+ */
+typedef std::uint64_t PageKey;
+
+/**
+ * @brief Replacement policies shipped with the buffer manager.
+ */
+enum class ReplacementPolicyType {
+  /**
+   * Single reference bit clock (the default).
+   */
+  CLOCK,
+
+  /**
+   * Full 2Q (Johnson and Shasha): pages seen once age out through a FIFO
+   * without disturbing the LRU list of pages seen at least twice.
+   */
+  TWO_QUEUE,
+
+  /**
+   * CLOCK-Pro (Jiang, Chen and Zhang): clock with separate hot and cold
+   * pages and an adaptive cold share driven by re-references of recently
+   * evicted pages.
+   */
+  CLOCK_PRO
+};
+
+/**
+ * @brief The buffer pool frames as seen by a replacement policy while it is
+ * choosing a victim.  Implemented by the buffer manager.
+ */
+class FrameView {
+ public:
+  virtual ~FrameView() {}
+
+  /**
+   * Returns whether the frame has been referenced since this was last asked
+   * and clears its reference bit.
+   *
+   * @param frame   Frame to test
+   * @return  True if the reference bit was set
+   */
+  virtual bool testAndClearRefbit(const FrameId frame) = 0;
+
+  /**
+   * Tries to take the frame as the victim.  Succeeds if the frame holds no
+   * page or an unpinned one and no other thread is busy with it.  Never
+   * blocks.  Once this returns true the policy must stop looking and return
+   * the frame.
+   *
+   * @param frame   Frame to take
+   * @return  True if the frame was taken
+   */
+  virtual bool tryClaim(const FrameId frame) = 0;
+};
+
+/**
+ * @brief Interface of the page replacement policy used by BufMgr.
+ *
+ * The buffer manager reports what happens to each frame and asks the policy
+ * for a victim whenever it needs a frame.  Notifications may arrive from
+ * concurrent threads, so implementations synchronize themselves.  BufMgr
+ * may call in while holding the latch of the frame concerned; FrameView
+ * calls never block, so a policy may make them under its own lock.
+ *
+ * Hits are the hot path: BufMgr sets the frame's reference bit itself (it is
+ * also set when a page is loaded) and calls onAccess, which should be cheap.
+ */
+class ReplacementPolicy {
+ public:
+  virtual ~ReplacementPolicy() {}
+
+  /**
+   * Creates one of the built-in policies.
+   *
+   * @param type        Policy to create
+   * @param numFrames   Number of frames the buffer pool can grow to
+   */
+  static std::unique_ptr<ReplacementPolicy> create(
+      const ReplacementPolicyType type, const std::uint32_t numFrames);
+
+  /**
+   * Returns a short name of the policy.
+   */
+  virtual const char *name() const = 0;
+
+  /**
+   * A page has been read into (or allocated in) the frame.
+   *
+   * @param frame   Frame holding the page
+   * @param key     Identifier of the page
+   */
+  virtual void onLoad(const FrameId frame, const PageKey key) = 0;
+
+  /**
+   * The page in the frame was requested while already in the pool.
+   *
+   * @param frame   Frame holding the page
+   */
+  virtual void onAccess(const FrameId frame) = 0;
+
+  /**
+   * The page in the frame went from unpinned to pinned.
+   *
+   * @param frame   Frame holding the page
+   */
+  virtual void onPin(const FrameId frame) {}
+
+  /**
+   * The page in the frame went from pinned to unpinned.
+   *
+   * @param frame   Frame holding the page
+   */
+  virtual void onUnpin(const FrameId frame) {}
+
+  /**
+   * The page in a frame returned by pickVictim has been evicted.
+   *
+   * @param frame   Frame that held the page
+   */
+  virtual void onEvict(const FrameId frame) = 0;
+
+  /**
+   * The page in the frame was dropped from the pool without being chosen as
+   * a victim (flushFile, disposePage), so the frame is free.
+   *
+   * @param frame   Frame that held the page
+   */
+  virtual void onRemove(const FrameId frame) = 0;
+
+  /**
+   * The pool now uses frames [0, frames) only; frames past it hold no page
+   * and are neither offered nor looked at until the pool grows into them
+   * again.  Policies start out using every frame they were created with.
+   * BufMgr calls this after emptying the frames it drops and before any
+   * frame it adds is used.
+   *
+   * @param frames  Number of frames in use, at most the number the policy
+   *                was created with
+   */
+  virtual void onResize(const std::uint32_t frames) = 0;
+
+  /**
+   * Chooses the frame to be reused next and claims it through the view.
+   *
+   * @param frames  The buffer pool frames
+   * @param victim  Set to the claimed frame
+   * @return  False if no frame could be claimed
+   */
+  virtual bool pickVictim(FrameView &frames, FrameId &victim) = 0;
+};
+
+}  // namespace badgerdb
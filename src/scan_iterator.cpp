@@ -0,0 +1,126 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "scan_iterator.h"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+namespace badgerdb {
+
+const std::uint32_t ScanIterator::DEFAULT_WINDOW;
+
+ScanIterator::ScanIterator()
+    : buf_mgr_(NULL),
+      file_(NULL),
+      current_page_number_(Page::INVALID_NUMBER),
+      page_(NULL),
+      dirty_(false),
+      max_window_(0),
+      window_(0),
+      prefetched_until_(Page::INVALID_NUMBER),
+      next_batch_(Page::INVALID_NUMBER) {}
+
+ScanIterator::ScanIterator(BufMgr *buf_mgr, File *file,
+                           const std::uint32_t window)
+    : buf_mgr_(buf_mgr),
+      file_(file),
+      current_page_number_(Page::INVALID_NUMBER),
+      page_(NULL),
+      dirty_(false),
+      max_window_(window),
+      window_(std::min<std::uint32_t>(4, window)),
+      prefetched_until_(Page::INVALID_NUMBER),
+      next_batch_(0) {
+  assert(buf_mgr_ != NULL && file_ != NULL);
+  const PageId first = file_->readHeader().first_used_page;
+  prefetched_until_ = first;
+  moveTo(first);
+}
+
+ScanIterator::ScanIterator(ScanIterator &&other)
+    : buf_mgr_(other.buf_mgr_),
+      file_(other.file_),
+      current_page_number_(other.current_page_number_),
+      page_(other.page_),
+      dirty_(other.dirty_),
+      max_window_(other.max_window_),
+      window_(other.window_),
+      prefetched_until_(other.prefetched_until_),
+      next_batch_(other.next_batch_) {
+  other.current_page_number_ = Page::INVALID_NUMBER;
+  other.page_ = NULL;
+}
+
+ScanIterator &ScanIterator::operator=(ScanIterator &&rhs) {
+  if (this != &rhs) {
+    release();
+    buf_mgr_ = rhs.buf_mgr_;
+    file_ = rhs.file_;
+    current_page_number_ = rhs.current_page_number_;
+    page_ = rhs.page_;
+    dirty_ = rhs.dirty_;
+    max_window_ = rhs.max_window_;
+    window_ = rhs.window_;
+    prefetched_until_ = rhs.prefetched_until_;
+    next_batch_ = rhs.next_batch_;
+    rhs.current_page_number_ = Page::INVALID_NUMBER;
+    rhs.page_ = NULL;
+  }
+  return *this;
+}
+
+ScanIterator::~ScanIterator() { release(); }
+
+ScanIterator &ScanIterator::operator++() {
+  assert(page_ != NULL);
+  moveTo(file_->nextUsedPage(current_page_number_));
+  return *this;
+}
+
+void ScanIterator::moveTo(const PageId page_number) {
+  release();
+  if (page_number == Page::INVALID_NUMBER) return;
+
+  // Keep one batch ahead: reaching the batch asked for last asks for the
+  // next, which is read while this one is processed.
+  if (page_number >= next_batch_ && window_ > 0) prefetchAhead();
+  buf_mgr_->readPage(*file_, page_number, page_, AccessIntent::SEQUENTIAL);
+  current_page_number_ = page_number;
+}
+
+void ScanIterator::prefetchAhead() {
+  std::vector<PageId> batch;
+  batch.reserve(window_);
+  for (PageId page_number = prefetched_until_;
+       batch.size() < window_ &&
+       (page_number = file_->nextUsedPage(page_number)) !=
+           Page::INVALID_NUMBER;) {
+    batch.push_back(page_number);
+  }
+  if (batch.empty()) {
+    next_batch_ = Page::INVALID_NUMBER;
+    return;
+  }
+
+  buf_mgr_->prefetch(*file_, batch.data(), batch.size());
+  next_batch_ = batch.front();
+  prefetched_until_ = batch.back();
+  window_ = std::min(2 * window_, max_window_);
+}
+
+void ScanIterator::release() {
+  if (page_ == NULL) return;
+  buf_mgr_->unPinPage(*file_, current_page_number_, dirty_);
+  page_ = NULL;
+  dirty_ = false;
+  current_page_number_ = Page::INVALID_NUMBER;
+}
+
+}  // namespace badgerdb
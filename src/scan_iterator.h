@@ -0,0 +1,160 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Iterator scanning the pages of a file through the buffer pool.
+ *
+ * Unlike FileIterator, which copies every page out of the file, this one
+ * yields the page pinned in its buffer pool frame; it stays pinned until the
+ * iterator moves on or is destroyed.  Pages are visited in page order, and
+ * as the scan goes on the pages coming up are prefetched into the pool (see
+ * BufMgr::prefetch()) so that reading them overlaps with processing the
+ * current ones.  The read-ahead window starts small and doubles with every
+ * batch up to the maximum, so short scans do not drag in pages they never
+ * use.  Pages are asked for with AccessIntent::SEQUENTIAL, so a scan does
+ * not push the working set out of the pool.
+ *
+ * Iterators are moved, not copied, as each holds a pin.
+ */
+class ScanIterator {
+ public:
+  /**
+   * Default maximum read-ahead window, in pages.
+   */
+  static const std::uint32_t DEFAULT_WINDOW = 32;
+
+  /**
+   * Constructs an iterator past the end of any file.
+   */
+  ScanIterator();
+
+  /**
+   * Constructs an iterator at the first page of a file, which it pins.
+   *
+   * @param buf_mgr   Buffer manager to go through.
+   * @param file      File to scan.
+   * @param window    Most pages to read ahead at a time; keep it well below
+   *                  the size of the buffer pool.  0 turns read-ahead off.
+   */
+  ScanIterator(BufMgr *buf_mgr, File *file,
+               const std::uint32_t window = DEFAULT_WINDOW);
+
+  ScanIterator(ScanIterator &&other);
+  ScanIterator &operator=(ScanIterator &&rhs);
+  ScanIterator(const ScanIterator &) = delete;
+  ScanIterator &operator=(const ScanIterator &) = delete;
+
+  /**
+   * Unpins the current page.
+   */
+  ~ScanIterator();
+
+  /**
+   * Unpins the current page and advances the iterator to the next page in
+   * the file, pinning it.
+   */
+  ScanIterator &operator++();
+
+  /**
+   * Returns true if this iterator is equal to the given iterator.
+   *
+   * @param rhs   Iterator to compare against.
+   * @return    True if other iterator is equal to this one.
+   */
+  bool operator==(const ScanIterator &rhs) const {
+    return current_page_number_ == rhs.current_page_number_ &&
+           (current_page_number_ == Page::INVALID_NUMBER ||
+            file_->filename() == rhs.file_->filename());
+  }
+
+  bool operator!=(const ScanIterator &rhs) const { return !(*this == rhs); }
+
+  /**
+   * Returns the current page, in its buffer pool frame.
+   */
+  Page *operator*() const { return page_; }
+
+  Page *operator->() const { return page_; }
+
+  /**
+   * Marks the current page dirty, so that it is written back after the
+   * iterator unpins it.
+   */
+  void markDirty() { dirty_ = true; }
+
+ private:
+  /**
+   * Unpins the current page and pins the given one, prefetching more if the
+   * scan has reached the last batch asked for.
+   */
+  void moveTo(const PageId page_number);
+
+  /**
+   * Asks for the next batch of pages after the ones already prefetched.
+   */
+  void prefetchAhead();
+
+  /**
+   * Unpins the current page, if any.
+   */
+  void release();
+
+  /**
+   * Buffer manager the pages are pinned in.
+   */
+  BufMgr *buf_mgr_;
+
+  /**
+   * File we're iterating over.
+   */
+  File *file_;
+
+  /**
+   * Number of page iterator is currently pointing to.
+   */
+  PageId current_page_number_;
+
+  /**
+   * The current page, pinned.
+   */
+  Page *page_;
+
+  /**
+   * Whether the current page is to be unpinned dirty.
+   */
+  bool dirty_;
+
+  /**
+   * Largest and current read-ahead window.
+   */
+  std::uint32_t max_window_;
+  std::uint32_t window_;
+
+  /**
+   * Last page prefetched so far.
+   */
+  PageId prefetched_until_;
+
+  /**
+   * First page of the last batch prefetched; reaching it prefetches the next.
+   */
+  PageId next_batch_;
+};
+
+}  // namespace badgerdb
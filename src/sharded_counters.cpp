@@ -0,0 +1,21 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "sharded_counters.h"
+
+namespace badgerdb {
+
+std::size_t currentCounterShard() {
+  static std::atomic<std::size_t> next_shard(0);
+  thread_local const std::size_t shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) %
+      ShardedCounters<1>::NUM_SHARDS;
+  return shard;
+}
+
+}  // namespace badgerdb
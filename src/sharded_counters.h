@@ -0,0 +1,186 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+ * Returns the shard of ShardedCounters the calling thread counts in, fixed
+ * for the thread's lifetime.  Threads are spread over the shards round robin
+ * as they first count.
+ */
+std::size_t currentCounterShard();
+
+/**
+ * @brief A fixed set of 64-bit event counters that many threads can bump at
+ * once without contending.
+ *
+ * Every counter exists once per shard and a thread only ever adds to the
+ * copies in its own shard, with relaxed atomic adds on a cache line no other
+ * shard uses, so counting costs about as much as an uncontended increment.
+ * Reading a counter sums its copies; reads are not atomic with respect to
+ * each other but never lose counts.
+ *
+ * @tparam N  Number of counters
+ */
+template <std::size_t N>
+class ShardedCounters {
+ public:
+  /**
+   * Number of shards; threads beyond this share them.
+   */
+  static const std::size_t NUM_SHARDS = 16;
+
+  ShardedCounters() { clear(); }
+
+  ShardedCounters(const ShardedCounters &) = delete;
+  ShardedCounters &operator=(const ShardedCounters &) = delete;
+
+  /**
+   * Adds to a counter.
+   *
+   * @param counter   Index of the counter, below N
+   * @param n         Amount to add
+   */
+  void add(const std::size_t counter, const std::uint64_t n = 1) {
+    shards_[currentCounterShard()].values[counter].fetch_add(
+        n, std::memory_order_relaxed);
+  }
+
+  /**
+   * Returns the sum of a counter over all shards.
+   *
+   * @param counter   Index of the counter, below N
+   */
+  std::uint64_t value(const std::size_t counter) const {
+    std::uint64_t sum = 0;
+    for (const Shard &shard : shards_) {
+      sum += shard.values[counter].load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  /**
+   * Sets every counter to zero.
+   */
+  void clear() {
+    for (Shard &shard : shards_) {
+      for (std::atomic<std::uint64_t> &value : shard.values) {
+        value.store(0, std::memory_order_relaxed);
+      }
+    }
+  }
+
+ private:
+  static const std::size_t CACHE_LINE = 64;
+
+  /**
+   * The counters of one shard, padded to whole cache lines
+   */
+  struct Shard {
+    std::atomic<std::uint64_t> values[N];
+    char padding[CACHE_LINE - N * sizeof(std::uint64_t) % CACHE_LINE];
+  };
+
+  Shard shards_[NUM_SHARDS];
+};
+
+/**
+ * @brief Counts of latencies in power-of-two buckets, copied out of a
+ * LatencyHistogram.
+ */
+struct LatencySnapshot {
+  /**
+   * Number of latencies in each bucket: bucket 0 holds those under 2 ns,
+   * bucket i > 0 those in [2^i, 2^(i+1)) ns, and the last one everything
+   * longer.
+   */
+  std::vector<std::uint64_t> buckets;
+
+  /**
+   * Returns the number of latencies recorded.
+   */
+  std::uint64_t count() const {
+    std::uint64_t sum = 0;
+    for (const std::uint64_t n : buckets) sum += n;
+    return sum;
+  }
+
+  /**
+   * Returns an upper bound, in nanoseconds, of the latency below which
+   * <percent> percent of them fall: the end of the bucket it is in.  0 if
+   * there are none.
+   *
+   * @param percent   Percentile, 0 to 100
+   */
+  std::uint64_t percentile(const double percent) const {
+    const std::uint64_t total = count();
+    if (total == 0) return 0;
+    const double rank = percent / 100.0 * total;
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets.size(); ++i) {
+      seen += buckets[i];
+      if (seen >= rank && seen > 0) return std::uint64_t(2) << i;
+    }
+    return std::uint64_t(2) << (buckets.size() - 1);
+  }
+};
+
+/**
+ * @brief Histogram of operation latencies in power-of-two nanosecond buckets,
+ * as cheap to record into from many threads as ShardedCounters.
+ */
+class LatencyHistogram {
+ public:
+  /**
+   * Number of buckets; the last one holds latencies of 2^31 ns (2 s) and up.
+   */
+  static const std::size_t NUM_BUCKETS = 32;
+
+  /**
+   * Records a latency.
+   *
+   * @param nanoseconds   The latency
+   */
+  void record(const std::uint64_t nanoseconds) {
+    std::size_t bucket = 0;
+    if (nanoseconds > 1) {
+      bucket = 63 - __builtin_clzll(nanoseconds);
+      if (bucket >= NUM_BUCKETS) bucket = NUM_BUCKETS - 1;
+    }
+    buckets_.add(bucket);
+  }
+
+  /**
+   * Returns the counts recorded so far.
+   */
+  LatencySnapshot snapshot() const {
+    LatencySnapshot snapshot;
+    snapshot.buckets.resize(NUM_BUCKETS);
+    for (std::size_t i = 0; i < NUM_BUCKETS; ++i) {
+      snapshot.buckets[i] = buckets_.value(i);
+    }
+    return snapshot;
+  }
+
+  /**
+   * Forgets every latency recorded.
+   */
+  void clear() { buckets_.clear(); }
+
+ private:
+  ShardedCounters<NUM_BUCKETS> buckets_;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,57 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "thread_pool_io_engine.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+ThreadPoolIoEngine::ThreadPoolIoEngine(const std::uint32_t threads)
+    : stopping_(false) {
+  for (std::uint32_t i = 0; i < std::max<std::uint32_t>(1, threads); i++) {
+    workers_.emplace_back(&ThreadPoolIoEngine::run, this);
+  }
+}
+
+ThreadPoolIoEngine::~ThreadPoolIoEngine() {
+  {
+    std::lock_guard<std::mutex> latch(latch_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& worker : workers_) worker.join();
+}
+
+void ThreadPoolIoEngine::submit(std::unique_ptr<IoRequest> request) {
+  {
+    std::lock_guard<std::mutex> latch(latch_);
+    queue_.push_back(std::move(request));
+  }
+  wake_.notify_one();
+}
+
+/**
+ * Workers finish the queue before they stop, so every request is done.
+ */
+void ThreadPoolIoEngine::run() {
+  std::unique_lock<std::mutex> latch(latch_);
+  for (;;) {
+    wake_.wait(latch, [this]() { return stopping_ || !queue_.empty(); });
+    if (queue_.empty()) return;
+
+    std::unique_ptr<IoRequest> request = std::move(queue_.front());
+    queue_.pop_front();
+    latch.unlock();
+    request->done(perform(*request, 0));
+    request.reset();
+    latch.lock();
+  }
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,58 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "io_engine.h"
+
+namespace badgerdb {
+
+/**
+ * @brief I/O engine running requests on a pool of worker threads, each doing
+ * one blocking request at a time through the file's backend.  Works with
+ * every backend and kernel.
+ */
+class ThreadPoolIoEngine : public IoEngine {
+ public:
+  /**
+   * Starts the worker threads.
+   *
+   * @param threads   Number of workers, at least one
+   */
+  explicit ThreadPoolIoEngine(const std::uint32_t threads);
+
+  ~ThreadPoolIoEngine() override;
+
+  const char* name() const override { return "threads"; }
+
+  void submit(std::unique_ptr<IoRequest> request) override;
+
+ private:
+  /**
+   * Body of the worker threads.
+   */
+  void run();
+
+  /**
+   * Protects queue_ and stopping_
+   */
+  std::mutex latch_;
+  std::condition_variable wake_;
+  std::deque<std::unique_ptr<IoRequest>> queue_;
+  bool stopping_;
+
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,165 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "two_queue_policy.h"
+
+#include <algorithm>
+
+namespace badgerdb {
+
+const FrameId TwoQueuePolicy::NIL;
+
+bool GhostList::add(const PageKey key) {
+  remove(key);
+  members_[key] = sequence_;
+  order_.emplace_back(key, sequence_++);
+
+  bool forgot = false;
+  while (members_.size() > capacity_ ||
+         (!order_.empty() && order_.size() > 2 * capacity_)) {
+    const std::pair<PageKey, std::uint64_t> oldest = order_.front();
+    order_.pop_front();
+    auto member = members_.find(oldest.first);
+    if (member != members_.end() && member->second == oldest.second) {
+      members_.erase(member);
+      forgot = true;
+    }
+  }
+  return forgot;
+}
+
+bool GhostList::remove(const PageKey key) { return members_.erase(key) > 0; }
+
+TwoQueuePolicy::TwoQueuePolicy(const std::uint32_t numFrames)
+    : numFrames_(numFrames),
+      kin_(std::max<std::uint32_t>(1, numFrames / 4)),
+      prev_(numFrames, NIL),
+      next_(numFrames, NIL),
+      queue_(numFrames, FREE),
+      keys_(numFrames, 0),
+      free_{NIL, NIL, 0},
+      a1in_{NIL, NIL, 0},
+      am_{NIL, NIL, 0},
+      a1out_(std::max<std::uint32_t>(1, numFrames / 2)) {
+  for (FrameId i = 0; i < numFrames; i++) push(free_, FREE, i);
+}
+
+FrameList &TwoQueuePolicy::listOf(const Queue queue) {
+  switch (queue) {
+    case A1IN:
+      return a1in_;
+    case AM:
+      return am_;
+    default:
+      return free_;
+  }
+}
+
+void TwoQueuePolicy::push(FrameList &list, const Queue queue,
+                          const FrameId frame) {
+  queue_[frame] = queue;
+  prev_[frame] = list.tail;
+  next_[frame] = NIL;
+  if (list.tail != NIL) {
+    next_[list.tail] = frame;
+  } else {
+    list.head = frame;
+  }
+  list.tail = frame;
+  list.size++;
+}
+
+void TwoQueuePolicy::unlink(const FrameId frame) {
+  FrameList &list = listOf(queue_[frame]);
+  if (prev_[frame] != NIL) {
+    next_[prev_[frame]] = next_[frame];
+  } else {
+    list.head = next_[frame];
+  }
+  if (next_[frame] != NIL) {
+    prev_[next_[frame]] = prev_[frame];
+  } else {
+    list.tail = prev_[frame];
+  }
+  list.size--;
+}
+
+void TwoQueuePolicy::onLoad(const FrameId frame, const PageKey key) {
+  std::lock_guard<std::mutex> latch(latch_);
+  unlink(frame);
+  keys_[frame] = key;
+
+  // Seen again shortly after leaving A1in: the page is worth keeping.
+  if (a1out_.remove(key)) {
+    push(am_, AM, frame);
+  } else {
+    push(a1in_, A1IN, frame);
+  }
+}
+
+void TwoQueuePolicy::onAccess(const FrameId frame) {
+  std::unique_lock<std::mutex> latch(latch_, std::try_to_lock);
+  if (!latch.owns_lock()) return;
+
+  // Hits in A1in are correlated references and do not promote the page.
+  if (queue_[frame] == AM && am_.tail != frame) {
+    unlink(frame);
+    push(am_, AM, frame);
+  }
+}
+
+void TwoQueuePolicy::onEvict(const FrameId frame) {
+  std::lock_guard<std::mutex> latch(latch_);
+  if (queue_[frame] == A1IN) a1out_.add(keys_[frame]);
+  unlink(frame);
+  push(free_, FREE, frame);
+}
+
+void TwoQueuePolicy::onRemove(const FrameId frame) {
+  std::lock_guard<std::mutex> latch(latch_);
+  unlink(frame);
+  push(free_, FREE, frame);
+}
+
+void TwoQueuePolicy::onResize(const std::uint32_t frames) {
+  std::lock_guard<std::mutex> latch(latch_);
+  // frames dropped hold no page, so they are all on the free queue
+  for (FrameId i = frames; i < numFrames_; i++) {
+    unlink(i);
+    queue_[i] = UNUSED;
+  }
+  for (FrameId i = numFrames_; i < frames; i++) push(free_, FREE, i);
+  numFrames_ = frames;
+  kin_ = std::max<std::uint32_t>(1, frames / 4);
+  a1out_.setCapacity(std::max<std::uint32_t>(1, frames / 2));
+}
+
+bool TwoQueuePolicy::claimFrom(const FrameList &list, FrameView &frames,
+                               FrameId &victim) {
+  for (FrameId frame = list.head; frame != NIL; frame = next_[frame]) {
+    if (frames.tryClaim(frame)) {
+      victim = frame;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool TwoQueuePolicy::pickVictim(FrameView &frames, FrameId &victim) {
+  std::lock_guard<std::mutex> latch(latch_);
+  if (claimFrom(free_, frames, victim)) return true;
+
+  // Reclaim from A1in while it is over its share, otherwise from the LRU end
+  // of Am; fall back to the other queue if every frame in one is pinned.
+  if (a1in_.size > kin_ || am_.size == 0) {
+    return claimFrom(a1in_, frames, victim) || claimFrom(am_, frames, victim);
+  }
+  return claimFrom(am_, frames, victim) || claimFrom(a1in_, frames, victim);
+}
+
+}  // namespace badgerdb
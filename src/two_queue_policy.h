@@ -0,0 +1,156 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "replacement_policy.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Queue of frames threaded through per-frame prev/next arrays, oldest
+ * frame at the head.
+ */
+struct FrameList {
+  FrameId head;
+  FrameId tail;
+  std::uint32_t size;
+};
+
+/**
+ * @brief Bounded FIFO of recently evicted pages, with O(1) membership test.
+ */
+class GhostList {
+ public:
+  /**
+   * @param capacity  Maximum number of pages remembered
+   */
+  explicit GhostList(const std::uint32_t capacity)
+      : capacity_(capacity), sequence_(0) {}
+
+  /**
+   * Remembers a page, forgetting the oldest one if the list is full.
+   *
+   * @return  True if a page had to be forgotten to make room
+   */
+  bool add(const PageKey key);
+
+  /**
+   * Forgets a page if it is remembered.
+   *
+   * @return  True if the page was remembered
+   */
+  bool remove(const PageKey key);
+
+  /**
+   * Changes the number of pages remembered; a smaller list forgets its
+   * oldest pages as new ones are added.
+   */
+  void setCapacity(const std::uint32_t capacity) { capacity_ = capacity; }
+
+ private:
+  std::uint32_t capacity_;
+  std::uint64_t sequence_;
+
+  /**
+   * Pages in insertion order with the sequence number they were added with;
+   * entries whose page was removed since are skipped when they age out.
+   */
+  std::deque<std::pair<PageKey, std::uint64_t>> order_;
+
+  /**
+   * Remembered pages and the sequence number of their live entry in order_
+   */
+  std::unordered_map<PageKey, std::uint64_t> members_;
+};
+
+/**
+ * @brief The full 2Q replacement algorithm (Johnson and Shasha, VLDB 1994).
+ *
+ * Pages brought in for the first time enter the A1in FIFO, which is kept at
+ * about a quarter of the pool.  Pages evicted from A1in are remembered in the
+ * A1out ghost list; if one of them is requested again it is loaded straight
+ * into Am, an LRU list of pages that have proven to be reused.  A large scan
+ * therefore only cycles through A1in and leaves Am alone.
+ *
+ * Victim selection and loads take the policy latch.  Hits only try it and
+ * skip the LRU update when it is contended, so hit paths never queue up
+ * behind it; Am is then an approximate LRU.
+ */
+class TwoQueuePolicy : public ReplacementPolicy {
+ public:
+  /**
+   * Constructor of TwoQueuePolicy class
+   *
+   * @param numFrames   Number of frames the buffer pool can grow to
+   */
+  explicit TwoQueuePolicy(const std::uint32_t numFrames);
+
+  const char *name() const override { return "2q"; }
+
+  void onLoad(const FrameId frame, const PageKey key) override;
+  void onAccess(const FrameId frame) override;
+  void onEvict(const FrameId frame) override;
+  void onRemove(const FrameId frame) override;
+  void onResize(const std::uint32_t frames) override;
+  bool pickVictim(FrameView &frames, FrameId &victim) override;
+
+ private:
+  /**
+   * Queue a frame is on; frames past the ones in use are on none
+   */
+  enum Queue : std::uint8_t { FREE, A1IN, AM, UNUSED };
+
+  void push(FrameList &list, const Queue queue, const FrameId frame);
+  void unlink(const FrameId frame);
+  FrameList &listOf(const Queue queue);
+
+  /**
+   * Claims the oldest claimable frame of a list.
+   */
+  bool claimFrom(const FrameList &list, FrameView &frames, FrameId &victim);
+
+  static const FrameId NIL = ~FrameId(0);
+
+  /**
+   * Protects everything below
+   */
+  std::mutex latch_;
+
+  /**
+   * Number of frames in use
+   */
+  std::uint32_t numFrames_;
+
+  /**
+   * Target size of A1in
+   */
+  std::uint32_t kin_;
+
+  std::vector<FrameId> prev_;
+  std::vector<FrameId> next_;
+  std::vector<Queue> queue_;
+  std::vector<PageKey> keys_;
+
+  FrameList free_;
+  FrameList a1in_;
+  FrameList am_;
+
+  /**
+   * Pages recently evicted from A1in
+   */
+  GhostList a1out_;
+};
+
+}  // namespace badgerdb
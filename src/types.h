@@ -22,11 +22,29 @@ typedef std::uint32_t PageId;
  */
 typedef std::uint16_t SlotId;
 
+/**
+ * @brief Offset or length of bytes within the data of a page.  16 bits cover
+ * the data of the largest pages, see Page::SIZE.
+ */
+typedef std::uint16_t PageOffset;
+
 /**
  * @brief Identifier for a frame in buffer pool.
  */
 typedef std::uint32_t FrameId;
 
+/**
+ * @brief Identifier for an open file.  All File objects referring to the same
+ * open file share one identifier; 0 is never assigned to an open file.
+ */
+typedef std::uint32_t FileId;
+
+/**
+ * @brief Log sequence number: the position in the write-ahead log just past
+ * the end of a log record, see LogManager.  0 is before every record.
+ */
+typedef std::uint64_t Lsn;
+
 /**
  * @brief Identifier for a record in a page.
  */
@@ -0,0 +1,196 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "uring_io_engine.h"
+
+#include <limits.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace badgerdb {
+
+namespace {
+
+int ioUringSetup(const unsigned entries, struct io_uring_params* params) {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int ioUringEnter(const int fd, const unsigned to_submit,
+                 const unsigned min_complete, const unsigned flags) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit,
+                                    min_complete, flags, nullptr, 0));
+}
+
+unsigned* field(void* ring, const std::uint32_t offset) {
+  return reinterpret_cast<unsigned*>(static_cast<char*>(ring) + offset);
+}
+
+/**
+ * Marks the submission that wakes the completion thread to stop.
+ */
+const std::uint64_t WAKE_UP = 0;
+
+}  // namespace
+
+std::unique_ptr<IoEngine> UringIoEngine::tryCreate(const std::uint32_t depth) {
+  struct io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  // one more entry for the wake-up submission
+  const int fd = ioUringSetup(depth + 1, &params);
+  if (fd < 0) return nullptr;
+
+  std::unique_ptr<UringIoEngine> engine(new UringIoEngine());
+  engine->ring_fd_ = fd;
+  engine->depth_ = std::min(depth, params.sq_entries - 1);
+  if (engine->depth_ == 0 || !engine->mapRings(&params)) return nullptr;
+  engine->completer_ = std::thread(&UringIoEngine::reap, engine.get());
+  return std::move(engine);
+}
+
+bool UringIoEngine::mapRings(const void* raw_params) {
+  const struct io_uring_params& params =
+      *static_cast<const struct io_uring_params*>(raw_params);
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    return false;
+  }
+  sq_tail_ = field(sq_ring_, params.sq_off.tail);
+  sq_mask_ = field(sq_ring_, params.sq_off.ring_mask);
+  sq_array_ = field(sq_ring_, params.sq_off.array);
+
+  sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqes = ::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) return false;
+  sqes_ = static_cast<struct io_uring_sqe*>(sqes);
+
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+  cq_ring_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+  if (cq_ring_ == MAP_FAILED) {
+    cq_ring_ = nullptr;
+    return false;
+  }
+  cq_head_ = field(cq_ring_, params.cq_off.head);
+  cq_tail_ = field(cq_ring_, params.cq_off.tail);
+  cq_mask_ = field(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<struct io_uring_cqe*>(
+      static_cast<char*>(cq_ring_) + params.cq_off.cqes);
+  return true;
+}
+
+UringIoEngine::~UringIoEngine() {
+  if (completer_.joinable()) {
+    std::lock_guard<std::mutex> latch(latch_);
+    stopping_ = true;
+    push(IORING_OP_NOP, -1, 0, nullptr, 0, WAKE_UP);
+  }
+  if (completer_.joinable()) completer_.join();
+  if (sqes_ != nullptr) ::munmap(sqes_, sqes_size_);
+  if (sq_ring_ != nullptr) ::munmap(sq_ring_, sq_ring_size_);
+  if (cq_ring_ != nullptr) ::munmap(cq_ring_, cq_ring_size_);
+  if (ring_fd_ >= 0) ::close(ring_fd_);
+}
+
+void UringIoEngine::submit(std::unique_ptr<IoRequest> request) {
+  const int fd = request->backend->fd();
+  if (fd < 0 || request->buffers.size() > IOV_MAX) {
+    request->done(perform(*request, 0));
+    return;
+  }
+
+  std::unique_lock<std::mutex> latch(latch_);
+  space_.wait(latch, [this]() { return in_flight_ < depth_; });
+  in_flight_++;
+  const std::uint8_t opcode = request->operation == IoRequest::READ
+                                  ? IORING_OP_READV
+                                  : IORING_OP_WRITEV;
+  IoRequest* const raw = request.release();
+  push(opcode, fd, raw->offset, raw->buffers.data(),
+       static_cast<std::uint32_t>(raw->buffers.size()),
+       reinterpret_cast<std::uintptr_t>(raw));
+}
+
+void UringIoEngine::push(const std::uint8_t opcode, const int fd,
+                         const std::uint64_t offset,
+                         const struct iovec* buffers,
+                         const std::uint32_t count,
+                         const std::uint64_t user_data) {
+  // We are the only producer, so the tail only changes here.
+  const unsigned tail = *sq_tail_;
+  const unsigned index = tail & *sq_mask_;
+  struct io_uring_sqe& sqe = sqes_[index];
+  std::memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = opcode;
+  sqe.fd = fd;
+  sqe.off = offset;
+  sqe.addr = reinterpret_cast<std::uintptr_t>(buffers);
+  sqe.len = count;
+  sqe.user_data = user_data;
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+  while (ioUringEnter(ring_fd_, 1, 0, 0) < 0 &&
+         (errno == EINTR || errno == EAGAIN || errno == EBUSY)) {
+  }
+}
+
+/**
+ * Runs until stopped and every request in flight is done.
+ */
+void UringIoEngine::reap() {
+  for (;;) {
+    // We are the only consumer, so the head only changes here.
+    const unsigned head = *cq_head_;
+    if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      {
+        std::lock_guard<std::mutex> latch(latch_);
+        if (stopping_ && in_flight_ == 0) return;
+      }
+      ioUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS);
+      continue;
+    }
+
+    const struct io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+    const std::uint64_t user_data = cqe.user_data;
+    const int result = cqe.res;
+    __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+    if (user_data == WAKE_UP) continue;
+
+    // Taking the latch the request was pushed under also orders our reads
+    // of it after the submitter's writes for tools that cannot see the ring.
+    {
+      std::lock_guard<std::mutex> latch(latch_);
+      in_flight_--;
+    }
+    space_.notify_one();
+
+    std::unique_ptr<IoRequest> request(reinterpret_cast<IoRequest*>(user_data));
+    int error = 0;
+    if (result < 0) {
+      error = -result;
+    } else if (static_cast<std::size_t>(result) < request->size()) {
+      // short transfer, e.g. a read reaching the end of the file
+      error = perform(*request, result);
+    }
+    request->done(error);
+  }
+}
+
+}  // namespace badgerdb
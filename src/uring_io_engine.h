@@ -0,0 +1,107 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include "io_engine.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace badgerdb {
+
+/**
+ * @brief I/O engine on a Linux io_uring, used through the raw system calls.
+ *
+ * Requests become READV/WRITEV submissions on the ring; one completion thread
+ * reaps them and calls their done callbacks.  A request the kernel completes
+ * only in part is finished with blocking calls on the completion thread.
+ * Requests on backends without a file descriptor are done right away in the
+ * submitting thread.
+ */
+class UringIoEngine : public IoEngine {
+ public:
+  /**
+   * Sets up a ring with room for <depth> requests in flight.
+   *
+   * @return The engine, or null if the kernel does not support io_uring
+   */
+  static std::unique_ptr<IoEngine> tryCreate(const std::uint32_t depth);
+
+  ~UringIoEngine() override;
+
+  const char* name() const override { return "io_uring"; }
+
+  void submit(std::unique_ptr<IoRequest> request) override;
+
+ private:
+  UringIoEngine() {}
+
+  /**
+   * Maps the rings of ring_fd_; false if that fails.
+   */
+  bool mapRings(const void* params);
+
+  /**
+   * Queues a submission and hands it to the kernel; called with latch_ held.
+   */
+  void push(const std::uint8_t opcode, const int fd, const std::uint64_t offset,
+            const struct iovec* buffers, const std::uint32_t count,
+            const std::uint64_t user_data);
+
+  /**
+   * Body of the completion thread.
+   */
+  void reap();
+
+  int ring_fd_ = -1;
+
+  /**
+   * Submission queue ring and entries
+   */
+  void* sq_ring_ = nullptr;
+  std::size_t sq_ring_size_ = 0;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_mask_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  io_uring_sqe* sqes_ = nullptr;
+  std::size_t sqes_size_ = 0;
+
+  /**
+   * Completion queue ring
+   */
+  void* cq_ring_ = nullptr;
+  std::size_t cq_ring_size_ = 0;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned* cq_mask_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+
+  /**
+   * Most requests in flight
+   */
+  std::uint32_t depth_ = 0;
+
+  /**
+   * Protects the submission queue, in_flight_ and stopping_
+   */
+  std::mutex latch_;
+  std::condition_variable space_;
+  std::uint32_t in_flight_ = 0;
+  bool stopping_ = false;
+
+  std::thread completer_;
+};
+
+}  // namespace badgerdb
@@ -0,0 +1,102 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#include "victim_cache.h"
+
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include "lz_codec.h"
+#include "page.h"
+
+namespace badgerdb {
+
+const std::size_t VictimCache::ENTRY_OVERHEAD;
+
+VictimCache::VictimCache(const std::size_t capacity)
+    : capacity_(capacity), used_(0) {}
+
+std::string VictimCache::compress(const char *page) {
+  char compressed[Page::SIZE];
+  const std::size_t length =
+      lzCompress(page, Page::SIZE, compressed, Page::SIZE - 1);
+  return length > 0 ? std::string(compressed, length)
+                    : std::string(page, Page::SIZE);
+}
+
+void VictimCache::insert(const FileId file, const PageId page_number,
+                         std::string bytes) {
+  const std::size_t size = bytes.size() + ENTRY_OVERHEAD;
+  std::lock_guard<std::mutex> latch(latch_);
+  // an older copy goes even if this one does not fit, as it is stale now
+  const auto found = index_.find(keyOf(file, page_number));
+  if (found != index_.end()) erase(found->second);
+  if (size > capacity_) return;
+
+  while (used_ + size > capacity_) erase(std::prev(entries_.end()));
+
+  entries_.push_front(Entry{file, page_number, std::move(bytes)});
+  index_[keyOf(file, page_number)] = entries_.begin();
+  used_ += size;
+}
+
+bool VictimCache::take(const FileId file, const PageId page_number,
+                       char *page) {
+  std::string bytes;
+  {
+    std::lock_guard<std::mutex> latch(latch_);
+    const auto found = index_.find(keyOf(file, page_number));
+    if (found == index_.end()) return false;
+    const EntryList::iterator entry = found->second;
+    used_ -= ENTRY_OVERHEAD + entry->bytes.size();
+    bytes.swap(entry->bytes);
+    index_.erase(found);
+    entries_.erase(entry);
+  }
+  if (bytes.size() == Page::SIZE) {
+    std::memcpy(page, bytes.data(), Page::SIZE);
+    return true;
+  }
+  // the entry is gone either way; a page that does not decompress is read
+  // from its file instead
+  return lzDecompress(bytes.data(), bytes.size(), page, Page::SIZE);
+}
+
+void VictimCache::drop(const FileId file, const PageId page_number) {
+  std::lock_guard<std::mutex> latch(latch_);
+  const auto found = index_.find(keyOf(file, page_number));
+  if (found != index_.end()) erase(found->second);
+}
+
+void VictimCache::dropFile(const FileId file) {
+  std::lock_guard<std::mutex> latch(latch_);
+  for (auto entry = entries_.begin(); entry != entries_.end();) {
+    const auto next = std::next(entry);
+    if (entry->file == file) erase(entry);
+    entry = next;
+  }
+}
+
+void VictimCache::erase(const EntryList::iterator entry) {
+  used_ -= ENTRY_OVERHEAD + entry->bytes.size();
+  index_.erase(keyOf(entry->file, entry->page_number));
+  entries_.erase(entry);
+}
+
+std::size_t VictimCache::pages() const {
+  std::lock_guard<std::mutex> latch(latch_);
+  return entries_.size();
+}
+
+std::size_t VictimCache::bytes() const {
+  std::lock_guard<std::mutex> latch(latch_);
+  return used_;
+}
+
+}  // namespace badgerdb
@@ -0,0 +1,192 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University
+ * of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Configuration of the victim cache behind the buffer pool, see
+ * VictimCache.
+ */
+struct VictimCacheConfig {
+  /**
+   * Most memory the cache takes, in bytes; 0 turns it off.
+   */
+  std::size_t bytes = 0;
+};
+
+/**
+ * @brief Second tier behind the buffer pool holding pages it evicted,
+ * compressed, so a page asked for again soon is decompressed instead of read.
+ *
+ * Pages of text records compress several times over, so a few frames' worth
+ * of memory here holds many pages, which extends the pool cheaply for data
+ * sets slightly bigger than it.  BufMgr puts every page it evicts to make
+ * room in, after writing it back if it was dirty, so a page here always
+ * matches its file.  A page is taken out again when it is read back into the
+ * pool: it is never in both, and the memory goes to the next victim.  The
+ * least recently put pages go first when the cache is full.
+ *
+ * Pages are known by file ID and page number, so the pages of a closed file
+ * are never found again; BufMgr drops them in flushFile().
+ */
+class VictimCache {
+ public:
+  /**
+   * Creates an empty cache.
+   *
+   * @param capacity  Most bytes the cache takes, pages and bookkeeping.
+   */
+  explicit VictimCache(const std::size_t capacity);
+
+  VictimCache(const VictimCache &) = delete;
+  VictimCache &operator=(const VictimCache &) = delete;
+
+  /**
+   * Puts an evicted page in the cache, in place of an older copy, making
+   * room for it if need be.  Compression happens before the cache is
+   * latched.
+   *
+   * @param file         ID of the page's file
+   * @param page_number  Number of the page in the file
+   * @param page         Page::SIZE bytes of the page
+   */
+  void put(const FileId file, const PageId page_number, const char *page) {
+    insert(file, page_number, compress(page));
+  }
+
+  /**
+   * Returns a page as the cache stores it, so a caller holding other latches
+   * can compress before taking them and insert() after.
+   *
+   * @param page  Page::SIZE bytes of the page
+   * @return  The page compressed, or its bytes as they are if that did not
+   *          make them smaller
+   */
+  static std::string compress(const char *page);
+
+  /**
+   * Puts a page returned by compress() in the cache, in place of an older
+   * copy, making room for it if need be.  The older copy is dropped even if
+   * the page is too big for the cache.
+   *
+   * @param file         ID of the page's file
+   * @param page_number  Number of the page in the file
+   * @param bytes        What compress() returned for the page
+   */
+  void insert(const FileId file, const PageId page_number,
+              std::string bytes);
+
+  /**
+   * Takes a page out of the cache into a frame.
+   *
+   * @param file         ID of the page's file
+   * @param page_number  Number of the page in the file
+   * @param page         Where the Page::SIZE bytes of the page go
+   * @return  Whether the page was in the cache and decompressed; if it was
+   *          there but did not decompress, it is dropped and <page> may have
+   *          been written to
+   */
+  bool take(const FileId file, const PageId page_number, char *page);
+
+  /**
+   * Forgets a page, if the cache has it, as it was deleted from its file.
+   *
+   * @param file         ID of the page's file
+   * @param page_number  Number of the page in the file
+   */
+  void drop(const FileId file, const PageId page_number);
+
+  /**
+   * Forgets every page of a file.
+   *
+   * @param file  ID of the file
+   */
+  void dropFile(const FileId file);
+
+  /**
+   * Returns the number of pages in the cache.
+   */
+  std::size_t pages() const;
+
+  /**
+   * Returns the number of bytes the cache takes.
+   */
+  std::size_t bytes() const;
+
+  /**
+   * Bytes counted for a page besides its compressed bytes.
+   */
+  static const std::size_t ENTRY_OVERHEAD = 64;
+
+ private:
+  /**
+   * A page and what it is stored as.
+   */
+  struct Entry {
+    FileId file;
+    PageId page_number;
+
+    /**
+     * Page compressed with lzCompress(), or Page::SIZE bytes as they are if
+     * it did not get smaller.
+     */
+    std::string bytes;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  /**
+   * Returns the key of a page in index_.
+   */
+  static std::uint64_t keyOf(const FileId file, const PageId page_number) {
+    return static_cast<std::uint64_t>(file) << 32 | page_number;
+  }
+
+  /**
+   * Takes an entry out of the cache; the latch must be held.
+   */
+  void erase(EntryList::iterator entry);
+
+  /**
+   * Most bytes the cache takes
+   */
+  const std::size_t capacity_;
+
+  /**
+   * Guards everything below
+   */
+  mutable std::mutex latch_;
+
+  /**
+   * Pages, the one put last first
+   */
+  EntryList entries_;
+
+  /**
+   * Where each page is in entries_, by keyOf()
+   */
+  std::unordered_map<std::uint64_t, EntryList::iterator> index_;
+
+  /**
+   * Bytes the entries take, counted as their size plus ENTRY_OVERHEAD
+   */
+  std::size_t used_;
+};
+
+}  // namespace badgerdb